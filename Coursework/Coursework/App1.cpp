@@ -38,17 +38,22 @@ void App1::init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeigh
 	//! render ortho mesh initialisation
 	orthoMesh_ = new OrthoMesh(renderer->getDevice(), renderer->getDeviceContext(), screenWidth, screenHeight, 0, 0);
 
+	//! the quadtree bounds, the surface bake and the water trimming need the heights on the CPU
+	Heightfield heightfield;
+	heightfield.load(L"res/landscape.png");
+
 	//! landcape intitialisation
-	initLandscape();
+	initLandscape(heightfield);
+	initStreamedTerrain();
 
 	//! River / water
-	initWater();
+	initWater(heightfield);
 
 	//! scene objects
-	sceneObjects_.push_back(new Object(new SphereMesh(renderer->getDevice(), renderer->getDeviceContext()), defaultShader_, simpleShader_, NULL , NULL, materialLib_->getMaterial("Test")));
+	sceneObjects_.push_back(new Object(materialLib_->getGeometry().acquireSphere(renderer->getDevice(), renderer->getDeviceContext()), defaultShader_, simpleShader_, NULL , NULL, materialLib_->getMaterial("Test")));
 	sceneObjects_.back()->setObjectTransform({ 2,0,0 });
 	
-	sceneObjects_.push_back(new Object(new CubeMesh(renderer->getDevice(), renderer->getDeviceContext()), defaultShader_, simpleShader_, NULL, NULL, materialLib_->getMaterial("Test")));
+	sceneObjects_.push_back(new Object(materialLib_->getGeometry().acquireCube(renderer->getDevice(), renderer->getDeviceContext()), defaultShader_, simpleShader_, NULL, NULL, materialLib_->getMaterial("Test")));
 	sceneObjects_.back()->setObjectTransform({ -2,0,0 });
 
 	//! wind models
@@ -58,16 +63,22 @@ void App1::init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeigh
 	sceneObjects_.push_back(new Object(materialLib_->getMesh("Tree"), windShader_, NULL, textureMgr->getTexture(L"tree3D"), NULL, materialLib_->getMaterial("Base"), D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST));
 	sceneObjects_.back()->setObjectTransform({ 59.72,14.7,67.63 }, { 0,15,0 }, {20,20,20});
 	sceneObjects_.back()->setAdditionalShaderData(windParams);
+	//! the wind moves vertices by up to half the intensity on every axis, leaves are open so no cone culling
+	sceneObjects_.back()->setClusterCulling(true, false, windParams->windBuffer.intensity * 0.87f);
 
 	sceneObjects_.push_back(new Object(materialLib_->getMesh("Tree"), windShader_, NULL, textureMgr->getTexture(L"tree3D"), NULL, materialLib_->getMaterial("Base"), D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST));
 	sceneObjects_.back()->setObjectTransform({ 0,0,0 }, { 0,0,0 }, { 20,20,20 });
 	sceneObjects_.back()->setAdditionalShaderData(windParams,false);
+	sceneObjects_.back()->setClusterCulling(true, false, windParams->windBuffer.intensity * 0.87f);
 
 	sceneObjects_.push_back(new Object(materialLib_->getMesh("Cottage"), defaultShader_, simpleShader_, textureMgr->getTexture(L"cottageD"), textureMgr->getTexture(L"CottageN"), materialLib_->getMaterial("Base")));
 	sceneObjects_.back()->setObjectTransform({ 11.95,-2.1f, 66.68 }, { 0,0,0 }, { 0.2,0.2,0.2 });
+	//! closed mesh, clusters facing away are never seen
+	sceneObjects_.back()->setClusterCulling(true, true);
 	
 	sceneObjects_.push_back(new Object(materialLib_->getMesh("Cottage"), defaultShader_, simpleShader_, textureMgr->getTexture(L"cottageD"), textureMgr->getTexture(L"CottageN"), materialLib_->getMaterial("Base")));
 	sceneObjects_.back()->setObjectTransform({ 53.42, -0.6f, 34.97 }, { 0,90,0 }, { 0.2,0.2,0.2 });
+	sceneObjects_.back()->setClusterCulling(true, true);
 	
 	//! foliage / trees
 	initFoliage();
@@ -78,6 +89,10 @@ void App1::init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeigh
 
 App1::~App1()
 {
+	//! finishes its loads first, which still use the texture manager and the device
+	if (materialLib_)
+		delete materialLib_;
+
 	// Run base application deconstructor
 	BaseApplication::~BaseApplication();
 
@@ -106,14 +121,26 @@ App1::~App1()
 	if (simpleShader_)
 		delete simpleShader_;
 
-	if (materialLib_)
-		delete materialLib_;
+	if (waterQuery_)
+		waterQuery_->Release();
+
+	if (waterMesh_)
+		delete waterMesh_;
+
+	//! waits for its loader threads
+	if (streamedTerrain_)
+		delete streamedTerrain_;
 }
 
 bool App1::frame()
 {
 	float deltaTime = timer->getFPS() != 0 ? 1.f/timer->getFPS() : 0.f;
 
+	// ASSET LOADING //
+
+	//! uploads textures and creates model buffers finished by the loading threads
+	materialLib_->update();
+
 	// CAMERA UPADTAE //
 
 	//! Generate the view matrix based on the camera's position.s
@@ -132,12 +159,63 @@ bool App1::frame()
 	XMFLOAT2 newUV = UVPanner(waterData->pixelBuffer.uvOffset2, XMFLOAT2(P_waterTextureSpeed * deltaTime, 0.f));
 	waterData->pixelBuffer.uvOffset2 = newUV;
 
+	//! the trimmed mesh is rebuilt only when the level changed
+	XMFLOAT3 waterPosition = water_->getPosition();
+	water_->setObjectTransform({ waterPosition.x, P_waterLevel, waterPosition.z });
+	waterMesh_->setLevel(renderer->getDevice(), P_waterLevel - landscape_->getPosition().y);
+	water_->setMesh(P_fullWaterPlane ? static_cast<BaseMesh*>(waterPlane_) : waterMesh_);
+
+	//! statistics of an earlier frame, never waited for
+	D3D11_QUERY_DATA_PIPELINE_STATISTICS waterStats;
+	if (waterQueryPending_ && renderer->getDeviceContext()->GetData(waterQuery_, &waterStats, sizeof(waterStats), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+	{
+		waterStats_ = waterStats;
+		waterQueryPending_ = false;
+	}
+
+	// TERRAIN STREAMING //
+
+	//! the streamed tiles replace the landscape in the scene, the water and foliage stay where they are
+	Object* shownTerrain = P_streamedTerrain ? static_cast<Object*>(streamedTerrain_) : landscape_;
+	for (auto& object : sceneObjects_)
+	{
+		if (object == landscape_ || object == streamedTerrain_)
+			object = shownTerrain;
+	}
+
+	//! requests and uploads tiles around the camera, the loading runs on threads of its own
+	if (P_streamedTerrain)
+		streamedTerrain_->update(renderer->getDeviceContext(), camera->getPosition());
+
 	// FOLIAGE UPDATE //
 
-	//! foliage alpha blending order, max 5000 units (can be increased with multiple dispatches)
-	auto* mesh = static_cast<BetterPointMesh*>(foliage_->getMesh());
-	gpuOrderShader_->Compute(renderer, mesh->getVerticesVector(), camera->getPosition());
-	mesh->initBuffers(renderer->getDevice());
+	//! foliage alpha blending order, far to near, sorted on the GPU into the index buffer the foliage is drawn with
+	//! or on a worker thread starting from the last order, a sort started this frame is drawn from the next one
+	auto* foliageMesh = static_cast<BetterPointMesh*>(foliage_->getMesh());
+	if (P_cpuFoliageSort)
+	{
+		//! the sorter keeps a copy of the points, appended ones need a new copy and their commit dropped the old order
+		if (foliageSorter_.getPointCount() != (unsigned int)foliageMesh->getVertexCount())
+		{
+			foliageSorter_.setPoints(foliageMesh->getVerticesVector()->data(), sizeof(BaseMesh::VertexType), foliageMesh->getVertexCount());
+			cpuOrderShown_ = false;
+		}
+
+		//! the order published when the CPU sort last ran can be far out of date, switching to it sorts at once
+		if (!cpuOrderShown_)
+		{
+			foliageSorter_.sortNow(camera->getPosition());
+			foliageMesh->setDrawOrder(renderer->getDevice(), foliageSorter_.getOrder());
+			cpuOrderShown_ = true;
+		}
+		else if (foliageSorter_.update(camera->getPosition()))
+			foliageMesh->setDrawOrder(renderer->getDevice(), foliageSorter_.getOrder());
+	}
+	else
+	{
+		gpuOrderShader_->sortMesh(renderer, foliageMesh, camera->getPosition());
+		cpuOrderShown_ = false;
+	}
 
 	// WIND UPDATE //
 
@@ -180,10 +258,22 @@ bool App1::renderGeometry()
 	XMMATRIX viewMatrix = camera->getViewMatrix();
 	XMMATRIX projectionMatrix = renderer->getProjectionMatrix();
 
-	//! render all the scene objects for the final pass
+	//! render all the scene objects for the final pass, the water draw is measured while no earlier measurement is outstanding
 	for (auto it : sceneObjects_)
+	{
+		bool measure = it == water_ && waterQuery_ && !waterQueryPending_;
+		if (measure)
+			renderer->getDeviceContext()->Begin(waterQuery_);
+
 		it->render(renderer, viewMatrix, projectionMatrix, &shadowMaps_, &lights_, &lightTypes_, camera->getPosition());
 
+		if (measure)
+		{
+			renderer->getDeviceContext()->End(waterQuery_);
+			waterQueryPending_ = true;
+		}
+	}
+
 	//! Reset the render target back to the original back buffer and not the render to texture anymore.
 	renderer->setBackBufferRenderTarget();
 
@@ -308,11 +398,48 @@ void App1::gui()
 	ImGui::InputFloat2("Layer 2 - scaling", &waterData->pixelBuffer.uvScaling2.x, 2);
 	ImGui::InputFloat("Amplitude", &waterData->vertexBuffer.waveAltitude, 0.01, 0.01);
 	ImGui::InputFloat("Frequency", &waterData->vertexBuffer.waveFrequency, 0.01, 0.01);
+	ImGui::InputFloat("Level", &P_waterLevel, 0.1, 0.1);
+	ImGui::Checkbox("Full water plane", &P_fullWaterPlane);
+	ImGui::Text("Water mesh: %d of %d quads, %d vertices (plane %d)", waterMesh_->getQuadCount(), waterMesh_->getFullQuadCount(), waterMesh_->getVertexCount(), waterPlane_->getVertexCount());
+	ImGui::Text("Water draw: %llu vertices shaded, %llu triangles rasterised, %llu pixels shaded", waterStats_.VSInvocations, waterStats_.CPrimitives, waterStats_.PSInvocations);
 	ImGui::Text("-Landscape");
 	ImGui::InputFloat("Bottom Y", &landscapeData->bot_mid_range.first, 0.01, 0.01);
 	ImGui::InputFloat("Middle Y1", &landscapeData->bot_mid_range.second, 0.01, 0.01);
 	ImGui::InputFloat("Bottom Y2", &landscapeData->mid_top_range.first, 0.01, 0.01);
 	ImGui::InputFloat("Top Y", &landscapeData->mid_top_range.second, 0.01, 0.01);
+	ImGui::Text("Terrain nodes: %d drawn, %d culled, %d triangles", landscape_->getSelectionStats().selected, landscape_->getSelectionStats().culled, landscape_->getSelectionStats().triangles);
+	ImGui::Text("Terrain surface: %.1f ms (%s)", landscape_->getSurfaceBakeMs(), landscape_->isSurfaceFromCache() ? "cached" : "baked");
+	ImGui::Text("Terrain occlusion: %.1f ms (%s)", landscape_->getOcclusionBakeMs(), landscape_->isOcclusionFromCache() ? "cached" : "baked");
+	ImGui::InputFloat("Occlusion strength", &landscapeData->occlusionStrength, 0.1, 0.1);
+	ImGui::Checkbox("Streamed terrain", &P_streamedTerrain);
+	if (P_streamedTerrain)
+	{
+		const TerrainStreamer::Stats& streaming = streamedTerrain_->getStreamer().getStats();
+		ImGui::Text("Tiles: %d resident, %d cached (%.1f MB), %d missing, %d free slots", streaming.resident, streaming.cached, streaming.cpuBytes / (1024.f * 1024.f), streaming.missing, streaming.freeSlots);
+		ImGui::Text("Loader queue: %d (max %d), %d generated in %.2f ms each, %d evicted, %d cancelled", streaming.queued, streaming.maxQueued, streaming.generated, streaming.generateMs, streaming.evicted, streaming.cancelled);
+		ImGui::Text("Time to resident: %.1f ms, avg %.1f ms, max %.1f ms", streaming.timeToResidentMs, streaming.averageTimeToResidentMs, streaming.maxTimeToResidentMs);
+		ImGui::Text("Stream update: %.3f ms, max %.3f ms, %d nodes drawn", streaming.updateMs, streaming.maxUpdateMs, streamedTerrain_->getSelectionStats().selected);
+	}
+
+	//! CPU terrain queries in landscape object space, the landscape is only translated
+	const HeightfieldQuery& heightQuery = landscape_->getHeightQuery();
+	XMFLOAT3 landscapePosition = landscape_->getPosition();
+	XMFLOAT3 eye = camera->getPosition();
+	XMFLOAT3 objectEye(eye.x - landscapePosition.x, eye.y - landscapePosition.y, eye.z - landscapePosition.z);
+	XMFLOAT3 forward;
+	XMStoreFloat3(&forward, XMMatrixInverse(nullptr, camera->getViewMatrix()).r[2]);
+	HeightfieldQuery::Hit viewHit;
+	bool viewHitFound = heightQuery.raycast(objectEye, forward, 500.f, viewHit);
+	ImGui::Text("Ground under camera: %.2f, view ray %s %.1f units (%d patches tested)", heightQuery.getHeight(objectEye.x, objectEye.z) + landscapePosition.y,
+		viewHitFound ? "hits at" : "misses within", viewHitFound ? viewHit.distance : 500.f, viewHit.patchesTested);
+	ImGui::Text("-Foliage");
+	ImGui::Checkbox("Sort on the CPU", &P_cpuFoliageSort);
+	if (P_cpuFoliageSort)
+	{
+		const CPUDepthSort::Stats& sorting = foliageSorter_.getStats();
+		ImGui::Text("Foliage sort: %.3f ms on the worker (%s, %u descents, %u moves), %d sorts, %d skipped", sorting.sortMs, sorting.insertion ? "insertion" : "radix",
+			sorting.descents, sorting.moves, sorting.sorts, sorting.skipped);
+	}
 	ImGui::Text("-Wind");
 	ImGui::InputFloat("Speed", &P_windSpeed, 0.01, 0.01);
 	ImGui::Text("-Directional Light");
@@ -322,6 +449,48 @@ void App1::gui()
 	ImGui::InputFloat3("Direction", &P_L_dirDir.x, 2);
 	ImGui::Text("-Background");
 	ImGui::InputFloat4("Colour BG", &P_bgColour.x, 2);
+	ImGui::Text("-Levels of detail");
+	for (const char* key : { "Tree", "Cottage" })
+	{
+		//! thresholds are the largest projected bounds, as a share of the screen height, drawing the level
+		Model* model = materialLib_->getMesh(key);
+		for (int i = 0; i < model->getLodCount(); i++)
+		{
+			BaseMesh::LevelOfDetail lod = model->getLod(i);
+			if (i == 0)
+				ImGui::Text("%s LOD 0: %d triangles", key, lod.indexCount / 3);
+			else
+				ImGui::Text("%s LOD %d: %d triangles, error %.4f, below %.1f%% of the screen (shadows %.1f%%)", key, i, lod.indexCount / 3, lod.error,
+					model->getLodScreenSize(i, k_LodScreenError) * 100.f, model->getLodScreenSize(i, k_LodScreenError * k_ShadowLodBias) * 100.f);
+		}
+	}
+	ImGui::Text("-Cluster culling");
+	{
+		//! totals of the camera pass, it renders after the shadow maps
+		Meshlets::CullStats total;
+		for (auto* object : sceneObjects_)
+		{
+			const Meshlets::CullStats& stats = object->getCullStats();
+			total.visible += stats.visible;
+			total.frustumCulled += stats.frustumCulled;
+			total.coneCulled += stats.coneCulled;
+			total.ranges += stats.ranges;
+		}
+		ImGui::Text("Meshlets drawn %d in %d draws, outside the view %d, facing away %d", total.visible, total.ranges, total.frustumCulled, total.coneCulled);
+	}
+	ImGui::Text("-Benchmarks");
+	ImGui::Text("Startup asset loading: %.2f ms blocking, first frame at %.2f ms", materialLib_->getConstructorMs(), materialLib_->getFirstUpdateMs());
+	if (materialLib_->getAllLoadedMs() < 0.f)
+		ImGui::Text("Assets still loading");
+	else
+		ImGui::Text("All assets at %.2f ms, slowest model %.2f ms (%s)", materialLib_->getAllLoadedMs(), materialLib_->getSlowestModelMs(), materialLib_->areModelsFromCache() ? "warm, baked cache" : "cold");
+	for (const std::string& key : materialLib_->getFailedModels())
+		ImGui::Text("Model %s failed to load", key.c_str());
+	{
+		GeometryRegistry::Stats geometry = materialLib_->getGeometry().getStats();
+		ImGui::Text("Shared geometry: %d meshes %.1f KB, %d hits, %d misses, %.1f KB saved", geometry.liveMeshes, geometry.liveBytes / 1024.f, geometry.hits, geometry.misses, geometry.bytesSaved / 1024.f);
+	}
+	benchmarks_.gui(renderer->getDevice());
 	
 	//! Render UI
 	ImGui::Render();
@@ -350,61 +519,76 @@ void App1::initFoliage()
 	sceneObjects_.push_back(new Object(new BetterPointMesh(renderer->getDevice(), renderer->getDeviceContext()), foliageShader_, simpleShader_, textureMgr->getTexture(L"tree"), NULL, materialLib_->getMaterial("Foliage"), D3D_PRIMITIVE_TOPOLOGY_POINTLIST));
 	sceneObjects_.back()->setAdditionalShaderData(foliageParams);
 
-	//! setting up foliage compute params
+	//! blue noise over the brush map, read from the file rather than the texture so nothing waits on the GPU
+	//! the heights are taken from the surface the landscape is drawn with
+	Heightfield brush;
+	brush.load(L"res/foliage_brush.png");
+	std::vector<XMFLOAT3> foliagePoints;
+	PoissonScatter::scatter(FoliageShader::scatterSettings(), brush, &landscape_->getHeightQuery(), foliagePoints);
+
+	std::vector<BaseMesh::VertexType> foliageVertices(foliagePoints.size());
+	for (size_t i = 0; i < foliagePoints.size(); i++)
+		foliageVertices[i] = { foliagePoints[i], XMFLOAT2(0,0), XMFLOAT3(0,0,-1) };
+
+	//! all the points go to the GPU in one upload
+	auto* foliageMesh = static_cast<BetterPointMesh*>(sceneObjects_.back()->getMesh());
+	foliageMesh->reserve((int)foliageVertices.size());
+	foliageMesh->appendVertices(foliageVertices.data(), (int)foliageVertices.size(), { -5, -5 + 0.5 , -10 });
+	foliageMesh->commit(renderer->getDevice());
+	//! the sorter keeps its own copy, the position is the first member of a vertex
+	foliageSorter_.setPoints(foliageMesh->getVerticesVector()->data(), sizeof(BaseMesh::VertexType), foliageMesh->getVertexCount());
+
+	//! store for later use
+	foliage_ = sceneObjects_.back();
+
+	//! the benchmark compares the scatter with the compute it replaced
 	FoliageShader::ComputeParams params;
 	params.additionalParams.filingPercentage_GPU = 0.00005f;
 	params.additionalParams.landscapeScalng = XMFLOAT3(100.f, 1, 100.f);
+	params.additionalParams.maxHeight = TerrainObject::landscapeSettings().maxHeight;
 	params.brushMap = textureMgr->getTexture(L"foliageBrush");
 	params.heightMap = textureMgr->getTexture(L"landscapeH");
-
-	//! generates the points where each piece is based on the brush map
-	foliageShader_->Compute(renderer, &params);
-
-	//! copy the results into a separate buffer
-	ID3D11Buffer* computeResult = CreateAndCopyToDebugBuf(renderer->getDevice(), renderer->getDeviceContext(), foliageShader_->_vertexComputeBuffer);
-	auto* computeData = MapBufferToPointer<FoliageShader::VertexComputeBufferType[TEX_HEIGHT * TEX_WIDTH]>(renderer->getDeviceContext(), computeResult, D3D11_MAP_READ);
-	int debugCount = 0;
-
-	//! determine which points to actually write, pseudo random
-	for (int i = 0; i < TEX_WIDTH * TEX_WIDTH; i++)
-	{
-		float r = (float)rand() / 1000.f;
-		r -= std::floor(r);
-		if ((*computeData)[i].position.y > -15000.f && r < fillingPercentage_CPU)
-		{
-			static_cast<BetterPointMesh*>(sceneObjects_.back()->getMesh())->addVertex(renderer->getDevice(), { (*computeData)[i].position, XMFLOAT2(0,0), XMFLOAT3(0,0,-1) }, { -5, -5 + 0.5 , -10 });
-			debugCount++;
-		}
-	}
-	renderer->getDeviceContext()->Unmap(computeResult, 0);
-	ReleaseBuffer(&computeResult);
-
-	//! store for later use
-	foliage_ = sceneObjects_.back();
+	benchmarks_.setFoliageScene(renderer, foliageShader_, params, &landscape_->getHeightQuery(), gpuOrderShader_);
 }
 
-void App1::initWater()
+void App1::initWater(const Heightfield& heightfield)
 {
 	//! responsibility for the heap struct is given to the object
 	WaterShader::WaterParams* waterP = new WaterShader::WaterParams;
 	waterP->pixelBuffer.uvScaling2 = XMFLOAT2(30.f, 30.f);
 	waterP->pixelBuffer.landscapeOriginPosition = sceneObjects_.back()->getPosition();
+	waterP->pixelBuffer.maxHeight = TerrainObject::landscapeSettings().maxHeight;
 	waterP->vertexBuffer.waveAltitude = .05f;
 	waterP->vertexBuffer.waveFrequency = 15;
 	waterP->bottomLayer = textureMgr->getTexture(L"waterBelow");
 	waterP->heightMap = textureMgr->getTexture(L"landscapeH");
 
-	sceneObjects_.push_back(new Object(new PlaneMesh(renderer->getDevice(), renderer->getDeviceContext(), 100), waterShader_, simpleShader_, textureMgr->getTexture(L"water"), textureMgr->getTexture(L"stone1N"), materialLib_->getMaterial("Water")));
+	//! only the quads above the terrain, the waves reach twice their altitude up and the rest of the margin covers the terrain morphing
+	WaterMesh::Settings waterSettings;
+	waterSettings.terrainOffset = { k_WaterPosition.x - landscape_->getPosition().x, k_WaterPosition.z - landscape_->getPosition().z };
+	waterSettings.uvPerUnit = k_LandscapeUvPerUnit;
+	waterSettings.heightScale = TerrainObject::landscapeSettings().maxHeight;
+	waterSettings.margin = waterP->vertexBuffer.waveAltitude * 2.f + 0.25f;
+	waterMesh_ = new WaterMesh(renderer->getDevice(), renderer->getDeviceContext(), heightfield, waterSettings, k_WaterPosition.y - landscape_->getPosition().y);
+	P_waterLevel = k_WaterPosition.y;
+
+	//! the full plane the water used to be, drawn instead for comparison
+	waterPlane_ = materialLib_->getGeometry().acquirePlane(renderer->getDevice(), renderer->getDeviceContext(), 100, true);
+
+	sceneObjects_.push_back(new Object(waterMesh_, waterShader_, simpleShader_, textureMgr->getTexture(L"water"), textureMgr->getTexture(L"stone1N"), materialLib_->getMaterial("Water")));
 	water_ = sceneObjects_.back();
-	water_->setObjectTransform({ -5, -3, -10 });
+	water_->setObjectTransform(k_WaterPosition);
 	water_->setAdditionalShaderData(waterP);
+
+	//! pipeline statistics of the water draw in the main pass
+	D3D11_QUERY_DESC queryDesc = { D3D11_QUERY_PIPELINE_STATISTICS, 0 };
+	renderer->getDevice()->CreateQuery(&queryDesc, &waterQuery_);
 }
 
-void App1::initLandscape()
+void App1::initLandscape(const Heightfield& heightfield)
 {
 	//! responsibility for the heap struct is given to the object
 	LandscapeShader::LandscapeParameters* landscapeP = new LandscapeShader::LandscapeParameters;
-	landscapeP->heightMap = textureMgr->getTexture(L"landscapeH");
 	landscapeP->bottomL = textureMgr->getTexture(L"grass");
 	landscapeP->middleL = textureMgr->getTexture(L"stone1");
 	landscapeP->topL = textureMgr->getTexture(L"stone2");
@@ -414,10 +598,27 @@ void App1::initLandscape()
 	landscapeP->bot_mid_range = { -3.0f, 1.0f };
 	landscapeP->mid_top_range = { 10.f, 20.f };
 
-	sceneObjects_.push_back(new Object(new PlaneMesh(renderer->getDevice(), renderer->getDeviceContext(), 100), landscapeShader_, NULL, textureMgr->getTexture(L"grass"), textureMgr->getTexture(L"landscapeN"), materialLib_->getMaterial("Land")));
-	sceneObjects_.back()->setAdditionalShaderData(landscapeP);
-	sceneObjects_.back()->setObjectTransform({ -5, -5, -10 });
-	landscape_ = sceneObjects_.back();
+	landscape_ = new TerrainObject(renderer->getDevice(), new TerrainGridMesh(renderer->getDevice(), renderer->getDeviceContext(), 16), landscapeShader_, TerrainObject::landscapeSettings(), heightfield,
+		k_LandscapeUvPerUnit, MeshCache::getCachePath("res/landscape.png", "surface").c_str(), MeshCache::getCachePath("res/landscape.png", "occlusion").c_str(), textureMgr->getTexture(L"grass"), textureMgr->getTexture(L"landscapeN"), materialLib_->getMaterial("Land"));
+	landscapeP->surfaceMap = landscape_->getSurfaceMap();
+	landscapeP->occlusionMap = landscape_->getOcclusionMap();
+	landscape_->setAdditionalShaderData(landscapeP);
+	landscape_->setObjectTransform({ -5, -5, -10 });
+	sceneObjects_.push_back(landscape_);
+}
+
+void App1::initStreamedTerrain()
+{
+	//! the layers of the landscape, blended by the weights baked with the tiles
+	LandscapeShader::LandscapeParameters* streamedP = new LandscapeShader::LandscapeParameters(*static_cast<LandscapeShader::LandscapeParameters*>(landscape_->getAdditionalShaderData()));
+	streamedP->surfaceMap = NULL;
+	streamedP->occlusionMap = NULL;
+	streamedP->splatWeights = true;
+
+	streamedTerrain_ = new StreamedTerrain(renderer->getDevice(), new TerrainGridMesh(renderer->getDevice(), renderer->getDeviceContext(), 16), landscapeShader_, StreamedTerrain::landscapeSettings(),
+		textureMgr->getTexture(L"grass"), textureMgr->getTexture(L"landscapeN"), materialLib_->getMaterial("Land"));
+	streamedTerrain_->setAdditionalShaderData(streamedP);
+	streamedTerrain_->setObjectTransform({ -5, -25, -10 });
 }
 
 void App1::initWind()
@@ -4,15 +4,19 @@
 
 // Includes
 #include "Object.h"
+#include "TerrainObject.h"
+#include "StreamedTerrain.h"
 #include "MaterialLibrary.h"
 #include "LandscapeShader.h"
 #include "FoliageShader.h"
 #include "WaterShader.h"
 #include "GPUOrderShader.h"
+#include "CPUDepthSort.h"
 #include "WindShader.h"
 #include "PPBlurShader.h"
 #include "PPDofShader.h"
 #include "SimpleShader.h"
+#include "Benchmarks.h"
 
 enum class LightType : int;
 
@@ -48,12 +52,11 @@ protected:
 private:
 	//! separate initialisers of different aspects
 	void initFoliage();
-	void initWater();
-	void initLandscape();
+	void initWater(const Heightfield& heightfield);
+	void initLandscape(const Heightfield& heightfield);
+	void initStreamedTerrain();
 	void initWind();
 
-	const float fillingPercentage_CPU = 0.5f;
-
 	XMFLOAT2 uvOffset = XMFLOAT2(0.f, 0.f);
 
 	std::vector<Object*> sceneObjects_;
@@ -78,16 +81,31 @@ private:
 	OrthoMesh* orthoMesh_;
 	XMFLOAT2 resolution_;
 
+	//! CPU benchmarks, run from the UI
+	Benchmarks benchmarks_;
+
 	//! deleted as a part of scene objects vector deletion
 	Object* water_ = NULL;
+	WaterMesh* waterMesh_ = NULL;		//! trimmed to the terrain, drawn by water_
+	PlaneMesh* waterPlane_ = NULL;		//! full plane of the same grid, held by the geometry registry
+	ID3D11Query* waterQuery_ = NULL;
+	bool waterQueryPending_ = false;
+	D3D11_QUERY_DATA_PIPELINE_STATISTICS waterStats_ = {};		//! water draw of the last finished measurement
 	Object* foliage_ = NULL;
-	Object* landscape_ = NULL;
+	CPUDepthSort foliageSorter_;		//! orders the foliage instead of the GPU sort while P_cpuFoliageSort is set
+	bool cpuOrderShown_ = false;		//! the foliage is drawn with the sorter's order
+	TerrainObject* landscape_ = NULL;
+	StreamedTerrain* streamedTerrain_ = NULL;	//! takes the place of the landscape in the scene objects while P_streamedTerrain is set
 	WindShader::WindAddititonalParams* windParams = NULL;
 
 	//!settable params
 	bool P_renderDof = false;
 	float P_waterWavesSpeed = 5.f;
 	float P_waterTextureSpeed = 0.005;
+	float P_waterLevel = 0.f;
+	bool P_fullWaterPlane = false;
+	bool P_streamedTerrain = false;
+	bool P_cpuFoliageSort = false;
 	float P_windSpeed = 0.2f;
 	XMFLOAT3 P_L_dirPos = { 50.f,20.f,100.f };
 	XMFLOAT3 P_L_dirDir = { 0.f,-1.f,-1.f };
@@ -0,0 +1,1622 @@
+#include "Benchmarks.h"
+#include "ObjLoader.h"
+#include "TokenStream.h"
+#include "TokenScanner.h"
+#include "TerrainObject.h"
+#include "StreamedTerrain.h"
+#include "BetterPointMesh.h"
+#include "CPUDepthSort.h"
+#include "ShaderUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <thread>
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+
+namespace
+{
+	//! models shipped with the scene
+	const char* k_BenchmarkModels[] = { "res/models/cottage.obj", "res/models/tree.obj" };
+
+	//! seconds elapsed since start
+	float secondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//! milliseconds elapsed since start
+	float millisecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	class AllocationCounter;
+	//! counter of the calling thread between start and stop, the hook ignores every other thread
+	thread_local AllocationCounter* t_counter = nullptr;
+
+	//! heap allocations made on the calling thread between start and stop, seen through the debug CRT allocation hook
+	//! the hook is only installed while counting, the allocator of the application is left alone
+	//! release builds have no hook, nothing is counted and isAvailable is false
+	class AllocationCounter
+	{
+	public:
+		static bool isAvailable()
+		{
+#ifdef _DEBUG
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		void start()
+		{
+			allocations = 0;
+			liveBytes = 0;
+			peakBytes = 0;
+			firstRequest_ = LONG_MAX;
+			t_counter = this;
+#ifdef _DEBUG
+			previousHook_ = _CrtSetAllocHook(hook);
+#endif
+		}
+
+		void stop()
+		{
+#ifdef _DEBUG
+			_CrtSetAllocHook(previousHook_);
+#endif
+			t_counter = nullptr;
+		}
+
+		int allocations = 0;
+		long long liveBytes = 0;		//! bytes of the counted blocks not freed yet
+		long long peakBytes = 0;
+
+	private:
+#ifdef _DEBUG
+		//! allocations and reallocations add their size, frees and reallocations take back blocks allocated since start
+		//! CRT blocks are the runtime's own and are not counted
+		static int __cdecl hook(int allocType, void* userData, size_t size, int blockUse, long request, const unsigned char* file, int line)
+		{
+			AllocationCounter* counter = t_counter;
+			if (counter && blockUse != _CRT_BLOCK)
+			{
+				if (allocType != _HOOK_ALLOC && userData)
+				{
+					long blockRequest = 0;
+					size_t blockSize = _msize_dbg(userData, blockUse);
+					if (_CrtIsMemoryBlock(userData, (unsigned int)blockSize, &blockRequest, nullptr, nullptr) && blockRequest >= counter->firstRequest_)
+						counter->liveBytes -= blockSize;
+				}
+				if (allocType != _HOOK_FREE)
+				{
+					counter->allocations++;
+					counter->liveBytes += size;
+					counter->peakBytes = counter->liveBytes > counter->peakBytes ? counter->liveBytes : counter->peakBytes;
+					counter->firstRequest_ = request < counter->firstRequest_ ? request : counter->firstRequest_;
+				}
+			}
+			return previousHook_ ? previousHook_(allocType, userData, size, blockUse, request, file, line) : TRUE;
+		}
+
+		static _CRT_ALLOC_HOOK previousHook_;
+#endif
+		long firstRequest_ = LONG_MAX;
+	};
+
+#ifdef _DEBUG
+	_CRT_ALLOC_HOOK AllocationCounter::previousHook_ = nullptr;
+#endif
+
+	//! landscape object space view of a scripted flythrough, circling the centre bobbing up and down and looking ahead along the path
+	//! the scene transform of the landscape and the camera projection
+	Meshlets::CullView landscapeFlythrough(int frame, int frames)
+	{
+		const XMMATRIX world = XMMatrixTranslation(-5.f, -5.f, -10.f);
+		const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.f / 9.f, SCREEN_NEAR, SCREEN_DEPTH);
+		const XMFLOAT3 centre(44.5f, 0.f, 39.5f);
+
+		float angle = XM_2PI * frame / frames;
+		XMVECTOR eye = XMVectorSet(centre.x + cosf(angle) * 35.f, 10.f + sinf(angle * 2.f) * 5.f, centre.z + sinf(angle) * 35.f, 1.f);
+		XMVECTOR target = XMVectorSet(centre.x + cosf(angle + 0.6f) * 35.f, 0.f, centre.z + sinf(angle + 0.6f) * 35.f, 1.f);
+		XMMATRIX view = XMMatrixLookAtLH(eye, target, XMVectorSet(0.f, 1.f, 0.f, 0.f));
+		return Meshlets::makeCullView(world, view, projection);
+	}
+
+	//! size of a file in bytes, 0 if missing
+	size_t fileSize(const char* filename)
+	{
+		std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
+		return file.good() ? (size_t)file.tellg() : 0;
+	}
+
+	//! previous cube and sphere generator for reference, one face and one vertex at a time, the sphere bent in a second pass
+	void referenceCubeFaces(VertexPacking::Vertex* vertices, unsigned long* indices, int resolution, bool sphere)
+	{
+		static const XMFLOAT3 faces[6][3] =
+		{
+			{ XMFLOAT3(-1.f, 1.f, -1.f), XMFLOAT3(1.f, 0.f, 0.f), XMFLOAT3(0.f, -1.f, 0.f) },
+			{ XMFLOAT3(1.f, 1.f, 1.f), XMFLOAT3(-1.f, 0.f, 0.f), XMFLOAT3(0.f, -1.f, 0.f) },
+			{ XMFLOAT3(1.f, 1.f, -1.f), XMFLOAT3(0.f, 0.f, 1.f), XMFLOAT3(0.f, -1.f, 0.f) },
+			{ XMFLOAT3(-1.f, 1.f, 1.f), XMFLOAT3(0.f, 0.f, -1.f), XMFLOAT3(0.f, -1.f, 0.f) },
+			{ XMFLOAT3(-1.f, 1.f, 1.f), XMFLOAT3(1.f, 0.f, 0.f), XMFLOAT3(0.f, 0.f, -1.f) },
+			{ XMFLOAT3(-1.f, -1.f, -1.f), XMFLOAT3(1.f, 0.f, 0.f), XMFLOAT3(0.f, 0.f, 1.f) },
+		};
+
+		int side = resolution + 1;
+		float increment = 1.0f / resolution;
+		int v = 0;
+		int count = 0;
+		for (int face = 0; face < 6; face++)
+		{
+			XMVECTOR origin = XMLoadFloat3(&faces[face][0]);
+			XMVECTOR uAxis = XMLoadFloat3(&faces[face][1]);
+			XMVECTOR vAxis = XMLoadFloat3(&faces[face][2]);
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, XMVector3Cross(uAxis, vAxis));
+
+			count += MeshUtils::buildGridIndices(indices + count, resolution, resolution, (unsigned long)v, false);
+			for (int y = 0; y < side; y++)
+			{
+				for (int x = 0; x < side; x++)
+				{
+					XMVECTOR position = XMVectorAdd(origin, XMVectorAdd(XMVectorScale(uAxis, x * 2.f * increment), XMVectorScale(vAxis, y * 2.f * increment)));
+					XMStoreFloat3(&vertices[v].position, position);
+					vertices[v].texture = XMFLOAT2(x * increment, y * increment);
+					vertices[v].normal = normal;
+					v++;
+				}
+			}
+		}
+
+		for (int i = 0; sphere && i < v; i++)
+		{
+			float x = vertices[i].position.x;
+			float y = vertices[i].position.y;
+			float z = vertices[i].position.z;
+			vertices[i].position.x = x * sqrtf(1.0f - (y*y / 2.0f) - (z*z / 2.0f) + (y*y*z*z / 3.0f));
+			vertices[i].position.y = y * sqrtf(1.0f - (z*z / 2.0f) - (x*x / 2.0f) + (z*z*x*x / 3.0f));
+			vertices[i].position.z = z * sqrtf(1.0f - (x*x / 2.0f) - (y*y / 2.0f) + (x*x*y*y / 3.0f));
+			vertices[i].normal = vertices[i].position;
+		}
+	}
+}
+
+void Benchmarks::runObjLoader(int iterations)
+{
+	objLoaderResults_.clear();
+
+	for (const char* filename : k_BenchmarkModels)
+	{
+		ObjLoaderResult result;
+		result.file = filename;
+		result.sizeMB = fileSize(filename) / (1024.f * 1024.f);
+
+		ObjLoader::ObjData data;
+
+		//! new loader, memory mapped and multithreaded
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+			ObjLoader::loadFile(filename, data);
+		float mappedTime = secondsSince(start);
+		result.triangles = (int)data.corners.size() / 3;
+
+		//! previous loader for reference
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+			ObjLoader::loadFileScanf(filename, data);
+		float scanfTime = secondsSince(start);
+
+		result.mappedMBps = mappedTime > 0.f ? result.sizeMB * iterations / mappedTime : 0.f;
+		result.scanfMBps = scanfTime > 0.f ? result.sizeMB * iterations / scanfTime : 0.f;
+		objLoaderResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runWelding(ID3D11Device* device)
+{
+	weldingResults_.clear();
+
+	for (const char* filename : k_BenchmarkModels)
+	{
+		WeldingResult result;
+		result.file = filename;
+
+		Model* model = new Model(device, nullptr, filename);
+		result.loader = "Model";
+		result.stats = model->getWeldStats();
+		weldingResults_.push_back(result);
+		delete model;
+
+		AModel* aModel = new AModel(device, filename);
+		result.loader = "AModel";
+		result.stats = aModel->getWeldStats();
+		weldingResults_.push_back(result);
+		delete aModel;
+	}
+}
+
+void Benchmarks::runMeshCache(ID3D11Device* device)
+{
+	meshCacheResults_.clear();
+
+	for (const char* filename : k_BenchmarkModels)
+	{
+		MeshCacheResult result;
+		result.file = filename;
+
+		//! Model
+		result.loader = "Model";
+		std::remove(MeshCache::getCachePath(filename, "model").c_str());
+		auto start = std::chrono::high_resolution_clock::now();
+		delete new Model(device, nullptr, filename);
+		result.coldMs = millisecondsSince(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		Model* model = new Model(device, nullptr, filename);
+		result.warmMs = millisecondsSince(start);
+		result.warmHit = model->isFromCache();
+		delete model;
+		meshCacheResults_.push_back(result);
+
+		//! AModel
+		result.loader = "AModel";
+		std::remove(MeshCache::getCachePath(filename, "amodel").c_str());
+		start = std::chrono::high_resolution_clock::now();
+		delete new AModel(device, filename);
+		result.coldMs = millisecondsSince(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		AModel* aModel = new AModel(device, filename);
+		result.warmMs = millisecondsSince(start);
+		result.warmHit = aModel->isFromCache();
+		delete aModel;
+		meshCacheResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runVertexCache(ID3D11Device* device)
+{
+	vertexCacheResults_.clear();
+
+	for (const char* filename : k_BenchmarkModels)
+	{
+		Model* model = new Model(device, nullptr, filename);
+		vertexCacheResults_.push_back({ std::string("Model ") + filename, model->getOptimiseStats() });
+		delete model;
+
+		AModel* aModel = new AModel(device, filename);
+		vertexCacheResults_.push_back({ std::string("AModel ") + filename, aModel->getOptimiseStats() });
+		delete aModel;
+	}
+
+	SphereMesh* sphere = new SphereMesh(device, nullptr);
+	vertexCacheResults_.push_back({ "SphereMesh", sphere->getOptimiseStats() });
+	delete sphere;
+
+	CubeMesh* cube = new CubeMesh(device, nullptr);
+	vertexCacheResults_.push_back({ "CubeMesh", cube->getOptimiseStats() });
+	delete cube;
+
+	PlaneMesh* plane = new PlaneMesh(device, nullptr);
+	vertexCacheResults_.push_back({ "PlaneMesh", plane->getOptimiseStats() });
+	delete plane;
+}
+
+void Benchmarks::runVertexPacking(ID3D11Device* device)
+{
+	vertexPackingResults_.clear();
+
+	for (const char* filename : k_BenchmarkModels)
+	{
+		ObjLoader::ObjData data;
+		if (!ObjLoader::loadFile(filename, data))
+			continue;
+
+		//! unroll the corners and weld them, the same vertices Model puts in its buffer
+		std::vector<VertexPacking::Vertex> vertices(data.corners.size());
+		for (size_t i = 0; i < data.corners.size(); i++)
+		{
+			const ObjLoader::Corner& corner = data.corners[i];
+			vertices[i].position = data.positions[corner.position];
+			vertices[i].texture = corner.texture >= 0 ? data.texCoords[corner.texture] : XMFLOAT2(0.f, 0.f);
+			vertices[i].normal = corner.normal >= 0 ? data.normals[corner.normal] : XMFLOAT3(0.f, 0.f, 0.f);
+		}
+		std::vector<unsigned long> remap;
+		MeshUtils::weldVertices(vertices, remap);
+
+		std::vector<VertexPacking::PackedVertex> packed(vertices.size());
+		VertexPacking::Quantisation quantisation = VertexPacking::computeQuantisation(vertices.data(), (int)vertices.size());
+		VertexPacking::packVertices(vertices.data(), (int)vertices.size(), quantisation, packed.data());
+
+		VertexPackingResult result;
+		result.mesh = filename;
+		result.vertices = (int)vertices.size();
+		result.fullKB = vertices.size() * sizeof(VertexPacking::Vertex) / 1024.f;
+		result.packedKB = packed.size() * sizeof(VertexPacking::PackedVertex) / 1024.f;
+		result.bounds = VertexPacking::getErrorBounds(quantisation, VertexPacking::getMaxTexture(vertices.data(), (int)vertices.size()));
+		result.measured = VertexPacking::measureError(vertices.data(), packed.data(), (int)packed.size(), quantisation);
+		vertexPackingResults_.push_back(result);
+	}
+
+	//! landscape and water plane, uvs stay below 1
+	PlaneMesh* plane = new PlaneMesh(device, nullptr, 100, true);
+	VertexPackingResult result;
+	result.mesh = "PlaneMesh 100";
+	result.vertices = plane->getVertexCount();
+	result.fullKB = result.vertices * sizeof(VertexPacking::Vertex) / 1024.f;
+	result.packedKB = result.vertices * sizeof(VertexPacking::PackedVertex) / 1024.f;
+	result.bounds = VertexPacking::getErrorBounds(plane->getQuantisation(), 1.f);
+	result.measured = plane->getPackingError();
+	vertexPackingResults_.push_back(result);
+	delete plane;
+}
+
+void Benchmarks::runMeshlets(int iterations, int views)
+{
+	meshletResults_.clear();
+
+	for (const char* filename : k_BenchmarkModels)
+	{
+		ObjLoader::ObjData data;
+		if (!ObjLoader::loadFile(filename, data))
+			continue;
+
+		//! the welded and optimised mesh Model builds its meshlets from
+		std::vector<VertexPacking::Vertex> vertices(data.corners.size());
+		for (size_t i = 0; i < data.corners.size(); i++)
+		{
+			const ObjLoader::Corner& corner = data.corners[i];
+			vertices[i].position = data.positions[corner.position];
+			vertices[i].texture = corner.texture >= 0 ? data.texCoords[corner.texture] : XMFLOAT2(0.f, 0.f);
+			vertices[i].normal = corner.normal >= 0 ? data.normals[corner.normal] : XMFLOAT3(0.f, 0.f, 0.f);
+		}
+		std::vector<unsigned long> indices;
+		MeshUtils::weldVertices(vertices, indices);
+		MeshUtils::optimiseMesh(vertices, indices);
+
+		//! build, every run from the same optimised order
+		std::vector<Meshlets::Meshlet> meshlets;
+		std::vector<unsigned long> clustered;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			clustered = indices;
+			meshlets.clear();
+			Meshlets::buildMeshlets(vertices.data(), (int)vertices.size(), sizeof(VertexPacking::Vertex), clustered.data(), 0, (int)clustered.size(), meshlets);
+		}
+
+		MeshletResult result;
+		result.mesh = filename;
+		result.buildMs = millisecondsSince(start) / iterations;
+		result.meshlets = (int)meshlets.size();
+		if (meshlets.empty())
+			continue;
+
+		XMVECTOR centre = XMVectorZero();
+		for (auto& meshlet : meshlets)
+		{
+			result.cones += meshlet.coneCutoff <= 1.f ? 1 : 0;
+			result.trianglesPerMeshlet += (float)meshlet.triangleCount / meshlets.size();
+			result.verticesPerMeshlet += (float)meshlet.vertexCount / meshlets.size();
+			centre = XMVectorAdd(centre, XMVectorScale(XMLoadFloat3(&meshlet.centre), 1.f / meshlets.size()));
+		}
+		float radius = 0.f;
+		for (auto& meshlet : meshlets)
+		{
+			float reach = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&meshlet.centre), centre))) + meshlet.radius;
+			radius = reach > radius ? reach : radius;
+		}
+
+		//! views circling the mesh at two heights and distances, aimed past the centre so the frustum cuts through the mesh
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.f / 9.f, 0.1f, 100.f * radius);
+		std::vector<Meshlets::IndexRange> ranges;
+		int frustumCulled = 0, coneCulled = 0, rangeCount = 0;
+		double trianglesDrawn = 0.0;
+		float cullMs = 0.f;
+		for (int v = 0; v < views; v++)
+		{
+			float angle = XM_2PI * v / views;
+			float distance = radius * ((v & 1) ? 1.2f : 2.5f);
+			float height = radius * ((v & 2) ? 0.8f : -0.3f);
+			XMVECTOR eye = XMVectorAdd(centre, XMVectorSet(cosf(angle) * distance, height, sinf(angle) * distance, 0.f));
+			XMVECTOR target = XMVectorAdd(centre, XMVectorSet(-sinf(angle) * radius, 0.f, cosf(angle) * radius, 0.f));
+			XMMATRIX view = XMMatrixLookAtLH(eye, target, XMVectorSet(0.f, 1.f, 0.f, 0.f));
+
+			start = std::chrono::high_resolution_clock::now();
+			Meshlets::CullView cullView = Meshlets::makeCullView(XMMatrixIdentity(), view, projection);
+			Meshlets::CullStats stats = Meshlets::cullMeshlets(meshlets.data(), (int)meshlets.size(), cullView, true, ranges);
+			cullMs += millisecondsSince(start);
+
+			frustumCulled += stats.frustumCulled;
+			coneCulled += stats.coneCulled;
+			rangeCount += stats.ranges;
+			for (auto& range : ranges)
+				trianglesDrawn += range.indexCount / 3;
+		}
+
+		float meshletViews = (float)meshlets.size() * views;
+		result.cullMicroseconds = cullMs * 1000.f / views;
+		result.frustumCulled = frustumCulled / meshletViews;
+		result.coneCulled = coneCulled / meshletViews;
+		result.trianglesDrawn = (float)(trianglesDrawn / ((double)clustered.size() / 3 * views));
+		result.ranges = (float)rangeCount / views;
+		meshletResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runTokenizer(int iterations)
+{
+	tokenizerResults_.clear();
+	char delimiters[] = " \t\r\n";
+
+	for (const char* filename : k_BenchmarkModels)
+	{
+		MappedFile file;
+		if (!file.open(filename))
+			continue;
+
+		TokenizerResult result;
+		result.file = filename;
+		result.sizeMB = file.getSize() / (1024.f * 1024.f);
+
+		//! TokenStream needs a null terminated copy, as the old loaders read it
+		std::vector<char> text(file.getData(), file.getData() + file.getSize());
+		text.push_back('\0');
+
+		//! previous class, a string per token and a copy of the file per stream
+		size_t streamBytes = 0;
+		int streamTokens = 0;
+		AllocationCounter counter;
+		counter.start();
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			TokenStream stream;
+			stream.SetTokenStream(text.data());
+			std::string token;
+			streamBytes = 0;
+			streamTokens = 0;
+			while (stream.GetNextToken(&token, delimiters, 4))
+			{
+				streamBytes += token.size();
+				streamTokens++;
+			}
+		}
+		float streamTime = secondsSince(start);
+		counter.stop();
+		int streamAllocations = counter.allocations;
+
+		//! zero copy scanner over the mapped view
+		size_t scannerBytes = 0;
+		int scannerTokens = 0;
+		counter.start();
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			TokenScanner scanner(file.getData(), file.getSize(), delimiters);
+			TokenScanner::View token;
+			scannerBytes = 0;
+			scannerTokens = 0;
+			while (scanner.nextToken(token))
+			{
+				scannerBytes += token.size;
+				scannerTokens++;
+			}
+		}
+		float scannerTime = secondsSince(start);
+		counter.stop();
+		int scannerAllocations = counter.allocations;
+
+		//! both see the same tokens
+		result.tokensMatch = scannerTokens == streamTokens && scannerBytes == streamBytes;
+
+		float totalMB = result.sizeMB * iterations;
+		result.tokens = scannerTokens;
+		result.streamMTokensPerSecond = streamTime > 0.f ? streamTokens * iterations / streamTime / 1e6f : 0.f;
+		result.scannerMTokensPerSecond = scannerTime > 0.f ? scannerTokens * iterations / scannerTime / 1e6f : 0.f;
+		result.streamAllocationsPerMB = totalMB > 0.f ? streamAllocations / totalMB : 0.f;
+		result.scannerAllocationsPerMB = totalMB > 0.f ? scannerAllocations / totalMB : 0.f;
+		tokenizerResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runAModelImport(ID3D11Device* device, int iterations)
+{
+	aModelImportResults_.clear();
+
+	for (const char* filename : k_BenchmarkModels)
+	{
+		AModelImportResult result;
+		result.file = filename;
+		std::string cacheFile = MeshCache::getCachePath(filename, "amodel");
+
+		//! cold imports only, the cache is deleted before every load
+		for (int arena = 0; arena < 2; arena++)
+		{
+			float totalMs = 0.f;
+			int allocations = 0;
+			long long peakBytes = 0;
+			for (int i = 0; i < iterations; i++)
+			{
+				std::remove(cacheFile.c_str());
+				AllocationCounter counter;
+				counter.start();
+				auto start = std::chrono::high_resolution_clock::now();
+				AModel* aModel = new AModel(device, filename, arena == 1);
+				totalMs += millisecondsSince(start);
+				counter.stop();
+				allocations = counter.allocations;
+				peakBytes = counter.peakBytes;
+
+				result.submeshes = aModel->getSubmeshCount();
+				result.materials = aModel->getMaterialSlotCount();
+				delete aModel;
+			}
+
+			float ms = totalMs / iterations;
+			float peakKB = peakBytes / 1024.f;
+			if (arena)
+			{
+				result.arenaMs = ms;
+				result.arenaAllocations = allocations;
+				result.arenaPeakKB = peakKB;
+			}
+			else
+			{
+				result.appendMs = ms;
+				result.appendAllocations = allocations;
+				result.appendPeakKB = peakKB;
+			}
+		}
+		aModelImportResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runGridMeshes(ID3D11Device* device, int iterations)
+{
+	gridMeshResults_.clear();
+	const int resolutions[] = { 20, 50, 100, 200, 255 };
+
+	for (int mesh = 0; mesh < 3; mesh++)
+	{
+		for (int resolution : resolutions)
+		{
+			GridMeshResult result;
+			result.mesh = mesh == 0 ? "PlaneMesh" : mesh == 1 ? "SphereMesh" : "CubeMesh";
+			result.resolution = resolution;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			BaseMesh* generated = nullptr;
+			for (int i = 0; i < iterations; i++)
+			{
+				delete generated;
+				if (mesh == 0)
+					generated = new PlaneMesh(device, nullptr, resolution);
+				else if (mesh == 1)
+					generated = new SphereMesh(device, nullptr, resolution);
+				else
+					generated = new CubeMesh(device, nullptr, resolution);
+			}
+			result.generationMs = millisecondsSince(start) / iterations;
+
+			//! the previous generators wrote 6 vertices per quad with an identity index buffer
+			int stride = generated->isPacked() ? sizeof(VertexPacking::PackedVertex) : sizeof(VertexPacking::Vertex);
+			result.unrolledVertices = generated->getIndexCount();
+			result.unrolledKB = (result.unrolledVertices * (float)stride + result.unrolledVertices * (MeshUtils::fitsShortIndices(result.unrolledVertices) ? 2.f : 4.f)) / 1024.f;
+			result.vertices = generated->getVertexCount();
+			result.sharedKB = (result.vertices * (float)stride + generated->getIndexCount() * (generated->getIndexFormat() == DXGI_FORMAT_R16_UINT ? 2.f : 4.f)) / 1024.f;
+			delete generated;
+			gridMeshResults_.push_back(result);
+		}
+	}
+}
+
+void Benchmarks::runCubeFaces(int iterations)
+{
+	cubeFacesResults_.clear();
+	const int resolutions[] = { 20, 64, 128, 256, 512 };
+
+	for (int mesh = 0; mesh < 2; mesh++)
+	{
+		for (int resolution : resolutions)
+		{
+			CubeFacesResult result;
+			result.mesh = mesh == 0 ? "SphereMesh" : "CubeMesh";
+			result.resolution = resolution;
+			result.vertices = 6 * (resolution + 1) * (resolution + 1);
+			BaseMesh::CubeFaceShape shape = mesh == 0 ? BaseMesh::CubeFaceShape::Sphere : BaseMesh::CubeFaceShape::Cube;
+
+			//! written once before timing, so page faults of the first touch are not counted against either generator
+			std::vector<VertexPacking::Vertex> reference(result.vertices), generated(result.vertices);
+			std::vector<unsigned long> referenceIndices(6 * resolution * resolution * 6), generatedIndices(referenceIndices.size());
+			referenceCubeFaces(reference.data(), referenceIndices.data(), resolution, mesh == 0);
+			BaseMesh::buildCubeFaces(generated.data(), generatedIndices.data(), resolution, shape);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int i = 0; i < iterations; i++)
+				referenceCubeFaces(reference.data(), referenceIndices.data(), resolution, mesh == 0);
+			result.scalarMs = millisecondsSince(start) / iterations;
+
+			start = std::chrono::high_resolution_clock::now();
+			for (int i = 0; i < iterations; i++)
+				BaseMesh::buildCubeFaces(generated.data(), generatedIndices.data(), resolution, shape, 1);
+			result.singleThreadMs = millisecondsSince(start) / iterations;
+
+			start = std::chrono::high_resolution_clock::now();
+			for (int i = 0; i < iterations; i++)
+				BaseMesh::buildCubeFaces(generated.data(), generatedIndices.data(), resolution, shape);
+			result.parallelMs = millisecondsSince(start) / iterations;
+
+			result.matches = memcmp(reference.data(), generated.data(), reference.size() * sizeof(VertexPacking::Vertex)) == 0 && referenceIndices == generatedIndices;
+			cubeFacesResults_.push_back(result);
+		}
+	}
+}
+
+void Benchmarks::runTerrain(int frames)
+{
+	terrainResults_.clear();
+
+	Heightfield heightfield;
+	heightfield.load(L"res/landscape.png");
+	TerrainQuadtree::Settings settings = TerrainObject::landscapeSettings();
+	TerrainQuadtree quadtree;
+	quadtree.build(settings, heightfield.getHeights(), heightfield.getWidth(), heightfield.getHeight(), settings.size * k_LandscapeUvPerUnit);
+
+	const float lodBiases[] = { 0.5f, 1.f, 2.f };
+	std::vector<TerrainQuadtree::Node> nodes;
+
+	for (float lodBias : lodBiases)
+	{
+		TerrainResult result;
+		result.lodBias = lodBias;
+		//! the old 100x100 plane
+		result.planeTriangles = 99 * 99 * 2;
+
+		float selectMs = 0.f;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			Meshlets::CullView cullView = landscapeFlythrough(frame, frames);
+			TerrainQuadtree::SelectionStats stats = quadtree.select(cullView, cullView.eye, lodBias, nodes);
+			selectMs += millisecondsSince(start);
+
+			float finest = settings.size;
+			for (auto& node : nodes)
+				finest = node.size < finest ? node.size : finest;
+
+			result.triangles += (float)stats.triangles / frames;
+			result.maxTriangles = stats.triangles > result.maxTriangles ? stats.triangles : result.maxTriangles;
+			result.nodes += (float)stats.selected / frames;
+			result.culledNodes += (float)stats.culled / frames;
+			result.finestSpacing += finest / settings.gridResolution / frames;
+		}
+		result.selectMicroseconds = selectMs * 1000.f / frames;
+		terrainResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runTerrainBake(int iterations, int frames)
+{
+	terrainBakeResults_.clear();
+
+	Heightfield heightfield;
+	if (!heightfield.load(L"res/landscape.png"))
+		return;
+
+	TerrainQuadtree::Settings settings = TerrainObject::landscapeSettings();
+	Heightfield::SurfaceSettings surface = TerrainObject::surfaceSettings(settings);
+	TerrainBakeResult result;
+	result.texels = heightfield.getWidth() * heightfield.getHeight();
+
+	std::vector<Heightfield::SurfaceTexel> texels;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+		heightfield.bakeSurface(surface, texels, 1);
+	result.singleThreadMs = millisecondsSince(start) / iterations;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+		heightfield.bakeSurface(surface, texels);
+	result.bakeMs = millisecondsSince(start) / iterations;
+
+	start = std::chrono::high_resolution_clock::now();
+	unsigned long long key = heightfield.getSurfaceKey(surface);
+	result.keyMs = millisecondsSince(start);
+
+	//! the cache the landscape reads, rewritten with the same bake
+	std::string cacheFile = MeshCache::getCachePath("res/landscape.png", "surface");
+	Heightfield::saveSurface(cacheFile.c_str(), key, heightfield.getWidth(), heightfield.getHeight(), texels);
+	start = std::chrono::high_resolution_clock::now();
+	Heightfield::loadSurface(cacheFile.c_str(), key, heightfield.getWidth(), heightfield.getHeight(), texels);
+	result.cacheLoadMs = millisecondsSince(start);
+
+	//! vertices the landscape shader runs for per frame, quarter nodes draw a quarter of the grid
+	TerrainQuadtree quadtree;
+	quadtree.build(settings, heightfield.getHeights(), heightfield.getWidth(), heightfield.getHeight(), settings.size * k_LandscapeUvPerUnit);
+	std::vector<TerrainQuadtree::Node> nodes;
+	const int side = settings.gridResolution + 1;
+	const int quarterSide = settings.gridResolution / 2 + 1;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		Meshlets::CullView cullView = landscapeFlythrough(frame, frames);
+		quadtree.select(cullView, cullView.eye, 1.f, nodes);
+		for (auto& node : nodes)
+			result.vertices += (float)(node.quadrant < 0 ? side * side : quarterSide * quarterSide) / frames;
+	}
+	terrainBakeResults_.push_back(result);
+}
+
+void Benchmarks::runWaterMesh(ID3D11Device* device, int iterations)
+{
+	waterMeshResults_.clear();
+
+	Heightfield heightfield;
+	heightfield.load(L"res/landscape.png");
+	const XMFLOAT3 landscapePosition(-5.f, -5.f, -10.f);
+
+	//! settings of App1::initWater, with its wave altitude of 0.05
+	WaterMesh::Settings settings;
+	settings.terrainOffset = { k_WaterPosition.x - landscapePosition.x, k_WaterPosition.z - landscapePosition.z };
+	settings.uvPerUnit = k_LandscapeUvPerUnit;
+	settings.heightScale = TerrainObject::landscapeSettings().maxHeight;
+	settings.margin = 0.05f * 2.f + 0.25f;
+
+	const float levels[] = { k_WaterPosition.y, -4.f, -2.f, 0.f, 5.f };
+	for (float level : levels)
+	{
+		WaterMeshResult result;
+		result.level = level;
+		result.planeVertices = 100 * 100;
+		result.planeQuads = 99 * 99;
+
+		WaterMesh* water = nullptr;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			delete water;
+			water = new WaterMesh(device, nullptr, heightfield, settings, level - landscapePosition.y);
+		}
+		result.buildMs = millisecondsSince(start) / iterations;
+
+		//! alternating levels, every call rebuilds
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			water->setLevel(device, level - landscapePosition.y + 0.01f);
+			water->setLevel(device, level - landscapePosition.y);
+		}
+		result.rebuildMs = millisecondsSince(start) / (iterations * 2);
+
+		result.vertices = water->getVertexCount();
+		result.quads = water->getQuadCount();
+		delete water;
+		waterMeshResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runGeometryRegistry(ID3D11Device* device, int instances)
+{
+	geometryRegistryResults_.clear();
+
+	//! the meshes of the scene, models keyed by the contents of their file
+	struct Source
+	{
+		std::string name;
+		std::string key;
+		std::function<BaseMesh*()> create;
+	};
+	std::vector<Source> sources;
+	sources.push_back({ "SphereMesh 20", "", [device]() -> BaseMesh* { return new SphereMesh(device, nullptr); } });
+	sources.push_back({ "CubeMesh 20", "", [device]() -> BaseMesh* { return new CubeMesh(device, nullptr); } });
+	sources.push_back({ "PlaneMesh 100 packed", "", [device]() -> BaseMesh* { return new PlaneMesh(device, nullptr, 100, true); } });
+	for (const char* filename : k_BenchmarkModels)
+		sources.push_back({ filename, filename, [device, filename]() -> BaseMesh* { return new Model(device, nullptr, filename); } });
+
+	for (auto& source : sources)
+	{
+		GeometryRegistryResult result;
+		result.mesh = source.name;
+		result.instances = instances;
+
+		std::vector<BaseMesh*> meshes;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < instances; i++)
+			meshes.push_back(source.create());
+		result.separateMs = millisecondsSince(start);
+		for (auto* mesh : meshes)
+		{
+			result.separateKB += mesh->getBufferBytes() / 1024.f;
+			delete mesh;
+		}
+
+		//! a registry per mesh, so its counters are the mesh's own
+		GeometryRegistry registry;
+		meshes.clear();
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < instances; i++)
+		{
+			std::string key = source.key.empty() ? source.name : GeometryRegistry::getFileKey("Model", source.key.c_str());
+			meshes.push_back(registry.acquire(key, source.create));
+		}
+		result.sharedMs = millisecondsSince(start);
+		result.stats = registry.getStats();
+		result.sharedKB = result.stats.liveBytes / 1024.f;
+		for (auto* mesh : meshes)
+			registry.release(mesh);
+
+		geometryRegistryResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runHeightfieldQuery(int queries, int rays, int marchedRays)
+{
+	heightfieldQueryResults_.clear();
+
+	Heightfield heightfield;
+	if (!heightfield.load(L"res/landscape.png"))
+		return;
+
+	TerrainQuadtree::Settings settings = TerrainObject::landscapeSettings();
+	std::vector<Heightfield::SurfaceTexel> texels;
+	heightfield.bakeSurface(TerrainObject::surfaceSettings(settings), texels);
+
+	HeightfieldQueryResult result;
+	result.queries = queries;
+	HeightfieldQuery query;
+	auto start = std::chrono::high_resolution_clock::now();
+	query.build(texels.data(), heightfield.getWidth(), heightfield.getHeight(), k_LandscapeUvPerUnit, settings.size);
+	result.buildMs = millisecondsSince(start);
+
+	//! fixed seed, points over the terrain and a little past its edges where the texture wraps
+	std::mt19937 generator(1);
+	auto random = [&generator](float low, float high) { return std::uniform_real_distribution<float>(low, high)(generator); };
+	std::vector<XMFLOAT2> points(queries);
+	for (auto& point : points)
+		point = XMFLOAT2(random(-10.f, settings.size + 10.f), random(-10.f, settings.size + 10.f));
+
+	std::vector<float> heights(queries), batchedHeights(queries);
+	std::vector<XMFLOAT3> normals(queries), batchedNormals(queries);
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < queries; i++)
+		heights[i] = query.getHeight(points[i].x, points[i].y);
+	result.scalarMQps = queries / secondsSince(start) / 1e6f;
+
+	start = std::chrono::high_resolution_clock::now();
+	query.getHeights(points.data(), queries, batchedHeights.data());
+	result.batchedMQps = queries / secondsSince(start) / 1e6f;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < queries; i++)
+		normals[i] = query.getNormal(points[i].x, points[i].y);
+	result.scalarNormalMQps = queries / secondsSince(start) / 1e6f;
+
+	start = std::chrono::high_resolution_clock::now();
+	query.getNormals(points.data(), queries, batchedNormals.data());
+	result.batchedNormalMQps = queries / secondsSince(start) / 1e6f;
+
+	result.batchMatches = memcmp(heights.data(), batchedHeights.data(), queries * sizeof(float)) == 0 &&
+		memcmp(normals.data(), batchedNormals.data(), queries * sizeof(XMFLOAT3)) == 0;
+
+	//! rays from above the terrain heading down at it, as picking and placement would
+	struct Ray
+	{
+		XMFLOAT3 origin;
+		XMFLOAT3 direction;
+	};
+	std::vector<Ray> testRays(rays);
+	for (auto& ray : testRays)
+	{
+		ray.origin = XMFLOAT3(random(5.f, settings.size - 5.f), random(45.f, 60.f), random(5.f, settings.size - 5.f));
+		XMVECTOR direction = XMVector3Normalize(XMVectorSet(random(-1.f, 1.f), -random(0.2f, 1.f), random(-1.f, 1.f), 0.f));
+		XMStoreFloat3(&ray.direction, direction);
+	}
+
+	const float maxDistance = 200.f;
+	std::vector<HeightfieldQuery::Hit> hits(rays);
+	std::vector<bool> hitFound(rays);
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < rays; i++)
+		hitFound[i] = query.raycast(testRays[i].origin, testRays[i].direction, maxDistance, hits[i]);
+	result.rayMicroseconds = millisecondsSince(start) * 1000.f / rays;
+	result.rays = rays;
+	for (int i = 0; i < rays; i++)
+	{
+		result.hits += hitFound[i] ? 1 : 0;
+		result.patchesPerRay += (float)hits[i].patchesTested / rays;
+	}
+
+	//! the march stops at the edges of the square, the pyramid also covers the patches overlapping them
+	result.marchStep = 0.005f;
+	const float inset = 1.f;
+	for (int i = 0; i < marchedRays && i < rays; i++)
+	{
+		const Ray& ray = testRays[i];
+		float marched = -1.f;
+		for (float t = 0.f; t < maxDistance; t += result.marchStep)
+		{
+			float x = ray.origin.x + ray.direction.x * t;
+			float z = ray.origin.z + ray.direction.z * t;
+			if (x < 0.f || z < 0.f || x > settings.size || z > settings.size)
+				break;
+			if (ray.origin.y + ray.direction.y * t <= query.getHeight(x, z))
+			{
+				marched = t;
+				break;
+			}
+		}
+
+		//! hits near the edges can fall either side of where the march gave up
+		const XMFLOAT3& position = hits[i].position;
+		bool nearEdge = hitFound[i] && (position.x < inset || position.z < inset || position.x > settings.size - inset || position.z > settings.size - inset);
+		if (nearEdge)
+			continue;
+
+		result.marchChecked++;
+		if (hitFound[i] ? marched >= 0.f && fabsf(hits[i].distance - marched) <= result.marchStep : marched < 0.f)
+			result.marchAgreed++;
+	}
+	heightfieldQueryResults_.push_back(result);
+}
+
+void Benchmarks::runHeightGenerator(int tileSize, int tilesPerSide)
+{
+	heightGeneratorResults_.clear();
+
+	HeightGenerator::Settings fbm;
+	HeightGenerator::Settings ridged;
+	ridged.type = HeightGenerator::Type::Ridged;
+	ridged.warpStrength = 64.f;
+	const std::pair<const char*, HeightGenerator::Settings> noises[] = { { "fBm", fbm }, { "ridged warped", ridged } };
+
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	hardwareThreads = hardwareThreads ? hardwareThreads : 1;
+	const int tiles = tilesPerSide * tilesPerSide;
+	const size_t tileSamples = (size_t)tileSize * tileSize;
+
+	for (auto& noise : noises)
+	{
+		HeightGenerator generator(noise.second);
+
+		//! one row per tile through the scalar path
+		std::vector<float> row(tileSize);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int z = 0; z < tiles; z++)
+			for (int x = 0; x < tileSize; x++)
+				row[x] = generator.sample(x, z);
+		float scalarMegasamplesPerSecond = tiles * tileSize / secondsSince(start) / 1e6f;
+
+		std::vector<unsigned short> reference(tiles * tileSamples);
+		std::vector<unsigned short> heights(tiles * tileSamples);
+		float singleThreadSeconds = 0.f;
+		for (unsigned int threads = 1; ; threads *= 2)
+		{
+			threads = threads < hardwareThreads ? threads : hardwareThreads;
+			HeightGeneratorResult result;
+			result.noise = noise.first;
+			result.threads = threads;
+			result.tileSize = tileSize;
+			result.tiles = tiles;
+			result.scalarMegasamplesPerSecond = scalarMegasamplesPerSecond;
+
+			//! the calling thread claims rows too, so the pool holds one thread less
+			ThreadPool* pool = threads > 1 ? new ThreadPool(threads - 1) : nullptr;
+			std::vector<unsigned short>& out = threads == 1 ? reference : heights;
+			start = std::chrono::high_resolution_clock::now();
+			for (int tile = 0; tile < tiles; tile++)
+				generator.generateTile(tile % tilesPerSide, tile / tilesPerSide, tileSize, &out[tile * tileSamples], pool);
+			float seconds = secondsSince(start);
+			delete pool;
+
+			singleThreadSeconds = threads == 1 ? seconds : singleThreadSeconds;
+			result.megasamplesPerSecond = tiles * tileSamples / seconds / 1e6f;
+			result.speedup = singleThreadSeconds / seconds;
+			result.matches = threads == 1 || memcmp(reference.data(), heights.data(), heights.size() * sizeof(unsigned short)) == 0;
+			heightGeneratorResults_.push_back(result);
+
+			if (threads == hardwareThreads)
+				break;
+		}
+	}
+}
+
+void Benchmarks::runOcclusionBake(int directions)
+{
+	occlusionBakeResults_.clear();
+
+	//! the landscape as the terrain object bakes it, and a generated map of the landscape's texel size and height
+	Heightfield landscape;
+	landscape.load(L"res/landscape.png");
+	const int generatedSize = 4096;
+	std::vector<unsigned short> generatedHeights((size_t)generatedSize * generatedSize);
+	ThreadPool pool;
+	HeightGenerator(HeightGenerator::Settings()).generateTile(0, 0, generatedSize, generatedHeights.data(), &pool);
+	Heightfield generated;
+	generated.setHeights(generatedHeights.data(), generatedSize, generatedSize);
+
+	TerrainQuadtree::Settings terrain = TerrainObject::landscapeSettings();
+	const std::pair<const char*, const Heightfield*> maps[] = { { "landscape", &landscape }, { "generated", &generated } };
+	for (auto& map : maps)
+	{
+		if (map.second->isEmpty())
+			continue;
+
+		OcclusionBakeResult result;
+		result.map = map.first;
+		result.size = map.second->getWidth();
+		HorizonOcclusion::Settings settings = TerrainObject::occlusionSettings(terrain, k_LandscapeUvPerUnit, landscape.isEmpty() ? 1024 : landscape.getWidth());
+		settings.directions = directions;
+		result.directions = directions;
+
+		std::vector<unsigned char> reference, visibility;
+		auto start = std::chrono::high_resolution_clock::now();
+		HorizonOcclusion::bake(*map.second, settings, reference, 1);
+		result.singleThreadMs = millisecondsSince(start);
+
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		result.threads = hardwareThreads ? hardwareThreads : 1;
+		start = std::chrono::high_resolution_clock::now();
+		HorizonOcclusion::bake(*map.second, settings, visibility);
+		result.bakeMs = millisecondsSince(start);
+		result.matches = reference == visibility;
+		result.megatexelsPerSecond = (float)visibility.size() * directions / (result.bakeMs * 1000.f);
+
+		long long visibilitySum = 0;
+		for (unsigned char texel : visibility)
+			visibilitySum += texel;
+		result.averageVisibility = visibilitySum / (255.f * visibility.size());
+
+		//! the landscape rewrites the cache it reads with the same bake, the generated map's cache is removed after the reload
+		std::string cacheFile = MeshCache::getCachePath(map.second == &landscape ? "res/landscape.png" : "generated.png", "occlusion");
+		unsigned long long key = HorizonOcclusion::getKey(*map.second, settings);
+		HorizonOcclusion::save(cacheFile.c_str(), key, result.size, map.second->getHeight(), visibility);
+		start = std::chrono::high_resolution_clock::now();
+		bool loaded = HorizonOcclusion::load(cacheFile.c_str(), key, result.size, map.second->getHeight(), reference);
+		result.loadMs = millisecondsSince(start);
+		result.matches = result.matches && loaded && reference == visibility;
+		if (map.second != &landscape)
+			std::remove(cacheFile.c_str());
+
+		occlusionBakeResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runTerrainStreaming(ID3D11Device* device, int frames)
+{
+	terrainStreamingResults_.clear();
+
+	ID3D11DeviceContext* context = NULL;
+	device->GetImmediateContext(&context);
+
+	const float frameSeconds = 1.f / 60.f;
+	for (float speed : { 30.f, 120.f, 480.f })
+	{
+		//! a new streamer per flight, every tile is generated on the way
+		TerrainStreamer streamer(device, StreamedTerrain::landscapeSettings());
+		TerrainStreamingResult result;
+		result.speed = speed;
+		result.frames = frames;
+
+		double updateMsSum = 0.0;
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			//! diagonal, so tiles enter along both axes
+			XMFLOAT3 eye(frame * frameSeconds * speed * 0.8f, 30.f, frame * frameSeconds * speed * 0.6f);
+			streamer.update(context, eye);
+
+			const TerrainStreamer::Stats& stats = streamer.getStats();
+			updateMsSum += stats.updateMs;
+			result.holeFrames += stats.missing > 0 ? 1 : 0;
+			result.maxMissing = stats.missing > result.maxMissing ? stats.missing : result.maxMissing;
+
+			//! the rest of the frame is left to the loader threads
+			frameStart += std::chrono::microseconds((long long)(frameSeconds * 1e6f));
+			std::this_thread::sleep_until(frameStart);
+		}
+
+		const TerrainStreamer::Stats& stats = streamer.getStats();
+		result.averageUpdateMs = (float)(updateMsSum / frames);
+		result.maxUpdateMs = stats.maxUpdateMs;
+		result.maxQueued = stats.maxQueued;
+		result.averageTimeToResidentMs = stats.averageTimeToResidentMs;
+		result.maxTimeToResidentMs = stats.maxTimeToResidentMs;
+		result.generated = stats.generated;
+		result.evicted = stats.evicted;
+		terrainStreamingResults_.push_back(result);
+	}
+
+	context->Release();
+}
+
+void Benchmarks::runFoliagePopulation(ID3D11Device* device, int rebuildLimit)
+{
+	foliagePopulationResults_.clear();
+
+	ID3D11DeviceContext* context = NULL;
+	device->GetImmediateContext(&context);
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> coordinate(0.f, 100.f);
+	for (int count : { 5000, 50000, 500000 })
+	{
+		FoliagePopulationResult result;
+		result.points = count;
+
+		std::vector<BaseMesh::VertexType> points(count + count / 100);
+		for (auto& point : points)
+			point = { XMFLOAT3(coordinate(random), coordinate(random) * 0.5f, coordinate(random)), XMFLOAT2(0,0), XMFLOAT3(0,0,-1) };
+
+		//! what addVertex used to do for every point, copy the list and create both buffers from it
+		if (count <= rebuildLimit)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			std::vector<BaseMesh::VertexType> list;
+			for (int i = 0; i < count; i++)
+			{
+				list.push_back(points[i]);
+				std::vector<BaseMesh::VertexType> vertices(list);
+				std::vector<unsigned long> indices(list.size());
+				for (size_t index = 0; index < indices.size(); index++)
+					indices[index] = (unsigned long)index;
+
+				ID3D11Buffer* vertexBuffer = NULL;
+				ID3D11Buffer* indexBuffer = NULL;
+				D3D11_BUFFER_DESC desc = { (UINT)(sizeof(BaseMesh::VertexType) * vertices.size()), D3D11_USAGE_DEFAULT, D3D11_BIND_VERTEX_BUFFER, 0, 0, 0 };
+				D3D11_SUBRESOURCE_DATA data = { vertices.data(), 0, 0 };
+				device->CreateBuffer(&desc, &data, &vertexBuffer);
+				desc = { (UINT)(sizeof(unsigned long) * indices.size()), D3D11_USAGE_DEFAULT, D3D11_BIND_INDEX_BUFFER, 0, 0, 0 };
+				data = { indices.data(), 0, 0 };
+				device->CreateBuffer(&desc, &data, &indexBuffer);
+				vertexBuffer->Release();
+				indexBuffer->Release();
+			}
+			result.rebuildMs = millisecondsSince(start);
+		}
+
+		{
+			BetterPointMesh mesh(device, context);
+			int capacity = 0;
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int i = 0; i < count; i++)
+			{
+				mesh.addVertex(device, points[i]);
+				result.addVertexCreations += mesh.getCapacity() != capacity ? 1 : 0;
+				capacity = mesh.getCapacity();
+			}
+			result.addVertexMs = millisecondsSince(start);
+		}
+
+		{
+			BetterPointMesh mesh(device, context);
+			auto start = std::chrono::high_resolution_clock::now();
+			mesh.reserve(count);
+			mesh.appendVertices(points.data(), count);
+			mesh.commit(device);
+			result.batchMs = millisecondsSince(start);
+
+			int capacity = mesh.getCapacity();
+			start = std::chrono::high_resolution_clock::now();
+			mesh.appendVertices(points.data() + count, count / 100);
+			mesh.commit(device);
+			result.tailAppendMs = millisecondsSince(start);
+			result.tailRecreated = mesh.getCapacity() != capacity;
+		}
+
+		foliagePopulationResults_.push_back(result);
+	}
+
+	context->Release();
+}
+
+void Benchmarks::setFoliageScene(D3D* renderer, FoliageShader* shader, const FoliageShader::ComputeParams& computeParams, const HeightfieldQuery* heights, GPUOrderShader* orderShader)
+{
+	orderShader_ = orderShader;
+	foliageRenderer_ = renderer;
+	foliageShader_ = shader;
+	foliageComputeParams_ = computeParams;
+	foliageHeights_ = heights;
+}
+
+void Benchmarks::runFoliageScatter()
+{
+	foliageScatterResults_.clear();
+	if (!foliageRenderer_ || !foliageShader_ || !foliageHeights_)
+		return;
+
+	//! what initFoliage used to do, dispatch over the brush map, read the whole result back and keep every other point at random
+	{
+		FoliageScatterResult result;
+		result.method = "compute and readback";
+		auto start = std::chrono::high_resolution_clock::now();
+
+		FoliageShader::ComputeParams params = foliageComputeParams_;
+		foliageShader_->Compute(foliageRenderer_, &params);
+		ID3D11Buffer* computeResult = CreateAndCopyToDebugBuf(foliageRenderer_->getDevice(), foliageRenderer_->getDeviceContext(), foliageShader_->_vertexComputeBuffer);
+		auto* computeData = MapBufferToPointer<FoliageShader::VertexComputeBufferType[TEX_HEIGHT * TEX_WIDTH]>(foliageRenderer_->getDeviceContext(), computeResult, D3D11_MAP_READ);
+		std::vector<XMFLOAT2> points;
+		for (int i = 0; i < TEX_WIDTH * TEX_WIDTH; i++)
+		{
+			float r = (float)rand() / 1000.f;
+			r -= std::floor(r);
+			if ((*computeData)[i].position.y > -15000.f && r < 0.5f)
+				points.push_back({ (*computeData)[i].position.x, (*computeData)[i].position.z });
+		}
+		foliageRenderer_->getDeviceContext()->Unmap(computeResult, 0);
+		ReleaseBuffer(&computeResult);
+		std::vector<float> heights(points.size());
+		foliageHeights_->getHeights(points.data(), (int)points.size(), heights.data());
+
+		result.startupMs = millisecondsSince(start);
+		result.instances = (int)points.size();
+		foliageScatterResults_.push_back(result);
+	}
+
+	//! the spacing of the scene, then denser until the scatter itself dominates
+	PoissonScatter::Settings settings = FoliageShader::scatterSettings();
+	for (float minDistance : { settings.minDistance, 1.f, 0.3f, 0.1f })
+	{
+		FoliageScatterResult result;
+		result.method = "Poisson scatter";
+		result.minDistance = minDistance;
+		result.threads = (int)std::thread::hardware_concurrency();
+		settings.minDistance = minDistance;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		Heightfield brush;
+		brush.load(L"res/foliage_brush.png");
+		std::vector<XMFLOAT3> points;
+		auto scatterStart = std::chrono::high_resolution_clock::now();
+		PoissonScatter::scatter(settings, brush, foliageHeights_, points);
+		float scatterSeconds = secondsSince(scatterStart);
+		result.startupMs = millisecondsSince(start);
+		result.instances = (int)points.size();
+		result.instancesPerSecond = scatterSeconds > 0.f ? points.size() / scatterSeconds : 0.f;
+
+		std::vector<XMFLOAT3> singleThread;
+		start = std::chrono::high_resolution_clock::now();
+		PoissonScatter::scatter(settings, brush, foliageHeights_, singleThread, 1);
+		result.singleThreadMs = millisecondsSince(start);
+		result.matches = singleThread.size() == points.size() &&
+			(points.empty() || std::memcmp(singleThread.data(), points.data(), points.size() * sizeof(XMFLOAT3)) == 0);
+
+		foliageScatterResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runDepthSort()
+{
+	depthSortResults_.clear();
+	if (!foliageRenderer_ || !orderShader_)
+		return;
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> coordinate(0.f, 100.f);
+	const XMFLOAT3 camera(50.f, 20.f, 50.f);
+	for (int count : { 5000, 100000, 1000000 })
+	{
+		DepthSortResult result;
+		result.points = count;
+
+		std::vector<XMFLOAT3> positions(count);
+		for (auto& position : positions)
+			position = XMFLOAT3(coordinate(random), coordinate(random) * 0.5f, coordinate(random));
+
+		//! the first sort grows the buffers, the second one is timed
+		std::vector<DepthSort::Key> gpuKeys;
+		orderShader_->sortKeys(foliageRenderer_, positions.data(), sizeof(XMFLOAT3), count, camera, gpuKeys);
+		auto start = std::chrono::high_resolution_clock::now();
+		orderShader_->sortKeys(foliageRenderer_, positions.data(), sizeof(XMFLOAT3), count, camera, gpuKeys);
+		result.gpuMs = millisecondsSince(start);
+
+		std::vector<DepthSort::Key> reference, sorted;
+		std::vector<DepthSort::Pass> passes;
+		DepthSort::makeKeys(positions.data(), sizeof(XMFLOAT3), count, camera, reference);
+		sorted = reference;
+		DepthSort::buildPasses((unsigned int)reference.size(), passes);
+		result.passes = (int)passes.size();
+		start = std::chrono::high_resolution_clock::now();
+		DepthSort::sortReference(reference, passes);
+		result.referenceMs = millisecondsSince(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		std::sort(sorted.begin(), sorted.end(), DepthSort::less);
+		result.stdSortMs = millisecondsSince(start);
+
+		depthSortResults_.push_back(result);
+	}
+}
+
+void Benchmarks::runCPUDepthSort()
+{
+	cpuDepthSortResults_.clear();
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> coordinate(0.f, 100.f);
+	const XMFLOAT3 camera(50.f, 20.f, 50.f);
+	const XMFLOAT3 movedCamera(50.001f, 20.f, 50.f);
+
+	//! a permutation of the points whose keys never decrease
+	auto isOrdered = [](const std::vector<XMFLOAT3>& positions, const std::vector<unsigned int>& order, const XMFLOAT3& eye)
+	{
+		if (order.size() != positions.size())
+			return false;
+		std::vector<bool> seen(positions.size(), false);
+		unsigned int lastKey = 0;
+		for (unsigned int index : order)
+		{
+			if (index >= positions.size() || seen[index] || DepthSort::depthKey(positions[index], eye) < lastKey)
+				return false;
+			seen[index] = true;
+			lastKey = DepthSort::depthKey(positions[index], eye);
+		}
+		return true;
+	};
+
+	for (int count : { 5000, 100000, 1000000 })
+	{
+		CPUDepthSortResult result;
+		result.points = count;
+
+		std::vector<XMFLOAT3> positions(count);
+		for (auto& position : positions)
+			position = XMFLOAT3(coordinate(random), coordinate(random) * 0.5f, coordinate(random));
+
+		//! the first sort grows the buffers, setting the points again drops its order
+		CPUDepthSort sorter;
+		sorter.setPoints(positions.data(), sizeof(XMFLOAT3), count);
+		sorter.sortNow(camera);
+		sorter.setPoints(positions.data(), sizeof(XMFLOAT3), count);
+		auto start = std::chrono::high_resolution_clock::now();
+		sorter.sortNow(camera);
+		result.radixMs = millisecondsSince(start);
+
+		std::vector<DepthSort::Key> keys;
+		DepthSort::makeKeys(positions.data(), sizeof(XMFLOAT3), count, camera, keys);
+		keys.resize(count);
+		start = std::chrono::high_resolution_clock::now();
+		std::sort(keys.begin(), keys.end(), DepthSort::less);
+		result.stdSortMs = millisecondsSince(start);
+
+		result.matches = sorter.getOrder().size() == (size_t)count;
+		for (int i = 0; i < count && result.matches; i++)
+			result.matches = sorter.getOrder()[i] == keys[i].index;
+
+		start = std::chrono::high_resolution_clock::now();
+		sorter.sortNow(movedCamera);
+		result.nearlySortedMs = millisecondsSince(start);
+		result.insertion = sorter.getStats().insertion;
+		result.descents = sorter.getStats().descents;
+		result.matches &= isOrdered(positions, sorter.getOrder(), movedCamera);
+
+		CPUDepthSort::Settings settings;
+		settings.shortKeys = true;
+		CPUDepthSort shortSorter;
+		shortSorter.setSettings(settings);
+		shortSorter.setPoints(positions.data(), sizeof(XMFLOAT3), count);
+		shortSorter.sortNow(camera);
+		shortSorter.setPoints(positions.data(), sizeof(XMFLOAT3), count);
+		start = std::chrono::high_resolution_clock::now();
+		shortSorter.sortNow(camera);
+		result.shortRadixMs = millisecondsSince(start);
+		result.matches &= shortSorter.getOrder().size() == (size_t)count;
+
+		//! a frame starting the sort, then updates until the one publishing it
+		CPUDepthSort worker;
+		worker.setPoints(positions.data(), sizeof(XMFLOAT3), count);
+		start = std::chrono::high_resolution_clock::now();
+		bool published = worker.update(camera);
+		result.updateMs = millisecondsSince(start);
+		while (!published)
+		{
+			std::this_thread::yield();
+			published = worker.update(camera);
+		}
+		result.publishedMs = millisecondsSince(start);
+		result.matches &= isOrdered(positions, worker.getOrder(), camera);
+
+		cpuDepthSortResults_.push_back(result);
+	}
+}
+
+void Benchmarks::gui(ID3D11Device* device)
+{
+	// OBJ LOADER //
+	if (ImGui::Button("OBJ loader throughput"))
+		runObjLoader();
+
+	for (auto& it : objLoaderResults_)
+		ImGui::Text("%s (%.2f MB, %d tris): mapped %.1f MB/s, fscanf %.1f MB/s", it.file.c_str(), it.sizeMB, it.triangles, it.mappedMBps, it.scanfMBps);
+
+	// VERTEX WELDING //
+	if (ImGui::Button("Vertex welding"))
+		runWelding(device);
+
+	for (auto& it : weldingResults_)
+		ImGui::Text("%s %s: %d -> %d verts, %.1f -> %.1f KB (%s indices)", it.loader.c_str(), it.file.c_str(), it.stats.sourceVertexCount, it.stats.weldedVertexCount,
+			it.stats.sourceBytes() / 1024.f, it.stats.weldedBytes() / 1024.f, it.stats.shortIndices ? "16 bit" : "32 bit");
+
+	// MESH CACHE //
+	if (ImGui::Button("Mesh cache cold/warm"))
+		runMeshCache(device);
+
+	for (auto& it : meshCacheResults_)
+		ImGui::Text("%s %s: cold %.2f ms, warm %.2f ms%s", it.loader.c_str(), it.file.c_str(), it.coldMs, it.warmMs, it.warmHit ? "" : " (cache miss)");
+
+	// VERTEX CACHE //
+	if (ImGui::Button("Vertex cache ACMR/ATVR"))
+		runVertexCache(device);
+
+	for (auto& it : vertexCacheResults_)
+		ImGui::Text("%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", it.mesh.c_str(), it.stats.before.acmr, it.stats.after.acmr, it.stats.before.atvr, it.stats.after.atvr);
+
+	// VERTEX PACKING //
+	if (ImGui::Button("Packed vertex format"))
+		runVertexPacking(device);
+
+	for (auto& it : vertexPackingResults_)
+		ImGui::Text("%s (%d verts): %.1f -> %.1f KB, error pos %.5f/%.5f, uv %.6f/%.6f, normal %.4f/%.4f deg (measured/bound)", it.mesh.c_str(), it.vertices, it.fullKB, it.packedKB,
+			it.measured.position, it.bounds.position, it.measured.texture, it.bounds.texture, it.measured.normalDegrees, it.bounds.normalDegrees);
+
+	// MESHLETS //
+	if (ImGui::Button("Meshlet build and cluster culling"))
+		runMeshlets();
+
+	for (auto& it : meshletResults_)
+		ImGui::Text("%s: %d meshlets (%d cones, %.1f tris, %.1f verts), build %.2f ms, cull %.1f us, culled %.0f%% frustum %.0f%% cone, %.0f%% tris drawn in %.1f draws",
+			it.mesh.c_str(), it.meshlets, it.cones, it.trianglesPerMeshlet, it.verticesPerMeshlet, it.buildMs, it.cullMicroseconds,
+			it.frustumCulled * 100.f, it.coneCulled * 100.f, it.trianglesDrawn * 100.f, it.ranges);
+
+	// TOKENIZER //
+	if (ImGui::Button("Tokenizer TokenStream/TokenScanner"))
+		runTokenizer();
+
+	for (auto& it : tokenizerResults_)
+		ImGui::Text("%s (%.2f MB, %d tokens%s): TokenStream %.1f Mtok/s %.0f allocs/MB, TokenScanner %.1f Mtok/s %.0f allocs/MB%s", it.file.c_str(), it.sizeMB, it.tokens,
+			it.tokensMatch ? "" : ", MISMATCH", it.streamMTokensPerSecond, it.streamAllocationsPerMB, it.scannerMTokensPerSecond, it.scannerAllocationsPerMB,
+			AllocationCounter::isAvailable() ? "" : " (allocations counted in debug builds only)");
+
+	// AMODEL IMPORT //
+	if (ImGui::Button("AModel import arena/append"))
+		runAModelImport(device);
+
+	for (auto& it : aModelImportResults_)
+		ImGui::Text("%s (%d submeshes, %d materials): append %.2f ms %d allocs %.0f KB peak, arena %.2f ms %d allocs %.0f KB peak%s", it.file.c_str(), it.submeshes, it.materials,
+			it.appendMs, it.appendAllocations, it.appendPeakKB, it.arenaMs, it.arenaAllocations, it.arenaPeakKB, AllocationCounter::isAvailable() ? "" : " (allocations counted in debug builds only)");
+
+	// GRID MESHES //
+	if (ImGui::Button("Shared vertex grid meshes"))
+		runGridMeshes(device);
+
+	for (auto& it : gridMeshResults_)
+		ImGui::Text("%s %d: %d -> %d verts, %.1f -> %.1f KB, %.2f ms", it.mesh.c_str(), it.resolution, it.unrolledVertices, it.vertices, it.unrolledKB, it.sharedKB, it.generationMs);
+
+	// CUBE FACES //
+	if (ImGui::Button("Sphere and cube generators"))
+		runCubeFaces();
+
+	for (auto& it : cubeFacesResults_)
+		ImGui::Text("%s %d (%d verts%s): previous %.2f ms, rows 1 thread %.2f ms, all threads %.2f ms", it.mesh.c_str(), it.resolution, it.vertices,
+			it.matches ? "" : ", MISMATCH", it.scalarMs, it.singleThreadMs, it.parallelMs);
+
+	// TERRAIN LOD //
+	if (ImGui::Button("Terrain quadtree flythrough"))
+		runTerrain();
+
+	for (auto& it : terrainResults_)
+		ImGui::Text("lod bias %.1f: %.0f tris (max %d) vs plane %d, %.1f nodes, %.1f culled, finest spacing %.2f, select %.1f us", it.lodBias, it.triangles, it.maxTriangles,
+			it.planeTriangles, it.nodes, it.culledNodes, it.finestSpacing, it.selectMicroseconds);
+
+	// TERRAIN SURFACE BAKE //
+	if (ImGui::Button("Terrain surface bake"))
+		runTerrainBake();
+
+	for (auto& it : terrainBakeResults_)
+		ImGui::Text("%d texels: bake %.2f ms (1 thread %.2f ms), key %.2f ms, cache load %.2f ms, %.0f verts/frame, fetches %d -> %d per vertex (%.0f -> %.0f per frame)", it.texels,
+			it.bakeMs, it.singleThreadMs, it.keyMs, it.cacheLoadMs, it.vertices, it.fetchesBefore, it.fetchesAfter, it.vertices * it.fetchesBefore, it.vertices * it.fetchesAfter);
+
+	// WATER MESH //
+	if (ImGui::Button("Terrain-aware water"))
+		runWaterMesh(device);
+
+	for (auto& it : waterMeshResults_)
+		ImGui::Text("level %.1f: %d -> %d verts, %d -> %d quads (%.0f%%), build %.2f ms, rebuild %.2f ms", it.level, it.planeVertices, it.vertices, it.planeQuads, it.quads,
+			it.quads * 100.f / it.planeQuads, it.buildMs, it.rebuildMs);
+
+	// GEOMETRY REGISTRY //
+	if (ImGui::Button("Shared geometry registry"))
+		runGeometryRegistry(device);
+
+	for (auto& it : geometryRegistryResults_)
+		ImGui::Text("%s x%d: separate %.2f ms %.1f KB, shared %.2f ms %.1f KB, %d hits %d misses, %.1f KB saved", it.mesh.c_str(), it.instances, it.separateMs, it.separateKB,
+			it.sharedMs, it.sharedKB, it.stats.hits, it.stats.misses, it.stats.bytesSaved / 1024.f);
+
+	// HEIGHTFIELD QUERIES //
+	if (ImGui::Button("CPU terrain queries"))
+		runHeightfieldQuery();
+
+	for (auto& it : heightfieldQueryResults_)
+		ImGui::Text("%d points: build %.1f ms, heights %.1f -> %.1f Mq/s batched, normals %.1f -> %.1f Mq/s%s, %d rays %.2f us (%d hits, %.1f patches), march agreed %d/%d (step %.3f)",
+			it.queries, it.buildMs, it.scalarMQps, it.batchedMQps, it.scalarNormalMQps, it.batchedNormalMQps, it.batchMatches ? "" : ", MISMATCH", it.rays, it.rayMicroseconds,
+			it.hits, it.patchesPerRay, it.marchAgreed, it.marchChecked, it.marchStep);
+
+	// HEIGHT GENERATOR //
+	if (ImGui::Button("Procedural heightmap tiles"))
+		runHeightGenerator();
+
+	for (auto& it : heightGeneratorResults_)
+		ImGui::Text("%s, %d threads, %d tiles of %d: %.1f MS/s (x%.2f, scalar 1 thread %.1f MS/s)%s", it.noise.c_str(), it.threads, it.tiles, it.tileSize,
+			it.megasamplesPerSecond, it.speedup, it.scalarMegasamplesPerSecond, it.matches ? "" : ", MISMATCH");
+
+	// OCCLUSION BAKE //
+	if (ImGui::Button("Terrain occlusion bake"))
+		runOcclusionBake();
+
+	for (auto& it : occlusionBakeResults_)
+		ImGui::Text("%s %dx%d, %d directions: %.1f ms on 1 thread, %.1f ms on %d (%.1f Mtexel/s)%s, cache load %.2f ms, average visibility %.2f",
+			it.map.c_str(), it.size, it.size, it.directions, it.singleThreadMs, it.bakeMs, it.threads, it.megatexelsPerSecond, it.matches ? "" : ", MISMATCH",
+			it.loadMs, it.averageVisibility);
+
+	// TERRAIN STREAMING //
+	if (ImGui::Button("Streamed terrain flight"))
+		runTerrainStreaming(device);
+
+	for (auto& it : terrainStreamingResults_)
+		ImGui::Text("%.0f units/s, %d frames: update %.3f ms avg %.3f ms max, queue max %d, resident after %.1f ms avg %.1f ms max, %d generated, %d evicted, holes in %d frames (max %d tiles)",
+			it.speed, it.frames, it.averageUpdateMs, it.maxUpdateMs, it.maxQueued, it.averageTimeToResidentMs, it.maxTimeToResidentMs, it.generated, it.evicted,
+			it.holeFrames, it.maxMissing);
+
+	// FOLIAGE POPULATION //
+	if (ImGui::Button("Foliage population"))
+		runFoliagePopulation(device);
+
+	for (auto& it : foliagePopulationResults_)
+	{
+		if (it.rebuildMs >= 0.f)
+			ImGui::Text("%d points: rebuild per point %.1f ms, addVertex %.1f ms (%d buffer creations), batch %.2f ms, 1%% more %.3f ms (%s)",
+				it.points, it.rebuildMs, it.addVertexMs, it.addVertexCreations, it.batchMs, it.tailAppendMs, it.tailRecreated ? "recreated" : "tail mapped");
+		else
+			ImGui::Text("%d points: rebuild per point skipped, addVertex %.1f ms (%d buffer creations), batch %.2f ms, 1%% more %.3f ms (%s)",
+				it.points, it.addVertexMs, it.addVertexCreations, it.batchMs, it.tailAppendMs, it.tailRecreated ? "recreated" : "tail mapped");
+	}
+
+	// FOLIAGE SCATTER //
+	if (ImGui::Button("Foliage scatter"))
+		runFoliageScatter();
+
+	for (auto& it : foliageScatterResults_)
+	{
+		if (it.minDistance > 0.f)
+			ImGui::Text("%s, %.1f apart: %d instances, startup %.2f ms, scatter %.0f instances/s on %d threads, %.2f ms on 1 thread%s",
+				it.method.c_str(), it.minDistance, it.instances, it.startupMs, it.instancesPerSecond, it.threads, it.singleThreadMs, it.matches ? "" : ", MISMATCH");
+		else
+			ImGui::Text("%s: %d instances, startup %.2f ms", it.method.c_str(), it.instances, it.startupMs);
+	}
+
+	// DEPTH SORT //
+	if (ImGui::Button("Depth sort"))
+		runDepthSort();
+
+	for (auto& it : depthSortResults_)
+		ImGui::Text("%d points, %d passes: GPU %.2f ms, CPU reference %.1f ms, std::sort %.1f ms",
+			it.points, it.passes, it.gpuMs, it.referenceMs, it.stdSortMs);
+
+	// CPU DEPTH SORT //
+	if (ImGui::Button("CPU depth sort"))
+		runCPUDepthSort();
+
+	for (auto& it : cpuDepthSortResults_)
+		ImGui::Text("%d points: radix %.2f ms (16 bit %.2f ms), std::sort %.1f ms, nearly sorted %.2f ms (%s, %u descents), worker update %.3f ms, published after %.1f ms%s",
+			it.points, it.radixMs, it.shortRadixMs, it.stdSortMs, it.nearlySortedMs, it.insertion ? "insertion" : "radix", it.descents, it.updateMs, it.publishedMs, it.matches ? "" : " MISMATCH");
+}
@@ -0,0 +1,396 @@
+#pragma once
+#ifndef _BENCHMARKS_H_
+#define _BENCHMARKS_H_
+
+#include "DXF.h"	// include dxframework
+#include "FoliageShader.h"
+#include "GPUOrderShader.h"
+#include <string>
+#include <vector>
+
+//! CPU side benchmarks, triggered from the UI so they can be run on the target machine without a separate build
+//! results are kept until the next run and displayed in the benchmark section of the UI
+class Benchmarks
+{
+public:
+	//! throughput of the OBJ loaders on a single file
+	struct ObjLoaderResult
+	{
+		std::string file;
+		float sizeMB = 0.f;
+		int triangles = 0;
+		float mappedMBps = 0.f;		//! multithreaded, memory mapped loader
+		float scanfMBps = 0.f;		//! previous fscanf_s loader
+	};
+
+	//! vertex and memory savings of welding, for one loader
+	struct WeldingResult
+	{
+		std::string file;
+		std::string loader;
+		MeshUtils::WeldStats stats;
+	};
+
+	//! load time of one model with and without its baked cache file
+	struct MeshCacheResult
+	{
+		std::string file;
+		std::string loader;
+		float coldMs = 0.f;		//! cache deleted, source imported and baked
+		float warmMs = 0.f;		//! mapped from the cache written by the cold load
+		bool warmHit = false;
+	};
+
+	//! simulated post transform cache efficiency of one mesh
+	struct VertexCacheResult
+	{
+		std::string mesh;
+		MeshUtils::OptimiseStats stats;
+	};
+
+	//! memory and precision of the packed vertex format on one mesh
+	struct VertexPackingResult
+	{
+		std::string mesh;
+		int vertices = 0;
+		float fullKB = 0.f;		//! VertexType buffer
+		float packedKB = 0.f;	//! VertexType_Packed buffer
+		VertexPacking::ErrorBounds bounds;		//! guaranteed worst case
+		VertexPacking::ErrorBounds measured;	//! actual worst case over the mesh
+	};
+
+	//! meshlet build and CPU cluster culling of one mesh, culled shares are averages over the test views
+	struct MeshletResult
+	{
+		std::string mesh;
+		int meshlets = 0;
+		int cones = 0;				//! meshlets with a usable normal cone
+		float trianglesPerMeshlet = 0.f;
+		float verticesPerMeshlet = 0.f;
+		float buildMs = 0.f;
+		float cullMicroseconds = 0.f;	//! one cull of the whole mesh
+		float frustumCulled = 0.f;		//! share of meshlets outside the view
+		float coneCulled = 0.f;			//! share of meshlets facing away
+		float trianglesDrawn = 0.f;		//! share of triangles left to draw
+		float ranges = 0.f;				//! draw calls per view after merging
+	};
+
+	//! cost of splitting one file into whitespace separated tokens
+	struct TokenizerResult
+	{
+		std::string file;
+		float sizeMB = 0.f;
+		int tokens = 0;
+		bool tokensMatch = false;			//! both classes returned the same tokens
+		float streamMTokensPerSecond = 0.f;	//! TokenStream, std::string tokens over a copy of the file
+		float streamAllocationsPerMB = 0.f;
+		float scannerMTokensPerSecond = 0.f;	//! TokenScanner, views into the mapped file
+		float scannerAllocationsPerMB = 0.f;
+	};
+
+	//! cold import of one model through AModel, previous per mesh appends against the pre-sized arena
+	//! allocations and peak are counted on this thread through the debug CRT hook, in debug builds only, assimp allocates inside its DLL and is not seen
+	struct AModelImportResult
+	{
+		std::string file;
+		int submeshes = 0;
+		int materials = 0;
+		float appendMs = 0.f;
+		int appendAllocations = 0;
+		float appendPeakKB = 0.f;
+		float arenaMs = 0.f;
+		int arenaAllocations = 0;
+		float arenaPeakKB = 0.f;
+	};
+
+	//! generation of one procedural mesh with shared vertices, against the unrolled 6 vertices per quad it replaced
+	struct GridMeshResult
+	{
+		std::string mesh;
+		int resolution = 0;
+		int unrolledVertices = 0;
+		int vertices = 0;
+		float unrolledKB = 0.f;		//! vertex and identity index buffer of the unrolled mesh
+		float sharedKB = 0.f;		//! vertex and index buffer now created
+		float generationMs = 0.f;	//! constructor, buffer creation included
+	};
+
+	//! generation of the sphere and cube vertices and indices, without the buffers, against the previous generator
+	struct CubeFacesResult
+	{
+		std::string mesh;
+		int resolution = 0;
+		int vertices = 0;
+		float scalarMs = 0.f;			//! previous generator, one vertex at a time
+		float singleThreadMs = 0.f;		//! rows four vertices at a time
+		float parallelMs = 0.f;			//! bands of rows on all hardware threads
+		bool matches = false;			//! same bits as the previous generator
+	};
+
+	//! terrain quadtree selection over a scripted flythrough of the landscape, against the flat plane drawn whole every frame
+	struct TerrainResult
+	{
+		float lodBias = 1.f;
+		int planeTriangles = 0;
+		float triangles = 0.f;			//! average per frame
+		int maxTriangles = 0;
+		float nodes = 0.f;				//! average draws per frame
+		float culledNodes = 0.f;		//! average subtrees skipped by the frustum
+		float finestSpacing = 0.f;		//! average vertex spacing of the finest selected node, the plane had 1
+		float selectMicroseconds = 0.f;
+	};
+
+	//! surface bake of the landscape heightmap, and the vertex texture fetches it saves along the terrain flythrough
+	struct TerrainBakeResult
+	{
+		int texels = 0;
+		float singleThreadMs = 0.f;
+		float bakeMs = 0.f;				//! all hardware threads
+		float keyMs = 0.f;				//! hashing the heights for the cache key
+		float cacheLoadMs = 0.f;		//! reading back the saved bake
+		float vertices = 0.f;			//! grid vertices per frame of the main pass, average
+		int fetchesBefore = 6;			//! per vertex, morph height, height and four normal taps of the heightmap
+		int fetchesAfter = 2;			//! per vertex, morph height and surface
+	};
+
+	//! water trimmed to the landscape at one level, against the full plane it replaced
+	struct WaterMeshResult
+	{
+		float level = 0.f;			//! scene height of the water, -3 is the default scene
+		int planeVertices = 0;
+		int planeQuads = 0;
+		int vertices = 0;
+		int quads = 0;
+		float buildMs = 0.f;		//! terrain scan and buffers
+		float rebuildMs = 0.f;		//! buffers only, after a level change
+	};
+
+	//! one mesh built for several objects, each building its own against sharing it through the geometry registry
+	struct GeometryRegistryResult
+	{
+		std::string mesh;
+		int instances = 0;
+		float separateMs = 0.f;		//! every object builds and uploads its own copy
+		float separateKB = 0.f;
+		float sharedMs = 0.f;		//! acquired, one build and the hits, file hashing included
+		float sharedKB = 0.f;
+		GeometryRegistry::Stats stats;
+	};
+
+	//! CPU terrain queries against the landscape surface, rays checked against a fine march of the same heights
+	struct HeightfieldQueryResult
+	{
+		int queries = 0;
+		float buildMs = 0.f;
+		float scalarMQps = 0.f;			//! million height queries per second, one call each
+		float batchedMQps = 0.f;
+		float scalarNormalMQps = 0.f;
+		float batchedNormalMQps = 0.f;
+		bool batchMatches = false;		//! batched heights and normals have the bits of the single queries
+		int rays = 0;
+		int hits = 0;
+		float rayMicroseconds = 0.f;
+		float patchesPerRay = 0.f;		//! bilinear patches solved, the pyramid skips the rest
+		int marchChecked = 0;			//! rays also marched in steps of marchStep
+		int marchAgreed = 0;			//! hit or missed as the march did, within a step of it
+		float marchStep = 0.f;
+	};
+
+	//! procedural heightmap tiles on a number of threads, the calling thread included
+	struct HeightGeneratorResult
+	{
+		std::string noise;
+		int threads = 0;
+		int tileSize = 0;
+		int tiles = 0;
+		float megasamplesPerSecond = 0.f;
+		float scalarMegasamplesPerSecond = 0.f;		//! HeightGenerator::sample on one thread
+		float speedup = 0.f;						//! against one thread
+		bool matches = false;						//! same bits as the single thread tiles
+	};
+
+	//! horizon occlusion of a heightmap on one and on all hardware threads
+	struct OcclusionBakeResult
+	{
+		std::string map;
+		int size = 0;
+		int directions = 0;
+		int threads = 0;
+		float singleThreadMs = 0.f;
+		float bakeMs = 0.f;				//! on all threads
+		float megatexelsPerSecond = 0.f;	//! on all threads, texels times directions
+		bool matches = false;			//! same bytes whatever the thread count
+		float loadMs = 0.f;				//! reading the bake back from its cache file
+		float averageVisibility = 0.f;
+	};
+
+	//! camera flown in a straight line over the streamed terrain at a paced 60 frames per second
+	struct TerrainStreamingResult
+	{
+		float speed = 0.f;				//! units per second
+		int frames = 0;
+		float averageUpdateMs = 0.f;	//! what the frame pays for the streaming
+		float maxUpdateMs = 0.f;
+		int maxQueued = 0;
+		float averageTimeToResidentMs = 0.f;
+		float maxTimeToResidentMs = 0.f;
+		int generated = 0;
+		int evicted = 0;
+		int holeFrames = 0;				//! frames with a tile within the load radius not resident
+		int maxMissing = 0;
+	};
+
+	//! foliage point mesh filled with random points the way the scene populates it
+	struct FoliagePopulationResult
+	{
+		int points = 0;
+		float rebuildMs = -1.f;			//! previous addVertex, both buffers recreated from a copy of the list per point, only run up to the limit
+		float addVertexMs = 0.f;		//! addVertex per point, committed one at a time
+		int addVertexCreations = 0;		//! times the buffers were recreated by it
+		float batchMs = 0.f;			//! reserve, append all, one commit
+		float tailAppendMs = 0.f;		//! another 1% appended and committed after the batch
+		bool tailRecreated = false;		//! whether that append had to recreate the buffers rather than map their tail
+	};
+
+	//! foliage placement, the previous compute and readback against the Poisson scatter at the scene's spacing and denser
+	struct FoliageScatterResult
+	{
+		std::string method;
+		float minDistance = 0.f;		//! of the scatter, 0 for the compute
+		int instances = 0;
+		float startupMs = 0.f;			//! from nothing to positions with heights on the CPU, the brush decode included for the scatter
+		float singleThreadMs = 0.f;		//! scatter alone on one thread
+		float instancesPerSecond = 0.f;	//! scatter alone on all threads
+		int threads = 0;
+		bool matches = true;			//! same points on one thread and all
+	};
+
+	//! depth keys of random points sorted on the GPU, checked against the CPU reference of the same network
+	struct DepthSortResult
+	{
+		int points = 0;
+		int passes = 0;				//! dispatches of the sort, the key dispatch not counted
+		float gpuMs = 0.f;			//! upload, keys, sort and readback, buffers already grown
+		float referenceMs = 0.f;	//! the network run on the CPU
+		float stdSortMs = 0.f;		//! std::sort of the same keys
+	};
+
+	//! random points ordered by CPUDepthSort from no order and from the order of a camera a small step back
+	struct CPUDepthSortResult
+	{
+		int points = 0;
+		float radixMs = 0.f;			//! 32 bit keys from no order, keys included, buffers already grown
+		float shortRadixMs = 0.f;		//! 16 bit keys from no order
+		float stdSortMs = 0.f;			//! std::sort of the 32 bit keys, keys not included
+		float nearlySortedMs = 0.f;		//! 32 bit keys from the last order
+		bool insertion = false;			//! the insertion pass sorted the nearly sorted case, the radix sort otherwise
+		unsigned int descents = 0;		//! out of order neighbours the nearly sorted case started with
+		float updateMs = 0.f;			//! calling thread's share of the frame that starts a sort on the worker
+		float publishedMs = 0.f;		//! from that update to the one publishing the order, polled without frames in between
+		bool matches = false;			//! orders from no order equal to std::sort, the others far to near by their keys
+	};
+
+	//! parses every shipped model a few times with both loaders
+	void runObjLoader(int iterations = 5);
+
+	//! loads every shipped model with Model and AModel and collects their welding numbers
+	void runWelding(ID3D11Device* device);
+
+	//! deletes the baked caches, then loads every shipped model twice with Model and AModel
+	void runMeshCache(ID3D11Device* device);
+
+	//! builds the models and procedural meshes and collects their ACMR/ATVR before and after optimisation
+	void runVertexCache(ID3D11Device* device);
+
+	//! packs the welded models and the landscape plane and compares the error against the guaranteed bounds
+	void runVertexPacking(ID3D11Device* device);
+
+	//! builds the meshlets of every shipped model and culls them from views circling the model, no device work
+	void runMeshlets(int iterations = 5, int views = 256);
+
+	//! tokenizes every shipped model with TokenStream and TokenScanner, counting heap allocations on this thread in debug builds
+	void runTokenizer(int iterations = 5);
+
+	//! deletes the AModel cache before every load and imports every shipped model with both import paths
+	void runAModelImport(ID3D11Device* device, int iterations = 3);
+
+	//! builds the plane, sphere and cube at several resolutions and compares their buffers with the unrolled meshes
+	void runGridMeshes(ID3D11Device* device, int iterations = 3);
+
+	//! generates the sphere and cube faces from resolution 20 to 512 with the previous and the row generators, no device work
+	void runCubeFaces(int iterations = 3);
+
+	//! selects the landscape nodes along a flythrough circling the terrain at several lod biases, no device work
+	void runTerrain(int frames = 256);
+
+	//! bakes the landscape surface on one and on all threads, saves and reloads it, and counts the vertices of the flythrough
+	void runTerrainBake(int iterations = 3, int frames = 256);
+
+	//! trims the water to the landscape at the default level and around it, compared with the full 100x100 plane
+	void runWaterMesh(ID3D11Device* device, int iterations = 5);
+
+	//! builds the scene's procedural meshes and models once per object, then acquires them through a geometry registry
+	void runGeometryRegistry(ID3D11Device* device, int instances = 8);
+
+	//! samples the landscape surface at random points one by one and batched, and casts rays at it from above, no device work
+	void runHeightfieldQuery(int queries = 1 << 20, int rays = 4096, int marchedRays = 64);
+
+	//! generates a block of fBm and warped ridged tiles on 1, 2, 4... up to all hardware threads, no device work
+	void runHeightGenerator(int tileSize = 512, int tilesPerSide = 2);
+
+	//! bakes the occlusion of the landscape heightmap and of a generated 4096x4096 one, no device work
+	void runOcclusionBake(int directions = 16);
+
+	//! streams the terrain tiles under a camera flying at increasing speeds, uploads through the immediate context
+	void runTerrainStreaming(ID3D11Device* device, int frames = 300);
+
+	//! populates foliage point meshes of 5k, 50k and 500k points per point and batched, the per point rebuild only up to rebuildLimit points
+	void runFoliagePopulation(ID3D11Device* device, int rebuildLimit = 5000);
+
+	//! scene the foliage benchmarks run against, the previous compute needs the shader and maps, the heights come from the landscape
+	void setFoliageScene(D3D* renderer, FoliageShader* shader, const FoliageShader::ComputeParams& computeParams, const HeightfieldQuery* heights, GPUOrderShader* orderShader);
+
+	//! places the foliage with the previous compute, copy back and rand() filter, then scatters it on the CPU at the scene's and denser spacings
+	void runFoliageScatter();
+
+	//! sorts 5k, 100k and 1M random points on the GPU, with the network run on the CPU and with std::sort, the test target checks the results
+	void runDepthSort();
+
+	//! orders 5k, 100k and 1M random points with CPUDepthSort, from no order, from the order of a camera moved a thousandth of a unit and on its worker
+	void runCPUDepthSort();
+
+	//! draws the buttons and the last results
+	void gui(ID3D11Device* device);
+
+private:
+	std::vector<ObjLoaderResult> objLoaderResults_;
+	std::vector<WeldingResult> weldingResults_;
+	std::vector<MeshCacheResult> meshCacheResults_;
+	std::vector<VertexCacheResult> vertexCacheResults_;
+	std::vector<VertexPackingResult> vertexPackingResults_;
+	std::vector<MeshletResult> meshletResults_;
+	std::vector<TokenizerResult> tokenizerResults_;
+	std::vector<AModelImportResult> aModelImportResults_;
+	std::vector<GridMeshResult> gridMeshResults_;
+	std::vector<CubeFacesResult> cubeFacesResults_;
+	std::vector<TerrainResult> terrainResults_;
+	std::vector<TerrainBakeResult> terrainBakeResults_;
+	std::vector<WaterMeshResult> waterMeshResults_;
+	std::vector<GeometryRegistryResult> geometryRegistryResults_;
+	std::vector<HeightGeneratorResult> heightGeneratorResults_;
+	std::vector<HeightfieldQueryResult> heightfieldQueryResults_;
+	std::vector<OcclusionBakeResult> occlusionBakeResults_;
+	std::vector<TerrainStreamingResult> terrainStreamingResults_;
+	std::vector<FoliagePopulationResult> foliagePopulationResults_;
+	std::vector<FoliageScatterResult> foliageScatterResults_;
+
+	D3D* foliageRenderer_ = NULL;
+	FoliageShader* foliageShader_ = NULL;
+	FoliageShader::ComputeParams foliageComputeParams_ = {};
+	const HeightfieldQuery* foliageHeights_ = NULL;
+	GPUOrderShader* orderShader_ = NULL;
+	std::vector<DepthSortResult> depthSortResults_;
+	std::vector<CPUDepthSortResult> cpuDepthSortResults_;
+};
+
+#endif
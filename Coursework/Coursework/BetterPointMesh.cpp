@@ -1,74 +1,182 @@
 #include "BetterPointMesh.h"
 #include "ShaderUtils.h"
+#include <algorithm>
 #include <vector>
 
+BetterPointMesh::BetterPointMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext) : PointMesh(device, deviceContext)
+{
+	//! the point mesh creates its three points, the list starts empty and the buffers are created on the first commit
+	ReleaseBuffer(&vertexBuffer);
+	ReleaseBuffer(&indexBuffer);
+	deviceContext_ = deviceContext;
+	vertexCount_ = 0;
+	indexCount_ = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+
+	//! the vertex buffer has a shader view for the depth sort, mapping it without overwrite needs a D3D11.1 driver that says so
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	noOverwriteVertices_ = SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.MapNoOverwriteOnDynamicBufferSRV;
+}
+
+BetterPointMesh::~BetterPointMesh()
+{
+	ReleaseBuffer(&orderBuffer_);
+	PointMesh::~PointMesh();
+}
+
 //! add a vertex to the point list, used for geometry shader
 void BetterPointMesh::addVertex(ID3D11Device* device, VertexType toAdd, XMFLOAT3 positionOffset)
 {
-	toAdd.position.x += positionOffset.x;
-	toAdd.position.y += positionOffset.y;
-	toAdd.position.z += positionOffset.z;
-	vertices_.push_back(toAdd);
-	vertexCount_++;
-	indexCount_ = vertexCount_;
-
-	//! recalculates the indices and vertex buffers.
-	initBuffers(device);
+	appendVertices(&toAdd, 1, positionOffset);
+	commit(device);
+}
+
+void BetterPointMesh::reserve(int count)
+{
+	vertices_.reserve(count);
+	reserved_ = std::max(reserved_, count);
+}
+
+void BetterPointMesh::appendVertices(const VertexType* vertices, int count, XMFLOAT3 positionOffset)
+{
+	size_t first = vertices_.size();
+	vertices_.insert(vertices_.end(), vertices, vertices + count);
+	for (size_t i = first; i < vertices_.size(); i++)
+	{
+		vertices_[i].position.x += positionOffset.x;
+		vertices_[i].position.y += positionOffset.y;
+		vertices_[i].position.z += positionOffset.z;
+	}
+}
+
+void BetterPointMesh::commit(ID3D11Device* device)
+{
+	int count = (int)vertices_.size();
+	if (count == committed_)
+		return;
+
+	bool written;
+	if (count > capacity_)
+	{
+		//! a new buffer holds nothing, all of the list goes in, and nothing is drawn from it until it does
+		createBuffers(device, count);
+		committed_ = 0;
+		vertexCount_ = 0;
+		indexCount_ = 0;
+		written = writeVertices(0, count, D3D11_MAP_WRITE_DISCARD) && writeIndices(0, count, D3D11_MAP_WRITE_DISCARD);
+	}
+	else
+	{
+		//! the committed part may still be drawn from, the tail past it is written without touching it
+		//! without the driver support the vertices are all written again into a discarded buffer
+		written = (noOverwriteVertices_ ? writeVertices(committed_, count - committed_, D3D11_MAP_WRITE_NO_OVERWRITE) : writeVertices(0, count, D3D11_MAP_WRITE_DISCARD)) &&
+			writeIndices(committed_, count - committed_, D3D11_MAP_WRITE_NO_OVERWRITE);
+	}
+
+	//! the vertices stay uncommitted, the next commit writes them again
+	if (!written)
+		return;
+
+	committed_ = count;
+	vertexCount_ = count;
+	indexCount_ = count;
+
+	//! an order made before covers only the old vertices, and a grown mesh draws more than its buffer holds
+	drawIndices_ = NULL;
+}
+
+void BetterPointMesh::sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLOGY top)
+{
+	unsigned int stride = sizeof(VertexType);
+	unsigned int offset = 0;
+
+	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	deviceContext->IASetIndexBuffer(drawIndices_ ? drawIndices_ : indexBuffer, indexFormat, 0);
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
 }
 
-//! recalculates the incdeces and vertices, adds them to the buffer
-void BetterPointMesh::initBuffers(ID3D11Device* device)
+void BetterPointMesh::setDrawOrder(ID3D11Device* device, const std::vector<unsigned int>& order)
+{
+	//! an order of another point set, e.g. sorted before the last commit, would draw the wrong or missing points
+	if (committed_ == 0 || (int)order.size() != committed_)
+		return;
+
+	//! grows with the vertex buffers, not with every order
+	if (orderCapacity_ < capacity_)
+	{
+		ReleaseBuffer(&orderBuffer_);
+		orderCapacity_ = capacity_;
+
+		D3D11_BUFFER_DESC orderBufferDesc;
+		orderBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		orderBufferDesc.ByteWidth = sizeof(unsigned int) * orderCapacity_;
+		orderBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		orderBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		orderBufferDesc.MiscFlags = 0;
+		orderBufferDesc.StructureByteStride = 0;
+		device->CreateBuffer(&orderBufferDesc, NULL, &orderBuffer_);
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(deviceContext_->Map(orderBuffer_, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+		return;
+	memcpy(mappedResource.pData, order.data(), sizeof(unsigned int) * committed_);
+	deviceContext_->Unmap(orderBuffer_, 0);
+
+	drawIndices_ = orderBuffer_;
+}
+
+void BetterPointMesh::createBuffers(ID3D11Device* device, int count)
 {
 	//! remove old buffers
 	ReleaseBuffer(&vertexBuffer);
 	ReleaseBuffer(&indexBuffer);
 
-	//! copy the list of the orihinal vertices, used as a way to preserve the points betwen calls
-	std::vector<VertexType> vertices;
-	vertices.resize(vertexCount_);
-	memcpy(vertices.data(), vertices_.data(), sizeof(VertexType) * vertexCount_);
+	//! half as much again as needed, so growing one point at a time recreates the buffers a logarithmic number of times
+	capacity_ = std::max(std::max(reserved_, count + count / 2), 64);
 
-	//! define the arrays and descriptors
-	unsigned long* indices;
 	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData, indexData;
-
-	indices = new unsigned long[indexCount_];
-
-	//! fill up indices array, default order, presumes the vertices are already ordered desirably
-	for (int i = 0; i < vertexCount_; i++) 
-		indices[i] = i;  
 
-	//! Set up the description of the static vertex buffer.
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexType) * vertexCount_;
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
+	//! Set up the description of the dynamic vertex buffer.
+	vertexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	vertexBufferDesc.ByteWidth = sizeof(VertexType) * capacity_;
+	//! also a shader resource, the depth sort reads the positions straight from it
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_SHADER_RESOURCE;
+	vertexBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	vertexBufferDesc.MiscFlags = 0;
 	vertexBufferDesc.StructureByteStride = 0;
-	//! Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices.data();
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-	//! Now create the vertex buffer. Seems to mess around the input array
-	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
-
-	//! Set up the description of the static index buffer.
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long) * indexCount_;
+	device->CreateBuffer(&vertexBufferDesc, NULL, &vertexBuffer);
+	vertexStride = sizeof(VertexType);
+
+	//! Set up the description of the dynamic index buffer.
+	indexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	indexBufferDesc.ByteWidth = sizeof(unsigned int) * capacity_;
 	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
+	indexBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	indexBufferDesc.MiscFlags = 0;
 	indexBufferDesc.StructureByteStride = 0;
-	//! Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-	//! Create the index buffer. Seems to mess arounf with the input array
-	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
-
-	//! cleanup
-	vertices.clear();
-	delete[] indices;
-	indices = 0;
+	device->CreateBuffer(&indexBufferDesc, NULL, &indexBuffer);
+}
+
+bool BetterPointMesh::writeVertices(int first, int count, D3D11_MAP mapping)
+{
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (!vertexBuffer || FAILED(deviceContext_->Map(vertexBuffer, 0, mapping, 0, &mappedResource)))
+		return false;
+	memcpy(static_cast<VertexType*>(mappedResource.pData) + first, vertices_.data() + first, sizeof(VertexType) * count);
+	deviceContext_->Unmap(vertexBuffer, 0);
+	return true;
+}
+
+bool BetterPointMesh::writeIndices(int first, int count, D3D11_MAP mapping)
+{
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (!indexBuffer || FAILED(deviceContext_->Map(indexBuffer, 0, mapping, 0, &mappedResource)))
+		return false;
+	unsigned int* indices = static_cast<unsigned int*>(mappedResource.pData);
+	for (int i = first; i < first + count; i++)
+		indices[i] = i;
+	deviceContext_->Unmap(indexBuffer, 0);
+	return true;
 }
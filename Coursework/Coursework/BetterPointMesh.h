@@ -6,17 +6,49 @@ class BetterPointMesh :
 {
 
 public:
-	BetterPointMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext) : PointMesh(device, deviceContext) { vertexCount_ = 0; indexCount_ = 0; };
-	~BetterPointMesh() { PointMesh::~PointMesh();};
-	
-	//!adds the vertex to the list and updates the buffers. 
+	BetterPointMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext);
+	~BetterPointMesh();
+
+	//!adds the vertex to the list and commits it, maps the tail of the buffers unless they have to grow
 	void addVertex(ID3D11Device* device, VertexType toAdd, XMFLOAT3 positionOffset = {0,0,0});
-	
+
+	//! makes room for count vertices in total, the next buffers created have at least this capacity
+	void reserve(int count);
+	//! adds the vertices to the list with the offset applied, nothing reaches the GPU until commit
+	void appendVertices(const VertexType* vertices, int count, XMFLOAT3 positionOffset = {0,0,0});
+	//! uploads the vertices appended since the last commit, maps the tail of the buffers when they have room and recreates them with spare capacity otherwise
+	void commit(ID3D11Device* device);
+
+	//! binds the vertices with the draw indices when they are set, the identity indices otherwise
+	void sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLOGY top = D3D11_PRIMITIVE_TOPOLOGY_POINTLIST) override;
+	//! draws the points in the order of these 32 bit indices, e.g. the far to near order GPUDepthSort writes, NULL goes back to the identity
+	//! they have to cover every committed vertex, the mesh does not own them, a commit that adds vertices goes back to the identity
+	void setDrawIndices(ID3D11Buffer* indices) { drawIndices_ = indices; }
+	//! uploads an order sorted on the CPU, e.g. by CPUDepthSort, into a dynamic index buffer of the mesh and draws with it
+	//! the order has to have one index per committed vertex, one made before vertices were appended is ignored
+	void setDrawOrder(ID3D11Device* device, const std::vector<unsigned int>& order);
+
 	std::vector<VertexType>* getVerticesVector() { return &vertices_; }
-	void initBuffers(ID3D11Device* device);
+	//! the vertices can be read as floats by compute shaders, it is recreated when the capacity grows
+	ID3D11Buffer* getVertexBuffer() { return vertexBuffer; }
+	int getCapacity() { return capacity_; }
 
 protected:
+	//! recreates both dynamic buffers with room for the count vertices and spare capacity, empty
+	void createBuffers(ID3D11Device* device, int count);
+	//! write [first, first + count) of the list and of the identity indices into the mapped buffers, false when the buffer could not be mapped
+	bool writeVertices(int first, int count, D3D11_MAP mapping);
+	bool writeIndices(int first, int count, D3D11_MAP mapping);
+
 	std::vector<VertexType> vertices_;
+	ID3D11DeviceContext* deviceContext_;
+	ID3D11Buffer* drawIndices_ = NULL;
+	ID3D11Buffer* orderBuffer_ = NULL;	//! written by setDrawOrder
+	int orderCapacity_ = 0;
+	int capacity_ = 0;			//! vertices the GPU buffers have room for
+	int reserved_ = 0;			//! capacity asked for with reserve
+	int committed_ = 0;			//! vertices already in the GPU buffers
+	bool noOverwriteVertices_ = false;	//! MapNoOverwriteOnDynamicBufferSRV, the vertex buffer has a shader view
 
 };
 
@@ -0,0 +1,209 @@
+#include "CPUDepthSort.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+CPUDepthSort::CPUDepthSort() : worker_(1)
+{
+}
+
+CPUDepthSort::~CPUDepthSort()
+{
+	//! the job reads the members, it has to end before they do
+	if (job_.valid())
+		job_.wait();
+}
+
+void CPUDepthSort::setPoints(const void* positions, size_t stride, unsigned int count)
+{
+	finish();
+
+	positions_.resize(count);
+	const char* position = static_cast<const char*>(positions);
+	for (unsigned int i = 0; i < count; i++, position += stride)
+		positions_[i] = *reinterpret_cast<const XMFLOAT3*>(position);
+
+	order_.clear();
+	started_ = false;
+}
+
+bool CPUDepthSort::update(XMFLOAT3 camera)
+{
+	//! the worker is still sorting, the last order stays until it is done
+	bool published = false;
+	if (job_.valid())
+	{
+		if (job_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+		finish();
+		published = true;
+	}
+
+	if (positions_.empty())
+		return published;
+
+	//! distances barely change for a small move, turning the camera changes none of them
+	float dx = camera.x - lastCamera_.x, dy = camera.y - lastCamera_.y, dz = camera.z - lastCamera_.z;
+	if (started_ && dx * dx + dy * dy + dz * dz < settings_.moveThreshold * settings_.moveThreshold)
+	{
+		stats_.skipped++;
+		return published;
+	}
+
+	lastCamera_ = camera;
+	started_ = true;
+	Settings settings = settings_;
+	job_ = worker_.submit([this, camera, settings]() { sort(camera, settings); });
+	return published;
+}
+
+void CPUDepthSort::sortNow(XMFLOAT3 camera)
+{
+	finish();
+	if (positions_.empty())
+		return;
+
+	lastCamera_ = camera;
+	started_ = true;
+	sort(camera, settings_);
+	order_.swap(sorted_);
+	stats_.sortMs = jobStats_.sortMs;
+	stats_.insertion = jobStats_.insertion;
+	stats_.descents = jobStats_.descents;
+	stats_.moves = jobStats_.moves;
+	stats_.sorts++;
+}
+
+void CPUDepthSort::finish()
+{
+	if (!job_.valid())
+		return;
+
+	job_.get();
+	order_.swap(sorted_);
+	stats_.sortMs = jobStats_.sortMs;
+	stats_.insertion = jobStats_.insertion;
+	stats_.descents = jobStats_.descents;
+	stats_.moves = jobStats_.moves;
+	stats_.sorts++;
+}
+
+void CPUDepthSort::sort(XMFLOAT3 camera, Settings settings)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	unsigned int count = (unsigned int)positions_.size();
+	makeKeys(camera, settings.shortKeys);
+
+	//! keys in the last order, points as far as each other keep it
+	bool seeded = order_.size() == count;
+	for (unsigned int i = 0; i < count; i++)
+		keys_[i].index = seeded ? order_[i] : i;
+	for (unsigned int i = 0; i < count; i++)
+		keys_[i].depth = scratch_[keys_[i].index].depth;
+
+	jobStats_.insertion = false;
+	jobStats_.descents = 0;
+	jobStats_.moves = 0;
+	if (seeded)
+	{
+		for (unsigned int i = 1; i < count; i++)
+			jobStats_.descents += keys_[i].depth < keys_[i - 1].depth;
+
+		if (jobStats_.descents <= settings.maxDescents * count)
+			jobStats_.insertion = insertionSort((unsigned long long)(settings.insertionBudget * count));
+	}
+	if (!jobStats_.insertion)
+		radixSort(settings.shortKeys ? 2 : 4);
+
+	sorted_.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+		sorted_[i] = keys_[i].index;
+
+	jobStats_.sortMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void CPUDepthSort::makeKeys(XMFLOAT3 camera, bool shortKeys)
+{
+	//! the keys are made in point order in scratch_, sort() gathers them in the last order
+	unsigned int count = (unsigned int)positions_.size();
+	keys_.resize(count);
+	scratch_.resize(count);
+	if (!shortKeys)
+	{
+		//! the float bits of the squared distance flipped, as the GPU sort keys them
+		for (unsigned int i = 0; i < count; i++)
+			scratch_[i].depth = DepthSort::depthKey(positions_[i], camera);
+		return;
+	}
+
+	//! the distance from the nearest to the furthest point over 16 bits, the furthest point is 0
+	distances_.resize(count);
+	float nearest = INFINITY, furthest = 0.f;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float dx = positions_[i].x - camera.x, dy = positions_[i].y - camera.y, dz = positions_[i].z - camera.z;
+		distances_[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+		nearest = std::min(nearest, distances_[i]);
+		furthest = std::max(furthest, distances_[i]);
+	}
+
+	float scale = furthest > nearest ? 65535.f / (furthest - nearest) : 0.f;
+	for (unsigned int i = 0; i < count; i++)
+		scratch_[i].depth = std::min((unsigned int)((furthest - distances_[i]) * scale), 65535u);
+}
+
+bool CPUDepthSort::insertionSort(unsigned long long budget)
+{
+	unsigned long long moves = 0;
+	DepthSort::Key* keys = keys_.data();
+	for (size_t i = 1; i < keys_.size(); i++)
+	{
+		if (keys[i].depth >= keys[i - 1].depth)
+			continue;
+
+		DepthSort::Key key = keys[i];
+		size_t j = i;
+		for (; j > 0 && key.depth < keys[j - 1].depth; j--)
+			keys[j] = keys[j - 1];
+		keys[j] = key;
+
+		moves += i - j;
+		if (moves > budget)
+		{
+			jobStats_.moves = (unsigned int)moves;
+			return false;
+		}
+	}
+
+	jobStats_.moves = (unsigned int)moves;
+	return true;
+}
+
+void CPUDepthSort::radixSort(int passes)
+{
+	//! the counts of every pass from one read of the keys
+	size_t count = keys_.size();
+	std::vector<unsigned int> counts(256 * passes, 0);
+	for (const DepthSort::Key& key : keys_)
+		for (int pass = 0; pass < passes; pass++)
+			counts[pass * 256 + ((key.depth >> (pass * 8)) & 0xFF)]++;
+
+	for (int pass = 0; pass < passes; pass++)
+	{
+		unsigned int* digitCounts = &counts[pass * 256];
+		if (digitCounts[(keys_[0].depth >> (pass * 8)) & 0xFF] == count)
+			continue;
+
+		unsigned int offset = 0;
+		for (int digit = 0; digit < 256; digit++)
+		{
+			unsigned int digitCount = digitCounts[digit];
+			digitCounts[digit] = offset;
+			offset += digitCount;
+		}
+
+		for (const DepthSort::Key& key : keys_)
+			scratch_[digitCounts[(key.depth >> (pass * 8)) & 0xFF]++] = key;
+		keys_.swap(scratch_);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef _CPU_DEPTH_SORT_H
+#define _CPU_DEPTH_SORT_H
+#include "DepthSort.h"
+#include "ThreadPool.h"
+#include <future>
+#include <vector>
+
+using namespace DirectX;
+
+//! back to front order of points sorted on a worker thread, the order a frame starts is published by the next update
+//! the order barely changes while the camera moves smoothly, so every sort starts from the last one: an insertion pass over it
+//! when it is nearly right, an LSD radix sort of the depth keys otherwise, and nothing at all while the camera stays put
+class CPUDepthSort
+{
+public:
+
+	struct Settings
+	{
+		bool shortKeys = false;			//! 16 bit keys of the distance between the nearest and the furthest point, two radix passes instead of four
+		float moveThreshold = 0.05f;	//! camera moves shorter than this keep the last order
+		float maxDescents = 0.25f;		//! out of order neighbours per point in the last order up to which the insertion pass is tried, an unrelated order has about half
+		float insertionBudget = 2.f;	//! moves per point the insertion pass makes before the radix sort takes over
+	};
+
+	struct Stats
+	{
+		float sortMs = 0.f;				//! last sort on the worker, keys included
+		bool insertion = false;			//! the last sort was done by the insertion pass
+		unsigned int descents = 0;		//! out of order neighbours the last sort started with, 0 without a last order
+		unsigned int moves = 0;			//! keys the insertion pass shifted by one
+		int sorts = 0;
+		int skipped = 0;				//! updates that kept the last order as the camera had not moved far enough
+	};
+
+	CPUDepthSort();
+	~CPUDepthSort();
+
+	//! copies count positions stride bytes apart, the last order is dropped, waits for a sort still running
+	//! points appended to the source later are not seen, call it again with all of them
+	void setPoints(const void* positions, size_t stride, unsigned int count);
+	unsigned int getPointCount() const { return (unsigned int)positions_.size(); }
+	//! applies to the next sort started
+	void setSettings(const Settings& settings) { settings_ = settings; }
+	const Settings& getSettings() const { return settings_; }
+
+	//! call once a frame, publishes the order of the sort started by an earlier update once it is done, then starts the next one
+	//! when the camera moved far enough and the worker is free, returns true when a new order was published
+	bool update(XMFLOAT3 camera);
+	//! sorts on the calling thread and publishes the order at once, as a finished job would
+	void sortNow(XMFLOAT3 camera);
+
+	//! point indices far to near, empty until the first sort after setPoints is published
+	const std::vector<unsigned int>& getOrder() const { return order_; }
+	const Stats& getStats() const { return stats_; }
+
+private:
+	// Worker and buffers are owned.
+	CPUDepthSort(const CPUDepthSort&);
+	CPUDepthSort& operator=(const CPUDepthSort&);
+
+	//! the job, reads the published order and writes only the sorted ones
+	void sort(XMFLOAT3 camera, Settings settings);
+	void makeKeys(XMFLOAT3 camera, bool shortKeys);
+	//! stable insertion sort by depth, gives up with the keys part sorted once it made budget moves
+	bool insertionSort(unsigned long long budget);
+	//! stable LSD radix sort by depth, a byte per pass, passes where every key has the same byte are skipped
+	void radixSort(int passes);
+	//! waits for a running job and publishes its order
+	void finish();
+
+	Settings settings_;
+	ThreadPool worker_;
+	std::future<void> job_;
+	XMFLOAT3 lastCamera_ = XMFLOAT3(0.f, 0.f, 0.f);	//! the camera the last sort was started for
+	bool started_ = false;								//! a sort was started since setPoints
+
+	std::vector<XMFLOAT3> positions_;
+	std::vector<unsigned int> order_;					//! published, read by the job as its starting order
+	Stats stats_;
+
+	//! written by the job only
+	std::vector<float> distances_;
+	std::vector<DepthSort::Key> keys_;
+	std::vector<DepthSort::Key> scratch_;
+	std::vector<unsigned int> sorted_;
+	Stats jobStats_;
+};
+
+#endif
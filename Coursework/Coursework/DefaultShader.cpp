@@ -4,6 +4,7 @@
 DefaultShader::DefaultShader(ID3D11Device* device, HWND hwnd) : BaseShader(device, hwnd)
 {
 	initShader(L"default_vs.cso", L"default_ps.cso");
+	loadPackedVertexShader(L"default_packed_vs.cso");
 }
 
 DefaultShader::~DefaultShader()
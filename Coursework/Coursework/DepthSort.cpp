@@ -0,0 +1,77 @@
+#include "DepthSort.h"
+#include <algorithm>
+
+namespace
+{
+	//! compare and swap of the pair (i, i + step), ascending where bit level of i is clear, as in the shaders
+	inline void compareExchange(DepthSort::Key* keys, unsigned int first, unsigned int i, unsigned int step, unsigned int level)
+	{
+		DepthSort::Key& a = keys[i];
+		DepthSort::Key& b = keys[i + step];
+		bool ascending = ((first + i) & level) == 0;
+		if (DepthSort::less(b, a) == ascending)
+			std::swap(a, b);
+	}
+
+	//! element thread t compares, the pairs of a step are (i, i + step) with i in the lower half of every 2 * step elements
+	inline unsigned int pairStart(unsigned int thread, unsigned int step)
+	{
+		return (thread / step) * step * 2 + thread % step;
+	}
+}
+
+unsigned int DepthSort::paddedCount(unsigned int count)
+{
+	unsigned int padded = k_GroupSize;
+	while (padded < count)
+		padded <<= 1;
+	return padded;
+}
+
+void DepthSort::buildPasses(unsigned int paddedCount, std::vector<Pass>& passes)
+{
+	passes.clear();
+
+	//! every group sorted, ascending and descending in turn, so pairs of groups are bitonic sequences
+	passes.push_back({ true, 2, k_GroupSize, 0 });
+
+	for (unsigned int level = k_GroupSize * 2; level <= paddedCount; level <<= 1)
+	{
+		//! steps across groups go through memory, the ones within a group are finished in shared memory
+		for (unsigned int step = level / 2; step >= k_GroupSize; step >>= 1)
+			passes.push_back({ false, level, level, step });
+		passes.push_back({ true, level, level, 0 });
+	}
+}
+
+void DepthSort::makeKeys(const void* positions, size_t stride, unsigned int count, const XMFLOAT3& camera, std::vector<Key>& keys)
+{
+	keys.resize(paddedCount(count));
+	const char* position = static_cast<const char*>(positions);
+	for (unsigned int i = 0; i < count; i++, position += stride)
+		keys[i] = { depthKey(*reinterpret_cast<const XMFLOAT3*>(position), camera), i };
+	std::fill(keys.begin() + count, keys.end(), k_Padding);
+}
+
+void DepthSort::sortReference(std::vector<Key>& keys, const std::vector<Pass>& passes)
+{
+	const unsigned int count = (unsigned int)keys.size();
+	for (const Pass& pass : passes)
+	{
+		if (!pass.local)
+		{
+			for (unsigned int thread = 0; thread < count / 2; thread++)
+				compareExchange(keys.data(), 0, pairStart(thread, pass.step), pass.step, pass.level);
+			continue;
+		}
+
+		for (unsigned int first = 0; first < count; first += k_GroupSize)
+		{
+			Key* group = keys.data() + first;
+			for (unsigned int level = pass.level; level <= pass.lastLevel; level <<= 1)
+				for (unsigned int step = std::min(level, k_GroupSize) / 2; step > 0; step >>= 1)
+					for (unsigned int thread = 0; thread < k_GroupSize / 2; thread++)
+						compareExchange(group, first, pairStart(thread, step), step, level);
+		}
+	}
+}
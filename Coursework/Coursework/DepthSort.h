@@ -0,0 +1,63 @@
+#pragma once
+#ifndef _DEPTH_SORT_H
+#define _DEPTH_SORT_H
+#include <directxmath.h>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+//! back to front order of points as the GPU sorts it, the keys and the bitonic network of gpu_order_*_cs.hlsl run on the CPU
+//! every (depth, index) pair is different, so any correct sort of them gives the same bits and the reference can check the GPU directly
+namespace DepthSort
+{
+	//! uint2 of the shaders, ascending keys go from far to near and points as far as each other keep their order
+	struct Key
+	{
+		unsigned int depth;
+		unsigned int index;
+	};
+
+	//! elements a group sorts in shared memory, GROUP_SIZE of the shaders, two per thread
+	const unsigned int k_GroupSize = 512;
+	//! fills the sorted buffer up to a power of two, after every point
+	const Key k_Padding = { 0xFFFFFFFF, 0xFFFFFFFF };
+
+	//! one dispatch of the sort
+	struct Pass
+	{
+		bool local;				//! in shared memory, every merge step of each level below the group size
+		unsigned int level;		//! size of the bitonic sequences merged, the first one for a local pass
+		unsigned int lastLevel;	//! local passes only, the presort runs every level up to the group size at once
+		unsigned int step;		//! global passes only, distance of the compared elements, local passes take every step below the group size
+	};
+
+	//! depth key of a point, the bits of its squared distance flipped, computed with the shader's operations in the shader's order
+	inline unsigned int depthKey(const XMFLOAT3& position, const XMFLOAT3& camera)
+	{
+		float dx = position.x - camera.x, dy = position.y - camera.y, dz = position.z - camera.z;
+		float distanceSq = dx * dx + dy * dy + dz * dz;
+		unsigned int bits;
+		memcpy(&bits, &distanceSq, sizeof(bits));
+		return ~bits;
+	}
+
+	inline bool less(const Key& a, const Key& b)
+	{
+		return a.depth < b.depth || (a.depth == b.depth && a.index < b.index);
+	}
+
+	//! elements sorted for count points, a power of two of at least a group
+	unsigned int paddedCount(unsigned int count);
+
+	//! dispatches sorting paddedCount keys, a presort of every group then the merges of the larger levels
+	void buildPasses(unsigned int paddedCount, std::vector<Pass>& passes);
+
+	//! keys of the points, stride bytes apart, followed by padding up to paddedCount
+	void makeKeys(const void* positions, size_t stride, unsigned int count, const XMFLOAT3& camera, std::vector<Key>& keys);
+
+	//! runs the passes group by group and thread by thread as the shaders do
+	void sortReference(std::vector<Key>& keys, const std::vector<Pass>& passes);
+}
+
+#endif
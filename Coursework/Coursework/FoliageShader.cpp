@@ -8,8 +8,7 @@ FoliageShader::FoliageShader(ID3D11Device* device, HWND hwnd) : DefaultShader(de
 	loadGeometryShader(L"foliage_gs.cso");
 	loadComputeShader(L"foliage_cs.cso");
 
-	//! create buffers
-	CreateStructuredBuffer(device, sizeof(VertexComputeBufferType), TEX_HEIGHT * TEX_WIDTH, nullptr, &_vertexComputeBuffer);
+	//! create buffers, the compute results only when computing, the scene scatters its foliage on the CPU
 	setupBuffer<ConstantComputeBufferType>(renderer, &_constantComputeBuffer);
 	setupBuffer<TransformBufferType>(renderer, &_transformBuffer);
 }
@@ -41,9 +40,12 @@ void FoliageShader::Compute(D3D* renderer, void* computeParams)
 
 	// -------- VERTEX COMPUTE BUFFER, compute reg u0 ------------
 	//! UAV only buffer, uses external code
+	if (!_vertexComputeBuffer)
+		CreateStructuredBuffer(renderer->getDevice(), sizeof(VertexComputeBufferType), TEX_HEIGHT * TEX_WIDTH, nullptr, &_vertexComputeBuffer);
     ID3D11UnorderedAccessView* UAV;
 	CreateBufferUAV(renderer->getDevice(),_vertexComputeBuffer, &UAV);
 	renderer->getDeviceContext()->CSSetUnorderedAccessViews(0, 1, &UAV, nullptr);
+	UAV->Release();
 
 	// -------- SAMPLER BUFFER, compute reg s0 ------------
 	//! Sampler, predefined in default shader, originally for pixel shader
@@ -60,6 +62,14 @@ void FoliageShader::Compute(D3D* renderer, void* computeParams)
 	compute(renderer->getDeviceContext(), 1024, 1, 1);
 }
 
+PoissonScatter::Settings FoliageShader::scatterSettings()
+{
+	PoissonScatter::Settings settings;
+	settings.size = 1.f / k_LandscapeUvPerUnit;
+	settings.minDistance = 8.f;
+	return settings;
+}
+
 //! part of the render process, specifies how to handle additional parameters
 void FoliageShader::additionalParameters(ID3D11DeviceContext* device, void* params)
 {
@@ -17,6 +17,8 @@ class FoliageShader :
     {
         float filingPercentage_GPU = 0.5f;
         XMFLOAT3 landscapeScalng = XMFLOAT3(100.f, 1.f, 100.f);
+        float maxHeight = 0.f;          //! height of a heightmap sample of 1, the landscape maxHeight
+        XMFLOAT3 p;
     };
 
     //! additional buffer for random size of each instance of foliage
@@ -61,6 +63,9 @@ public:
 
     void Compute(D3D* renderer, void* computeParams) override;
 
+    //! placement of the scene's foliage, a tree every 8 units at most over the brush map of the 100x100 landscape
+    static PoissonScatter::Settings scatterSettings();
+
 private:
     void additionalParameters(ID3D11DeviceContext* device, void* params) override;
 
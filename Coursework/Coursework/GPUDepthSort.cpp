@@ -0,0 +1,192 @@
+#include "GPUDepthSort.h"
+#include "ShaderUtils.h"
+
+GPUDepthSort::GPUDepthSort(ID3D11Device* device, const Kernels& kernels) : _kernels(kernels)
+{
+	//! the key and index buffers grow with the number of points, the constants are written before every dispatch
+	setupBuffer<SortConstantsBufferType>(device, &_computeConstantBuffer);
+}
+
+GPUDepthSort::~GPUDepthSort()
+{
+	ReleaseBuffer(&_computeConstantBuffer);
+	ReleaseBuffer(&_keyBuffer);
+	ReleaseBuffer(&_indexBuffer);
+	ReleaseBuffer(&_positionBuffer);
+	ReleaseBuffer(&_readbackBuffer);
+	for (ID3D11UnorderedAccessView* view : { _keyUAV, _indexUAV })
+		if (view)
+			view->Release();
+	for (ID3D11ShaderResourceView* view : { _meshPositionSRV, _positionSRV })
+		if (view)
+			view->Release();
+}
+
+void GPUDepthSort::sortMesh(ID3D11Device* device, ID3D11DeviceContext* context, BetterPointMesh* mesh, XMFLOAT3 cameraPos)
+{
+	unsigned int count = (unsigned int)mesh->getVertexCount();
+	if (count == 0)
+		return;
+
+	reserve(device, DepthSort::paddedCount(count));
+
+	//! a view over the vertex buffer, made again only when the mesh grew and recreated it
+	if (mesh->getVertexBuffer() != _meshVertices || mesh->getCapacity() != _meshCapacity)
+	{
+		if (_meshPositionSRV)
+			_meshPositionSRV->Release();
+		_meshVertices = mesh->getVertexBuffer();
+		_meshCapacity = mesh->getCapacity();
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = _meshCapacity * sizeof(BaseMesh::VertexType) / sizeof(float);
+		device->CreateShaderResourceView(_meshVertices, &srvDesc, &_meshPositionSRV);
+	}
+
+	run(context, _meshPositionSRV, sizeof(BaseMesh::VertexType) / sizeof(float), count, cameraPos, true);
+
+	//! the buffer only changes when it grows, setting it every sort keeps the mesh pointing at the current one
+	mesh->setDrawIndices(_indexBuffer);
+}
+
+void GPUDepthSort::sortKeys(ID3D11Device* device, ID3D11DeviceContext* context, const void* positions, size_t stride, unsigned int count, XMFLOAT3 cameraPos, std::vector<DepthSort::Key>& sorted)
+{
+	sorted.clear();
+	if (count == 0)
+		return;
+
+	reserve(device, DepthSort::paddedCount(count));
+	reserveUpload(device);
+
+	// -------- POSITION BUFFER, compute reg t0 ------------
+	auto* positionPtr = MapBufferToPointer<XMFLOAT3>(context, _positionBuffer);
+	const char* position = static_cast<const char*>(positions);
+	for (unsigned int i = 0; i < count; i++, position += stride)
+		positionPtr[i] = *reinterpret_cast<const XMFLOAT3*>(position);
+	context->Unmap(_positionBuffer, 0);
+
+	run(context, _positionSRV, 3, count, cameraPos, false);
+
+	//! only the keys of the points are copied back, the padding sorts after them
+	D3D11_BOX box = { 0, 0, 0, (UINT)(count * sizeof(DepthSort::Key)), 1, 1 };
+	context->CopySubresourceRegion(_readbackBuffer, 0, 0, 0, 0, _keyBuffer, 0, &box);
+	auto* keyPtr = MapBufferToPointer<DepthSort::Key>(context, _readbackBuffer, D3D11_MAP_READ);
+	sorted.assign(keyPtr, keyPtr + count);
+	context->Unmap(_readbackBuffer, 0);
+}
+
+void GPUDepthSort::reserve(ID3D11Device* device, unsigned int paddedCount)
+{
+	if (_passesCount != paddedCount)
+	{
+		DepthSort::buildPasses(paddedCount, _passes);
+		_passesCount = paddedCount;
+	}
+
+	if (paddedCount <= _capacity)
+		return;
+
+	ReleaseBuffer(&_keyBuffer);
+	ReleaseBuffer(&_indexBuffer);
+	for (ID3D11UnorderedAccessView* view : { _keyUAV, _indexUAV })
+		if (view)
+			view->Release();
+	_capacity = paddedCount;
+
+	CreateStructuredBuffer(device, sizeof(DepthSort::Key), _capacity, nullptr, &_keyBuffer);
+	CreateBufferUAV(device, _keyBuffer, &_keyUAV);
+
+	//! index buffers cannot be structured, the kernel stores the indices through a raw view
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = sizeof(unsigned int) * _capacity;
+	desc.BindFlags = D3D11_BIND_INDEX_BUFFER | D3D11_BIND_UNORDERED_ACCESS;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	desc.StructureByteStride = 0;
+	device->CreateBuffer(&desc, nullptr, &_indexBuffer);
+	CreateBufferUAV(device, _indexBuffer, &_indexUAV);
+}
+
+void GPUDepthSort::reserveUpload(ID3D11Device* device)
+{
+	if (_uploadCapacity >= _capacity)
+		return;
+
+	ReleaseBuffer(&_positionBuffer);
+	ReleaseBuffer(&_readbackBuffer);
+	if (_positionSRV)
+		_positionSRV->Release();
+	_uploadCapacity = _capacity;
+
+	//! written every sort, read by the key kernel as floats like the vertex buffer of a mesh
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = sizeof(XMFLOAT3) * _uploadCapacity;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+	device->CreateBuffer(&desc, nullptr, &_positionBuffer);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = _uploadCapacity * 3;
+	device->CreateShaderResourceView(_positionBuffer, &srvDesc, &_positionSRV);
+
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.ByteWidth = sizeof(DepthSort::Key) * _uploadCapacity;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	device->CreateBuffer(&desc, nullptr, &_readbackBuffer);
+}
+
+void GPUDepthSort::run(ID3D11DeviceContext* context, ID3D11ShaderResourceView* positions, unsigned int positionStride, unsigned int count, XMFLOAT3 cameraPos, bool writeIndices)
+{
+	unsigned int paddedCount = DepthSort::paddedCount(count);
+
+	// -------- KEY BUFFER, compute reg u0, INDEX BUFFER, compute reg u1 ------------
+	ID3D11UnorderedAccessView* views[2] = { _keyUAV, _indexUAV };
+	context->CSSetShaderResources(0, 1, &positions);
+	context->CSSetUnorderedAccessViews(0, writeIndices ? 2 : 1, views, nullptr);
+
+	SortConstantsBufferType constants = {};
+	constants.count = count;
+	constants.paddedCount = paddedCount;
+	constants.positionStride = positionStride;
+	constants.cameraPosition = cameraPos;
+
+	//! keys of the points and the padding, then the passes, each one sees the writes of the one before
+	dispatch(context, _kernels.keys, constants, paddedCount / 256);
+	for (const DepthSort::Pass& pass : _passes)
+	{
+		constants.level = pass.level;
+		constants.lastLevel = pass.lastLevel;
+		constants.step = pass.step;
+		dispatch(context, pass.local ? _kernels.local : _kernels.global, constants, paddedCount / DepthSort::k_GroupSize);
+	}
+	if (writeIndices)
+		dispatch(context, _kernels.indices, constants, paddedCount / 256);
+
+	//! the index buffer cannot be drawn with while it is still bound for writing
+	ID3D11UnorderedAccessView* noUAVs[2] = { NULL, NULL };
+	ID3D11ShaderResourceView* noSRV = NULL;
+	context->CSSetUnorderedAccessViews(0, 2, noUAVs, nullptr);
+	context->CSSetShaderResources(0, 1, &noSRV);
+}
+
+void GPUDepthSort::dispatch(ID3D11DeviceContext* context, ID3D11ComputeShader* shader, const SortConstantsBufferType& constants, unsigned int groups)
+{
+	// -------- COMPUTE CONSTANTS BUFFER, compute reg b0 ------------
+	auto* constantPtr = MapBufferToPointer<SortConstantsBufferType>(context, _computeConstantBuffer);
+	*constantPtr = constants;
+	finalizeBuffer(context, _computeConstantBuffer, PipelineStage::Compute, 0);
+
+	context->CSSetShader(shader, NULL, 0);
+	context->Dispatch(groups, 1, 1);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#ifndef _GPU_DEPTH_SORT_H
+#define _GPU_DEPTH_SORT_H
+#include "BetterPointMesh.h"
+#include "DepthSort.h"
+#include <d3d11.h>
+#include <vector>
+
+using namespace DirectX;
+
+//! buffers, views and dispatches of the depth sort, GPUOrderShader loads the kernels and keeps one of these
+//! only the device and the context are used, every buffer and view is kept from sort to sort and recreated when it has to grow
+class GPUDepthSort
+{
+public:
+
+	//! the compute shaders of gpu_order_*_cs.hlsl, owned by the caller
+	struct Kernels
+	{
+		ID3D11ComputeShader* keys;
+		ID3D11ComputeShader* local;
+		ID3D11ComputeShader* global;
+		ID3D11ComputeShader* indices;
+	};
+
+	//! specifies the pass of the sort and the camera position, one dispatch each
+	struct SortConstantsBufferType
+	{
+		unsigned int count;
+		unsigned int paddedCount;
+		unsigned int level;
+		unsigned int lastLevel;
+		unsigned int step;
+		unsigned int positionStride;
+		XMFLOAT2 padding;
+		XMFLOAT3 cameraPosition;
+		float padding2;
+	};
+
+	GPUDepthSort(ID3D11Device* device, const Kernels& kernels);
+	~GPUDepthSort();
+
+	//! sorts the points of the mesh far to near into an index buffer and has the mesh draw with it
+	//! the positions are read from the vertex buffer of the mesh, only the constants are mapped and nothing comes back to the CPU
+	void sortMesh(ID3D11Device* device, ID3D11DeviceContext* context, BetterPointMesh* mesh, XMFLOAT3 cameraPos);
+
+	//! sorts the keys of count positions stride bytes apart and reads them back, the first count of sorted are the points far to near
+	//! uploads the positions and waits for the GPU, for checking against DepthSort::sortReference
+	void sortKeys(ID3D11Device* device, ID3D11DeviceContext* context, const void* positions, size_t stride, unsigned int count, XMFLOAT3 cameraPos, std::vector<DepthSort::Key>& sorted);
+
+	ID3D11Buffer* getIndexBuffer() { return _indexBuffer; }
+
+private:
+	//! grows the key and index buffers to paddedCount keys
+	void reserve(ID3D11Device* device, unsigned int paddedCount);
+	//! grows the uploaded positions and the readback copy of sortKeys to its capacity
+	void reserveUpload(ID3D11Device* device);
+	//! keys of the positions in t0, positionStride floats apart, then every pass and, when asked, the indices of the sorted keys
+	void run(ID3D11DeviceContext* context, ID3D11ShaderResourceView* positions, unsigned int positionStride, unsigned int count, XMFLOAT3 cameraPos, bool writeIndices);
+	void dispatch(ID3D11DeviceContext* context, ID3D11ComputeShader* shader, const SortConstantsBufferType& constants, unsigned int groups);
+
+private:
+	Kernels _kernels;
+	ID3D11Buffer* _computeConstantBuffer = NULL;
+
+	unsigned int _capacity = 0;							//! keys the buffers hold, a power of two
+	ID3D11Buffer* _keyBuffer = NULL;					//! uint2 per key
+	ID3D11UnorderedAccessView* _keyUAV = NULL;
+	ID3D11Buffer* _indexBuffer = NULL;					//! sorted point indices, raw so it can be an index buffer and a UAV
+	ID3D11UnorderedAccessView* _indexUAV = NULL;
+
+	ID3D11Buffer* _meshVertices = NULL;					//! vertex buffer of the mesh the view below reads
+	int _meshCapacity = 0;								//! its capacity, a recreated buffer can come back at the same address
+	ID3D11ShaderResourceView* _meshPositionSRV = NULL;	//! floats of the vertices
+
+	unsigned int _uploadCapacity = 0;
+	ID3D11Buffer* _positionBuffer = NULL;				//! dynamic, float3 per point, sortKeys only
+	ID3D11ShaderResourceView* _positionSRV = NULL;
+	ID3D11Buffer* _readbackBuffer = NULL;				//! staging copy of the keys, sortKeys only
+
+	std::vector<DepthSort::Pass> _passes;
+	unsigned int _passesCount = 0;						//! padded count the passes were built for
+};
+
+#endif
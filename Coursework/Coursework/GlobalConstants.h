@@ -11,4 +11,12 @@ constexpr float k_InvalidFloat = std::numeric_limits<float>::quiet_NaN();
 constexpr float k_NullFloat = 0.f;
 constexpr XMFLOAT4 k_InvalidFloat4 = XMFLOAT4(k_InvalidFloat, k_InvalidFloat, k_InvalidFloat, k_NullFloat);
 constexpr XMFLOAT3 k_InvalidFloat3 = XMFLOAT3(k_InvalidFloat, k_InvalidFloat, k_InvalidFloat);
-const std::string k_InvalidString = "";
\ No newline at end of file
+const std::string k_InvalidString = "";
+//! level of detail selection, largest simplification error allowed on screen as a fraction of the screen height (about a pixel at 1080p)
+constexpr float k_LodScreenError = 0.001f;
+//! shadow maps tolerate coarser geometry, multiplies the allowed error in the shadow pass
+constexpr float k_ShadowLodBias = 4.f;
+//! heightmap uv per object space unit of the landscape, the 100x100 plane it replaced mapped the map once over its vertices
+constexpr float k_LandscapeUvPerUnit = 0.01f;
+//! scene position of the water, its height is the default water level
+constexpr XMFLOAT3 k_WaterPosition = XMFLOAT3(-5.f, -3.f, -10.f);
\ No newline at end of file
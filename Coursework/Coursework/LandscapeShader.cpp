@@ -5,15 +5,18 @@ LandscapeShader::LandscapeShader(ID3D11Device* device, HWND hwnd) : DefaultShade
 {
 	//! loads the specialised, sub shaders
 	initShader(L"landscape_vs.cso", L"landscape_ps.cso");
+	loadPackedVertexShader(L"landscape_packed_vs.cso");
 
 	//! create buffers
 	setupBuffer<LandscapeBufferType>(renderer, &_landscapeBuffer);
+	setupBuffer<TerrainNodeBufferType>(renderer, &_terrainNodeBuffer);
 }
 
 LandscapeShader::~LandscapeShader()
 {
 	//! cleanup new buffers
 	ReleaseBuffer(&_landscapeBuffer);
+	ReleaseBuffer(&_terrainNodeBuffer);
 
 	//! cleanup inherited objects
 	DefaultShader::~DefaultShader();
@@ -31,6 +34,8 @@ void LandscapeShader::additionalParameters(ID3D11DeviceContext* device, void* pa
 	landscapePtr->ranges.y = data->bot_mid_range.second;
 	landscapePtr->ranges.z = data->mid_top_range.first;
 	landscapePtr->ranges.w = data->mid_top_range.second;
+	landscapePtr->splat = XMFLOAT4(data->splatWeights ? 1.f : 0.f, 0.f, 0.f, 0.f);
+	landscapePtr->occlusion = XMFLOAT4(data->occlusionMap ? data->occlusionStrength : 0.f, 0.f, 0.f, 0.f);
 	finalizeBuffer(device, _landscapeBuffer, Pixel, 2);
 	
 	//! put the textures in arrays for easier handling
@@ -54,9 +59,36 @@ void LandscapeShader::additionalParameters(ID3D11DeviceContext* device, void* pa
 	// -------- NORMAL MAPS BUFFER, pixel reg t13-t15 ------------
 	device->PSSetShaderResources(13, 3, layersNormals); //pending change based on max number of lights
 
-	// -------- HEIGHT MAP BUFFER, vertex reg t0 ------------
-	device->VSSetShaderResources(0, 1, &data->heightMap);
+	// -------- SURFACE MAP BUFFER, vertex reg t0, SPLAT MAP BUFFER, pixel reg t16 ------------
+	setSurfaceMaps(device, data->surfaceMap, data->splatMap);
+
+	// -------- OCCLUSION MAP BUFFER, pixel reg t17 ------------
+	device->PSSetShaderResources(17, 1, &data->occlusionMap);
 
 	// -------- SAMPLER BUFFER, compute reg s0 ------------
 	device->VSSetSamplers(0, 1, &_sampleState);
+}
+
+//! meshes drawn without a node keep the buffer of the last terrain draw, only the terrain object draws with this shader
+void LandscapeShader::setTerrainNode(ID3D11DeviceContext* device, const TerrainQuadtree::Node& node, XMFLOAT3 eye, int gridResolution, float uvPerUnit,
+	XMFLOAT2 surfaceUvOffset, XMFLOAT2 tileOrigin)
+{
+	// -------- TERRAIN NODE BUFFER, vertex reg b3 ------------
+	auto* nodePtr = MapBufferToPointer<TerrainNodeBufferType>(device, _terrainNodeBuffer);
+	nodePtr->nodeOrigin = XMFLOAT2(node.x, node.z);
+	nodePtr->nodeSize = node.size;
+	nodePtr->gridResolution = (float)gridResolution;
+	nodePtr->eyePosition = eye;
+	nodePtr->uvPerUnit = uvPerUnit;
+	nodePtr->morphRange = XMFLOAT2(node.morphStart, node.morphEnd);
+	nodePtr->surfaceUvOffset = surfaceUvOffset;
+	nodePtr->tileOrigin = tileOrigin;
+	nodePtr->padding = XMFLOAT2(0.f, 0.f);
+	finalizeBuffer(device, _terrainNodeBuffer, Vertex, 3);
+}
+
+void LandscapeShader::setSurfaceMaps(ID3D11DeviceContext* device, ID3D11ShaderResourceView* surfaceMap, ID3D11ShaderResourceView* splatMap)
+{
+	device->VSSetShaderResources(0, 1, &surfaceMap);
+	device->PSSetShaderResources(16, 1, &splatMap);
 }
\ No newline at end of file
@@ -10,19 +10,39 @@ class LandscapeShader :
     struct LandscapeBufferType 
     {
         XMFLOAT4 ranges;
+        XMFLOAT4 splat;         //! x above 0 blends the layers by the splat map weights instead of the altitude
+        XMFLOAT4 occlusion;     //! x is the share of the ambient light the occlusion map can take away, 0 without a map
+    };
+
+    //! terrain node being drawn, places and morphs the shared grid mesh, vertex reg b3
+    struct TerrainNodeBufferType
+    {
+        XMFLOAT2 nodeOrigin;
+        float nodeSize;
+        float gridResolution;
+        XMFLOAT3 eyePosition;   //! object space, the morph is measured from it
+        float uvPerUnit;        //! heightmap uv per object space unit
+        XMFLOAT2 morphRange;
+        XMFLOAT2 surfaceUvOffset;   //! surface map uv of the node space origin
+        XMFLOAT2 tileOrigin;        //! object space of the node space origin, streamed tiles draw in their own space
+        XMFLOAT2 padding;
     };
 
 public:
     //! additional shader params for landscape shaders
     struct LandscapeParameters
     {
-        ID3D11ShaderResourceView* heightMap = NULL;
+        ID3D11ShaderResourceView* surfaceMap = NULL;   //! baked normals and object space heights, see Heightfield
         ID3D11ShaderResourceView* bottomL = NULL;
         ID3D11ShaderResourceView* middleL = NULL;
         ID3D11ShaderResourceView* topL = NULL;
         ID3D11ShaderResourceView* bottomL_N = NULL;
         ID3D11ShaderResourceView* middleL_N = NULL;
         ID3D11ShaderResourceView* topL_N = NULL;
+        ID3D11ShaderResourceView* splatMap = NULL;     //! layer weights in rgb, used with splatWeights
+        bool splatWeights = false;                      //! blends the layers by the splat map, streamed tiles bind theirs with setSurfaceMaps
+        ID3D11ShaderResourceView* occlusionMap = NULL;  //! baked ambient visibility on the texels of the surface map, see HorizonOcclusion
+        float occlusionStrength = 1.f;
         std::pair<float, float> bot_mid_range = { 0.f,0.f };
         std::pair<float, float> mid_top_range = { 0.f,0.f };
         float maxAltitude; //unused
@@ -30,10 +50,18 @@ public:
 
     LandscapeShader(ID3D11Device* device, HWND hwnd);
     ~LandscapeShader();
+
+    //! per node parameters of the terrain quadtree, set between the draws of one object
+    //! tiles pass their origin and the uv of it, the node and the eye are then in tile space
+    void setTerrainNode(ID3D11DeviceContext* device, const TerrainQuadtree::Node& node, XMFLOAT3 eye, int gridResolution, float uvPerUnit,
+        XMFLOAT2 surfaceUvOffset = { 0.f,0.f }, XMFLOAT2 tileOrigin = { 0.f,0.f });
+    //! surface and splat map of the next draws, replaces those of the parameters
+    void setSurfaceMaps(ID3D11DeviceContext* device, ID3D11ShaderResourceView* surfaceMap, ID3D11ShaderResourceView* splatMap);
 private:
     void additionalParameters(ID3D11DeviceContext* device,void* params) override;
     
     ID3D11Buffer* _landscapeBuffer = NULL;
+    ID3D11Buffer* _terrainNodeBuffer = NULL;
 };
 
 #endif
\ No newline at end of file
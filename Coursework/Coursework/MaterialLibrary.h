@@ -5,15 +5,26 @@
 #include "DefaultShader.h"
 #include "DXF.h"
 #include <map>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
 
 class MaterialLibrary
 {
 public:
+	//! called from update once the model has its buffers, not for models that failed to load
+	typedef std::function<void(const std::string& key, Model* model)> ModelCallback;
+
 	MaterialLibrary(TextureManager* textureMgr, D3D* renderer)
 	{
+		loadStart_ = std::chrono::high_resolution_clock::now();
+
 		//! just a pointer, legacy compatibility with DX framework
 		textureMgr_ = textureMgr;
-		//! loads all textures
+		device_ = renderer->getDevice();
+		//! starts loading all textures, they show white until update uploads them
 		loadTextures();
 	
 	// MATERIALS //
@@ -48,51 +59,208 @@ public:
 	
 	// MODELS //
 	//! define and initialise all models here
+	//! parsed on the pool, they draw nothing until update creates their buffers
 
-		models_["Cottage"] = new Model(renderer->getDevice(), renderer->getDeviceContext(), "res/models/cottage.obj");
-		models_["Tree"] = new Model(renderer->getDevice(), renderer->getDeviceContext(), "res/models/tree.obj");
-	
+		loadModelAsync("Cottage", "res/models/cottage.obj");
+		loadModelAsync("Tree", "res/models/tree.obj");
+
+		constructorMs_ = msSince(loadStart_);
 	};
 	
 	~MaterialLibrary() 
 	{
+		//! workers still hold pointers to the models and the textures, everything queued on the pool finishes first
+		waitForAll();
+
 		for (auto it : materials_)
 			delete it.second;
 
 		for (auto it : models_)
-			delete it.second;
+			geometry_.release(it.second);
 
 		materials_.clear();
 	};
+
+	//! starts loading a model, the returned pointer is valid right away and stays the same once loaded
+	//! models are shared by the contents of their file, a file already loading or loaded is not parsed again
+	Model* loadModelAsync(const std::string& key, const std::string& filename, ModelCallback onLoaded = nullptr)
+	{
+		PendingModel pending;
+		pending.key = key;
+		pending.onLoaded = onLoaded;
+
+		//! a key names one model, loading it again keeps the model already there
+		auto existing = models_.find(key);
+		if (existing != models_.end())
+		{
+			pending.model = existing->second;
+			pending.loaded = sharedLoad(existing->second);
+			pendingModels_.push_back(std::move(pending));
+			return existing->second;
+		}
+
+		std::string geometryKey = GeometryRegistry::getFileKey("Model", filename.c_str());
+		Model* model = static_cast<Model*>(geometry_.acquire(geometryKey, [&]()
+		{
+			Model* created = new Model();
+			pending.finish = true;
+			pending.loaded = pool_.submit([created, filename]()
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				if (!created->load(filename.c_str()))
+					OutputDebugStringA(("MaterialLibrary: failed to load model " + filename + "\n").c_str());
+				return msSince(start);
+			}).share();
+			return created;
+		}));
+
+		//! shared model, the callback waits for the load in flight or runs on the next update
+		if (!pending.finish)
+			pending.loaded = sharedLoad(model);
+
+		models_[key] = model;
+		pending.model = model;
+		pendingModels_.push_back(std::move(pending));
+		return model;
+	}
+
+	//! finishes the assets loaded so far, call every frame on the thread owning the device context
+	//! returns the number of assets still loading
+	int update()
+	{
+		if (firstUpdateMs_ < 0.f)
+			firstUpdateMs_ = msSince(loadStart_);
+
+		int loading = textureMgr_->update();
+
+		for (size_t i = 0; i < pendingModels_.size();)
+		{
+			if (pendingModels_[i].loaded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				i++;
+				continue;
+			}
+
+			//! taken out of the list first, callbacks may start new loads
+			PendingModel pending = std::move(pendingModels_[i]);
+			pendingModels_.erase(pendingModels_.begin() + i);
+
+			//! the buffers are created once, by the load that parsed the model
+			if (pending.finish)
+			{
+				float loadMs = pending.loaded.get();
+				slowestModelMs_ = loadMs > slowestModelMs_ ? loadMs : slowestModelMs_;
+				pending.model->finishLoad(device_);
+			}
+
+			//! a model that failed stays empty, its key is reported instead of calling back
+			if (!pending.model->isLoaded())
+			{
+				failedModels_.push_back(pending.key);
+				continue;
+			}
+			if (pending.finish)
+				modelsFromCache_ &= pending.model->isFromCache();
+
+			if (pending.onLoaded)
+				pending.onLoaded(pending.key, pending.model);
+		}
+
+		loading += (int)pendingModels_.size();
+		if (loading == 0 && allLoadedMs_ < 0.f)
+			allLoadedMs_ = msSince(loadStart_);
+
+		return loading;
+	}
+
+	//! blocks until the texture shows its image, for work that reads it at initialisation
+	void waitForTexture(const wchar_t* key) { textureMgr_->waitFor(key); }
+
+	//! blocks until every asset is loaded
+	void waitForAll()
+	{
+		while (update() > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
 	
 	//! accessors
 	DefaultShader::MaterialBufferType* getMaterial(std::string key) { return materials_.find(key) != materials_.end() ? materials_[key] : NULL; };
 	ID3D11ShaderResourceView* getTexture(const wchar_t* key) { return textureMgr_->getTexture(key); }
 	Model* getMesh(std::string key) { return models_.find(key) != models_.end() ? models_[key] : NULL; }
+	//! shared meshes, procedural ones are acquired here too so the scene builds each of them once
+	GeometryRegistry& getGeometry() { return geometry_; }
+	float getConstructorMs() { return constructorMs_; }
+	float getFirstUpdateMs() { return firstUpdateMs_; }
+	float getAllLoadedMs() { return allLoadedMs_; }
+	float getSlowestModelMs() { return slowestModelMs_; }
+	bool areModelsFromCache() { return modelsFromCache_; }
+	//! keys of the models whose file could not be loaded, they draw nothing
+	const std::vector<std::string>& getFailedModels() { return failedModels_; }
 
 private:
+	//! model parsed on the pool, waiting for its buffers
+	struct PendingModel
+	{
+		std::string key;
+		Model* model;
+		std::shared_future<float> loaded;	//! time the parse took on the worker
+		ModelCallback onLoaded;
+		bool finish = false;				//! whether this load parsed the model, or shares one parsed by another
+	};
+
+	//! the load of a shared model still in flight, or a ready one if it has finished
+	std::shared_future<float> sharedLoad(Model* model)
+	{
+		for (auto& it : pendingModels_)
+		{
+			if (it.model == model && it.finish)
+				return it.loaded;
+		}
+
+		std::promise<float> finished;
+		finished.set_value(0.f);
+		return finished.get_future().share();
+	}
+
+	static float msSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
 	std::map<std::string, DefaultShader::MaterialBufferType*> materials_;
 	std::map<std::string, Model*> models_;
+	GeometryRegistry geometry_;
 	TextureManager* textureMgr_;
+	ID3D11Device* device_;
+	ThreadPool pool_;
+	std::vector<PendingModel> pendingModels_;
+
+	std::chrono::high_resolution_clock::time_point loadStart_;
+	float constructorMs_ = 0.f;			//! time the constructor blocked the startup
+	float firstUpdateMs_ = -1.f;		//! from the constructor to the first frame
+	float allLoadedMs_ = -1.f;			//! from the constructor to the last asset finished, -1 while loading
+	float slowestModelMs_ = 0.f;		//! longest single model parse on a worker
+	bool modelsFromCache_ = true;		//! whether every model was mapped from its baked cache
+	std::vector<std::string> failedModels_;
 	
-	//! load all the textures to be used
+	//! start loading all the textures to be used, decoded on the pool
 	void loadTextures() 
 	{
-		textureMgr_->loadTexture(L"landscapeH", L"res/landscape.png");
-		textureMgr_->loadTexture(L"grass", L"res/grass.png");
-		textureMgr_->loadTexture(L"grassN", L"res/grassN.png");
-		textureMgr_->loadTexture(L"stone1", L"res/stone.png");
-		textureMgr_->loadTexture(L"stone1N", L"res/stoneN.png");
-		textureMgr_->loadTexture(L"stone2", L"res/stone2.png");
-		textureMgr_->loadTexture(L"tree", L"res/tree.png");
-		textureMgr_->loadTexture(L"foliageBrush", L"res/foliage_brush.png");
-		textureMgr_->loadTexture(L"water", L"res/waterSurface.png");
-		textureMgr_->loadTexture(L"waterBelow", L"res/waterUnder.png");
-		textureMgr_->loadTexture(L"cottageD", L"res/cottage_diffuse.png");
-		textureMgr_->loadTexture(L"cottageN", L"res/cottage_normal.png");
-		textureMgr_->loadTexture(L"tree3D", L"res/tree3D.png");
-		textureMgr_->loadTexture(L"windM", L"res/windM.jpg");
-		textureMgr_->loadTexture(L"tree3DW", L"res/treeWindBrush.png");
+		textureMgr_->loadTextureAsync(L"landscapeH", L"res/landscape.png", pool_);
+		textureMgr_->loadTextureAsync(L"grass", L"res/grass.png", pool_);
+		textureMgr_->loadTextureAsync(L"grassN", L"res/grassN.png", pool_);
+		textureMgr_->loadTextureAsync(L"stone1", L"res/stone.png", pool_);
+		textureMgr_->loadTextureAsync(L"stone1N", L"res/stoneN.png", pool_);
+		textureMgr_->loadTextureAsync(L"stone2", L"res/stone2.png", pool_);
+		textureMgr_->loadTextureAsync(L"tree", L"res/tree.png", pool_);
+		textureMgr_->loadTextureAsync(L"foliageBrush", L"res/foliage_brush.png", pool_);
+		textureMgr_->loadTextureAsync(L"water", L"res/waterSurface.png", pool_);
+		textureMgr_->loadTextureAsync(L"waterBelow", L"res/waterUnder.png", pool_);
+		textureMgr_->loadTextureAsync(L"cottageD", L"res/cottage_diffuse.png", pool_);
+		textureMgr_->loadTextureAsync(L"cottageN", L"res/cottage_normal.png", pool_);
+		textureMgr_->loadTextureAsync(L"tree3D", L"res/tree3D.png", pool_);
+		textureMgr_->loadTextureAsync(L"windM", L"res/windM.jpg", pool_);
+		textureMgr_->loadTextureAsync(L"tree3DW", L"res/treeWindBrush.png", pool_);
 	}
 
 };
@@ -40,6 +40,129 @@ void Object::applyTransform(XMMATRIX& world)
 	world = XMMatrixMultiply(world, XMMatrixTranslation(_position.x, _position.y, _position.z));
 }
 
+//! the projected diameter of the bounding sphere over the screen height decides, w after projection is the view depth
+//! for perspective and 1 for orthographic projections so the same formula serves the camera and the shadow maps
+int Object::selectLod(const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection, float lodBias)
+{
+	_lod = 0;
+	if (_mesh->getLodCount() <= 1)
+		return _lod;
+
+	XMFLOAT3 centre = _mesh->getBoundingCentre();
+	XMVECTOR viewCentre = XMVector3TransformCoord(XMLoadFloat3(&centre), XMMatrixMultiply(world, view));
+	//! the largest scale axis keeps the sphere conservative
+	float maxScale = fabsf(_scale.x);
+	maxScale = fabsf(_scale.y) > maxScale ? fabsf(_scale.y) : maxScale;
+	maxScale = fabsf(_scale.z) > maxScale ? fabsf(_scale.z) : maxScale;
+	float radius = _mesh->getBoundingRadius() * maxScale;
+
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&proj, projection);
+	float w = XMVectorGetZ(viewCentre) * proj._34 + proj._44;
+
+	//! camera inside the bounds, full detail
+	if (w <= radius * proj._34)
+		return _lod;
+
+	float screenSize = radius * fabsf(proj._22) / w;
+	_lod = _mesh->selectLod(screenSize, k_LodScreenError * lodBias);
+	return _lod;
+}
+
+//! only the full detail level has meshlets, coarser levels are drawn whole
+bool Object::cullClusters(const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection)
+{
+	_cullStats = Meshlets::CullStats();
+	if (!_clusterCulling || _lod != 0 || _mesh->getMeshletCount() == 0)
+		return false;
+
+	Meshlets::CullView cullView = Meshlets::makeCullView(world, view, projection);
+	cullView.margin = _clusterMargin;
+	_cullStats = Meshlets::cullMeshlets(_mesh->getMeshlets(), _mesh->getMeshletCount(), cullView, _coneCulling, _ranges);
+	return true;
+}
+
+void Object::draw(D3D* renderer, BaseShader* shader, const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection)
+{
+	if (cullClusters(world, view, projection))
+	{
+		shader->render(renderer->getDeviceContext(), _ranges.data(), (int)_ranges.size());
+		return;
+	}
+
+	BaseMesh::LevelOfDetail lod = _mesh->getLod(_lod);
+	shader->render(renderer->getDeviceContext(), lod.indexCount, lod.indexStart);
+}
+
+void Object::drawSpan(D3D* renderer, BaseShader* shader, bool culled, unsigned int start, unsigned int end)
+{
+	if (!culled)
+	{
+		shader->render(renderer->getDeviceContext(), (int)(end - start), (int)start);
+		return;
+	}
+
+	//! meshlets never cross a submesh but merged ranges can, clip them to the span
+	_slotRanges.clear();
+	for (auto& range : _ranges)
+	{
+		unsigned int rangeStart = range.indexStart > start ? range.indexStart : start;
+		unsigned int rangeEnd = range.indexStart + range.indexCount < end ? range.indexStart + range.indexCount : end;
+		if (rangeStart < rangeEnd)
+			_slotRanges.push_back({ rangeStart, rangeEnd - rangeStart });
+	}
+
+	if (!_slotRanges.empty())
+		shader->render(renderer->getDeviceContext(), _slotRanges.data(), (int)_slotRanges.size());
+}
+
+//! submeshes are sorted by material on import, so each slot is one span of the index buffer
+void Object::renderSlots(D3D* renderer, const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection,
+	const std::vector<ShadowMap*>* shadowMaps, const std::vector<Light*>* lightArray, const std::vector<LightType>* lightTypes, XMFLOAT3 cameraPos)
+{
+	bool culled = cullClusters(world, view, projection);
+	const MeshCache::Submesh* submeshes = _mesh->getSubmeshes();
+	int submeshCount = _mesh->getSubmeshCount();
+
+	_mesh->sendData(renderer->getDeviceContext(), _top);
+	_shader->setVertexFormat(renderer->getDeviceContext(), _mesh);
+
+	for (int first = 0; first < submeshCount;)
+	{
+		//! extend the span over the following submeshes of the same slot
+		unsigned int slot = submeshes[first].materialSlot;
+		int last = first;
+		while (last + 1 < submeshCount && submeshes[last + 1].materialSlot == slot)
+			last++;
+		unsigned int start = submeshes[first].startIndex;
+		unsigned int end = submeshes[last].startIndex + submeshes[last].indexCount;
+		first = last + 1;
+
+		DefaultShader::MaterialBufferType* material = slot < _slotMaterials.size() && _slotMaterials[slot] ? _slotMaterials[slot] : _material;
+		ID3D11ShaderResourceView* texture = slot < _slotTextures.size() && _slotTextures[slot] ? _slotTextures[slot] : _texture;
+
+		_shader->setShaderParameters(
+			renderer->getDeviceContext(),
+			world,
+			view,
+			projection,
+			texture,
+			_normalMap,
+			material,
+			lightArray,
+			lightTypes,
+			shadowMaps,
+			cameraPos
+			);
+		_shader->additionalParameters(renderer->getDeviceContext(), _additionalShaderData);
+
+		renderer->setAlphaBlending(material->diffuse.w < 1.f);
+		drawSpan(renderer, _shader, culled, start, end);
+	}
+
+	renderer->setAlphaBlending(false);
+}
+
 void Object::render(
 	D3D* renderer, 
 	XMMATRIX viewMatrix,
@@ -47,15 +170,25 @@ void Object::render(
 	const std::vector<ShadowMap*>* shadowMaps,
 	const std::vector<Light*>* lightArray,
 	const std::vector<LightType>* lightTypes,
-	XMFLOAT3 cameraPos
+	XMFLOAT3 cameraPos,
+	float lodBias
 	)
 {
 	//! apply transform
 	auto worldMatrix = renderer->getWorldMatrix();
 	applyTransform(worldMatrix);
+	selectLod(worldMatrix, viewMatrix, perspectiveMatrix, lodBias);
+
+	//! multi material meshes at full detail draw slot by slot
+	if (!_slotMaterials.empty() && _lod == 0 && _mesh->getSubmeshCount() > 0)
+	{
+		renderSlots(renderer, worldMatrix, viewMatrix, perspectiveMatrix, shadowMaps, lightArray, lightTypes, cameraPos);
+		return;
+	}
 
-	//! send and setup data
+	//! send and setup data, packed meshes need the packed vertex shader
 	_mesh->sendData(renderer->getDeviceContext(),_top);
+	_shader->setVertexFormat(renderer->getDeviceContext(), _mesh);
 	_shader->setShaderParameters(
 		renderer->getDeviceContext(), 
 		worldMatrix, 
@@ -77,28 +210,30 @@ void Object::render(
 	if (_material->diffuse.w < 1.f)
 		renderer->setAlphaBlending(true);
 	
-	//! render/ draw call to the GPU
-	_shader->render(renderer->getDeviceContext(), _mesh->getIndexCount());
+	//! render/ draw calls to the GPU
+	draw(renderer, _shader, worldMatrix, viewMatrix, perspectiveMatrix);
 
 	//! clean up transparency 
 	renderer->setAlphaBlending(false);
 }
 
 //! cheaper render, subject to unavaliability if simple shader is not provideds
-void Object::lowRender(D3D* renderer, XMMATRIX viewMatrix, XMMATRIX perspectiveMatrix, XMFLOAT3 cameraPos)
+void Object::lowRender(D3D* renderer, XMMATRIX viewMatrix, XMMATRIX perspectiveMatrix, XMFLOAT3 cameraPos, float lodBias)
 {
 	if (!_lowShader) 
 	{
-		render(renderer, viewMatrix, perspectiveMatrix, NULL, NULL, NULL, cameraPos);
+		render(renderer, viewMatrix, perspectiveMatrix, NULL, NULL, NULL, cameraPos, lodBias);
 		return;
 	}
 
 	//! apply transform
 	auto worldMatrix = renderer->getWorldMatrix();
 	applyTransform(worldMatrix);
+	selectLod(worldMatrix, viewMatrix, perspectiveMatrix, lodBias);
 
 	//! send and render data
 	_mesh->sendData(renderer->getDeviceContext(), _top);
+	_lowShader->setVertexFormat(renderer->getDeviceContext(), _mesh);
 	_lowShader->setShaderParameters(
 		renderer->getDeviceContext(),
 		worldMatrix,
@@ -106,6 +241,6 @@ void Object::lowRender(D3D* renderer, XMMATRIX viewMatrix, XMMATRIX perspectiveM
 		perspectiveMatrix,
 		_texture);
 
-	//! render/ draw call to the GPU
-	_lowShader->render(renderer->getDeviceContext(), _mesh->getIndexCount());
+	//! render/ draw calls to the GPU
+	draw(renderer, _lowShader, worldMatrix, viewMatrix, perspectiveMatrix);
 }
@@ -8,6 +8,7 @@
 
 class Object
 {
+protected:
 	//! base object attributes
 	BaseMesh* _mesh;
 	DefaultShader* _shader;
@@ -21,6 +22,27 @@ class Object
 	DefaultShader::MaterialBufferType* _material = NULL;
 	D3D_PRIMITIVE_TOPOLOGY _top = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	bool ownerOfAdittionalParams = true;
+	int _lod = 0;					//! level of detail used by the last render call
+	bool _clusterCulling = true;	//! meshlets outside the view are skipped at full detail
+	bool _coneCulling = false;		//! meshlets facing away are skipped as well, closed meshes only as both faces are rasterised
+	float _clusterMargin = 0.f;		//! object space room added to the meshlet bounds for shader displacement
+	std::vector<Meshlets::IndexRange> _ranges;
+	std::vector<Meshlets::IndexRange> _slotRanges;	//! culled ranges clipped to one material slot
+	Meshlets::CullStats _cullStats;	//! meshlets drawn and culled by the last render call
+	std::vector<DefaultShader::MaterialBufferType*> _slotMaterials;	//! per material slot of the submeshes, empty draws the mesh with _material
+	std::vector<ID3D11ShaderResourceView*> _slotTextures;
+
+	//! picks the level of detail of the mesh from the projected size of its bounds, lodBias multiplies the allowed screen error
+	int selectLod(const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection, float lodBias);
+	//! culls the meshlets of the full detail level, false if the mesh is drawn whole
+	bool cullClusters(const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection);
+	//! draws the selected level of detail, or the ranges left by cluster culling
+	void draw(D3D* renderer, BaseShader* shader, const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection);
+	//! draws the indices in [start, end), clipped to the culled ranges when culled is set
+	void drawSpan(D3D* renderer, BaseShader* shader, bool culled, unsigned int start, unsigned int end);
+	//! one vertex buffer bind, then the parameters and a ranged draw per material slot of the submeshes
+	void renderSlots(D3D* renderer, const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection,
+		const std::vector<ShadowMap*>* shadowMaps, const std::vector<Light*>* lightArray, const std::vector<LightType>* lightTypes, XMFLOAT3 cameraPos);
 
 public:
 	Object(
@@ -33,7 +55,7 @@ public:
 		D3D_PRIMITIVE_TOPOLOGY top = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
 	);
 
-	~Object() { if (_additionalShaderData && ownerOfAdittionalParams) delete _additionalShaderData; };
+	virtual ~Object() { if (_additionalShaderData && ownerOfAdittionalParams) delete _additionalShaderData; };
 
 	//! accessors
 	void setObjectTransform(XMFLOAT3 pos = k_InvalidFloat3, XMFLOAT3 rot = k_InvalidFloat3, XMFLOAT3 scale = k_InvalidFloat3);
@@ -44,28 +66,39 @@ public:
 	XMFLOAT3 getRotation() { return _rotation; }
 	XMFLOAT3 getScale() { return _scale; }
 	BaseMesh* getMesh() { return _mesh; }
+	void setMesh(BaseMesh* mesh) { _mesh = mesh; }
 	DefaultShader::MaterialBufferType* getMaterial() { return _material; }
+	int getLod() { return _lod; }
+	const Meshlets::CullStats& getCullStats() { return _cullStats; }
+
+	//! cluster culling of meshes with meshlets, margin covers any vertex displacement of the shader (frustum test only)
+	void setClusterCulling(bool enabled, bool coneCulling = false, float margin = 0.f) { _clusterCulling = enabled; _coneCulling = coneCulling; _clusterMargin = margin; }
+
+	//! materials and textures indexed by the material slot of the mesh submeshes, slots without one use the object material and texture
+	void setSubmeshMaterials(const std::vector<DefaultShader::MaterialBufferType*>& materials, const std::vector<ID3D11ShaderResourceView*>& textures = {}) { _slotMaterials = materials; _slotTextures = textures; }
 
 	//! concatenates the matrices
 	void applyTransform(XMMATRIX& world);
 
 	//! calls the appropriate shader functions to result in a correct render procedure
-	void render(
+	virtual void render(
 		D3D* renderer,
 		XMMATRIX viewMatrix,
 		XMMATRIX perspectiveMatrix,
 		const std::vector<ShadowMap*>* shadowMaps = NULL,
 		const std::vector<Light*>* lightArray = NULL,
 		const std::vector<LightType>* lightTypes = NULL,
-		XMFLOAT3 cameraPos = { 0,0,0 }
+		XMFLOAT3 cameraPos = { 0,0,0 },
+		float lodBias = 1.f
 		);
 	//! used for depth maps or in any other case where it suits the situation
 	//! if no simple shader is present, simply calls standard render.
-	void lowRender(
+	virtual void lowRender(
 		D3D* renderer,
 		XMMATRIX viewMatrix,
 		XMMATRIX perspectiveMatrix,
-		XMFLOAT3 cameraPos
+		XMFLOAT3 cameraPos,
+		float lodBias = 1.f
 		);
 };
 
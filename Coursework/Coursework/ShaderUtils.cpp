@@ -114,8 +114,9 @@ void BakeLightsMaps(D3D* renderer, std::vector<ShadowMap*>& maps, std::vector<Li
 			if (it->getMaterial()->diffuse.w < -1.f)
 				continue;
 
+			//! shadow maps use coarser levels of detail
 			XMMATRIX worldMatrix = renderer->getWorldMatrix();
-			it->render(renderer, lightViewMatrix, lightProjectionMatrix);
+			it->render(renderer, lightViewMatrix, lightProjectionMatrix, NULL, NULL, NULL, { 0,0,0 }, k_ShadowLodBias);
 		}
 		renderer->resetViewport();
 	}
@@ -5,6 +5,7 @@ SimpleShader::SimpleShader(ID3D11Device* device, HWND hwnd) : BaseShader(device,
 {
 	//! uses base vertex shader, the other stages are customized
 	initShader(L"base_vs.cso", L"base_ps.cso");
+	loadPackedVertexShader(L"base_packed_vs.cso");
 }
 
 SimpleShader::~SimpleShader()
@@ -0,0 +1,109 @@
+#include "StreamedTerrain.h"
+
+StreamedTerrain::StreamedTerrain(ID3D11Device* device, TerrainGridMesh* grid, LandscapeShader* shader, const TerrainStreamer::Settings& settings,
+	ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* normalMap, DefaultShader::MaterialBufferType* material) :
+	Object(grid, shader, NULL, texture, normalMap, material),
+	_streamer(device, settings),
+	_grid(grid),
+	_landscapeShader(shader)
+{
+}
+
+//! 64 unit tiles of 128 quads, half a unit per quad as the finest landscape level, 4 levels of 16x16 grids per tile
+//! heights up to 50 units as the landscape, low and warped noise so hills span several tiles
+TerrainStreamer::Settings StreamedTerrain::landscapeSettings()
+{
+	TerrainStreamer::Settings settings;
+	settings.noise.frequency = 1.f / 512.f;
+	settings.noise.warpStrength = 64.f;
+	settings.lod.gridResolution = 16;
+	settings.lod.lodCount = 4;
+	settings.lod.leafRange = 16.f;
+	settings.lod.morphRatio = 0.7f;
+	settings.tileQuads = 128;
+	settings.tileSize = 64.f;
+	settings.heightScale = 50.f;
+	settings.splatRanges = XMFLOAT4(18.f, 22.f, 28.f, 32.f);
+	return settings;
+}
+
+void StreamedTerrain::update(ID3D11DeviceContext* context, XMFLOAT3 cameraPos)
+{
+	_streamer.update(context, XMFLOAT3(cameraPos.x - _position.x, cameraPos.y - _position.y, cameraPos.z - _position.z));
+}
+
+void StreamedTerrain::render(
+	D3D* renderer,
+	XMMATRIX viewMatrix,
+	XMMATRIX perspectiveMatrix,
+	const std::vector<ShadowMap*>* shadowMaps,
+	const std::vector<Light*>* lightArray,
+	const std::vector<LightType>* lightTypes,
+	XMFLOAT3 cameraPos,
+	float lodBias
+	)
+{
+	_selectionStats = TerrainQuadtree::SelectionStats();
+	const std::vector<TerrainStreamer::ResidentTile>& tiles = _streamer.getResidentTiles();
+	if (tiles.empty())
+		return;
+
+	//! apply transform
+	auto worldMatrix = renderer->getWorldMatrix();
+	applyTransform(worldMatrix);
+
+	//! the shadow maps select around the camera too, so the shadows are cast by the geometry that is seen
+	Meshlets::CullView objectView = Meshlets::makeCullView(worldMatrix, viewMatrix, perspectiveMatrix);
+	if (!objectView.orthographic)
+		_lodEye = objectView.eye;
+
+	//! the grid is bound and the object parameters set once, the maps change per tile and the node buffer per draw
+	ID3D11DeviceContext* context = renderer->getDeviceContext();
+	_mesh->sendData(context, _top);
+	_shader->setVertexFormat(context, _mesh);
+	_shader->setShaderParameters(
+		context,
+		worldMatrix,
+		viewMatrix,
+		perspectiveMatrix,
+		_texture,
+		_normalMap,
+		_material,
+		lightArray,
+		lightTypes,
+		shadowMaps,
+		cameraPos
+		);
+	_shader->additionalParameters(context, _additionalShaderData);
+
+	const XMFLOAT2 surfaceUvOffset(_streamer.getUvOffset(), _streamer.getUvOffset());
+	const float uvPerUnit = _streamer.getUvPerUnit();
+	for (const TerrainStreamer::ResidentTile& tile : tiles)
+	{
+		//! every quadtree is in the space of its tile
+		Meshlets::CullView view = Meshlets::makeCullView(XMMatrixTranslation(tile.origin.x, 0.f, tile.origin.y) * worldMatrix, viewMatrix, perspectiveMatrix);
+		XMFLOAT3 tileEye(_lodEye.x - tile.origin.x, _lodEye.y, _lodEye.z - tile.origin.y);
+		TerrainQuadtree::SelectionStats stats = tile.quadtree->select(view, tileEye, lodBias, _nodes);
+		_selectionStats.visited += stats.visited;
+		_selectionStats.selected += stats.selected;
+		_selectionStats.culled += stats.culled;
+		_selectionStats.triangles += stats.triangles;
+		if (_nodes.empty())
+			continue;
+
+		_landscapeShader->setSurfaceMaps(context, tile.surface, tile.splat);
+		for (const TerrainQuadtree::Node& node : _nodes)
+		{
+			_landscapeShader->setTerrainNode(context, node, tileEye, _grid->getResolution(), uvPerUnit, surfaceUvOffset, tile.origin);
+			if (node.quadrant < 0)
+			{
+				_shader->render(context, _mesh->getIndexCount(), 0);
+			}
+			else
+			{
+				const Meshlets::IndexRange& quadrant = _grid->getQuadrant(node.quadrant);
+				_shader->render(context, (int)quadrant.indexCount, (int)quadrant.indexStart);
+			}
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef _STREAMED_TERRAIN_H
+#define _STREAMED_TERRAIN_H
+#include "Object.h"
+#include "LandscapeShader.h"
+
+//! endless procedural landscape, tiles around the camera are generated on loader threads and drawn like the terrain object, one quadtree per tile
+//! the additional shader data needs splatWeights set, each tile binds its own surface and splat map
+class StreamedTerrain : public Object
+{
+	TerrainStreamer _streamer;
+	TerrainGridMesh* _grid;
+	LandscapeShader* _landscapeShader;
+	XMFLOAT3 _lodEye = { 0,0,0 };					//! object space camera of the last perspective view, orthographic (shadow) views select around it
+	std::vector<TerrainQuadtree::Node> _nodes;
+	TerrainQuadtree::SelectionStats _selectionStats;	//! nodes and triangles of the last render call, all tiles
+
+public:
+	StreamedTerrain(
+		ID3D11Device* device,
+		TerrainGridMesh* grid,
+		LandscapeShader* shader,
+		const TerrainStreamer::Settings& settings,
+		ID3D11ShaderResourceView* texture = NULL,
+		ID3D11ShaderResourceView* normalMap = NULL,
+		DefaultShader::MaterialBufferType* material = NULL
+	);
+
+	//! tiles of the same size and height as the landscape, the noise turned into hills and ridges a few tiles across
+	static TerrainStreamer::Settings landscapeSettings();
+
+	//! streams around the camera, the object is only translated, never waits on the loaders
+	void update(ID3D11DeviceContext* context, XMFLOAT3 cameraPos);
+
+	const TerrainStreamer& getStreamer() { return _streamer; }
+	const TerrainQuadtree::SelectionStats& getSelectionStats() { return _selectionStats; }
+
+	//! selects the nodes of every resident tile for the view and draws the grid for each of them
+	void render(
+		D3D* renderer,
+		XMMATRIX viewMatrix,
+		XMMATRIX perspectiveMatrix,
+		const std::vector<ShadowMap*>* shadowMaps = NULL,
+		const std::vector<Light*>* lightArray = NULL,
+		const std::vector<LightType>* lightTypes = NULL,
+		XMFLOAT3 cameraPos = { 0,0,0 },
+		float lodBias = 1.f
+		) override;
+};
+
+#endif
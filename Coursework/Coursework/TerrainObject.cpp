@@ -0,0 +1,147 @@
+#include "TerrainObject.h"
+#include <chrono>
+
+TerrainObject::TerrainObject(ID3D11Device* device, TerrainGridMesh* grid, LandscapeShader* shader, const TerrainQuadtree::Settings& settings, const Heightfield& heightfield,
+	float uvPerUnit, const char* surfaceCache, const char* occlusionCache, ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* normalMap, DefaultShader::MaterialBufferType* material) :
+	Object(grid, shader, NULL, texture, normalMap, material),
+	_grid(grid),
+	_landscapeShader(shader),
+	_uvPerUnit(uvPerUnit)
+{
+	//! the part of the heightmap under the terrain, the shader samples it at position * uvPerUnit
+	_quadtree.build(settings, heightfield.getHeights(), heightfield.getWidth(), heightfield.getHeight(), settings.size * uvPerUnit);
+
+	if (heightfield.isEmpty())
+		return;
+
+	//! the bake only runs again once the heights or the altitude change
+	auto start = std::chrono::high_resolution_clock::now();
+	Heightfield::SurfaceSettings surface = surfaceSettings(settings);
+	unsigned long long key = heightfield.getSurfaceKey(surface);
+	std::vector<Heightfield::SurfaceTexel> texels;
+	_surfaceFromCache = Heightfield::loadSurface(surfaceCache, key, heightfield.getWidth(), heightfield.getHeight(), texels);
+	if (!_surfaceFromCache)
+	{
+		heightfield.bakeSurface(surface, texels);
+		Heightfield::saveSurface(surfaceCache, key, heightfield.getWidth(), heightfield.getHeight(), texels);
+	}
+	_surfaceBakeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	_surfaceMap = Heightfield::createSurfaceTexture(device, texels.data(), heightfield.getWidth(), heightfield.getHeight());
+
+	//! built from the same texels, so CPU placement and picking agree with the drawn terrain
+	_heightQuery.build(texels.data(), heightfield.getWidth(), heightfield.getHeight(), uvPerUnit, settings.size);
+
+	//! horizons of the same heights, the bake is deterministic so a cached one is what a bake would give
+	start = std::chrono::high_resolution_clock::now();
+	HorizonOcclusion::Settings occlusion = occlusionSettings(settings, uvPerUnit, heightfield.getWidth());
+	key = HorizonOcclusion::getKey(heightfield, occlusion);
+	std::vector<unsigned char> visibility;
+	_occlusionFromCache = HorizonOcclusion::load(occlusionCache, key, heightfield.getWidth(), heightfield.getHeight(), visibility);
+	if (!_occlusionFromCache)
+	{
+		HorizonOcclusion::bake(heightfield, occlusion, visibility);
+		HorizonOcclusion::save(occlusionCache, key, heightfield.getWidth(), heightfield.getHeight(), visibility);
+	}
+	_occlusionBakeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	_occlusionMap = HorizonOcclusion::createTexture(device, visibility.data(), heightfield.getWidth(), heightfield.getHeight());
+}
+
+TerrainObject::~TerrainObject()
+{
+	if (_surfaceMap)
+		_surfaceMap->Release();
+
+	if (_occlusionMap)
+		_occlusionMap->Release();
+}
+
+//! the old plane had vertices from 0 to 99 and sampled the heightmap at position / 100
+//! 5 levels of 16x16 grids give the finest level 99 / 256 units per quad, the leaf range of about 2.5 leaf nodes keeps neighbours within a level
+TerrainQuadtree::Settings TerrainObject::landscapeSettings()
+{
+	TerrainQuadtree::Settings settings;
+	settings.size = 99.f;
+	settings.maxHeight = 50.f;		//! baked into the surface map, the landscape shader reads heights in object space
+	settings.gridResolution = 16;
+	settings.lodCount = 5;
+	settings.leafRange = 16.f;
+	settings.morphRatio = 0.7f;
+	return settings;
+}
+
+//! the normal step of 0.008 uv is what the landscape vertex shader used with the heightmap
+Heightfield::SurfaceSettings TerrainObject::surfaceSettings(const TerrainQuadtree::Settings& settings)
+{
+	Heightfield::SurfaceSettings surface;
+	surface.heightScale = settings.maxHeight;
+	surface.normalStep = 0.008f;
+	return surface;
+}
+
+//! 16 directions, with fewer the occlusion of ridges and valleys shows streaks along the swept directions
+HorizonOcclusion::Settings TerrainObject::occlusionSettings(const TerrainQuadtree::Settings& settings, float uvPerUnit, int heightmapWidth)
+{
+	HorizonOcclusion::Settings occlusion;
+	occlusion.directions = 16;
+	occlusion.heightScale = settings.maxHeight;
+	occlusion.texelSize = 1.f / (uvPerUnit * heightmapWidth);
+	return occlusion;
+}
+
+void TerrainObject::render(
+	D3D* renderer,
+	XMMATRIX viewMatrix,
+	XMMATRIX perspectiveMatrix,
+	const std::vector<ShadowMap*>* shadowMaps,
+	const std::vector<Light*>* lightArray,
+	const std::vector<LightType>* lightTypes,
+	XMFLOAT3 cameraPos,
+	float lodBias
+	)
+{
+	//! apply transform
+	auto worldMatrix = renderer->getWorldMatrix();
+	applyTransform(worldMatrix);
+
+	//! the shadow maps select around the camera too, so the shadows are cast by the geometry that is seen
+	Meshlets::CullView view = Meshlets::makeCullView(worldMatrix, viewMatrix, perspectiveMatrix);
+	if (!view.orthographic)
+		_lodEye = view.eye;
+
+	_selectionStats = _quadtree.select(view, _lodEye, lodBias, _nodes);
+	if (_nodes.empty())
+		return;
+
+	//! the grid is bound and the object parameters set once, only the node buffer changes between the draws
+	ID3D11DeviceContext* context = renderer->getDeviceContext();
+	_mesh->sendData(context, _top);
+	_shader->setVertexFormat(context, _mesh);
+	_shader->setShaderParameters(
+		context,
+		worldMatrix,
+		viewMatrix,
+		perspectiveMatrix,
+		_texture,
+		_normalMap,
+		_material,
+		lightArray,
+		lightTypes,
+		shadowMaps,
+		cameraPos
+		);
+	_shader->additionalParameters(context, _additionalShaderData);
+
+	for (const TerrainQuadtree::Node& node : _nodes)
+	{
+		_landscapeShader->setTerrainNode(context, node, _lodEye, _grid->getResolution(), _uvPerUnit);
+		if (node.quadrant < 0)
+		{
+			_shader->render(context, _mesh->getIndexCount(), 0);
+		}
+		else
+		{
+			const Meshlets::IndexRange& quadrant = _grid->getQuadrant(node.quadrant);
+			_shader->render(context, (int)quadrant.indexCount, (int)quadrant.indexStart);
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#ifndef _TERRAIN_OBJECT_H
+#define _TERRAIN_OBJECT_H
+#include "Object.h"
+#include "LandscapeShader.h"
+
+//! landscape drawn with continuous level of detail, the quadtree selects nodes per view and the shared grid mesh is drawn once per node
+//! the landscape shader places, morphs and displaces the grid, so the mesh is the same for every node and level
+class TerrainObject : public Object
+{
+	TerrainQuadtree _quadtree;
+	TerrainGridMesh* _grid;
+	LandscapeShader* _landscapeShader;
+	float _uvPerUnit;								//! heightmap uv per object space unit
+	ID3D11ShaderResourceView* _surfaceMap = NULL;	//! baked normals and heights the shader samples, see Heightfield
+	float _surfaceBakeMs = 0.f;						//! bake or cache load time of the surface
+	bool _surfaceFromCache = false;
+	ID3D11ShaderResourceView* _occlusionMap = NULL;	//! ambient visibility of the surface texels, see HorizonOcclusion
+	float _occlusionBakeMs = 0.f;
+	bool _occlusionFromCache = false;
+	HeightfieldQuery _heightQuery;					//! CPU copy of the surface map, heights and normals where the shader puts them
+	XMFLOAT3 _lodEye = { 0,0,0 };					//! object space camera of the last perspective view, orthographic (shadow) views select around it
+	std::vector<TerrainQuadtree::Node> _nodes;
+	TerrainQuadtree::SelectionStats _selectionStats;	//! nodes and triangles of the last render call
+
+public:
+	//! the heightfield is read for the node bounds and the surface map, not kept
+	//! the surface is loaded from surfaceCache when it was baked from the same heights and altitude, and baked and saved there otherwise
+	//! the occlusion map is cached the same way in occlusionCache
+	TerrainObject(
+		ID3D11Device* device,
+		TerrainGridMesh* grid,
+		LandscapeShader* shader,
+		const TerrainQuadtree::Settings& settings,
+		const Heightfield& heightfield,
+		float uvPerUnit,
+		const char* surfaceCache,
+		const char* occlusionCache,
+		ID3D11ShaderResourceView* texture = NULL,
+		ID3D11ShaderResourceView* normalMap = NULL,
+		DefaultShader::MaterialBufferType* material = NULL
+	);
+	~TerrainObject();
+
+	//! settings matching the extent and altitude of the 100x100 plane the scene landscape used to be
+	static TerrainQuadtree::Settings landscapeSettings();
+	//! the surface bake of the landscape, normals as the landscape shader computed them from the heightmap before
+	static Heightfield::SurfaceSettings surfaceSettings(const TerrainQuadtree::Settings& settings);
+	//! the occlusion bake of the landscape, texels as far apart as the shader samples them
+	static HorizonOcclusion::Settings occlusionSettings(const TerrainQuadtree::Settings& settings, float uvPerUnit, int heightmapWidth);
+
+	ID3D11ShaderResourceView* getSurfaceMap() { return _surfaceMap; }
+	float getSurfaceBakeMs() { return _surfaceBakeMs; }
+	bool isSurfaceFromCache() { return _surfaceFromCache; }
+	ID3D11ShaderResourceView* getOcclusionMap() { return _occlusionMap; }
+	float getOcclusionBakeMs() { return _occlusionBakeMs; }
+	bool isOcclusionFromCache() { return _occlusionFromCache; }
+	const HeightfieldQuery& getHeightQuery() { return _heightQuery; }
+	const TerrainQuadtree& getQuadtree() { return _quadtree; }
+	const TerrainQuadtree::SelectionStats& getSelectionStats() { return _selectionStats; }
+
+	//! selects the nodes for the view and draws the grid for each of them
+	void render(
+		D3D* renderer,
+		XMMATRIX viewMatrix,
+		XMMATRIX perspectiveMatrix,
+		const std::vector<ShadowMap*>* shadowMaps = NULL,
+		const std::vector<Light*>* lightArray = NULL,
+		const std::vector<LightType>* lightTypes = NULL,
+		XMFLOAT3 cameraPos = { 0,0,0 },
+		float lodBias = 1.f
+		) override;
+};
+
+#endif
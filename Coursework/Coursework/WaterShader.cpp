@@ -4,6 +4,7 @@
 WaterShader::WaterShader(ID3D11Device* device, HWND hwnd) : DefaultShader(device, hwnd)
 {
 	initShader(L"water_vs.cso", L"water_ps.cso");
+	loadPackedVertexShader(L"water_packed_vs.cso");
 
 	setupBuffer<WaterPixelBufferType>(renderer, &_waterBuffer);
 	setupBuffer<WaterVertexBufferType>(renderer, &_waveBuffer);
@@ -15,7 +15,7 @@ public:
         XMFLOAT2 uvOffset2 = { 0, 0 };
         XMFLOAT2 uvScaling2 = { 1, 1 }; //altitude, frequency
         XMFLOAT3 landscapeOriginPosition = { 0,0,0 };
-        float p;
+        float maxHeight = 0.f; //height of a heightmap sample of 1, the landscape maxHeight
     };
 
     //! buffer for vertex stage, modifies the waves, public for UI params ease of access 
@@ -6,7 +6,7 @@ struct InputType
 {
     float4 position : POSITION;
     float2 tex : TEXCOORD0;
-    float3 normal : NORMAL;
+    NORMAL_INPUT normal : NORMAL;
 };
 
 struct OutputType
@@ -23,13 +23,13 @@ OutputType main(InputType input)
     OutputType output;
 
 	//! Calculate the position of the vertex against the world, view, and projection matrices.
-    output.position = calculateScreenPosition(input.position);
+    output.position = calculateScreenPosition(decodePosition(input.position));
 
     //! propagate UVs further, flip Y coords
     output.tex = input.tex;
     
     //! calculate normals in the world space
-    output.normal = calculateWorldNormal(input.normal);
+    output.normal = calculateWorldNormal(decodeNormal(input.normal));
     
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,3 @@
+//! default_vs.hlsl for VertexType_Packed meshes, positions and normals are decoded in shader_tools_vs.hlsli
+#define PACKED_VERTEX
+#include "default_vs.hlsl"
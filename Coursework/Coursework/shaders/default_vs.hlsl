@@ -6,7 +6,7 @@ struct InputType
 {
     float4 position : POSITION;
     float2 tex : TEXCOORD0;
-	float3 normal : NORMAL;
+	NORMAL_INPUT normal : NORMAL;
 };
 
 struct OutputType
@@ -24,20 +24,21 @@ struct OutputType
 OutputType main(InputType input)
 {
     OutputType output;
+    const float4 position = decodePosition(input.position);
 
 	//! Calculate the position of the vertex against the world, view, and projection matrices.
-    output.position = calculateScreenPosition(input.position);
-    output.worldPosition = calculateWorldPosition(input.position);
+    output.position = calculateScreenPosition(position);
+    output.worldPosition = calculateWorldPosition(position);
     
 	//! Calculate the position of the vertex as viewed by the light source.
     for (int i = 0; i < NUM_OF_LIGHTS; i++)
-        output.lightViewPos[i] = calculateLightViewPosition(input.position, i);
+        output.lightViewPos[i] = calculateLightViewPosition(position, i);
 
     //! propagate UVs further, flip Y coords
     output.tex = flipUVsVertical(input.tex);
     
     //! calculate normals in the world space
-    output.normal = calculateWorldNormal(input.normal);
+    output.normal = calculateWorldNormal(decodeNormal(input.normal));
 
     //! camera view vector calculation
     output.viewVector = calculateCameraView(output.worldPosition);
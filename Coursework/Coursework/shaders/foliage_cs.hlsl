@@ -27,6 +27,8 @@ cbuffer ConstantComputeBuffer : register(b0)
 {
     float fillingPercentage;
     float3 landscapeScaling;
+    float maxHeight;
+    float3 p;
 };
 
 // GROUP CONSTANTS //
@@ -56,7 +58,7 @@ void main(uint3 groupID : SV_GroupID, uint3 dispatchThreadID : SV_DispatchThread
     if (random < fillingPercentage && 
         int(brushMap.SampleLevel(diffuseSampler, uv, 0).r))
     {
-        float altitude = heightMap.SampleLevel(diffuseSampler, uv, 0).r * MAX_ALTITUDE;
+        float altitude = heightMap.SampleLevel(diffuseSampler, uv, 0).r * maxHeight;
         newVerticesBuffer[index].position = float3(uv.x * landscapeScaling.x, altitude, uv.y * landscapeScaling.z);
     }
     else
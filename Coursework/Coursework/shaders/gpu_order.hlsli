@@ -0,0 +1,35 @@
+//! shared by the depth sort kernels, DepthSort.h runs the same network on the CPU
+
+#define GROUP_SIZE 512          //elements a group sorts in shared memory, two per thread
+#define THREADS 256             //threads per group of every kernel
+
+// BUFFERS //
+
+cbuffer SortConstantsBuffer : register(b0)
+{
+    uint count;                 //points sorted
+    uint paddedCount;           //keys sorted, a power of two of at least a group
+    uint level;                 //size of the bitonic sequences merged, the first one of a local pass
+    uint lastLevel;             //local passes run every level up to this one
+    uint step;                  //global passes, distance of the compared keys
+    uint positionStride;        //floats from one position to the next
+    float2 padding;
+    float3 cameraPosition;
+    float padding2;
+};
+
+//! (depth, index), depth is the squared distance with its bits flipped so the furthest point comes first
+RWStructuredBuffer<uint2> keys : register(u0);
+
+// FUNCTIONS //
+
+bool keyLess(uint2 a, uint2 b)
+{
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+//! first element thread t compares, the pairs are (i, i + s) with i in the lower half of every 2 * s elements
+uint pairStart(uint t, uint s)
+{
+    return (t / s) * s * 2 + t % s;
+}
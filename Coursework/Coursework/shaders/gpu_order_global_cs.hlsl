@@ -0,0 +1,20 @@
+#include "gpu_order.hlsli"
+
+// FUNCTIONS //
+
+//! one merge step of keys a group or more apart, straight in the buffer
+[numthreads(THREADS, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    if (dispatchThreadID.x >= paddedCount / 2)
+        return;
+
+    uint i = pairStart(dispatchThreadID.x, step);
+    uint2 a = keys[i];
+    uint2 b = keys[i + step];
+    if (keyLess(b, a) == ((i & level) == 0))
+    {
+        keys[i] = b;
+        keys[i + step] = a;
+    }
+};
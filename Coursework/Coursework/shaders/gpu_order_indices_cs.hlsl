@@ -0,0 +1,19 @@
+#include "gpu_order.hlsli"
+
+// BUFFERS //
+
+//! index buffer the points are drawn with, raw as index buffers cannot be structured
+RWByteAddressBuffer drawIndices : register(u1);
+
+// FUNCTIONS //
+
+[numthreads(THREADS, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint index = dispatchThreadID.x;
+    if (index >= count)
+        return;
+
+    //! the keys of the points are sorted before the padding, far to near
+    drawIndices.Store(index * 4, keys[index].y);
+};
@@ -0,0 +1,27 @@
+#include "gpu_order.hlsli"
+
+// BUFFERS //
+
+//! the position is the first three floats of every point, a vertex buffer or uploaded positions
+Buffer<float> positions : register(t0);
+
+// FUNCTIONS //
+
+[numthreads(THREADS, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint index = dispatchThreadID.x;
+    if (index >= paddedCount)
+        return;
+
+    //! precise keeps the multiplies and adds apart and in order, the CPU reference gets the same bits
+    if (index < count)
+    {
+        uint first = index * positionStride;
+        precise float3 offset = float3(positions[first], positions[first + 1], positions[first + 2]) - cameraPosition;
+        precise float distanceSq = offset.x * offset.x + offset.y * offset.y + offset.z * offset.z;
+        keys[index] = uint2(~asuint(distanceSq), index);
+    }
+    else
+        keys[index] = uint2(0xFFFFFFFF, 0xFFFFFFFF);
+};
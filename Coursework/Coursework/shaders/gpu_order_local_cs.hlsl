@@ -0,0 +1,38 @@
+#include "gpu_order.hlsli"
+
+// GROUP CONSTANTS //
+
+groupshared uint2 sharedKeys[GROUP_SIZE];
+
+// FUNCTIONS //
+
+//! sorts or merges the keys of the group in shared memory, every step below the group size of the levels level to lastLevel
+[numthreads(THREADS, 1, 1)]
+void main(uint3 groupID : SV_GroupID, uint3 groupThreadID : SV_GroupThreadID)
+{
+    uint first = groupID.x * GROUP_SIZE;
+    uint thread = groupThreadID.x;
+    sharedKeys[thread] = keys[first + thread];
+    sharedKeys[thread + THREADS] = keys[first + thread + THREADS];
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint l = level; l <= lastLevel; l <<= 1)
+    {
+        for (uint s = min(l, GROUP_SIZE) / 2; s > 0; s >>= 1)
+        {
+            //! ascending where the level bit of the global index is clear, so neighbouring sequences alternate
+            uint i = pairStart(thread, s);
+            uint2 a = sharedKeys[i];
+            uint2 b = sharedKeys[i + s];
+            if (keyLess(b, a) == (((first + i) & l) == 0))
+            {
+                sharedKeys[i] = b;
+                sharedKeys[i + s] = a;
+            }
+            GroupMemoryBarrierWithGroupSync();
+        }
+    }
+
+    keys[first + thread] = sharedKeys[thread];
+    keys[first + thread + THREADS] = sharedKeys[thread + THREADS];
+};
@@ -5,6 +5,8 @@
 
 Texture2D layerTexture[3] : register(t10); //! t1-t9 are reserved for the default shader textures
 Texture2D normalMaps[3] : register(t13);
+Texture2D splatMap : register(t16); //! layer weights in rgb, baked with the streamed tiles
+Texture2D occlusionMap : register(t17); //! ambient visibility baked from the horizons of the heightmap
 
 struct InputType
 {
@@ -13,16 +15,34 @@ struct InputType
     float3 normal : NORMAL;
     float3 worldPosition : TEXCOORD1;
     float3 viewVector : TEXCOORD2;
-    float4 lightViewPos[NUM_OF_LIGHTS] : TEXCOORD3;
+    float2 surfaceUv : TEXCOORD3;
+    float4 lightViewPos[NUM_OF_LIGHTS] : TEXCOORD4;
 };
 
 cbuffer LandscapeBuffer : register(b2)
 {
     float4 ranges;
+    float4 splat; //! x above 0 blends by the splat map instead of the altitude
+    float4 occlusion; //! x is the strength of the occlusion map, 0 without one
 };
 
 // FUNCTIONS //
 
+//! blends the three layers and their normal maps by the weights, the altitude ranges are not used
+float4 splatLayers(float3 weights, float2 uv, inout float3 normalVector)
+{
+    float4 colour = float4(0.f, 0.f, 0.f, 0.f);
+    float4 normalMapValue = float4(0.f, 0.f, 0.f, 0.f);
+    for (int i = 0; i < 3; i++)
+    {
+        colour += weights[i] * saturate(ENUM_IF(shadingType, 0.f) || ENUM_IF(shadingType, 1.f) ? layerTexture[i].SampleLevel(diffuseSampler, uv, 0) : diffuse);
+        normalMapValue += weights[i] * saturate(ENUM_IF(shadingType, 0.f) || ENUM_IF(shadingType, 2.f) ? normalMaps[i].SampleLevel(diffuseSampler, uv, 0) : float4(0.5f, 0.5f, 0.5f, 0.f));
+    }
+
+    normalVector = normalize(normalVector + normalMapValue.rgb - 0.5f);
+    return colour;
+}
+
 float4 main(InputType input) : SV_TARGET
 {
 //----------------NORMAL AND TEXTURE -----------------
@@ -33,9 +53,16 @@ float4 main(InputType input) : SV_TARGET
     float4 normalMapValue = float4(0.f, 0.f, 0.f, 0.f);
     float2 finalUV = applyUVTransform(input.tex, uvOffset, uvScale);
     
+    //! streamed tiles carry their own weights
+    if (splat.x > 0.f)
+    {
+        const float3 weights = splatMap.SampleLevel(diffuseSampler, input.surfaceUv, 0).rgb;
+        alpha = splatLayers(weights / max(weights.r + weights.g + weights.b, 0.001f), finalUV, normalVector);
+    }
+
     //! interpolate beteen layers if needed, based on the altitude
     //Layer 1
-    if (input.worldPosition.y < ranges.x)
+    else if (input.worldPosition.y < ranges.x)
     {
         
         alpha = getScaledTextureColour(input.tex, uvOffset, uvScale, layerTexture[0]);
@@ -116,6 +143,10 @@ float4 main(InputType input) : SV_TARGET
         input.viewVector,
         input.tex);
     
+    //! horizon occlusion darkens the light coming from all around, the direct light has the shadow maps
+    if (occlusion.x > 0.f)
+        lightData.ambient.rgb *= lerp(1.f, occlusionMap.SampleLevel(diffuseSampler, input.surfaceUv, 0).r, occlusion.x);
+    
 //-------- final assembly of the colour ----------
     lightData.lightColour = finalizeLightColour(lightData.shadowPasses, lightData.ambient, lightData.lightColour);
     
@@ -1,15 +1,29 @@
 #include "shader_tools_vs.hlsli"
-#define MAX_ALTITUDE 50.f
 
 // BUFFERS //
 
-Texture2D heightMap : register(t0);
-SamplerState heightSampler : register(s0);
+//! baked on the CPU, unit normal in xyz and object space height in w
+Texture2D surfaceMap : register(t0);
+SamplerState surfaceSampler : register(s0);
+
+//! terrain quadtree node the grid is drawn for
+cbuffer TerrainNodeBuffer : register(b3)
+{
+    float2 nodeOrigin;
+    float nodeSize;
+    float gridResolution;
+    float3 eyePosition;
+    float uvPerUnit;
+    float2 morphRange;
+    float2 surfaceUvOffset;
+    float2 tileOrigin;
+    float2 padding;
+};
 
 struct InputType
 {
     float4 position : POSITION;
-    float3 normal : NORMAL;
+    NORMAL_INPUT normal : NORMAL;
     float2 tex : TEXCOORD0;
 };
 
@@ -20,25 +34,37 @@ struct OutputType
     float3 normal : NORMAL;
     float3 worldPosition : TEXCOORD1;
     float3 viewVector : TEXCOORD2;
-    float4 lightViewPos[NUM_OF_LIGHTS] : TEXCOORD3;
+    float2 surfaceUv : TEXCOORD3;
+    float4 lightViewPos[NUM_OF_LIGHTS] : TEXCOORD4;
 };
 
 // FUNCTIONS //
 
-float3 calculateNormalFromHeightMap(Texture2D heighMap, float2 uv, float step)
+//! moves the odd vertices of the grid onto the even ones, which are the vertices of the grid a level coarser (CDLOD)
+//! at morphK 1 the node matches its coarser neighbours along the shared edge
+float2 morphVertex(float2 gridPos, float morphK)
 {
-    const float deltaY1 = heightMap.SampleLevel(heightSampler, uv + float2(step, 0.f), 0) - heightMap.SampleLevel(heightSampler, uv + float2(-step, 0.f), 0);
-    const float deltaY2 = heightMap.SampleLevel(heightSampler, uv + float2(0.f, step), 0) - heightMap.SampleLevel(heightSampler, uv + float2(0.f, -step), 0);
-    return calculateNormalFromPlane(step, deltaY1, deltaY2);
+    const float2 oddOffset = frac(gridPos * 0.5f) * 2.f;
+    return gridPos - oddOffset * morphK;
 }
 
 OutputType main(InputType input)
 {
     OutputType output;
 
-    const float4 heightVal = heightMap.SampleLevel(heightSampler, input.tex, 0);
-    float4 relativePos = input.position;
-    relativePos.y += heightVal.r * MAX_ALTITUDE;
+    //! grid vertex placed within the node, its distance to the eye decides how far it morphs
+    //! node positions are in the space of the surface map, which is offset by tileOrigin for streamed tiles
+    const float2 gridPos = round(decodePosition(input.position).xz);
+    const float gridScale = nodeSize / gridResolution;
+    float2 nodePos = nodeOrigin + gridPos * gridScale;
+    const float gridHeight = surfaceMap.SampleLevel(surfaceSampler, nodePos * uvPerUnit + surfaceUvOffset, 0).w;
+    const float eyeDistance = length(eyePosition - float3(nodePos.x, gridHeight, nodePos.y));
+    const float morphK = saturate((eyeDistance - morphRange.x) / (morphRange.y - morphRange.x));
+    nodePos = nodeOrigin + morphVertex(gridPos, morphK) * gridScale;
+
+    const float2 uv = nodePos * uvPerUnit + surfaceUvOffset;
+    const float4 surface = surfaceMap.SampleLevel(surfaceSampler, uv, 0);
+    float4 relativePos = float4(nodePos.x + tileOrigin.x, surface.w, nodePos.y + tileOrigin.y, 1.f);
 
 	//! Calculate the position of the vertex against the world, view, and projection matrices.
     output.position = calculateScreenPosition(relativePos);
@@ -48,13 +74,12 @@ OutputType main(InputType input)
     for (int i = 0; i < NUM_OF_LIGHTS; i++)
         output.lightViewPos[i] = calculateLightViewPosition(relativePos, i);
 
-    //! propagate normals
-    output.tex = input.tex;
+    //! propagate normals, the layer uvs run on across the tiles
+    output.tex = relativePos.xz * uvPerUnit;
+    output.surfaceUv = uv;
     
-    //! Recalculate normals for vertices
-    //! Since uv are 0-1 and height map is 0-1, we can relate height differences with positional differences 1:1
-    const float3 normal = calculateNormalFromHeightMap(heightMap, input.tex, 0.008);
-    output.normal = calculateWorldNormal(normal);
+    //! Baked normals, renormalised after filtering
+    output.normal = calculateWorldNormal(normalize(surface.xyz));
 
     //! View vector per vertex
     output.viewVector = calculateCameraView(output.worldPosition);
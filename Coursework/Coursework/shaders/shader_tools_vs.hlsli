@@ -21,8 +21,49 @@ cbuffer LightMatrixBuffer : register(b2)
     matrix L_lightProjection[NUM_OF_LIGHTS];
 };
 
+//! packed variants (*_packed_vs.hlsl) define PACKED_VERTEX, positions then arrive as unorm relative to the mesh bounds
+//! and normals octahedral encoded, see VertexPacking in the framework
+#ifdef PACKED_VERTEX
+cbuffer QuantisationBuffer : register(b4)
+{
+    float3 positionOffset;
+    float padding0;
+    float3 positionScale;
+    float padding1;
+};
+
+#define NORMAL_INPUT float2
+#else
+#define NORMAL_INPUT float3
+#endif
+
 // FUNCTIONS //
 
+//! DECODE POSITION --------------------------------------------------------------------------------------------
+//! object space position of the vertex, dequantised for packed vertices
+float4 decodePosition(float4 position)
+{
+#ifdef PACKED_VERTEX
+    return float4(positionOffset + position.xyz * positionScale, 1.f);
+#else
+    return position;
+#endif
+}
+
+//! DECODE NORMAL --------------------------------------------------------------------------------------------
+//! object space normal of the vertex, unfolds the octahedral encoding for packed vertices
+float3 decodeNormal(NORMAL_INPUT normal)
+{
+#ifdef PACKED_VERTEX
+    float3 decoded = float3(normal.xy, 1.f - abs(normal.x) - abs(normal.y));
+    const float fold = saturate(-decoded.z);
+    decoded.xy += decoded.xy >= 0.f ? -fold : fold;
+    return normalize(decoded);
+#else
+    return normal;
+#endif
+}
+
 //! FLIP UV VERTICAL //
 //! Flips the y uv corrdinate
 float2 flipUVsVertical(float2 uv)
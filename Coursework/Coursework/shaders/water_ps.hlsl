@@ -11,7 +11,7 @@ cbuffer WaterPixelBuffer : register(b2)
     float2 uvOffset2;
     float2 uvScaling2;
     float3 landscapeOriginPosition;
-    float p1;
+    float maxHeight;
 };
 
 struct InputType
@@ -65,7 +65,7 @@ float4 main(InputType input) : SV_TARGET
     _out.w = saturate(alpha.w + length(lightData.specular.xyz));
     
     //water foam around the shore/edge
-    float heightVal = landscapeOriginPosition.y + heightMap.Sample(diffuseSampler, input.tex).r * MAX_ALTITUDE;
+    float heightVal = landscapeOriginPosition.y + heightMap.Sample(diffuseSampler, input.tex).r * maxHeight;
     heightVal = abs(heightVal - input.worldPosition.y);
     _out += interpolateColourFromRange(float4(1.f, 1.f, 1.f, 0.f), float4(0.01f, 0.01f, 0.01f, 0.01f), 0.f, 1.5f, heightVal);
     
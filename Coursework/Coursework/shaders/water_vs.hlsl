@@ -46,7 +46,8 @@ OutputType main(InputType input)
     OutputType output;
     
     //! waves
-    float4 position = input.position;
+    const float4 basePosition = decodePosition(input.position);
+    float4 position = basePosition;
     position.y = getAltitudeAt(position.xyz);
     
 	//! Calculate the position of the vertex against the world, view, and projection matrices.
@@ -61,7 +62,7 @@ OutputType main(InputType input)
     output.tex = input.tex;
     
     //! calculate normal using basic calculus
-    const float3 normal = calculateNormal(input.position.xyz,0.0002);
+    const float3 normal = calculateNormal(basePosition.xyz,0.0002);
     
     //! calculate normals in the world space
     output.normal = calculateWorldNormal(normal);
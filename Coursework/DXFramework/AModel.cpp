@@ -1,9 +1,33 @@
 #include "AModel.h"
+#include <algorithm>
+#include <cstring>
 
-AModel::AModel(ID3D11Device* ldevice, const std::string& file)
+// Post processing applied on import, part of the cache hash so changing them rebuilds the baked files.
+const unsigned int k_ImportFlags = aiProcess_CalcTangentSpace |
+	aiProcess_Triangulate |
+	aiProcess_SortByPType |
+	aiProcess_MakeLeftHanded |
+	aiProcess_FlipUVs;
+
+AModel::AModel(ID3D11Device* ldevice, const std::string& file, bool arenaImport)
 {
 	device = ldevice;
-	importModel(file);
+	materialSlotCount = 0;
+	cacheFile = MeshCache::getCachePath(file.c_str(), "amodel");
+	sourceHash = MeshCache::hashSource(file.c_str(), k_ImportFlags);
+	fromCache = loadCache(device);
+
+	if (!fromCache)
+	{
+		if (arenaImport)
+		{
+			importModel(file);
+		}
+		else
+		{
+			importModelAppend(file);
+		}
+	}
 }
 
 AModel::~AModel()
@@ -16,75 +40,278 @@ void AModel::initBuffers(ID3D11Device* device)
 	
 }
 
+namespace
+{
+	// One reference to a mesh from the node tree, with its triangle count.
+	struct MeshInstance
+	{
+		const aiMesh* mesh;
+		unsigned int triangles;
+	};
+
+	void countNode(const aiNode* node, const aiScene* scene, std::vector<MeshInstance>* instances, int& meshCount)
+	{
+		for (UINT i = 0; i < node->mNumMeshes; i++)
+		{
+			if (instances)
+			{
+				// Points and lines are split off by aiProcess_SortByPType, only triangles are imported.
+				const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+				MeshInstance instance = { mesh, 0 };
+				for (UINT f = 0; f < mesh->mNumFaces; f++)
+				{
+					instance.triangles += mesh->mFaces[f].mNumIndices == 3 ? 1 : 0;
+				}
+				instances->push_back(instance);
+			}
+			meshCount++;
+		}
+
+		for (UINT i = 0; i < node->mNumChildren; i++)
+		{
+			countNode(node->mChildren[i], scene, instances, meshCount);
+		}
+	}
+}
+
+// Sizes the scene first, then writes vertices, indices and the weld table into one arena allocation.
 void AModel::importModel(const std::string& pFile)
 {
-	// Create an instance of the Importer class
 	Assimp::Importer importer;
-	// And have it read the given file with some example postprocessing
-	// Usually - if speed is not the most important aspect for you - you'll
-	// probably to request more postprocessing than we do in this example.
-	const aiScene* scene = importer.ReadFile(pFile,
-		aiProcess_CalcTangentSpace |
-		aiProcess_Triangulate |
-		aiProcess_JoinIdenticalVertices |
-		aiProcess_SortByPType|
-		aiProcess_MakeLeftHanded|
-		aiProcess_FlipUVs);
-	// If the import failed, report it
-	/*if (!scene)
+	const aiScene* scene = importer.ReadFile(pFile, k_ImportFlags);
+	if (!scene || !scene->mRootNode)
+	{
+		return;
+	}
+
+	// Pre-pass, the instance list is allocated once at its final size.
+	int meshCount = 0;
+	countNode(scene->mRootNode, scene, nullptr, meshCount);
+	std::vector<MeshInstance> instances;
+	instances.reserve(meshCount);
+	meshCount = 0;
+	countNode(scene->mRootNode, scene, &instances, meshCount);
+
+	// Sorting by material makes every material slot one contiguous range.
+	std::stable_sort(instances.begin(), instances.end(), [](const MeshInstance& a, const MeshInstance& b)
+	{
+		return a.mesh->mMaterialIndex < b.mesh->mMaterialIndex;
+	});
+
+	size_t totalVertices = 0, totalIndices = 0;
+	for (const MeshInstance& instance : instances)
+	{
+		if (instance.triangles > 0)
+		{
+			totalVertices += instance.mesh->mNumVertices;
+			totalIndices += instance.triangles * 3;
+		}
+	}
+	if (totalIndices == 0)
+	{
+		return;
+	}
+
+	size_t vertexBytes = totalVertices * sizeof(VertexType);
+	size_t indexBytes = totalIndices * sizeof(unsigned long);
+	unsigned char* arena = new unsigned char[vertexBytes + indexBytes + totalVertices * sizeof(unsigned long)];
+	VertexType* arenaVertices = reinterpret_cast<VertexType*>(arena);
+	unsigned long* arenaIndices = reinterpret_cast<unsigned long*>(arena + vertexBytes);
+	unsigned long* remap = reinterpret_cast<unsigned long*>(arena + vertexBytes + indexBytes);
+
+	submeshes.clear();
+	submeshes.reserve(instances.size());
+	unsigned long vertexCursor = 0;
+	unsigned int indexCursor = 0;
+	for (const MeshInstance& instance : instances)
+	{
+		const aiMesh* mesh = instance.mesh;
+		if (instance.triangles == 0)
+		{
+			continue;
+		}
+
+		MeshCache::Submesh submesh;
+		submesh.startIndex = indexCursor;
+		submesh.indexCount = instance.triangles * 3;
+		submesh.materialSlot = mesh->mMaterialIndex;
+
+		// Missing attributes are zeroed so they weld consistently.
+		XMVECTOR low = XMVectorSet(mesh->mVertices[0].x, mesh->mVertices[0].y, mesh->mVertices[0].z, 0.f);
+		XMVECTOR high = low;
+		for (UINT i = 0; i < mesh->mNumVertices; i++)
+		{
+			VertexType& vertex = arenaVertices[vertexCursor + i];
+			vertex.position = XMFLOAT3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+			vertex.texture = mesh->HasTextureCoords(0) ? XMFLOAT2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y) : XMFLOAT2(0.f, 0.f);
+			vertex.normal = mesh->HasNormals() ? XMFLOAT3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z) : XMFLOAT3(0.f, 0.f, 0.f);
+
+			XMVECTOR position = XMLoadFloat3(&vertex.position);
+			low = XMVectorMin(low, position);
+			high = XMVectorMax(high, position);
+		}
+		XMStoreFloat3(&submesh.boundsMin, low);
+		XMStoreFloat3(&submesh.boundsMax, high);
+
+		// Face indices are local to the mesh, offset them past the vertices of earlier meshes.
+		for (UINT i = 0; i < mesh->mNumFaces; i++)
+		{
+			const aiFace& face = mesh->mFaces[i];
+			if (face.mNumIndices != 3)
+			{
+				continue;
+			}
+			arenaIndices[indexCursor++] = vertexCursor + face.mIndices[0];
+			arenaIndices[indexCursor++] = vertexCursor + face.mIndices[1];
+			arenaIndices[indexCursor++] = vertexCursor + face.mIndices[2];
+		}
+
+		vertexCursor += mesh->mNumVertices;
+		submeshes.push_back(submesh);
+	}
+
+	processImport(arenaVertices, (int)totalVertices, arenaIndices, (int)totalIndices, remap);
+	delete[] arena;
+}
+
+// Previous import, every mesh appended to the member vectors in the order of the node tree, grouped by material like the arena import.
+void AModel::importModelAppend(const std::string& pFile)
+{
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(pFile, k_ImportFlags);
+	submeshes.clear();
+	if (scene && scene->mRootNode)
+	{
+		std::vector<const aiMesh*> meshes;
+		processNode(scene->mRootNode, scene, meshes);
+		std::stable_sort(meshes.begin(), meshes.end(), [](const aiMesh* a, const aiMesh* b)
+		{
+			return a->mMaterialIndex < b->mMaterialIndex;
+		});
+		for (const aiMesh* mesh : meshes)
+		{
+			processMesh(mesh, scene);
+		}
+	}
+	if (indices.empty())
+	{
+		return;
+	}
+
+	std::vector<unsigned long> remap(vertices.size());
+	processImport(vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size(), remap.data());
+	std::vector<VertexType>().swap(vertices);
+	std::vector<unsigned long>().swap(indices);
+}
+
+// Welds, optimises, packs and uploads the imported geometry, then bakes it. The arrays are reused in place.
+void AModel::processImport(VertexType* importVertices, int importVertexCount, unsigned long* importIndices, int importIndexCount, unsigned long* remap)
+{
+	// Weld identical vertices across all sub meshes (replaces aiProcess_JoinIdenticalVertices, which works per mesh).
+	weldStats.sourceVertexCount = importVertexCount;
+	int weldedCount = MeshUtils::weldVertices(importVertices, importVertexCount, sizeof(VertexType), importVertices, remap);
+	for (int i = 0; i < importIndexCount; i++)
+	{
+		importIndices[i] = remap[importIndices[i]];
+	}
+
+	// Reorder triangles for the vertex cache and overdraw within each sub mesh, so their index ranges stay intact,
+	// then reorder the shared vertices for fetch locality.
+	optimiseStats.before = MeshUtils::simulateVertexCache(importIndices, importIndexCount, weldedCount);
+	for (auto& submesh : submeshes)
+	{
+		unsigned long* submeshIndices = importIndices + submesh.startIndex;
+		MeshUtils::optimiseVertexCache(submeshIndices, submesh.indexCount, weldedCount);
+		MeshUtils::optimiseOverdraw(submeshIndices, submesh.indexCount, importVertices, weldedCount, sizeof(VertexType));
+	}
+	weldedCount = MeshUtils::optimiseVertexFetch(importVertices, weldedCount, sizeof(VertexType), importIndices, importIndexCount);
+
+	// Meshlets for cluster culling, built per sub mesh so none crosses a range.
+	meshlets.clear();
+	for (auto& submesh : submeshes)
+	{
+		Meshlets::buildMeshlets(importVertices, weldedCount, sizeof(VertexType), importIndices, submesh.startIndex, submesh.indexCount, meshlets);
+	}
+	optimiseStats.after = MeshUtils::simulateVertexCache(importIndices, importIndexCount, weldedCount);
+
+	materialSlotCount = 0;
+	for (auto& submesh : submeshes)
+	{
+		materialSlotCount = (int)submesh.materialSlot + 1 > materialSlotCount ? (int)submesh.materialSlot + 1 : materialSlotCount;
+	}
+
+	// Pack the indices to 16 bit in place when the welded vertex count allows it, each short lands at or before its source.
+	int indexSize = sizeof(unsigned long);
+	if (MeshUtils::fitsShortIndices(weldedCount))
+	{
+		indexSize = sizeof(unsigned short);
+		unsigned char* packed = reinterpret_cast<unsigned char*>(importIndices);
+		for (int i = 0; i < importIndexCount; i++)
+		{
+			unsigned short index = (unsigned short)importIndices[i];
+			memcpy(packed + i * sizeof(unsigned short), &index, sizeof(unsigned short));
+		}
+	}
+
+	createVertexBuffer(device, importVertices, weldedCount, sizeof(VertexType));
+	createIndexBuffer(device, importIndices, importIndexCount, indexSize == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT);
+
+	weldStats.weldedVertexCount = vertexCount;
+	weldStats.indexCount = indexCount;
+	weldStats.vertexStride = sizeof(VertexType);
+	weldStats.shortIndices = indexFormat == DXGI_FORMAT_R16_UINT;
+
+	// Bake the result for the next load.
+	MeshCache::MeshData mesh;
+	mesh.vertices = importVertices;
+	mesh.indices = importIndices;
+	mesh.submeshes = submeshes.data();
+	mesh.meshlets = meshlets.data();
+	mesh.vertexCount = vertexCount;
+	mesh.vertexStride = sizeof(VertexType);
+	mesh.indexCount = indexCount;
+	mesh.indexSize = indexSize;
+	mesh.submeshCount = (int)submeshes.size();
+	mesh.meshletCount = (int)meshlets.size();
+	mesh.sourceVertexCount = weldStats.sourceVertexCount;
+	mesh.optimiseStats = optimiseStats;
+	MeshCache::save(cacheFile.c_str(), sourceHash, mesh);
+}
+
+// Map the baked cache file, the streams go to the GPU straight from the mapped view.
+bool AModel::loadCache(ID3D11Device* device)
+{
+	MappedFile file;
+	MeshCache::MeshData mesh;
+	if (!MeshCache::load(cacheFile.c_str(), sourceHash, file, mesh) || mesh.vertexStride != sizeof(VertexType))
 	{
-		DoTheErrorLogging(importer.GetErrorString());
 		return false;
-	}*/
-	// Now we can access the file's contents.
-	//modelProcessing(scene);#
+	}
 
-	if (scene)
+	createVertexBuffer(device, mesh.vertices, mesh.vertexCount, mesh.vertexStride);
+	createIndexBuffer(device, mesh.indices, mesh.indexCount, mesh.indexSize == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT);
+	submeshes.assign(mesh.submeshes, mesh.submeshes + mesh.submeshCount);
+	materialSlotCount = 0;
+	for (auto& submesh : submeshes)
+	{
+		materialSlotCount = (int)submesh.materialSlot + 1 > materialSlotCount ? (int)submesh.materialSlot + 1 : materialSlotCount;
+	}
+	meshlets.clear();
+	for (int i = 0; i < mesh.meshletCount; i++)
 	{
-		processNode(scene->mRootNode, scene);
+		if ((size_t)mesh.meshlets[i].indexStart + (size_t)mesh.meshlets[i].triangleCount * 3 <= (size_t)mesh.indexCount)
+		{
+			meshlets.push_back(mesh.meshlets[i]);
+		}
 	}
 
-	// Set up the description of the static vertex buffer.
-	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData, indexData;
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexType)* (int)vertices.size();
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices.data();
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-	// Now create the vertex buffer.
-	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
-
-	// Set up the description of the static index buffer.
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long)* (int)indices.size();
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices.data();
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-	// Create the index buffer.
-	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
-
-	// Release the arrays now that the vertex and index buffers have been created and loaded.
-	//delete vertices;
-	//vertices = 0;
-
-	//delete indices;
-	//indices = 0;
-	vertexCount = (int)vertices.size();
-	indexCount = (int)indices.size();
-
-	//vertices.clear();
-	//indices.clear();
+	weldStats.sourceVertexCount = mesh.sourceVertexCount;
+	optimiseStats = mesh.optimiseStats;
+	weldStats.weldedVertexCount = vertexCount;
+	weldStats.indexCount = indexCount;
+	weldStats.vertexStride = sizeof(VertexType);
+	weldStats.shortIndices = indexFormat == DXGI_FORMAT_R16_UINT;
+	return true;
 }
 
 void AModel::modelProcessing(const aiScene* scene)
@@ -189,22 +416,37 @@ void AModel::processScene(const aiScene* scene)
 {
 
 }
-void AModel::processNode(const aiNode* node, const aiScene* scene)
+void AModel::processNode(const aiNode* node, const aiScene* scene, std::vector<const aiMesh*>& meshes)
 {
 	for (UINT i = 0; i < node->mNumMeshes; i++)
 	{
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		//meshes.push_back(this->processMesh(mesh, scene));
-		processMesh(mesh, scene);
+		meshes.push_back(mesh);
 	}
 
 	for (UINT i = 0; i < node->mNumChildren; i++)
 	{
-		this->processNode(node->mChildren[i], scene);
+		this->processNode(node->mChildren[i], scene, meshes);
 	}
 }
 void AModel::processMesh(const aiMesh* mesh, const aiScene* scene)
 {
+	// Points and lines are split off by aiProcess_SortByPType, only triangles are imported and a mesh without any is skipped.
+	bool hasTriangles = false;
+	for (UINT i = 0; i < mesh->mNumFaces && !hasTriangles; i++)
+	{
+		hasTriangles = mesh->mFaces[i].mNumIndices == 3;
+	}
+	if (!hasTriangles)
+	{
+		return;
+	}
+
+	// Face indices are local to the mesh, offset them past the vertices of earlier meshes.
+	unsigned long baseVertex = (unsigned long)vertices.size();
+	MeshCache::Submesh submesh = {};
+	submesh.startIndex = (unsigned int)indices.size();
+
 	/*for (UINT i = 0; i < mesh->mNumVertices; i++)
 	{
 		VERTEX vertex;
@@ -234,9 +476,10 @@ void AModel::processMesh(const aiMesh* mesh, const aiScene* scene)
 
 	for (UINT i = 0; i < mesh->mNumVertices; i++)
 	{
+		// Missing attributes are zeroed so they weld consistently.
 		XMFLOAT3 vert;
-		XMFLOAT2 text;
-		XMFLOAT3 norm;
+		XMFLOAT2 text(0.f, 0.f);
+		XMFLOAT3 norm(0.f, 0.f, 0.f);
 
 		vert.x = mesh->mVertices[i].x;
 		vert.y = mesh->mVertices[i].y;
@@ -264,11 +507,28 @@ void AModel::processMesh(const aiMesh* mesh, const aiScene* scene)
 
 	for (UINT i = 0; i < mesh->mNumFaces; i++)
 	{
-		aiFace face = mesh->mFaces[i];
+		const aiFace& face = mesh->mFaces[i];
+		if (face.mNumIndices != 3)
+		{
+			continue;
+		}
 
 		for (UINT j = 0; j < face.mNumIndices; j++)
-			indices.push_back(face.mIndices[j]);
+			indices.push_back(baseVertex + face.mIndices[j]);
+	}
+
+	submesh.indexCount = (unsigned int)indices.size() - submesh.startIndex;
+	submesh.materialSlot = mesh->mMaterialIndex;
+	XMVECTOR low = vertices.size() > baseVertex ? XMLoadFloat3(&vertices[baseVertex].position) : XMVectorZero();
+	XMVECTOR high = low;
+	for (size_t i = baseVertex; i < vertices.size(); i++)
+	{
+		low = XMVectorMin(low, XMLoadFloat3(&vertices[i].position));
+		high = XMVectorMax(high, XMLoadFloat3(&vertices[i].position));
 	}
+	XMStoreFloat3(&submesh.boundsMin, low);
+	XMStoreFloat3(&submesh.boundsMax, high);
+	submeshes.push_back(submesh);
 }
 
 //vector<Texture> ModelLoader::loadMaterialTextures(aiMaterial * mat, aiTextureType type, string typeName, const aiScene * scene)
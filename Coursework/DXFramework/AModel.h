@@ -4,6 +4,10 @@
 * \brief Improved model loader, using the assimp library
 *
 * Inherits from Base Mesh, read a provided file and builds a mesh from the file data.
+* The imported mesh is baked into a cache file next to the source and memory mapped on later loads, until the source or the import flags change.
+* Every sub mesh is split into meshlets for CPU cluster culling, baked with the mesh.
+* The import sizes the whole scene in one pre-pass and fills a single arena, sub meshes sorted by material so every material slot is one
+* contiguous range of the index buffer: one vertex buffer bind and a ranged draw per material.
 *
 * \author Paul Robertson
 */
@@ -11,6 +15,8 @@
 #pragma once
 
 #include "BaseMesh.h"
+#include "MeshUtils.h"
+#include "MeshCache.h"
 #include "assimp\Importer.hpp"      // C++ importer interface
 #include "assimp\scene.h"           // Output data structure
 #include "assimp\postprocess.h"     // Post processing flags
@@ -26,19 +32,43 @@ public:
 	* Loads a sub-set of model. Tested with single mesh FBX and OBJ. Currently does not auto load textures. 
 	* @param device is the renderer device
 	* @param file path to model file
+	* @param arenaImport fills one pre-sized arena, false appends mesh by mesh into vectors as before (kept for comparison)
 	*/
-	AModel(ID3D11Device* device, const std::string& file);
+	AModel(ID3D11Device* device, const std::string& file, bool arenaImport = true);
 	~AModel();
 
+	/// Vertex and memory numbers before and after welding, for reporting.
+	const MeshUtils::WeldStats& getWeldStats() const { return weldStats; }
+	/// Vertex cache numbers before and after optimisation, for reporting.
+	const MeshUtils::OptimiseStats& getOptimiseStats() const { return optimiseStats; }
+	bool isFromCache() const { return fromCache; }		///< True if the mesh was mapped from its baked cache file
+
+	int getMeshletCount() override { return (int)meshlets.size(); }
+	const Meshlets::Meshlet* getMeshlets() override { return meshlets.data(); }
+	int getSubmeshCount() override { return (int)submeshes.size(); }		///< One per imported mesh
+	const MeshCache::Submesh* getSubmeshes() override { return submeshes.data(); }
+	int getMaterialSlotCount() const { return materialSlotCount; }			///< Materials of the source scene, slots index them
+
 protected:
 	void initBuffers(ID3D11Device* device);
 	void importModel(const std::string& pFile);
+	void importModelAppend(const std::string& pFile);
+	void processImport(VertexType* importVertices, int importVertexCount, unsigned long* importIndices, int importIndexCount, unsigned long* remap);
+	bool loadCache(ID3D11Device* device);
 	void modelProcessing(const aiScene* scene);
 
 	void processScene(const aiScene* scene);
-	void processNode(const aiNode* node, const aiScene* scene);
+	void processNode(const aiNode* node, const aiScene* scene, std::vector<const aiMesh*>& meshes);
 	void processMesh(const aiMesh* mesh, const aiScene* scene);
 	ID3D11Device* device;
 	std::vector<VertexType> vertices;
 	std::vector<unsigned long> indices;
+	std::vector<MeshCache::Submesh> submeshes;
+	int materialSlotCount;
+	std::vector<Meshlets::Meshlet> meshlets;
+	MeshUtils::WeldStats weldStats;
+	MeshUtils::OptimiseStats optimiseStats;
+	std::string cacheFile;
+	unsigned long long sourceHash;
+	bool fromCache;
 };
\ No newline at end of file
@@ -2,6 +2,103 @@
 // Base mesh class, for inheriting base mesh functionality.
 
 #include "basemesh.h"
+#include "threadpool.h"
+#include "meshutils.h"
+#include <xmmintrin.h>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Vertices per job at least, smaller meshes are not worth the thread start up.
+	const size_t k_MinVerticesPerJob = 16384;
+
+	// Corner of texture coordinate (0, 0), the directions of increasing u and v and the normal of one cube face.
+	struct CubeFace
+	{
+		XMFLOAT3 origin;
+		XMFLOAT3 uAxis;
+		XMFLOAT3 vAxis;
+		XMFLOAT3 normal;
+	};
+
+	// Maps a point of the [-1, 1] cube onto the unit sphere, spreading the vertices more evenly than normalising would.
+	inline float toSphere(float a, float b, float c)
+	{
+		return a * sqrtf(1.0f - (b*b / 2.0f) - (c*c / 2.0f) + (b*b*c*c / 3.0f));
+	}
+
+	inline __m128 toSphere(__m128 a, __m128 b, __m128 c)
+	{
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 two = _mm_set1_ps(2.f);
+		const __m128 three = _mm_set1_ps(3.f);
+		__m128 bb = _mm_mul_ps(b, b);
+		__m128 cc = _mm_mul_ps(c, c);
+		__m128 bbcc = _mm_mul_ps(_mm_mul_ps(bb, c), c);
+		__m128 scale = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(one, _mm_div_ps(bb, two)), _mm_div_ps(cc, two)), _mm_div_ps(bbcc, three));
+		return _mm_mul_ps(a, _mm_sqrt_ps(scale));
+	}
+
+	// One row of a face. Positions come from the grid coordinates so the edges of neighbouring faces match exactly,
+	// four vertices at a time in separate x, y and z registers. Computed in the same order as one at a time, so both give the same bits.
+	void buildFaceRow(VertexPacking::Vertex* row, const CubeFace& face, int y, int side, float increment, bool sphere)
+	{
+		float vScale = y * 2.f * increment;
+		float rowX = face.vAxis.x * vScale;
+		float rowY = face.vAxis.y * vScale;
+		float rowZ = face.vAxis.z * vScale;
+		float v = y * increment;
+
+		auto store = [&](int x, float px, float py, float pz)
+		{
+			row[x].position = XMFLOAT3(px, py, pz);
+			row[x].texture = XMFLOAT2(x * increment, v);
+			row[x].normal = sphere ? row[x].position : face.normal;
+		};
+
+		int x = 0;
+		const __m128 steps = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+		const __m128 increments = _mm_set1_ps(increment);
+		for (; x + 4 <= side; x += 4)
+		{
+			__m128 uScale = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)x), steps), _mm_set1_ps(2.f)), increments);
+			__m128 px = _mm_add_ps(_mm_set1_ps(face.origin.x), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(face.uAxis.x), uScale), _mm_set1_ps(rowX)));
+			__m128 py = _mm_add_ps(_mm_set1_ps(face.origin.y), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(face.uAxis.y), uScale), _mm_set1_ps(rowY)));
+			__m128 pz = _mm_add_ps(_mm_set1_ps(face.origin.z), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(face.uAxis.z), uScale), _mm_set1_ps(rowZ)));
+			if (sphere)
+			{
+				__m128 sx = toSphere(px, py, pz);
+				__m128 sy = toSphere(py, pz, px);
+				__m128 sz = toSphere(pz, px, py);
+				px = sx;
+				py = sy;
+				pz = sz;
+			}
+
+			alignas(16) float xs[4], ys[4], zs[4];
+			_mm_store_ps(xs, px);
+			_mm_store_ps(ys, py);
+			_mm_store_ps(zs, pz);
+			for (int i = 0; i < 4; i++)
+				store(x + i, xs[i], ys[i], zs[i]);
+		}
+
+		for (; x < side; x++)
+		{
+			float uScale = x * 2.f * increment;
+			float px = face.origin.x + (face.uAxis.x * uScale + rowX);
+			float py = face.origin.y + (face.uAxis.y * uScale + rowY);
+			float pz = face.origin.z + (face.uAxis.z * uScale + rowZ);
+			if (sphere)
+				store(x, toSphere(px, py, pz), toSphere(py, pz, px), toSphere(pz, px, py));
+			else
+				store(x, px, py, pz);
+		}
+	}
+}
 
 BaseMesh::BaseMesh()
 {
@@ -9,7 +106,12 @@ BaseMesh::BaseMesh()
 	indexBuffer = nullptr;
 	vertexCount = 0;
 	indexCount = 0;
-
+	vertexStride = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	packedVertices = false;
+	lodCount = 0;
+	boundingCentre = XMFLOAT3(0.f, 0.f, 0.f);
+	boundingRadius = 0.f;
 }
 
 // Release base objects (index, vertex buffers and texture object.
@@ -33,6 +135,215 @@ int BaseMesh::getIndexCount()
 	return indexCount;
 }
 
+DXGI_FORMAT BaseMesh::getIndexFormat()
+{
+	return indexFormat;
+}
+
+int BaseMesh::getVertexCount()
+{
+	return vertexCount;
+}
+
+bool BaseMesh::isPacked()
+{
+	return packedVertices;
+}
+
+size_t BaseMesh::getBufferBytes()
+{
+	size_t indexSize = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+	return (size_t)vertexCount * vertexStride + (size_t)indexCount * indexSize;
+}
+
+const VertexPacking::Quantisation& BaseMesh::getQuantisation()
+{
+	return quantisation;
+}
+
+VertexPacking::ErrorBounds BaseMesh::getPackingError()
+{
+	return packingError;
+}
+
+int BaseMesh::getLodCount()
+{
+	return lodCount > 0 ? lodCount : 1;
+}
+
+BaseMesh::LevelOfDetail BaseMesh::getLod(int lod)
+{
+	if (lodCount == 0)
+	{
+		LevelOfDetail full = { 0, indexCount, 0.f };
+		return full;
+	}
+	return lods[lod];
+}
+
+XMFLOAT3 BaseMesh::getBoundingCentre()
+{
+	return boundingCentre;
+}
+
+float BaseMesh::getBoundingRadius()
+{
+	return boundingRadius;
+}
+
+// The projected error of a level is its share of the bounding diameter times the projected size.
+int BaseMesh::selectLod(float screenSize, float screenError)
+{
+	int selected = 0;
+	for (int i = 1; i < lodCount; i++)
+	{
+		if (screenSize <= getLodScreenSize(i, screenError))
+		{
+			selected = i;
+		}
+	}
+	return selected;
+}
+
+float BaseMesh::getLodScreenSize(int lod, float screenError)
+{
+	if (lod >= lodCount || lods[lod].error <= 0.f)
+	{
+		return FLT_MAX;
+	}
+	return screenError * 2.f * boundingRadius / lods[lod].error;
+}
+
+// Creates a static vertex buffer and sets the vertex count.
+void BaseMesh::createVertexBuffer(ID3D11Device* device, const void* vertices, int count, int stride)
+{
+	D3D11_BUFFER_DESC vertexBufferDesc;
+	D3D11_SUBRESOURCE_DATA vertexData;
+
+	vertexCount = count;
+	vertexStride = stride;
+
+	// Set up the description of the static vertex buffer.
+	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	vertexBufferDesc.ByteWidth = stride * count;
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDesc.CPUAccessFlags = 0;
+	vertexBufferDesc.MiscFlags = 0;
+	vertexBufferDesc.StructureByteStride = 0;
+	// Give the subresource structure a pointer to the vertex data.
+	vertexData.pSysMem = vertices;
+	vertexData.SysMemPitch = 0;
+	vertexData.SysMemSlicePitch = 0;
+	// Now create the vertex buffer.
+	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
+}
+
+// Quantises the vertices to the bounds of the mesh and creates a static vertex buffer of half the size.
+void BaseMesh::createPackedVertexBuffer(ID3D11Device* device, const VertexType* vertices, int count)
+{
+	const VertexPacking::Vertex* source = reinterpret_cast<const VertexPacking::Vertex*>(vertices);
+	std::vector<VertexType_Packed> packed(count);
+
+	quantisation = VertexPacking::computeQuantisation(source, count);
+	VertexPacking::packVertices(source, count, quantisation, packed.data());
+	packingError = VertexPacking::measureError(source, packed.data(), count, quantisation);
+	packedVertices = true;
+
+	createVertexBuffer(device, packed.data(), count, sizeof(VertexType_Packed));
+}
+
+// Creates a static index buffer. Meshes with fewer than 65535 vertices get 16 bit indices, halving the buffer size.
+void BaseMesh::createIndexBuffer(ID3D11Device* device, const unsigned long* indices, int count)
+{
+	std::vector<unsigned char> packed;
+	int indexSize = MeshUtils::packIndices(indices, count, vertexCount, packed);
+	createIndexBuffer(device, packed.data(), count, indexSize == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT);
+}
+
+// Creates a static index buffer from indices already in their final format.
+void BaseMesh::createIndexBuffer(ID3D11Device* device, const void* indices, int count, DXGI_FORMAT format)
+{
+	D3D11_BUFFER_DESC indexBufferDesc;
+	D3D11_SUBRESOURCE_DATA indexData;
+
+	indexCount = count;
+	indexFormat = format;
+
+	// Set up the description of the static index buffer.
+	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	indexBufferDesc.ByteWidth = (format == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned long))* indexCount;
+	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDesc.CPUAccessFlags = 0;
+	indexBufferDesc.MiscFlags = 0;
+	indexBufferDesc.StructureByteStride = 0;
+	// Give the subresource structure a pointer to the index data.
+	indexData.pSysMem = indices;
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+	// Create the index buffer.
+	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
+}
+
+void BaseMesh::setLods(const LevelOfDetail* levels, int count)
+{
+	lodCount = count < k_MaxLods ? count : k_MaxLods;
+	for (int i = 0; i < lodCount; i++)
+	{
+		lods[i] = levels[i];
+	}
+}
+
+// Faces keep their own vertices along the edges, their normals and texture coordinates differ there.
+// Faces are split into bands of rows, the index lists per face. Every job writes its own vertices and index lists, so no locking is needed.
+int BaseMesh::buildCubeFaces(VertexPacking::Vertex* vertices, unsigned long* indices, int resolution, CubeFaceShape shape, unsigned int maxThreads)
+{
+	// Corner of texture coordinate (0, 0), then the directions of increasing u and v, per face.
+	static const XMFLOAT3 faces[6][3] =
+	{
+		{ XMFLOAT3(-1.f, 1.f, -1.f), XMFLOAT3(1.f, 0.f, 0.f), XMFLOAT3(0.f, -1.f, 0.f) },	// front
+		{ XMFLOAT3(1.f, 1.f, 1.f), XMFLOAT3(-1.f, 0.f, 0.f), XMFLOAT3(0.f, -1.f, 0.f) },	// back
+		{ XMFLOAT3(1.f, 1.f, -1.f), XMFLOAT3(0.f, 0.f, 1.f), XMFLOAT3(0.f, -1.f, 0.f) },	// right
+		{ XMFLOAT3(-1.f, 1.f, 1.f), XMFLOAT3(0.f, 0.f, -1.f), XMFLOAT3(0.f, -1.f, 0.f) },	// left
+		{ XMFLOAT3(-1.f, 1.f, 1.f), XMFLOAT3(1.f, 0.f, 0.f), XMFLOAT3(0.f, 0.f, -1.f) },	// top
+		{ XMFLOAT3(-1.f, -1.f, -1.f), XMFLOAT3(1.f, 0.f, 0.f), XMFLOAT3(0.f, 0.f, 1.f) },	// bottom
+	};
+
+	CubeFace cubeFaces[6];
+	for (int face = 0; face < 6; face++)
+	{
+		cubeFaces[face].origin = faces[face][0];
+		cubeFaces[face].uAxis = faces[face][1];
+		cubeFaces[face].vAxis = faces[face][2];
+		XMStoreFloat3(&cubeFaces[face].normal, XMVector3Cross(XMLoadFloat3(&faces[face][1]), XMLoadFloat3(&faces[face][2])));
+	}
+
+	const int side = resolution + 1;
+	const int rows = 6 * side;
+	const int facePitch = resolution * resolution * 6;
+	const float increment = 1.0f / resolution;
+
+	size_t jobCount = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+	size_t maxJobs = ((size_t)rows * side + k_MinVerticesPerJob - 1) / k_MinVerticesPerJob;
+	jobCount = jobCount < 1 ? 1 : jobCount > maxJobs ? maxJobs : jobCount;
+	int rowsPerJob = (int)((rows + jobCount - 1) / jobCount);
+
+	ThreadPool::shared().runParallel(jobCount, [&](size_t job)
+	{
+		for (size_t face = job; face < 6; face += jobCount)
+		{
+			MeshUtils::buildGridIndices(indices + face * facePitch, resolution, resolution, (unsigned long)(face * side * side), false);
+		}
+
+		int firstRow = (int)job * rowsPerJob;
+		int lastRow = firstRow + rowsPerJob < rows ? firstRow + rowsPerJob : rows;
+		for (int row = firstRow; row < lastRow; row++)
+		{
+			buildFaceRow(vertices + (size_t)row * side, cubeFaces[row / side], row % side, side, increment, shape == CubeFaceShape::Sphere);
+		}
+	});
+	return 6 * facePitch;
+}
+
 // Sends geometry data to the GPU. Default primitive topology is TriangleList.
 // To render alternative topologies this function needs to be overwritten.
 void BaseMesh::sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLOGY top)
@@ -40,12 +351,12 @@ void BaseMesh::sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLO
 	unsigned int stride;
 	unsigned int offset;
 	
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType);
+	// Set vertex buffer stride and offset, the stride the vertex buffer was created with.
+	stride = vertexStride;
 	offset = 0;
 
 	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 	deviceContext->IASetPrimitiveTopology(top);
 }
 
@@ -14,6 +14,11 @@
 
 #include <d3d11.h>
 #include <directxmath.h>
+#include "VertexPacking.h"
+#include "Meshlets.h"
+
+// MeshCache::Submesh, see MeshCache.h.
+struct MeshSubmesh;
 
 using namespace DirectX;
 
@@ -43,22 +48,93 @@ protected:
 		XMFLOAT2 texture;
 	};
 
+	/// Quantised 16 byte version of VertexType, see VertexPacking. Drawn with the packed vertex shaders.
+	typedef VertexPacking::PackedVertex VertexType_Packed;
+
 public:
 	/// Empty constructor
 	BaseMesh();
-	~BaseMesh();
+	/// Virtual so meshes handed out as BaseMesh, see GeometryRegistry, release their own data too.
+	virtual ~BaseMesh();
 
 	/// Transfers mesh data to the GPU.
 	virtual void sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLOGY top = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	int getIndexCount();			///< Returns total index value of the mesh
+	DXGI_FORMAT getIndexFormat();	///< Returns the index buffer format, 16 or 32 bit
+	int getVertexCount();			///< Returns the number of vertices in the vertex buffer
+	bool isPacked();				///< Whether the vertex buffer holds VertexType_Packed vertices
+	size_t getBufferBytes();		///< Size of the vertex and index buffers
+	const VertexPacking::Quantisation& getQuantisation();	///< Dequantisation of the packed positions, sent to the packed vertex shaders
+	VertexPacking::ErrorBounds getPackingError();		///< Largest error packing introduced into the mesh
+
+	static const int k_MaxLods = 8;
+
+	/// Range of the index buffer drawn for one level of detail.
+	struct LevelOfDetail
+	{
+		int indexStart;
+		int indexCount;
+		float error;		///< simplification error, object space distance to the full detail surface
+	};
+
+	int getLodCount();					///< Levels of detail in the index buffer, 1 for meshes without a chain
+	LevelOfDetail getLod(int lod);		///< Level 0 is the full detail mesh
+	XMFLOAT3 getBoundingCentre();		///< Bounding sphere of the levels of detail, object space
+	float getBoundingRadius();
+	/** \brief Coarsest level of detail whose error stays below screenError
+	* @param screenSize is the projected bounding sphere diameter as a fraction of the screen height
+	* @param screenError is the allowed error as a fraction of the screen height
+	*/
+	int selectLod(float screenSize, float screenError);
+	/// Largest projected size (as in selectLod) at which the level is still selected.
+	float getLodScreenSize(int lod, float screenError);
+	/// Clusters of the full detail level for CPU culling, see Meshlets. None by default, models provide them.
+	virtual int getMeshletCount() { return 0; }
+	virtual const Meshlets::Meshlet* getMeshlets() { return nullptr; }
+	/// Ranges of the full detail level with their material slots, none for meshes drawn with one material.
+	virtual int getSubmeshCount() { return 0; }
+	virtual const MeshSubmesh* getSubmeshes() { return nullptr; }
+
+	/// Shape buildCubeFaces bends the faces into.
+	enum class CubeFaceShape
+	{
+		Cube,
+		Sphere,		///< every vertex mapped onto the unit sphere, the normal is the position
+	};
+
+	/** \brief Six grids of resolution x resolution quads on the faces of the [-1, 1] cube, corners shared within each face
+	* Fills 6 * (resolution + 1)^2 vertices, split and wound as the cube and sphere always were. Returns the index count.
+	* Bands of rows are generated in parallel, four vertices at a time, each job writing its own part of the arrays.
+	* @param maxThreads limits the worker count, 0 uses all hardware threads
+	*/
+	static int buildCubeFaces(VertexPacking::Vertex* vertices, unsigned long* indices, int resolution, CubeFaceShape shape, unsigned int maxThreads = 0);
 	//D3D11_INPUT_ELEMENT_DESC getInputLayout();
 
 protected:
 	virtual void initBuffers(ID3D11Device*) = 0;
+	/// Creates the vertex buffer and sets the vertex count.
+	void createVertexBuffer(ID3D11Device* device, const void* vertices, int count, int stride);
+	/// Packs the vertices into VertexType_Packed, creates the vertex buffer from them and sets the vertex count.
+	void createPackedVertexBuffer(ID3D11Device* device, const VertexType* vertices, int count);
+	/// Creates the index buffer and sets the index count. Uses 16 bit indices when vertexCount allows it.
+	void createIndexBuffer(ID3D11Device* device, const unsigned long* indices, int count);
+	/// Creates the index buffer from indices already packed in format (R16_UINT or R32_UINT).
+	void createIndexBuffer(ID3D11Device* device, const void* indices, int count, DXGI_FORMAT format);
+	/// Copies the level of detail chain, ranges of the index buffer starting with the full detail mesh. Levels past k_MaxLods are dropped.
+	void setLods(const LevelOfDetail* levels, int count);
 
 	ID3D11Buffer *vertexBuffer, *indexBuffer;
 	//D3D11_INPUT_ELEMENT_DESC *inputLayout;
 	int vertexCount, indexCount;
+	int vertexStride;
+	DXGI_FORMAT indexFormat;
+	bool packedVertices;
+	VertexPacking::Quantisation quantisation;
+	VertexPacking::ErrorBounds packingError;
+	LevelOfDetail lods[k_MaxLods];
+	int lodCount;		///< 0 for meshes without a level of detail chain
+	XMFLOAT3 boundingCentre;
+	float boundingRadius;
 };
 
 #endif
\ No newline at end of file
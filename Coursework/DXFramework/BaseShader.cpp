@@ -2,12 +2,17 @@
 // Base class for shader object. Handles loading in shader files (vertex, pixel, domain, hull and geometry).
 // Handle render/sending to GPU for processing.
 #include "baseshader.h"
+#include "basemesh.h"
 
 // Store pointer to render device and handle to window.
 BaseShader::BaseShader(ID3D11Device* device, HWND lhwnd)
 {
 	renderer = device;
 	hwnd = hwnd;
+	packedVertexShader = nullptr;
+	packedLayout = nullptr;
+	quantisationBuffer = nullptr;
+	usePackedVertices = false;
 }
 
 // Release resources (if used).
@@ -48,6 +53,30 @@ BaseShader::~BaseShader()
 		computeShader->Release();
 		computeShader = 0;
 	}
+
+	releasePackedVertexShader();
+
+	if (quantisationBuffer)
+	{
+		quantisationBuffer->Release();
+		quantisationBuffer = 0;
+	}
+}
+
+// Release the packed variant, it belongs to the vertex shader that is being replaced.
+void BaseShader::releasePackedVertexShader()
+{
+	if (packedVertexShader)
+	{
+		packedVertexShader->Release();
+		packedVertexShader = 0;
+	}
+
+	if (packedLayout)
+	{
+		packedLayout->Release();
+		packedLayout = 0;
+	}
 }
 
 // Given pre-compiled file, load and create vertex shader.
@@ -59,6 +88,8 @@ void BaseShader::loadVertexShader(const wchar_t* filename)
 	
 	vertexShaderBuffer = 0;
 
+	releasePackedVertexShader();
+
 	// check file extension for correct loading function.
 	std::wstring fn(filename);
 	std::string::size_type idx;
@@ -115,6 +146,86 @@ void BaseShader::loadVertexShader(const wchar_t* filename)
 }
 
 
+// Given pre-compiled file, load and create the vertex shader variant for VertexType_Packed geometry.
+// Positions arrive as unorm relative to the mesh bounds, the shader dequantises them with the buffer set by setVertexFormat.
+void BaseShader::loadPackedVertexShader(const wchar_t* filename)
+{
+	ID3DBlob* vertexShaderBuffer;
+
+	unsigned int numElements;
+
+	vertexShaderBuffer = 0;
+
+	releasePackedVertexShader();
+
+	// check file extension for correct loading function.
+	std::wstring fn(filename);
+	std::string::size_type idx;
+	std::wstring extension;
+
+	idx = fn.rfind('.');
+
+	if (idx != std::string::npos)
+	{
+		extension = fn.substr(idx + 1);
+	}
+	else
+	{
+		// No extension found
+		MessageBox(hwnd, L"Error finding vertex shader file", L"ERROR", MB_OK);
+		exit(0);
+	}
+
+	// Load the texture in.
+	if (extension != L"cso")
+	{
+		MessageBox(hwnd, L"Incorrect vertex shader file type", L"ERROR", MB_OK);
+		exit(0);
+	}
+
+	// Reads compiled shader into buffer (bytecode).
+	HRESULT result = D3DReadFileToBlob(filename, &vertexShaderBuffer);
+	if (result != S_OK)
+	{
+		MessageBox(NULL, filename, L"File ERROR", MB_OK);
+		exit(0);
+	}
+
+	// Create the vertex shader from the buffer.
+	renderer->CreateVertexShader(vertexShaderBuffer->GetBufferPointer(), vertexShaderBuffer->GetBufferSize(), NULL, &packedVertexShader);
+
+	// Create the vertex input layout description.
+	// This setup needs to match the VertexPacking::PackedVertex stucture and the PACKED_VERTEX inputs in the shader.
+	D3D11_INPUT_ELEMENT_DESC polygonLayout[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+	};
+
+	// Get a count of the elements in the layout.
+	numElements = sizeof(polygonLayout) / sizeof(polygonLayout[0]);
+
+	// Create the vertex input layout.
+	renderer->CreateInputLayout(polygonLayout, numElements, vertexShaderBuffer->GetBufferPointer(), vertexShaderBuffer->GetBufferSize(), &packedLayout);
+
+	// Release the vertex shader buffer since it is no longer needed.
+	vertexShaderBuffer->Release();
+	vertexShaderBuffer = 0;
+
+	// Dequantisation buffer, shared by every packed mesh drawn with this shader.
+	if (!quantisationBuffer)
+	{
+		D3D11_BUFFER_DESC quantisationBufferDesc;
+		quantisationBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		quantisationBufferDesc.ByteWidth = sizeof(VertexPacking::Quantisation);
+		quantisationBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		quantisationBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		quantisationBufferDesc.MiscFlags = 0;
+		quantisationBufferDesc.StructureByteStride = 0;
+		renderer->CreateBuffer(&quantisationBufferDesc, NULL, &quantisationBuffer);
+	}
+}
+
 void BaseShader::loadTextureVertexShader(const wchar_t* filename)
 {
 	ID3DBlob* vertexShaderBuffer;
@@ -462,13 +573,55 @@ void BaseShader::loadComputeShader(const wchar_t* filename)
 }
 
 // De/Activate shader stages and send shaders to GPU.
-void BaseShader::render(ID3D11DeviceContext* deviceContext, int indexCount)
+// Select the packed or the full vertex shader for the next draw, packed meshes also need their dequantisation.
+void BaseShader::setVertexFormat(ID3D11DeviceContext* deviceContext, BaseMesh* mesh)
 {
-	// Set the vertex input layout.
-	deviceContext->IASetInputLayout(layout);
+	usePackedVertices = mesh->isPacked();
+	if (!usePackedVertices)
+	{
+		return;
+	}
+
+	if (!packedVertexShader)
+	{
+		MessageBox(hwnd, L"Packed mesh drawn with a shader without a packed vertex shader", L"ERROR", MB_OK);
+		exit(0);
+	}
 
-	// Set the vertex and pixel shaders that will be used to render.
-	deviceContext->VSSetShader(vertexShader, NULL, 0);
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	deviceContext->Map(quantisationBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	memcpy(mappedResource.pData, &mesh->getQuantisation(), sizeof(VertexPacking::Quantisation));
+	deviceContext->Unmap(quantisationBuffer, 0);
+	deviceContext->VSSetConstantBuffers(4, 1, &quantisationBuffer);
+}
+
+void BaseShader::render(ID3D11DeviceContext* deviceContext, int indexCount, int startIndex)
+{
+	setStages(deviceContext);
+
+	// Render the triangle.
+	deviceContext->DrawIndexed(indexCount, startIndex, 0);
+}
+
+// One draw per range, the stages are set once.
+void BaseShader::render(ID3D11DeviceContext* deviceContext, const Meshlets::IndexRange* ranges, int rangeCount)
+{
+	setStages(deviceContext);
+
+	for (int i = 0; i < rangeCount; i++)
+	{
+		deviceContext->DrawIndexed(ranges[i].indexCount, ranges[i].indexStart, 0);
+	}
+}
+
+void BaseShader::setStages(ID3D11DeviceContext* deviceContext)
+{
+	// Set the vertex input layout and the vertex shader, the format selection only lasts for this draw.
+	deviceContext->IASetInputLayout(usePackedVertices ? packedLayout : layout);
+	deviceContext->VSSetShader(usePackedVertices ? packedVertexShader : vertexShader, NULL, 0);
+	usePackedVertices = false;
+
+	// Set the pixel shader that will be used to render.
 	deviceContext->PSSetShader(pixelShader, NULL, 0);
 	deviceContext->CSSetShader(NULL, NULL, 0);
 	
@@ -493,9 +646,6 @@ void BaseShader::render(ID3D11DeviceContext* deviceContext, int indexCount)
 	{
 		deviceContext->GSSetShader(NULL, NULL, 0);
 	}
-
-	// Render the triangle.
-	deviceContext->DrawIndexed(indexCount, 0, 0);
 }
 
 // Dispatch the compute shader.
@@ -20,10 +20,12 @@
 #include <DirectXMath.h>
 #include <fstream>
 #include "imGUI/imgui.h"
+#include "Meshlets.h"
 
 using namespace std;
 using namespace DirectX;
 
+class BaseMesh;
 
 class BaseShader
 {
@@ -51,9 +53,15 @@ public:
 	~BaseShader();
 
 	/** \Brief render function
-	* Sets shader stages and draws the indexed data
+	* Sets shader stages and draws the indexed data, startIndex selects a range of the index buffer (levels of detail)
 	*/
-	virtual void render(ID3D11DeviceContext* deviceContext, int vertexCount);
+	virtual void render(ID3D11DeviceContext* deviceContext, int vertexCount, int startIndex = 0);
+	/// Sets the shader stages once and draws every range, the survivors of Meshlets::cullMeshlets.
+	void render(ID3D11DeviceContext* deviceContext, const Meshlets::IndexRange* ranges, int rangeCount);
+	/** \brief Selects the vertex shader matching the vertex format of the mesh for the next render call
+	* Packed meshes use the packed vertex shader and layout, their quantisation is sent to vertex shader register b4.
+	*/
+	void setVertexFormat(ID3D11DeviceContext* deviceContext, BaseMesh* mesh);
 	void compute(ID3D11DeviceContext* dc, int x, int y, int z);
 
 protected:
@@ -61,12 +69,17 @@ protected:
 	void loadVertexShader(const wchar_t* filename);		///< Load Vertex shader, for stand position, tex, normal geomtry
 	void loadColourVertexShader(const wchar_t* filename);		///< Load Vertex shader, pre-made for position and colour only
 	void loadTextureVertexShader(const wchar_t* filename);		///< Load Vertex shader, pre-made for position and tex only
+	void loadPackedVertexShader(const wchar_t* filename);		///< Load Vertex shader variant for packed position, tex, normal geometry. Call after loadVertexShader, which drops it
 	void loadHullShader(const wchar_t* filename);		///< Load Hull shader
 	void loadDomainShader(const wchar_t* filename);		///< Load Domain shader
 	void loadGeometryShader(const wchar_t* filename);	///< Load Geometry shader
 	void loadPixelShader(const wchar_t* filename);		///< Load Pixel shader
 	void loadComputeShader(const wchar_t* filename);	///< Load computer shader
 
+private:
+	void releasePackedVertexShader();
+	void setStages(ID3D11DeviceContext* deviceContext);	///< Binds the stages of a render call and resets the vertex format selection
+
 protected:
 	ID3D11Device* renderer;
 	HWND hwnd;
@@ -78,6 +91,10 @@ protected:
 	ID3D11GeometryShader* geometryShader;
 	ID3D11ComputeShader* computeShader;
 	ID3D11InputLayout* layout;
+	ID3D11VertexShader* packedVertexShader;
+	ID3D11InputLayout* packedLayout;
+	ID3D11Buffer* quantisationBuffer;
+	bool usePackedVertices;
 	ID3D11Buffer* matrixBuffer;
 	ID3D11SamplerState* sampleState;
 };
@@ -12,6 +12,7 @@
 #define _CUBEMESH_H_
 
 #include "BaseMesh.h"
+#include "MeshUtils.h"
 
 using namespace DirectX;
 
@@ -29,9 +30,13 @@ public:
 	CubeMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 20);
 	~CubeMesh();
 
+	/// Vertex cache numbers before and after optimisation, for reporting.
+	const MeshUtils::OptimiseStats& getOptimiseStats() const { return optimiseStats; }
+
 protected:
 	void initBuffers(ID3D11Device* device);
 	int resolution;
+	MeshUtils::OptimiseStats optimiseStats;
 };
 
 #endif
\ No newline at end of file
@@ -28,6 +28,16 @@
 #include "TessellationMesh.h"
 #include "TriangleMesh.h"
 #include "AModel.h"
+#include "TerrainGridMesh.h"
+#include "TerrainQuadtree.h"
+#include "Heightfield.h"
+#include "GeometryRegistry.h"
+#include "WaterMesh.h"
+#include "HeightGenerator.h"
+#include "HeightfieldQuery.h"
+#include "HorizonOcclusion.h"
+#include "TerrainStreamer.h"
+#include "PoissonScatter.h"
 
 // Include additional rendering headers
 #include "Light.h"
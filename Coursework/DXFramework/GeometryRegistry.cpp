@@ -0,0 +1,122 @@
+// Geometry Registry
+// Shared, reference counted meshes keyed by their generator parameters or source file.
+#include "geometryregistry.h"
+#include "meshcache.h"
+#include <cstdio>
+
+GeometryRegistry::GeometryRegistry() :
+	hits(0),
+	misses(0),
+	releasedBytesSaved(0)
+{
+}
+
+GeometryRegistry::~GeometryRegistry()
+{
+	for (auto& it : entries)
+	{
+		delete it.second.mesh;
+	}
+}
+
+BaseMesh* GeometryRegistry::acquire(const std::string& key, const std::function<BaseMesh*()>& create)
+{
+	auto found = entries.find(key);
+	if (found != entries.end())
+	{
+		found->second.references++;
+		found->second.hits++;
+		hits++;
+		return found->second.mesh;
+	}
+
+	BaseMesh* mesh = create();
+	if (!mesh)
+	{
+		return nullptr;
+	}
+
+	Entry entry = { mesh, 1, 0 };
+	entries[key] = entry;
+	keys[mesh] = key;
+	misses++;
+	return mesh;
+}
+
+PlaneMesh* GeometryRegistry::acquirePlane(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution, bool packed)
+{
+	char key[64];
+	snprintf(key, sizeof(key), "plane:%d:%d", resolution, packed ? 1 : 0);
+	return static_cast<PlaneMesh*>(acquire(key, [&]() { return new PlaneMesh(device, deviceContext, resolution, packed); }));
+}
+
+SphereMesh* GeometryRegistry::acquireSphere(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution)
+{
+	char key[64];
+	snprintf(key, sizeof(key), "sphere:%d", resolution);
+	return static_cast<SphereMesh*>(acquire(key, [&]() { return new SphereMesh(device, deviceContext, resolution); }));
+}
+
+CubeMesh* GeometryRegistry::acquireCube(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution)
+{
+	char key[64];
+	snprintf(key, sizeof(key), "cube:%d", resolution);
+	return static_cast<CubeMesh*>(acquire(key, [&]() { return new CubeMesh(device, deviceContext, resolution); }));
+}
+
+bool GeometryRegistry::release(BaseMesh* mesh)
+{
+	auto key = keys.find(mesh);
+	if (key == keys.end())
+	{
+		return false;
+	}
+
+	auto found = entries.find(key->second);
+	if (--found->second.references > 0)
+	{
+		return true;
+	}
+
+	releasedBytesSaved += found->second.hits * mesh->getBufferBytes();
+	delete mesh;
+	entries.erase(found);
+	keys.erase(key);
+	return true;
+}
+
+int GeometryRegistry::getReferenceCount(BaseMesh* mesh) const
+{
+	auto key = keys.find(mesh);
+	return key == keys.end() ? 0 : entries.at(key->second).references;
+}
+
+// Sizes are taken now rather than at acquire, meshes loading on another thread have no buffers until they finish.
+GeometryRegistry::Stats GeometryRegistry::getStats() const
+{
+	Stats stats;
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.liveMeshes = (int)entries.size();
+	stats.bytesSaved = releasedBytesSaved;
+	for (auto& it : entries)
+	{
+		size_t bytes = it.second.mesh->getBufferBytes();
+		stats.liveBytes += bytes;
+		stats.bytesSaved += it.second.hits * bytes;
+	}
+	return stats;
+}
+
+std::string GeometryRegistry::getFileKey(const char* type, const char* filename)
+{
+	unsigned long long hash = MeshCache::hashSource(filename, 0);
+	if (hash == 0)
+	{
+		return std::string(type) + ":" + filename;
+	}
+
+	char hex[17];
+	snprintf(hex, sizeof(hex), "%016llx", hash);
+	return std::string(type) + ":" + hex;
+}
@@ -0,0 +1,293 @@
+// Height generator
+// Gradient noise fBm and ridged terrain, four samples at a time, deterministic per seed and sample.
+#include "heightgenerator.h"
+#include <emmintrin.h>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	// Seeds of the domain warp noise and the step between octave seeds.
+	const unsigned int k_WarpSeedX = 0x68e31da4u;
+	const unsigned int k_WarpSeedZ = 0xb5297a4du;
+	const unsigned int k_OctaveSeedStep = 0x9e3779b9u;
+
+	// Integer hash of a lattice point.
+	inline unsigned int hash(int x, int z, unsigned int seed)
+	{
+		unsigned int h = seed ^ ((unsigned int)x * 0x27d4eb2du) ^ ((unsigned int)z * 0x165667b1u);
+		h ^= h >> 15;
+		h *= 0x2c1b3c6du;
+		h ^= h >> 12;
+		return h;
+	}
+
+	// Dot product of the offset with one of eight gradients, (+-1, +-0.5) or (+-0.5, +-1) picked by the low bits of the hash.
+	inline float gradient(unsigned int h, float x, float z)
+	{
+		float a = (h & 4) ? z : x;
+		float b = (h & 4) ? x : z;
+		return ((h & 1) ? -a : a) + ((h & 2) ? -b : b) * 0.5f;
+	}
+
+	inline float fade(float t)
+	{
+		return t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+	}
+
+	float noise(float x, float z, unsigned int seed)
+	{
+		float x0 = floorf(x);
+		float z0 = floorf(z);
+		int ix = (int)x0;
+		int iz = (int)z0;
+		float dx = x - x0;
+		float dz = z - z0;
+
+		float g00 = gradient(hash(ix, iz, seed), dx, dz);
+		float g10 = gradient(hash(ix + 1, iz, seed), dx - 1.f, dz);
+		float g01 = gradient(hash(ix, iz + 1, seed), dx, dz - 1.f);
+		float g11 = gradient(hash(ix + 1, iz + 1, seed), dx - 1.f, dz - 1.f);
+
+		float u = fade(dx);
+		float v = fade(dz);
+		float a = g00 + (g10 - g00) * u;
+		float b = g01 + (g11 - g01) * u;
+		return a + (b - a) * v;
+	}
+
+	// SSE2 has no 32 bit multiply keeping the low halves, two 64 bit products of the even and odd lanes make one.
+	inline __m128i multiply(__m128i a, __m128i b)
+	{
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+
+	inline __m128i hash(__m128i x, __m128i z, unsigned int seed)
+	{
+		__m128i h = _mm_xor_si128(_mm_set1_epi32((int)seed), _mm_xor_si128(multiply(x, _mm_set1_epi32((int)0x27d4eb2du)), multiply(z, _mm_set1_epi32((int)0x165667b1u))));
+		h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+		h = multiply(h, _mm_set1_epi32((int)0x2c1b3c6du));
+		return _mm_xor_si128(h, _mm_srli_epi32(h, 12));
+	}
+
+	// Lanes where bit of h is set.
+	inline __m128 hasBit(__m128i h, int bit)
+	{
+		__m128i mask = _mm_set1_epi32(bit);
+		return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, mask), mask));
+	}
+
+	inline __m128 select(__m128 mask, __m128 whenSet, __m128 otherwise)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, whenSet), _mm_andnot_ps(mask, otherwise));
+	}
+
+	inline __m128 gradient(__m128i h, __m128 x, __m128 z)
+	{
+		const __m128 sign = _mm_set1_ps(-0.f);
+		__m128 swap = hasBit(h, 4);
+		__m128 a = select(swap, z, x);
+		__m128 b = select(swap, x, z);
+		a = _mm_xor_ps(a, _mm_and_ps(hasBit(h, 1), sign));
+		b = _mm_xor_ps(b, _mm_and_ps(hasBit(h, 2), sign));
+		return _mm_add_ps(a, _mm_mul_ps(b, _mm_set1_ps(0.5f)));
+	}
+
+	inline __m128 fade(__m128 t)
+	{
+		__m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.f)), _mm_set1_ps(15.f))), _mm_set1_ps(10.f));
+		return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+	}
+
+	__m128 noise(__m128 x, __m128 z, unsigned int seed)
+	{
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128i oneInt = _mm_set1_epi32(1);
+
+		// Floor, truncation rounds negative coordinates up so they take a step back.
+		__m128i ix = _mm_cvttps_epi32(x);
+		__m128i iz = _mm_cvttps_epi32(z);
+		__m128 x0 = _mm_cvtepi32_ps(ix);
+		__m128 z0 = _mm_cvtepi32_ps(iz);
+		__m128 backX = _mm_cmpgt_ps(x0, x);
+		__m128 backZ = _mm_cmpgt_ps(z0, z);
+		ix = _mm_add_epi32(ix, _mm_castps_si128(backX));
+		iz = _mm_add_epi32(iz, _mm_castps_si128(backZ));
+		x0 = _mm_sub_ps(x0, _mm_and_ps(backX, one));
+		z0 = _mm_sub_ps(z0, _mm_and_ps(backZ, one));
+		__m128 dx = _mm_sub_ps(x, x0);
+		__m128 dz = _mm_sub_ps(z, z0);
+		__m128 dx1 = _mm_sub_ps(dx, one);
+		__m128 dz1 = _mm_sub_ps(dz, one);
+		__m128i ix1 = _mm_add_epi32(ix, oneInt);
+		__m128i iz1 = _mm_add_epi32(iz, oneInt);
+
+		__m128 g00 = gradient(hash(ix, iz, seed), dx, dz);
+		__m128 g10 = gradient(hash(ix1, iz, seed), dx1, dz);
+		__m128 g01 = gradient(hash(ix, iz1, seed), dx, dz1);
+		__m128 g11 = gradient(hash(ix1, iz1, seed), dx1, dz1);
+
+		__m128 u = fade(dx);
+		__m128 v = fade(dz);
+		__m128 a = _mm_add_ps(g00, _mm_mul_ps(_mm_sub_ps(g10, g00), u));
+		__m128 b = _mm_add_ps(g01, _mm_mul_ps(_mm_sub_ps(g11, g01), u));
+		return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), v));
+	}
+}
+
+HeightGenerator::HeightGenerator(const Settings& lsettings) :
+	settings(lsettings),
+	amplitudeSum(0.f)
+{
+	float amplitude = 1.f;
+	for (int octave = 0; octave < settings.octaves; octave++)
+	{
+		amplitudeSum += amplitude;
+		amplitude *= settings.gain;
+	}
+	amplitudeSum = amplitudeSum > 0.f ? amplitudeSum : 1.f;
+}
+
+float HeightGenerator::sample(int x, int z) const
+{
+	float px = (float)x;
+	float pz = (float)z;
+	if (settings.warpStrength != 0.f)
+	{
+		float wx = px * settings.warpFrequency;
+		float wz = pz * settings.warpFrequency;
+		float offsetX = noise(wx, wz, settings.seed ^ k_WarpSeedX);
+		float offsetZ = noise(wx, wz, settings.seed ^ k_WarpSeedZ);
+		px = px + offsetX * settings.warpStrength;
+		pz = pz + offsetZ * settings.warpStrength;
+	}
+
+	float fx = px * settings.frequency;
+	float fz = pz * settings.frequency;
+	float amplitude = 1.f;
+	float sum = 0.f;
+	for (int octave = 0; octave < settings.octaves; octave++)
+	{
+		float n = noise(fx, fz, settings.seed + (unsigned int)octave * k_OctaveSeedStep);
+		if (settings.type == Type::Ridged)
+		{
+			float ridge = 1.f - fabsf(n);
+			sum = sum + ridge * ridge * amplitude;
+		}
+		else
+		{
+			sum = sum + n * amplitude;
+		}
+		fx = fx * settings.lacunarity;
+		fz = fz * settings.lacunarity;
+		amplitude = amplitude * settings.gain;
+	}
+
+	float height = sum / amplitudeSum;
+	if (settings.type == Type::Fbm)
+	{
+		height = height * 0.5f + 0.5f;
+	}
+	return height < 0.f ? 0.f : height > 1.f ? 1.f : height;
+}
+
+// The scalar steps of sample, four lanes along x at a time, the remainder with sample itself.
+void HeightGenerator::sampleRow(int x, int z, int count, float* heights) const
+{
+	const __m128 sign = _mm_set1_ps(-0.f);
+	const __m128 lacunarity = _mm_set1_ps(settings.lacunarity);
+	const __m128 frequency = _mm_set1_ps(settings.frequency);
+	const __m128 warpFrequency = _mm_set1_ps(settings.warpFrequency);
+	const __m128 warpStrength = _mm_set1_ps(settings.warpStrength);
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 px = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x + i), lanes));
+		__m128 pz = _mm_set1_ps((float)z);
+		if (settings.warpStrength != 0.f)
+		{
+			__m128 wx = _mm_mul_ps(px, warpFrequency);
+			__m128 wz = _mm_mul_ps(pz, warpFrequency);
+			__m128 offsetX = noise(wx, wz, settings.seed ^ k_WarpSeedX);
+			__m128 offsetZ = noise(wx, wz, settings.seed ^ k_WarpSeedZ);
+			px = _mm_add_ps(px, _mm_mul_ps(offsetX, warpStrength));
+			pz = _mm_add_ps(pz, _mm_mul_ps(offsetZ, warpStrength));
+		}
+
+		__m128 fx = _mm_mul_ps(px, frequency);
+		__m128 fz = _mm_mul_ps(pz, frequency);
+		float amplitude = 1.f;
+		__m128 sum = _mm_setzero_ps();
+		for (int octave = 0; octave < settings.octaves; octave++)
+		{
+			__m128 n = noise(fx, fz, settings.seed + (unsigned int)octave * k_OctaveSeedStep);
+			if (settings.type == Type::Ridged)
+			{
+				__m128 ridge = _mm_sub_ps(one, _mm_andnot_ps(sign, n));
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_mul_ps(ridge, ridge), _mm_set1_ps(amplitude)));
+			}
+			else
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(n, _mm_set1_ps(amplitude)));
+			}
+			fx = _mm_mul_ps(fx, lacunarity);
+			fz = _mm_mul_ps(fz, lacunarity);
+			amplitude = amplitude * settings.gain;
+		}
+
+		__m128 height = _mm_div_ps(sum, _mm_set1_ps(amplitudeSum));
+		if (settings.type == Type::Fbm)
+		{
+			height = _mm_add_ps(_mm_mul_ps(height, half), half);
+		}
+		_mm_storeu_ps(heights + i, _mm_max_ps(_mm_min_ps(height, one), _mm_setzero_ps()));
+	}
+
+	for (; i < count; i++)
+	{
+		heights[i] = sample(x + i, z);
+	}
+}
+
+// Rows are handed out one at a time from a shared counter, so a thread that is held up leaves its share to the others.
+void HeightGenerator::generateTile(int tileX, int tileZ, int size, unsigned short* heights, ThreadPool* pool) const
+{
+	std::atomic<int> nextRow(0);
+	auto generateRows = [&]()
+	{
+		std::vector<float> row(size);
+		for (int z = nextRow++; z < size; z = nextRow++)
+		{
+			sampleRow(tileX * size, tileZ * size + z, size, row.data());
+			unsigned short* out = heights + (size_t)z * size;
+			for (int x = 0; x < size; x++)
+			{
+				out[x] = (unsigned short)(row[x] * 65535.f + 0.5f);
+			}
+		}
+	};
+
+	std::vector<std::future<void>> helpers;
+	if (pool)
+	{
+		for (unsigned int i = 0; i < pool->getThreadCount(); i++)
+		{
+			helpers.push_back(pool->submit(generateRows));
+		}
+	}
+
+	generateRows();
+
+	// Helpers still reference the counter, even those that started after the last row was taken.
+	for (auto& helper : helpers)
+	{
+		helper.wait();
+	}
+}
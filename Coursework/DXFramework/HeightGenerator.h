@@ -0,0 +1,61 @@
+/**
+* \class Height Generator
+*
+* \brief Procedural terrain heights, gradient noise summed into fBm or ridged octaves with optional domain warping
+*
+* A height depends only on the settings and the integer coordinate of its sample, so a tile can be regenerated on demand and
+* neighbouring tiles continue each other without seams. Rows are computed four samples at a time with SSE, the scalar path takes
+* the same steps in the same order, and any thread count gives the same bits.
+* Tiles are 16 bit, 0 to 65535 spanning the range of the noise.
+*/
+
+
+#ifndef _HEIGHTGENERATOR_H_
+#define _HEIGHTGENERATOR_H_
+
+#include "ThreadPool.h"
+
+class HeightGenerator
+{
+public:
+	/// How the octaves are combined.
+	enum class Type
+	{
+		Fbm,		///< signed octaves summed, rolling hills
+		Ridged,		///< inverted absolute octaves squared, sharp crests
+	};
+
+	/// Parameters of the noise, every one of them changes the terrain.
+	struct Settings
+	{
+		unsigned int seed = 1337;
+		Type type = Type::Fbm;
+		int octaves = 6;
+		float frequency = 1.f / 256.f;		///< cycles per sample of the first octave
+		float lacunarity = 2.f;				///< frequency multiplier from one octave to the next
+		float gain = 0.5f;					///< amplitude multiplier from one octave to the next
+		float warpStrength = 0.f;			///< samples the coordinates are displaced by, 0 turns domain warping off
+		float warpFrequency = 1.f / 512.f;	///< cycles per sample of the displacement noise
+	};
+
+	explicit HeightGenerator(const Settings& settings);
+
+	/// Height of one sample, 0 to 1.
+	float sample(int x, int z) const;
+	/// Heights of count samples along x from (x, z), 0 to 1.
+	void sampleRow(int x, int z, int count, float* heights) const;
+
+	/** \brief Generates the size x size samples of tile (tileX, tileZ), starting at sample (tileX * size, tileZ * size)
+	* @param pool shares the rows with its workers, each claiming the next row when it is free. The calling thread takes rows too,
+	* so it must not be a worker of the same pool. Null generates on the calling thread.
+	*/
+	void generateTile(int tileX, int tileZ, int size, unsigned short* heights, ThreadPool* pool = nullptr) const;
+
+	const Settings& getSettings() const { return settings; }
+
+private:
+	Settings settings;
+	float amplitudeSum;		///< largest possible sum of the octave amplitudes, normalises the result
+};
+
+#endif
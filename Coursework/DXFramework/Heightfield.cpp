@@ -0,0 +1,274 @@
+// Heightfield
+// CPU heights of a heightmap and the bake of the surface texture terrain shaders sample.
+#include "heightfield.h"
+#include "threadpool.h"
+#include "texturemanager.h"
+#include "meshcache.h"
+#include "mappedfile.h"
+#include <directxpackedvector.h>
+#include <xmmintrin.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	const char k_Magic[4] = { 'H', 'F', 'S', 'B' };
+	// Bump whenever the surface bake changes, older bakes are then redone.
+	const unsigned int k_Version = 1;
+	// Rows per job at least, smaller maps are not worth the thread start up.
+	const int k_MinRowsPerJob = 32;
+
+	struct Header
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned long long key;
+		unsigned int width;
+		unsigned int height;
+	};
+
+	// A tap step texels away lands the same distance past a texel for every texel, between offset and offset + 1 with weight on the latter.
+	struct Taps
+	{
+		int offset;
+		float weight;
+	};
+
+	Taps makeTaps(float texels)
+	{
+		Taps taps;
+		taps.offset = (int)floorf(texels);
+		taps.weight = texels - taps.offset;
+		return taps;
+	}
+
+	inline int wrap(int texel, int count)
+	{
+		return ((texel % count) + count) % count;
+	}
+
+	// Difference of the bilinear taps at +step and -step: (1 - w)(h[x + o] - h[x - o]) + w(h[x + o + 1] - h[x - o - 1]).
+	// One row of texels as normal xyz and scaled height, four at a time away from the wrapping edges.
+	void bakeRow(const float* heights, int width, int height, int y, const Taps& tapsX, const Taps& tapsZ, float twoStep, float heightScale, float* out)
+	{
+		const float* row = heights + (size_t)y * width;
+		const float* ahead = heights + (size_t)wrap(y + tapsZ.offset, height) * width;
+		const float* aheadFar = heights + (size_t)wrap(y + tapsZ.offset + 1, height) * width;
+		const float* behind = heights + (size_t)wrap(y - tapsZ.offset, height) * width;
+		const float* behindFar = heights + (size_t)wrap(y - tapsZ.offset - 1, height) * width;
+
+		auto bakeTexel = [&](int x)
+		{
+			float deltaX = (1.f - tapsX.weight) * (row[wrap(x + tapsX.offset, width)] - row[wrap(x - tapsX.offset, width)])
+				+ tapsX.weight * (row[wrap(x + tapsX.offset + 1, width)] - row[wrap(x - tapsX.offset - 1, width)]);
+			float deltaZ = (1.f - tapsZ.weight) * (ahead[x] - behind[x]) + tapsZ.weight * (aheadFar[x] - behindFar[x]);
+			float inverseLength = 1.f / sqrtf(deltaX * deltaX + twoStep * twoStep + deltaZ * deltaZ);
+			out[x * 4 + 0] = -deltaX * inverseLength;
+			out[x * 4 + 1] = twoStep * inverseLength;
+			out[x * 4 + 2] = -deltaZ * inverseLength;
+			out[x * 4 + 3] = row[x] * heightScale;
+		};
+
+		// The horizontal taps stay inside the row from first up to last.
+		int first = tapsX.offset + 1;
+		int last = width - tapsX.offset - 1;
+		int x = 0;
+		for (; x < first && x < width; x++)
+			bakeTexel(x);
+
+		const __m128 nearWeight = _mm_set1_ps(1.f - tapsX.weight);
+		const __m128 farWeight = _mm_set1_ps(tapsX.weight);
+		const __m128 nearWeightZ = _mm_set1_ps(1.f - tapsZ.weight);
+		const __m128 farWeightZ = _mm_set1_ps(tapsZ.weight);
+		const __m128 up = _mm_set1_ps(twoStep);
+		const __m128 upSquared = _mm_set1_ps(twoStep * twoStep);
+		const __m128 scale = _mm_set1_ps(heightScale);
+		const __m128 negate = _mm_set1_ps(-0.f);
+		for (; x + 4 <= last; x += 4)
+		{
+			__m128 nearX = _mm_sub_ps(_mm_loadu_ps(row + x + tapsX.offset), _mm_loadu_ps(row + x - tapsX.offset));
+			__m128 farX = _mm_sub_ps(_mm_loadu_ps(row + x + tapsX.offset + 1), _mm_loadu_ps(row + x - tapsX.offset - 1));
+			__m128 deltaX = _mm_add_ps(_mm_mul_ps(nearWeight, nearX), _mm_mul_ps(farWeight, farX));
+			__m128 nearZ = _mm_sub_ps(_mm_loadu_ps(ahead + x), _mm_loadu_ps(behind + x));
+			__m128 farZ = _mm_sub_ps(_mm_loadu_ps(aheadFar + x), _mm_loadu_ps(behindFar + x));
+			__m128 deltaZ = _mm_add_ps(_mm_mul_ps(nearWeightZ, nearZ), _mm_mul_ps(farWeightZ, farZ));
+
+			__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(deltaX, deltaX), upSquared), _mm_mul_ps(deltaZ, deltaZ));
+			__m128 inverseLength = _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(lengthSquared));
+
+			// Four texels of x, y, z, height each, transposed into texel order.
+			__m128 normalX = _mm_xor_ps(_mm_mul_ps(deltaX, inverseLength), negate);
+			__m128 normalY = _mm_mul_ps(up, inverseLength);
+			__m128 normalZ = _mm_xor_ps(_mm_mul_ps(deltaZ, inverseLength), negate);
+			__m128 scaled = _mm_mul_ps(_mm_loadu_ps(row + x), scale);
+			_MM_TRANSPOSE4_PS(normalX, normalY, normalZ, scaled);
+			_mm_storeu_ps(out + x * 4 + 0, normalX);
+			_mm_storeu_ps(out + x * 4 + 4, normalY);
+			_mm_storeu_ps(out + x * 4 + 8, normalZ);
+			_mm_storeu_ps(out + x * 4 + 12, scaled);
+		}
+
+		for (; x < width; x++)
+			bakeTexel(x);
+	}
+}
+
+Heightfield::Heightfield() :
+	width(0),
+	height(0)
+{
+}
+
+bool Heightfield::load(const wchar_t* filename)
+{
+	std::vector<unsigned char> pixels;
+	unsigned int imageWidth = 0, imageHeight = 0;
+	if (!TextureManager::readImagePixels(filename, pixels, imageWidth, imageHeight))
+	{
+		return false;
+	}
+
+	width = (int)imageWidth;
+	height = (int)imageHeight;
+	heights.resize((size_t)width * height);
+	for (size_t i = 0; i < heights.size(); i++)
+	{
+		heights[i] = pixels[i * 4] / 255.f;
+	}
+	return true;
+}
+
+void Heightfield::setHeights(const float* lheights, int lwidth, int lheight)
+{
+	width = lwidth;
+	height = lheight;
+	heights.assign(lheights, lheights + (size_t)width * height);
+}
+
+void Heightfield::setHeights(const unsigned short* lheights, int lwidth, int lheight)
+{
+	width = lwidth;
+	height = lheight;
+	heights.resize((size_t)width * height);
+	for (size_t i = 0; i < heights.size(); i++)
+	{
+		heights[i] = lheights[i] / 65535.f;
+	}
+}
+
+// Row bands on separate threads, each row computed in floats and converted to halves in one stream.
+void Heightfield::bakeSurface(const SurfaceSettings& settings, std::vector<SurfaceTexel>& texels, unsigned int maxThreads) const
+{
+	texels.resize(heights.size());
+	if (heights.empty())
+	{
+		return;
+	}
+
+	Taps tapsX = makeTaps(settings.normalStep * width);
+	Taps tapsZ = makeTaps(settings.normalStep * height);
+	float twoStep = settings.normalStep * 2.f;
+
+	size_t jobCount = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+	size_t maxJobs = (size_t)(height + k_MinRowsPerJob - 1) / k_MinRowsPerJob;
+	jobCount = jobCount < 1 ? 1 : jobCount > maxJobs ? maxJobs : jobCount;
+	int rowsPerJob = (int)((height + jobCount - 1) / jobCount);
+
+	ThreadPool::shared().runParallel(jobCount, [&](size_t job)
+	{
+		std::vector<float> row((size_t)width * 4);
+		int firstRow = (int)job * rowsPerJob;
+		int lastRow = firstRow + rowsPerJob < height ? firstRow + rowsPerJob : height;
+		for (int y = firstRow; y < lastRow; y++)
+		{
+			bakeRow(heights.data(), width, height, y, tapsX, tapsZ, twoStep, settings.heightScale, row.data());
+			PackedVector::XMConvertFloatToHalfStream(reinterpret_cast<PackedVector::HALF*>(&texels[(size_t)y * width]), sizeof(PackedVector::HALF),
+				row.data(), sizeof(float), row.size());
+		}
+	});
+}
+
+unsigned long long Heightfield::getSurfaceKey(const SurfaceSettings& settings) const
+{
+	unsigned long long key = MeshCache::hashData(heights.data(), heights.size() * sizeof(float));
+	key = MeshCache::hashData(&width, sizeof(width), key);
+	key = MeshCache::hashData(&settings.heightScale, sizeof(settings.heightScale), key);
+	key = MeshCache::hashData(&settings.normalStep, sizeof(settings.normalStep), key);
+	return MeshCache::hashData(&k_Version, sizeof(k_Version), key);
+}
+
+bool Heightfield::loadSurface(const char* cacheFile, unsigned long long key, int width, int height, std::vector<SurfaceTexel>& texels)
+{
+	MappedFile file;
+	if (!file.open(cacheFile) || file.getSize() < sizeof(Header))
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, file.getData(), sizeof(Header));
+	size_t texelCount = (size_t)width * height;
+	if (memcmp(header.magic, k_Magic, sizeof(k_Magic)) != 0 || header.version != k_Version || header.key != key
+		|| header.width != (unsigned int)width || header.height != (unsigned int)height || file.getSize() < sizeof(Header) + texelCount * sizeof(SurfaceTexel))
+	{
+		return false;
+	}
+
+	texels.resize(texelCount);
+	memcpy(texels.data(), file.getData() + sizeof(Header), texelCount * sizeof(SurfaceTexel));
+	return true;
+}
+
+bool Heightfield::saveSurface(const char* cacheFile, unsigned long long key, int width, int height, const std::vector<SurfaceTexel>& texels)
+{
+	if (texels.size() != (size_t)width * height)
+	{
+		return false;
+	}
+
+	std::ofstream file(cacheFile, std::ofstream::binary | std::ofstream::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(header.magic, k_Magic, sizeof(k_Magic));
+	header.version = k_Version;
+	header.key = key;
+	header.width = (unsigned int)width;
+	header.height = (unsigned int)height;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(texels.data()), texels.size() * sizeof(SurfaceTexel));
+	return file.good();
+}
+
+ID3D11ShaderResourceView* Heightfield::createSurfaceTexture(ID3D11Device* device, const SurfaceTexel* texels, int width, int height)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = (UINT)width;
+	desc.Height = (UINT)height;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA data = { texels, (UINT)(width * sizeof(SurfaceTexel)), 0 };
+	ID3D11Texture2D* texture = 0;
+	ID3D11ShaderResourceView* view = 0;
+	if (FAILED(device->CreateTexture2D(&desc, &data, &texture)))
+	{
+		return 0;
+	}
+
+	// The view keeps the texture alive.
+	device->CreateShaderResourceView(texture, NULL, &view);
+	texture->Release();
+	return view;
+}
@@ -0,0 +1,69 @@
+/**
+* \class Heightfield
+*
+* \brief CPU copy of a heightmap, and the baked surface texture terrain shaders read in its place
+*
+* Heights are the red channel of the image normalised to 0-1, row 0 at v = 0, sampled with wrapping as the shaders' sampler does.
+* The surface bake stores per texel the unit normal of the central differences the landscape vertex shader used to take with four extra
+* taps, and the height already scaled to object space, so a vertex needs a single fetch. Rows are baked in parallel, four texels at a time.
+* A bake is keyed by the heights and its settings, so a cached bake is only redone when either changes.
+*/
+
+
+#ifndef _HEIGHTFIELD_H_
+#define _HEIGHTFIELD_H_
+
+#include <d3d11.h>
+#include <vector>
+
+class Heightfield
+{
+public:
+	/// Texel of the surface texture, DXGI_FORMAT_R16G16B16A16_FLOAT.
+	struct SurfaceTexel
+	{
+		unsigned short normal[3];	///< unit normal, half floats
+		unsigned short height;		///< object space height, half float
+	};
+
+	/// Parameters of a surface bake, part of its key.
+	struct SurfaceSettings
+	{
+		float heightScale = 50.f;		///< object space height of a sample of 1
+		float normalStep = 0.008f;		///< uv distance of the central differences
+	};
+
+	Heightfield();
+
+	/// Decodes the image and keeps its red channel, false if it cannot be read.
+	bool load(const wchar_t* filename);
+	void setHeights(const float* heights, int width, int height);
+	/// 16 bit heights, 65535 is a height of 1, as generated by HeightGenerator tiles.
+	void setHeights(const unsigned short* heights, int width, int height);
+
+	const float* getHeights() const { return heights.empty() ? nullptr : heights.data(); }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	bool isEmpty() const { return heights.empty(); }
+
+	/** \brief Bakes the normals and scaled heights of every texel
+	* @param maxThreads limits the worker count, 0 uses all hardware threads
+	*/
+	void bakeSurface(const SurfaceSettings& settings, std::vector<SurfaceTexel>& texels, unsigned int maxThreads = 0) const;
+	/// Hash of the heights, the settings and the bake version. A cached bake with another key is stale.
+	unsigned long long getSurfaceKey(const SurfaceSettings& settings) const;
+
+	/// Reads a bake saved with saveSurface, false if missing, truncated, of another size or baked with another key.
+	static bool loadSurface(const char* cacheFile, unsigned long long key, int width, int height, std::vector<SurfaceTexel>& texels);
+	static bool saveSurface(const char* cacheFile, unsigned long long key, int width, int height, const std::vector<SurfaceTexel>& texels);
+
+	/// Immutable single level texture of the texels, the returned view holds the only reference to it.
+	static ID3D11ShaderResourceView* createSurfaceTexture(ID3D11Device* device, const SurfaceTexel* texels, int width, int height);
+
+private:
+	std::vector<float> heights;
+	int width;
+	int height;
+};
+
+#endif
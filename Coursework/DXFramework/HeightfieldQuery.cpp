@@ -0,0 +1,529 @@
+// Heightfield query
+// Bilinear heights and normals of the baked terrain surface, and rays through a min/max pyramid of its patches.
+#include "heightfieldquery.h"
+#include <directxpackedvector.h>
+#include <emmintrin.h>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	// Deepest pyramid the ray stack is sized for, 2^31 patches a side.
+	const int k_MaxLevels = 32;
+
+	inline bool isPowerOfTwo(int count)
+	{
+		return (count & (count - 1)) == 0;
+	}
+
+	inline int wrap(int texel, int count)
+	{
+		return isPowerOfTwo(count) ? texel & (count - 1) : ((texel % count) + count) % count;
+	}
+
+	inline float lerp(float a, float b, float t)
+	{
+		return a + (b - a) * t;
+	}
+
+	inline __m128 lerp(__m128 a, __m128 b, __m128 t)
+	{
+		return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+	}
+
+	// Floor of four texel coordinates, as integers and as floats.
+	inline __m128i floorLanes(__m128 x, __m128& floored)
+	{
+		__m128i truncated = _mm_cvttps_epi32(x);
+		floored = _mm_cvtepi32_ps(truncated);
+		__m128 back = _mm_cmpgt_ps(floored, x);
+		floored = _mm_sub_ps(floored, _mm_and_ps(back, _mm_set1_ps(1.f)));
+		return _mm_add_epi32(truncated, _mm_castps_si128(back));
+	}
+
+	// Offsets of the four texels of a bilinear tap into the row major texels.
+	struct Tap
+	{
+		size_t corners[4];		// x0 z0, x1 z0, x0 z1, x1 z1
+	};
+
+	inline void makeTap(int x, int z, int width, int height, Tap& tap)
+	{
+		size_t x0 = (size_t)wrap(x, width);
+		size_t x1 = (size_t)wrap(x + 1, width);
+		size_t row0 = (size_t)wrap(z, height) * width;
+		size_t row1 = (size_t)wrap(z + 1, height) * width;
+		tap.corners[0] = row0 + x0;
+		tap.corners[1] = row0 + x1;
+		tap.corners[2] = row1 + x0;
+		tap.corners[3] = row1 + x1;
+	}
+
+	// Texel indices of four taps by corner and lane, wrapped with masks when both sides are powers of two.
+	inline void makeTaps(__m128i x, __m128i z, int width, int height, int corners[4][4])
+	{
+		if (isPowerOfTwo(width) && isPowerOfTwo(height))
+		{
+			int rowShift = 0;
+			while ((1 << rowShift) < width)
+				rowShift++;
+
+			const __m128i one = _mm_set1_epi32(1);
+			const __m128i maskX = _mm_set1_epi32(width - 1);
+			const __m128i maskZ = _mm_set1_epi32(height - 1);
+			const __m128i shift = _mm_cvtsi32_si128(rowShift);
+			__m128i x0 = _mm_and_si128(x, maskX);
+			__m128i x1 = _mm_and_si128(_mm_add_epi32(x, one), maskX);
+			__m128i row0 = _mm_sll_epi32(_mm_and_si128(z, maskZ), shift);
+			__m128i row1 = _mm_sll_epi32(_mm_and_si128(_mm_add_epi32(z, one), maskZ), shift);
+			_mm_storeu_si128((__m128i*)corners[0], _mm_add_epi32(row0, x0));
+			_mm_storeu_si128((__m128i*)corners[1], _mm_add_epi32(row0, x1));
+			_mm_storeu_si128((__m128i*)corners[2], _mm_add_epi32(row1, x0));
+			_mm_storeu_si128((__m128i*)corners[3], _mm_add_epi32(row1, x1));
+			return;
+		}
+
+		alignas(16) int texelsX[4], texelsZ[4];
+		_mm_store_si128((__m128i*)texelsX, x);
+		_mm_store_si128((__m128i*)texelsZ, z);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			Tap tap;
+			makeTap(texelsX[lane], texelsZ[lane], width, height, tap);
+			for (int corner = 0; corner < 4; corner++)
+				corners[corner][lane] = (int)tap.corners[corner];
+		}
+	}
+
+	// Clips [tNear, tFar] to the part of the ray between low and high on one axis.
+	inline bool clipSlab(float origin, float direction, float low, float high, float& tNear, float& tFar)
+	{
+		if (direction == 0.f)
+		{
+			return origin >= low && origin <= high;
+		}
+
+		float inverse = 1.f / direction;
+		float t0 = (low - origin) * inverse;
+		float t1 = (high - origin) * inverse;
+		if (t0 > t1)
+		{
+			float swap = t0;
+			t0 = t1;
+			t1 = swap;
+		}
+		tNear = t0 > tNear ? t0 : tNear;
+		tFar = t1 < tFar ? t1 : tFar;
+		return tNear <= tFar;
+	}
+}
+
+HeightfieldQuery::HeightfieldQuery() :
+	width(0),
+	height(0),
+	texelsPerUnitX(0.f),
+	texelsPerUnitZ(0.f),
+	firstPatchX(0),
+	firstPatchZ(0),
+	patchCountX(0),
+	patchCountZ(0)
+{
+}
+
+void HeightfieldQuery::build(const Heightfield::SurfaceTexel* texels, int lwidth, int lheight, float uvPerUnit, float size)
+{
+	width = lwidth;
+	height = lheight;
+	heights.resize((size_t)width * height);
+	normals.resize(heights.size());
+	for (size_t i = 0; i < heights.size(); i++)
+	{
+		heights[i] = PackedVector::XMConvertHalfToFloat(texels[i].height);
+		normals[i].x = PackedVector::XMConvertHalfToFloat(texels[i].normal[0]);
+		normals[i].y = PackedVector::XMConvertHalfToFloat(texels[i].normal[1]);
+		normals[i].z = PackedVector::XMConvertHalfToFloat(texels[i].normal[2]);
+	}
+
+	// The patches overlapping the square, the first one starts at or before its origin and the last one ends at or after its far side.
+	texelsPerUnitX = uvPerUnit * width;
+	texelsPerUnitZ = uvPerUnit * height;
+	firstPatchX = (int)floorf(toTexelX(0.f));
+	firstPatchZ = (int)floorf(toTexelZ(0.f));
+	patchCountX = (int)floorf(toTexelX(size)) - firstPatchX + 1;
+	patchCountZ = (int)floorf(toTexelZ(size)) - firstPatchZ + 1;
+
+	levels.clear();
+	if (heights.empty())
+	{
+		return;
+	}
+
+	levels.push_back(std::vector<XMFLOAT2>((size_t)patchCountX * patchCountZ));
+	for (int z = 0; z < patchCountZ; z++)
+	{
+		for (int x = 0; x < patchCountX; x++)
+		{
+			float corners[4];
+			getCorners(x, z, corners);
+			float low = fminf(fminf(corners[0], corners[1]), fminf(corners[2], corners[3]));
+			float high = fmaxf(fmaxf(corners[0], corners[1]), fmaxf(corners[2], corners[3]));
+			levels[0][(size_t)z * patchCountX + x] = XMFLOAT2(low, high);
+		}
+	}
+
+	// Every level halves the previous one, rounding up, until a single node covers the square.
+	int countX = patchCountX;
+	int countZ = patchCountZ;
+	while (countX > 1 || countZ > 1)
+	{
+		int parentX = (countX + 1) / 2;
+		int parentZ = (countZ + 1) / 2;
+		const std::vector<XMFLOAT2>& children = levels.back();
+		std::vector<XMFLOAT2> parents((size_t)parentX * parentZ, XMFLOAT2(FLT_MAX, -FLT_MAX));
+		for (int z = 0; z < countZ; z++)
+		{
+			for (int x = 0; x < countX; x++)
+			{
+				const XMFLOAT2& child = children[(size_t)z * countX + x];
+				XMFLOAT2& parent = parents[(size_t)(z / 2) * parentX + x / 2];
+				parent.x = fminf(parent.x, child.x);
+				parent.y = fmaxf(parent.y, child.y);
+			}
+		}
+		levels.push_back(parents);
+		countX = parentX;
+		countZ = parentZ;
+	}
+}
+
+float HeightfieldQuery::getHeight(float x, float z) const
+{
+	float texelX = toTexelX(x);
+	float texelZ = toTexelZ(z);
+	float floorX = floorf(texelX);
+	float floorZ = floorf(texelZ);
+
+	Tap tap;
+	makeTap((int)floorX, (int)floorZ, width, height, tap);
+	float weightX = texelX - floorX;
+	float weightZ = texelZ - floorZ;
+	float lower = lerp(heights[tap.corners[0]], heights[tap.corners[1]], weightX);
+	float upper = lerp(heights[tap.corners[2]], heights[tap.corners[3]], weightX);
+	return lerp(lower, upper, weightZ);
+}
+
+XMFLOAT3 HeightfieldQuery::getNormal(float x, float z) const
+{
+	float texelX = toTexelX(x);
+	float texelZ = toTexelZ(z);
+	float floorX = floorf(texelX);
+	float floorZ = floorf(texelZ);
+
+	Tap tap;
+	makeTap((int)floorX, (int)floorZ, width, height, tap);
+	float weightX = texelX - floorX;
+	float weightZ = texelZ - floorZ;
+	const XMFLOAT3& n00 = normals[tap.corners[0]];
+	const XMFLOAT3& n10 = normals[tap.corners[1]];
+	const XMFLOAT3& n01 = normals[tap.corners[2]];
+	const XMFLOAT3& n11 = normals[tap.corners[3]];
+	float normalX = lerp(lerp(n00.x, n10.x, weightX), lerp(n01.x, n11.x, weightX), weightZ);
+	float normalY = lerp(lerp(n00.y, n10.y, weightX), lerp(n01.y, n11.y, weightX), weightZ);
+	float normalZ = lerp(lerp(n00.z, n10.z, weightX), lerp(n01.z, n11.z, weightX), weightZ);
+
+	// Renormalised after filtering, as the shader does.
+	float inverseLength = 1.f / sqrtf(normalX * normalX + normalY * normalY + normalZ * normalZ);
+	return XMFLOAT3(normalX * inverseLength, normalY * inverseLength, normalZ * inverseLength);
+}
+
+// The scalar steps four points at a time, the texels are gathered one by one as SSE2 has no gather.
+void HeightfieldQuery::getHeights(const XMFLOAT2* points, int count, float* out) const
+{
+	const __m128 scaleX = _mm_set1_ps(texelsPerUnitX);
+	const __m128 scaleZ = _mm_set1_ps(texelsPerUnitZ);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		// x0 z0 x1 z1 and x2 z2 x3 z3 into x0..x3 and z0..z3.
+		__m128 first = _mm_loadu_ps(&points[i].x);
+		__m128 second = _mm_loadu_ps(&points[i + 2].x);
+		__m128 texelX = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)), scaleX), half);
+		__m128 texelZ = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)), scaleZ), half);
+
+		__m128 floorX, floorZ;
+		alignas(16) int texels[4][4];
+		makeTaps(floorLanes(texelX, floorX), floorLanes(texelZ, floorZ), width, height, texels);
+
+		alignas(16) float corners[4][4];
+		for (int corner = 0; corner < 4; corner++)
+			for (int lane = 0; lane < 4; lane++)
+				corners[corner][lane] = heights[texels[corner][lane]];
+
+		__m128 weightX = _mm_sub_ps(texelX, floorX);
+		__m128 weightZ = _mm_sub_ps(texelZ, floorZ);
+		__m128 lower = lerp(_mm_load_ps(corners[0]), _mm_load_ps(corners[1]), weightX);
+		__m128 upper = lerp(_mm_load_ps(corners[2]), _mm_load_ps(corners[3]), weightX);
+		_mm_storeu_ps(out + i, lerp(lower, upper, weightZ));
+	}
+
+	for (; i < count; i++)
+	{
+		out[i] = getHeight(points[i].x, points[i].y);
+	}
+}
+
+void HeightfieldQuery::getNormals(const XMFLOAT2* points, int count, XMFLOAT3* out) const
+{
+	const __m128 scaleX = _mm_set1_ps(texelsPerUnitX);
+	const __m128 scaleZ = _mm_set1_ps(texelsPerUnitZ);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 first = _mm_loadu_ps(&points[i].x);
+		__m128 second = _mm_loadu_ps(&points[i + 2].x);
+		__m128 texelX = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)), scaleX), half);
+		__m128 texelZ = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)), scaleZ), half);
+
+		__m128 floorX, floorZ;
+		alignas(16) int texels[4][4];
+		makeTaps(floorLanes(texelX, floorX), floorLanes(texelZ, floorZ), width, height, texels);
+
+		// Corners by component, corner and lane.
+		alignas(16) float corners[3][4][4];
+		for (int corner = 0; corner < 4; corner++)
+		{
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const XMFLOAT3& normal = normals[texels[corner][lane]];
+				corners[0][corner][lane] = normal.x;
+				corners[1][corner][lane] = normal.y;
+				corners[2][corner][lane] = normal.z;
+			}
+		}
+
+		__m128 weightX = _mm_sub_ps(texelX, floorX);
+		__m128 weightZ = _mm_sub_ps(texelZ, floorZ);
+		__m128 components[3];
+		for (int c = 0; c < 3; c++)
+		{
+			__m128 lower = lerp(_mm_load_ps(corners[c][0]), _mm_load_ps(corners[c][1]), weightX);
+			__m128 upper = lerp(_mm_load_ps(corners[c][2]), _mm_load_ps(corners[c][3]), weightX);
+			components[c] = lerp(lower, upper, weightZ);
+		}
+
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(components[0], components[0]), _mm_mul_ps(components[1], components[1])),
+			_mm_mul_ps(components[2], components[2]));
+		__m128 inverseLength = _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(lengthSquared));
+		alignas(16) float unit[3][4];
+		for (int c = 0; c < 3; c++)
+			_mm_store_ps(unit[c], _mm_mul_ps(components[c], inverseLength));
+		for (int lane = 0; lane < 4; lane++)
+			out[i + lane] = XMFLOAT3(unit[0][lane], unit[1][lane], unit[2][lane]);
+	}
+
+	for (; i < count; i++)
+	{
+		out[i] = getNormal(points[i].x, points[i].y);
+	}
+}
+
+// Depth first through the pyramid, children in the order the ray enters them. Siblings do not overlap along the ray,
+// so the first patch hit is the nearest one.
+bool HeightfieldQuery::raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, Hit& hit) const
+{
+	hit.patchesTested = 0;
+	if (levels.empty())
+	{
+		return false;
+	}
+
+	// Patch space, patch (x, z) spans [x, x + 1] and [z, z + 1], heights stay in object space.
+	const XMFLOAT3 patchOrigin(toTexelX(origin.x) - firstPatchX, origin.y, toTexelZ(origin.z) - firstPatchZ);
+	const XMFLOAT3 patchDirection(direction.x * texelsPerUnitX, direction.y, direction.z * texelsPerUnitZ);
+
+	struct Node
+	{
+		int level, x, z;
+		float tEnter, tExit;
+		float lowest;
+	};
+
+	// Clips the ray to the part of a node it passes over the terrain or under its highest point, false if it misses it.
+	// The terrain is solid below the surface, so only the top of the bounds clips.
+	auto enterNode = [&](int level, int x, int z, float tNear, float tFar, Node& node)
+	{
+		int levelCountX = (patchCountX + (1 << level) - 1) >> level;
+		const XMFLOAT2& bounds = levels[level][(size_t)z * levelCountX + x];
+		float lowX = (float)(x << level);
+		float lowZ = (float)(z << level);
+		float highX = (float)((x + 1) << level);
+		float highZ = (float)((z + 1) << level);
+		highX = highX < patchCountX ? highX : (float)patchCountX;
+		highZ = highZ < patchCountZ ? highZ : (float)patchCountZ;
+		if (!clipSlab(patchOrigin.x, patchDirection.x, lowX, highX, tNear, tFar) ||
+			!clipSlab(patchOrigin.z, patchDirection.z, lowZ, highZ, tNear, tFar) ||
+			!clipSlab(patchOrigin.y, patchDirection.y, -FLT_MAX, bounds.y, tNear, tFar))
+		{
+			return false;
+		}
+		node = { level, x, z, tNear, tFar, bounds.x };
+		return true;
+	};
+
+	Node stack[k_MaxLevels * 3 + 1];
+	int depth = 0;
+	if (!enterNode((int)levels.size() - 1, 0, 0, 0.f, maxDistance, stack[0]))
+	{
+		return false;
+	}
+	depth = 1;
+
+	auto report = [&](float t)
+	{
+		hit.distance = t;
+		hit.position = XMFLOAT3(origin.x + direction.x * t, origin.y + direction.y * t, origin.z + direction.z * t);
+		hit.normal = getNormal(hit.position.x, hit.position.z);
+		return true;
+	};
+
+	while (depth > 0)
+	{
+		// Entering under the lowest point of a node is a hit without looking at its patches.
+		Node node = stack[--depth];
+		if (patchOrigin.y + patchDirection.y * node.tEnter <= node.lowest)
+		{
+			return report(node.tEnter);
+		}
+
+		if (node.level == 0)
+		{
+			float t;
+			hit.patchesTested++;
+			if (intersectPatch(node.x, node.z, patchOrigin, patchDirection, node.tEnter, node.tExit, t))
+			{
+				return report(t);
+			}
+			continue;
+		}
+
+		// Children the ray passes through, sorted by entry so the nearest is popped first.
+		int childLevel = node.level - 1;
+		int childCountX = (patchCountX + (1 << childLevel) - 1) >> childLevel;
+		int childCountZ = (patchCountZ + (1 << childLevel) - 1) >> childLevel;
+		Node children[4];
+		int childCount = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			int childX = node.x * 2 + (i & 1);
+			int childZ = node.z * 2 + (i >> 1);
+			if (childX < childCountX && childZ < childCountZ &&
+				enterNode(childLevel, childX, childZ, node.tEnter, node.tExit, children[childCount]))
+			{
+				int j = childCount++;
+				for (; j > 0 && children[j - 1].tEnter > children[j].tEnter; j--)
+				{
+					Node swap = children[j - 1];
+					children[j - 1] = children[j];
+					children[j] = swap;
+				}
+			}
+		}
+		for (int i = childCount - 1; i >= 0; i--)
+		{
+			stack[depth++] = children[i];
+		}
+	}
+	return false;
+}
+
+bool HeightfieldQuery::intersectSegment(const XMFLOAT3& from, const XMFLOAT3& to, Hit& hit) const
+{
+	return raycast(from, XMFLOAT3(to.x - from.x, to.y - from.y, to.z - from.z), 1.f, hit);
+}
+
+float HeightfieldQuery::getMinHeight() const
+{
+	return levels.empty() ? 0.f : levels.back()[0].x;
+}
+
+float HeightfieldQuery::getMaxHeight() const
+{
+	return levels.empty() ? 0.f : levels.back()[0].y;
+}
+
+void HeightfieldQuery::getCorners(int x, int z, float corners[4]) const
+{
+	Tap tap;
+	makeTap(firstPatchX + x, firstPatchZ + z, width, height, tap);
+	for (int i = 0; i < 4; i++)
+	{
+		corners[i] = heights[tap.corners[i]];
+	}
+}
+
+// Along the ray the bilinear patch is a quadratic in t, the ray is under it from its smallest root in the interval.
+bool HeightfieldQuery::intersectPatch(int x, int z, const XMFLOAT3& origin, const XMFLOAT3& direction, float tEnter, float tExit, float& t) const
+{
+	float corners[4];
+	getCorners(x, z, corners);
+	float a = corners[0];
+	float b = corners[1] - corners[0];
+	float c = corners[2] - corners[0];
+	float d = corners[0] - corners[1] - corners[2] + corners[3];
+
+	// Measured from the entry point, the patch offset by the ray height: A s^2 + B s + C, s from 0 to length.
+	float u = origin.x + direction.x * tEnter - x;
+	float v = origin.z + direction.z * tEnter - z;
+	float y = origin.y + direction.y * tEnter;
+	float length = tExit - tEnter;
+	float quadratic = d * direction.x * direction.z;
+	float linear = b * direction.x + c * direction.z + d * (u * direction.z + v * direction.x) - direction.y;
+	float constant = a + b * u + c * v + d * u * v - y;
+
+	if (constant >= 0.f)
+	{
+		t = tEnter;
+		return true;
+	}
+
+	float root = FLT_MAX;
+	if (fabsf(quadratic) < 1e-12f)
+	{
+		if (linear > 0.f)
+		{
+			root = -constant / linear;
+		}
+	}
+	else
+	{
+		float discriminant = linear * linear - 4.f * quadratic * constant;
+		if (discriminant >= 0.f)
+		{
+			// The stable pair of roots, q / A and C / q.
+			float q = -0.5f * (linear + (linear < 0.f ? -sqrtf(discriminant) : sqrtf(discriminant)));
+			float first = q / quadratic;
+			float second = q != 0.f ? constant / q : FLT_MAX;
+			root = first >= 0.f && first < root ? first : root;
+			root = second >= 0.f && second < root ? second : root;
+		}
+	}
+
+	if (root <= length)
+	{
+		t = tEnter + root;
+		return true;
+	}
+
+	// Rounding can lose a root at the upper edge while the ray already ends under the patch.
+	float exitHeight = quadratic * length * length + linear * length + constant;
+	if (exitHeight >= 0.f)
+	{
+		t = tExit;
+		return true;
+	}
+	return false;
+}
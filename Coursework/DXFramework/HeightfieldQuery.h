@@ -0,0 +1,84 @@
+/**
+* \class Heightfield Query
+*
+* \brief CPU heights, normals and ray intersections of a terrain, as the terrain shaders displace and light it
+*
+* Built from the baked surface texels the landscape vertex shader samples, so heights and normals are the half floats the GPU reads,
+* filtered the way a linear wrapping sampler does: texel centres at (i + 0.5) / width, bilinear weights, normals renormalised.
+* The GPU filters with fixed point weights, answers differ from the rendered vertices by at most a few thousandths of the local slope.
+* Batched queries run four points at a time with SSE and give the same bits as the single ones.
+* Rays are intersected with the bilinear patch between four texel centres, found through a min/max pyramid over the patches of the terrain square,
+* nearest patches first. Everything is in terrain object space, x and z from 0 to size.
+*/
+
+
+#ifndef _HEIGHTFIELDQUERY_H_
+#define _HEIGHTFIELDQUERY_H_
+
+#include "Heightfield.h"
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+class HeightfieldQuery
+{
+public:
+	/// Nearest intersection of a ray with the terrain.
+	struct Hit
+	{
+		float distance = 0.f;	///< along the ray, in lengths of its direction
+		XMFLOAT3 position = XMFLOAT3(0.f, 0.f, 0.f);
+		XMFLOAT3 normal = XMFLOAT3(0.f, 1.f, 0.f);
+		int patchesTested = 0;	///< bilinear patches solved on the way, the rest were skipped by their bounds
+	};
+
+	HeightfieldQuery();
+
+	/** \brief Copies the heights and normals of the texels and builds the pyramid
+	* @param uvPerUnit is the heightmap uv per object space unit, as the shader's
+	* @param size is the side of the terrain square rays are tested against, samples outside it wrap as the texture does
+	*/
+	void build(const Heightfield::SurfaceTexel* texels, int width, int height, float uvPerUnit, float size);
+	bool isEmpty() const { return heights.empty(); }
+
+	/// Object space height at (x, z).
+	float getHeight(float x, float z) const;
+	/// Unit normal at (x, z).
+	XMFLOAT3 getNormal(float x, float z) const;
+	/// Heights of count points, x and z in each.
+	void getHeights(const XMFLOAT2* points, int count, float* heights) const;
+	void getNormals(const XMFLOAT2* points, int count, XMFLOAT3* normals) const;
+
+	/** \brief Nearest point of the terrain square along the ray
+	* @param direction need not be unit length, maxDistance and the hit distance are measured in its lengths
+	* The terrain is solid, a ray starting under it hits at once and one entering the square under it hits at the edge.
+	*/
+	bool raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, Hit& hit) const;
+	/// First point of the terrain between from and to, the hit distance is 0 at from and 1 at to.
+	bool intersectSegment(const XMFLOAT3& from, const XMFLOAT3& to, Hit& hit) const;
+
+	/// Lowest and highest point of the terrain square.
+	float getMinHeight() const;
+	float getMaxHeight() const;
+
+private:
+	/// Texel coordinates of an object space point, texel centres on integers.
+	float toTexelX(float x) const { return x * texelsPerUnitX - 0.5f; }
+	float toTexelZ(float z) const { return z * texelsPerUnitZ - 0.5f; }
+	/// Heights of the corners of patch (x, z), counted from the first patch of the square.
+	void getCorners(int x, int z, float corners[4]) const;
+	bool intersectPatch(int x, int z, const XMFLOAT3& origin, const XMFLOAT3& direction, float tEnter, float tExit, float& t) const;
+
+	std::vector<float> heights;				///< object space, row major
+	std::vector<XMFLOAT3> normals;			///< as baked, not renormalised
+	int width;
+	int height;
+	float texelsPerUnitX;
+	float texelsPerUnitZ;
+	int firstPatchX, firstPatchZ;			///< patch of the origin of the square, patch i spans texel centres i and i + 1
+	int patchCountX, patchCountZ;
+	std::vector<std::vector<XMFLOAT2>> levels;	///< min and max of 2^level x 2^level patches, level 0 the patches themselves
+};
+
+#endif
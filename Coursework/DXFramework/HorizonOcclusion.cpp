@@ -0,0 +1,334 @@
+// Horizon occlusion
+// Line sweeps of a heightfield in several directions, each point's horizon found on a stack of the convex hull behind it.
+#include "horizonocclusion.h"
+#include "threadpool.h"
+#include "meshcache.h"
+#include "mappedfile.h"
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace
+{
+	const char k_Magic[4] = { 'H', 'F', 'A', 'O' };
+	// Bump whenever the bake changes, older bakes are then redone.
+	const unsigned int k_Version = 1;
+	// Lines per job at least, smaller maps are not worth the thread start up.
+	const int k_MinLinesPerJob = 64;
+	// Horizon of the first point of a line, below any surface slope so it occludes nothing.
+	const float k_NoHorizon = -1e6f;
+
+	struct Header
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned long long key;
+		unsigned int width;
+		unsigned int height;
+	};
+
+	// One direction of the bake. The map is seen as minor rows of major samples, line c crosses major sample a at minor c + a * slope,
+	// with |slope| at most 1 so every texel is nearest to the line of exactly one c. The offsets along a line are the same for every line.
+	struct Sweep
+	{
+		const float* heights;		// minorCount rows of majorCount heights in texels
+		float* sums;				// occlusion sums laid out as the heights
+		int majorCount;
+		int minorCount;
+		float step;					// texels travelled per major sample
+		bool forward;				// lines are walked with a increasing, against the direction
+		std::vector<int> nearest;	// minor offset of the texel nearest to the line at a, monotonic in a
+		std::vector<int> below;		// minor offset of the row under the line at a
+		std::vector<float> weight;	// of the row above
+	};
+
+	struct LineBuffers
+	{
+		std::vector<float> profile;
+		std::vector<float> horizon;
+		std::vector<float> tangent;
+		std::vector<int> texels;
+		std::vector<int> hull;
+
+		explicit LineBuffers(int length) : profile(length), horizon(length), tangent(length), texels(length), hull(length) {}
+	};
+
+	// Sine of an elevation given by its tangent, four at a time.
+	inline __m128 sineOf(__m128 tangent)
+	{
+		return _mm_div_ps(tangent, _mm_sqrt_ps(_mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(tangent, tangent))));
+	}
+
+	// Adds the occlusion of line c to the sums of its texels.
+	void sweepLine(const Sweep& sweep, int c, LineBuffers& buffers)
+	{
+		// The samples whose nearest texel is on the map, a single run as the offsets are monotonic.
+		const int* nearestBegin = sweep.nearest.data();
+		const int* nearestEnd = nearestBegin + sweep.majorCount;
+		int first, end;
+		if (sweep.nearest.back() >= sweep.nearest.front())
+		{
+			first = (int)(std::lower_bound(nearestBegin, nearestEnd, -c) - nearestBegin);
+			end = (int)(std::upper_bound(nearestBegin, nearestEnd, sweep.minorCount - 1 - c) - nearestBegin);
+		}
+		else
+		{
+			first = (int)(std::lower_bound(nearestBegin, nearestEnd, sweep.minorCount - 1 - c, std::greater<int>()) - nearestBegin);
+			end = (int)(std::upper_bound(nearestBegin, nearestEnd, -c, std::greater<int>()) - nearestBegin);
+		}
+
+		int count = end - first;
+		if (count <= 0)
+			return;
+
+		// The heights along the line, linear between the two rows it passes and clamped at the edges.
+		for (int i = 0; i < count; i++)
+		{
+			int a = sweep.forward ? first + i : end - 1 - i;
+			int row = c + sweep.below[a];
+			int lowRow = row < 0 ? 0 : row;
+			int highRow = row + 1 >= sweep.minorCount ? sweep.minorCount - 1 : row + 1;
+			float low = sweep.heights[(size_t)lowRow * sweep.majorCount + a];
+			float high = sweep.heights[(size_t)highRow * sweep.majorCount + a];
+			buffers.profile[i] = low + sweep.weight[a] * (high - low);
+			buffers.texels[i] = (c + sweep.nearest[a]) * sweep.majorCount + a;
+		}
+
+		// Points walked before are further along the direction, the hull of them holds the one with the steepest rise.
+		const float* profile = buffers.profile.data();
+		int* hull = buffers.hull.data();
+		int top = -1;
+		for (int i = 0; i < count; i++)
+		{
+			float height = profile[i];
+			while (top >= 1)
+			{
+				int previous = hull[top - 1];
+				int last = hull[top];
+				// The last point sits on or under the line from the previous one, it can no longer be anyone's horizon.
+				if ((profile[previous] - height) * (float)(i - last) >= (profile[last] - height) * (float)(i - previous))
+					top--;
+				else
+					break;
+			}
+
+			buffers.horizon[i] = top >= 0 ? (profile[hull[top]] - height) / ((i - hull[top]) * sweep.step) : k_NoHorizon;
+			hull[++top] = i;
+		}
+
+		// Rise of the surface along the direction, central differences of the profile.
+		float* tangent = buffers.tangent.data();
+		if (count == 1)
+		{
+			tangent[0] = 0.f;
+		}
+		else
+		{
+			tangent[0] = (profile[0] - profile[1]) / sweep.step;
+			for (int i = 1; i < count - 1; i++)
+				tangent[i] = (profile[i - 1] - profile[i + 1]) / (2.f * sweep.step);
+			tangent[count - 1] = (profile[count - 2] - profile[count - 1]) / sweep.step;
+		}
+
+		// Occlusion is the sine of the horizon above the sine of the slope, none where the horizon is lower.
+		float* horizon = buffers.horizon.data();
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 occlusion = _mm_max_ps(_mm_sub_ps(sineOf(_mm_loadu_ps(horizon + i)), sineOf(_mm_loadu_ps(tangent + i))), _mm_setzero_ps());
+			_mm_storeu_ps(horizon + i, occlusion);
+		}
+		for (; i < count; i++)
+		{
+			__m128 occlusion = _mm_max_ss(_mm_sub_ss(sineOf(_mm_set_ss(horizon[i])), sineOf(_mm_set_ss(tangent[i]))), _mm_setzero_ps());
+			horizon[i] = _mm_cvtss_f32(occlusion);
+		}
+
+		for (i = 0; i < count; i++)
+			sweep.sums[buffers.texels[i]] += horizon[i];
+	}
+}
+
+// Directions one after the other, the lines of each split into bands between threads.
+void HorizonOcclusion::bake(const Heightfield& heightfield, const Settings& settings, std::vector<unsigned char>& visibility, unsigned int maxThreads)
+{
+	const int width = heightfield.getWidth();
+	const int height = heightfield.getHeight();
+	visibility.assign((size_t)width * height, 255);
+	if (heightfield.isEmpty() || settings.directions < 1)
+	{
+		return;
+	}
+
+	// Heights in texels so slopes need no scaling, and a transposed copy for the lines closer to z.
+	const float* source = heightfield.getHeights();
+	const float scale = settings.heightScale / settings.texelSize;
+	std::vector<float> heights((size_t)width * height);
+	std::vector<float> transposed((size_t)width * height);
+	for (int z = 0; z < height; z++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			float scaled = source[(size_t)z * width + x] * scale;
+			heights[(size_t)z * width + x] = scaled;
+			transposed[(size_t)x * height + z] = scaled;
+		}
+	}
+
+	// Lines closer to z add into a transposed sum too, so every line writes along a row.
+	std::vector<float> sums((size_t)width * height, 0.f);
+	std::vector<float> transposedSums((size_t)width * height, 0.f);
+	const int longest = width > height ? width : height;
+	size_t threads = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+	threads = threads < 1 ? 1 : threads;
+
+	for (int direction = 0; direction < settings.directions; direction++)
+	{
+		// Half a step off the axes, so no line runs exactly along a row.
+		float angle = 6.28318531f * (direction + 0.5f) / settings.directions;
+		float dx = cosf(angle);
+		float dz = sinf(angle);
+		bool alongX = fabsf(dx) >= fabsf(dz);
+		float major = alongX ? dx : dz;
+		float slope = alongX ? dz / dx : dx / dz;
+
+		Sweep sweep;
+		sweep.heights = alongX ? heights.data() : transposed.data();
+		sweep.sums = alongX ? sums.data() : transposedSums.data();
+		sweep.majorCount = alongX ? width : height;
+		sweep.minorCount = alongX ? height : width;
+		sweep.step = 1.f / fabsf(major);
+		sweep.forward = major < 0.f;
+		sweep.nearest.resize(sweep.majorCount);
+		sweep.below.resize(sweep.majorCount);
+		sweep.weight.resize(sweep.majorCount);
+		for (int a = 0; a < sweep.majorCount; a++)
+		{
+			float offset = a * slope;
+			float below = floorf(offset);
+			sweep.nearest[a] = (int)floorf(offset + 0.5f);
+			sweep.below[a] = (int)below;
+			sweep.weight[a] = offset - below;
+		}
+
+		// Every line reaching the map.
+		int firstLine = -(sweep.nearest.back() > 0 ? sweep.nearest.back() : 0);
+		int lastLine = sweep.minorCount - 1 - (sweep.nearest.back() < 0 ? sweep.nearest.back() : 0);
+		int lineCount = lastLine - firstLine + 1;
+
+		size_t maxJobs = (size_t)(lineCount + k_MinLinesPerJob - 1) / k_MinLinesPerJob;
+		size_t jobCount = threads > maxJobs ? maxJobs : threads;
+		jobCount = jobCount < 1 ? 1 : jobCount;
+		int linesPerJob = (int)((lineCount + jobCount - 1) / jobCount);
+
+		ThreadPool::shared().runParallel(jobCount, [&](size_t job)
+		{
+			LineBuffers buffers(longest);
+			int first = firstLine + (int)job * linesPerJob;
+			int last = first + linesPerJob - 1 < lastLine ? first + linesPerJob - 1 : lastLine;
+			for (int c = first; c <= last; c++)
+				sweepLine(sweep, c, buffers);
+		});
+	}
+
+	for (int z = 0; z < height; z++)
+	{
+		for (int x = 0; x < width; x++)
+			sums[(size_t)z * width + x] += transposedSums[(size_t)x * height + z];
+	}
+
+	const float average = 1.f / settings.directions;
+	for (size_t i = 0; i < sums.size(); i++)
+	{
+		float visible = 1.f - sums[i] * average;
+		visible = visible < 0.f ? 0.f : visible;
+		visibility[i] = (unsigned char)(visible * 255.f + 0.5f);
+	}
+}
+
+unsigned long long HorizonOcclusion::getKey(const Heightfield& heightfield, const Settings& settings)
+{
+	int width = heightfield.getWidth();
+	unsigned long long key = MeshCache::hashData(heightfield.getHeights(), (size_t)width * heightfield.getHeight() * sizeof(float));
+	key = MeshCache::hashData(&width, sizeof(width), key);
+	key = MeshCache::hashData(&settings.directions, sizeof(settings.directions), key);
+	key = MeshCache::hashData(&settings.heightScale, sizeof(settings.heightScale), key);
+	key = MeshCache::hashData(&settings.texelSize, sizeof(settings.texelSize), key);
+	return MeshCache::hashData(&k_Version, sizeof(k_Version), key);
+}
+
+bool HorizonOcclusion::load(const char* cacheFile, unsigned long long key, int width, int height, std::vector<unsigned char>& visibility)
+{
+	MappedFile file;
+	if (!file.open(cacheFile) || file.getSize() < sizeof(Header))
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, file.getData(), sizeof(Header));
+	size_t texelCount = (size_t)width * height;
+	if (memcmp(header.magic, k_Magic, sizeof(k_Magic)) != 0 || header.version != k_Version || header.key != key
+		|| header.width != (unsigned int)width || header.height != (unsigned int)height || file.getSize() < sizeof(Header) + texelCount)
+	{
+		return false;
+	}
+
+	visibility.resize(texelCount);
+	memcpy(visibility.data(), file.getData() + sizeof(Header), texelCount);
+	return true;
+}
+
+bool HorizonOcclusion::save(const char* cacheFile, unsigned long long key, int width, int height, const std::vector<unsigned char>& visibility)
+{
+	if (visibility.size() != (size_t)width * height)
+	{
+		return false;
+	}
+
+	std::ofstream file(cacheFile, std::ofstream::binary | std::ofstream::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(header.magic, k_Magic, sizeof(k_Magic));
+	header.version = k_Version;
+	header.key = key;
+	header.width = (unsigned int)width;
+	header.height = (unsigned int)height;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(visibility.data()), visibility.size());
+	return file.good();
+}
+
+ID3D11ShaderResourceView* HorizonOcclusion::createTexture(ID3D11Device* device, const unsigned char* visibility, int width, int height)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = (UINT)width;
+	desc.Height = (UINT)height;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA data = { visibility, (UINT)width, 0 };
+	ID3D11Texture2D* texture = 0;
+	ID3D11ShaderResourceView* view = 0;
+	if (FAILED(device->CreateTexture2D(&desc, &data, &texture)))
+	{
+		return 0;
+	}
+
+	// The view keeps the texture alive.
+	device->CreateShaderResourceView(texture, NULL, &view);
+	texture->Release();
+	return view;
+}
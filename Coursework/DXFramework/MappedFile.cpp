@@ -0,0 +1,77 @@
+// Mapped file
+// Read only memory mapping of a file, used by the model loaders.
+#include "mappedfile.h"
+
+MappedFile::MappedFile()
+{
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+	data = nullptr;
+	size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+// Open the file and map all of it as a read only view.
+bool MappedFile::open(const char* filename)
+{
+	close();
+
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		// Empty files can not be mapped.
+		close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		close();
+		return false;
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+// Release the view and both handles.
+void MappedFile::close()
+{
+	if (data)
+	{
+		UnmapViewOfFile(data);
+		data = nullptr;
+	}
+
+	if (mapping)
+	{
+		CloseHandle(mapping);
+		mapping = NULL;
+	}
+
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+
+	size = 0;
+}
@@ -0,0 +1,186 @@
+// Mesh cache
+// Reads and writes baked binary meshes next to their source models.
+#include "meshcache.h"
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const char k_Magic[4] = { 'M', 'S', 'H', 'C' };
+	// Bump whenever the layout or the baking of the meshes changes, older files are then rebuilt.
+	const unsigned int k_Version = 5;
+	// Streams start on 16 byte boundaries inside the file.
+	const unsigned int k_StreamAlignment = 16;
+
+	struct Header
+	{
+		char magic[4];
+		unsigned int version;
+		unsigned long long sourceHash;
+		unsigned int vertexCount;
+		unsigned int vertexStride;
+		unsigned int indexCount;
+		unsigned int indexSize;
+		unsigned int submeshCount;
+		unsigned int lodCount;
+		unsigned int meshletCount;
+		unsigned int sourceVertexCount;
+		float acmrBefore, acmrAfter;
+		float atvrBefore, atvrAfter;
+		float boundsMin[3];
+		float boundsMax[3];
+		unsigned int vertexOffset;		// byte offsets from the start of the file
+		unsigned int indexOffset;
+	};
+
+	unsigned int align(unsigned int offset)
+	{
+		return (offset + k_StreamAlignment - 1) & ~(k_StreamAlignment - 1);
+	}
+}
+
+unsigned long long MeshCache::hashData(const void* data, size_t size, unsigned long long hash)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string MeshCache::getCachePath(const char* sourceFile, const char* tag)
+{
+	return std::string(sourceFile) + "." + tag + ".cache";
+}
+
+unsigned long long MeshCache::hashSource(const char* sourceFile, unsigned int importerFlags)
+{
+	MappedFile file;
+	if (!file.open(sourceFile))
+	{
+		return 0;
+	}
+
+	unsigned long long hash = hashData(file.getData(), file.getSize());
+	hash = hashData(&importerFlags, sizeof(importerFlags), hash);
+	hash = hashData(&k_Version, sizeof(k_Version), hash);
+	return hash;
+}
+
+bool MeshCache::load(const char* cacheFile, unsigned long long sourceHash, MappedFile& file, MeshData& mesh)
+{
+	if (sourceHash == 0 || !file.open(cacheFile) || file.getSize() < sizeof(Header))
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, file.getData(), sizeof(Header));
+
+	if (memcmp(header.magic, k_Magic, sizeof(k_Magic)) != 0 || header.version != k_Version || header.sourceHash != sourceHash
+		|| (header.indexSize != 2 && header.indexSize != 4))
+	{
+		file.close();
+		return false;
+	}
+
+	// Reject truncated files before handing out pointers into them.
+	size_t submeshEnd = sizeof(Header) + (size_t)header.submeshCount * sizeof(Submesh);
+	size_t lodEnd = submeshEnd + (size_t)header.lodCount * sizeof(Lod);
+	size_t meshletEnd = lodEnd + (size_t)header.meshletCount * sizeof(Meshlets::Meshlet);
+	size_t vertexEnd = (size_t)header.vertexOffset + (size_t)header.vertexCount * header.vertexStride;
+	size_t indexEnd = (size_t)header.indexOffset + (size_t)header.indexCount * header.indexSize;
+	if (meshletEnd > header.vertexOffset || vertexEnd > header.indexOffset || indexEnd > file.getSize())
+	{
+		file.close();
+		return false;
+	}
+
+	mesh.submeshes = reinterpret_cast<const Submesh*>(file.getData() + sizeof(Header));
+	mesh.lods = reinterpret_cast<const Lod*>(file.getData() + submeshEnd);
+	mesh.meshlets = reinterpret_cast<const Meshlets::Meshlet*>(file.getData() + lodEnd);
+	mesh.vertices = file.getData() + header.vertexOffset;
+	mesh.indices = file.getData() + header.indexOffset;
+	mesh.vertexCount = (int)header.vertexCount;
+	mesh.vertexStride = (int)header.vertexStride;
+	mesh.indexCount = (int)header.indexCount;
+	mesh.indexSize = (int)header.indexSize;
+	mesh.submeshCount = (int)header.submeshCount;
+	mesh.lodCount = (int)header.lodCount;
+	mesh.meshletCount = (int)header.meshletCount;
+	mesh.sourceVertexCount = (int)header.sourceVertexCount;
+	mesh.optimiseStats.before.acmr = header.acmrBefore;
+	mesh.optimiseStats.before.atvr = header.atvrBefore;
+	mesh.optimiseStats.after.acmr = header.acmrAfter;
+	mesh.optimiseStats.after.atvr = header.atvrAfter;
+	mesh.boundsMin = XMFLOAT3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	mesh.boundsMax = XMFLOAT3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	return true;
+}
+
+bool MeshCache::save(const char* cacheFile, unsigned long long sourceHash, MeshData& mesh)
+{
+	if (sourceHash == 0 || mesh.vertexCount <= 0 || mesh.vertexStride < (int)sizeof(XMFLOAT3))
+	{
+		return false;
+	}
+
+	// Bounds of the positions, the first member of every vertex type.
+	const char* vertices = static_cast<const char*>(mesh.vertices);
+	XMVECTOR boundsMin = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(vertices));
+	XMVECTOR boundsMax = boundsMin;
+	for (int i = 1; i < mesh.vertexCount; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(vertices + (size_t)i * mesh.vertexStride));
+		boundsMin = XMVectorMin(boundsMin, position);
+		boundsMax = XMVectorMax(boundsMax, position);
+	}
+	XMStoreFloat3(&mesh.boundsMin, boundsMin);
+	XMStoreFloat3(&mesh.boundsMax, boundsMax);
+
+	Header header;
+	memcpy(header.magic, k_Magic, sizeof(k_Magic));
+	header.version = k_Version;
+	header.sourceHash = sourceHash;
+	header.vertexCount = (unsigned int)mesh.vertexCount;
+	header.vertexStride = (unsigned int)mesh.vertexStride;
+	header.indexCount = (unsigned int)mesh.indexCount;
+	header.indexSize = (unsigned int)mesh.indexSize;
+	header.submeshCount = (unsigned int)mesh.submeshCount;
+	header.lodCount = (unsigned int)mesh.lodCount;
+	header.meshletCount = (unsigned int)mesh.meshletCount;
+	header.sourceVertexCount = (unsigned int)mesh.sourceVertexCount;
+	header.acmrBefore = mesh.optimiseStats.before.acmr;
+	header.atvrBefore = mesh.optimiseStats.before.atvr;
+	header.acmrAfter = mesh.optimiseStats.after.acmr;
+	header.atvrAfter = mesh.optimiseStats.after.atvr;
+	header.boundsMin[0] = mesh.boundsMin.x;
+	header.boundsMin[1] = mesh.boundsMin.y;
+	header.boundsMin[2] = mesh.boundsMin.z;
+	header.boundsMax[0] = mesh.boundsMax.x;
+	header.boundsMax[1] = mesh.boundsMax.y;
+	header.boundsMax[2] = mesh.boundsMax.z;
+	unsigned int tablesEnd = (unsigned int)(sizeof(Header) + header.submeshCount * sizeof(Submesh) + header.lodCount * sizeof(Lod)
+		+ header.meshletCount * sizeof(Meshlets::Meshlet));
+	header.vertexOffset = align(tablesEnd);
+	header.indexOffset = align(header.vertexOffset + header.vertexCount * header.vertexStride);
+
+	std::ofstream file(cacheFile, std::ofstream::binary | std::ofstream::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	const char padding[k_StreamAlignment] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(mesh.submeshes), header.submeshCount * sizeof(Submesh));
+	file.write(reinterpret_cast<const char*>(mesh.lods), header.lodCount * sizeof(Lod));
+	file.write(reinterpret_cast<const char*>(mesh.meshlets), header.meshletCount * sizeof(Meshlets::Meshlet));
+	file.write(padding, header.vertexOffset - tablesEnd);
+	file.write(vertices, (size_t)header.vertexCount * header.vertexStride);
+	file.write(padding, header.indexOffset - (header.vertexOffset + header.vertexCount * header.vertexStride));
+	file.write(static_cast<const char*>(mesh.indices), (size_t)header.indexCount * header.indexSize);
+	return file.good();
+}
@@ -0,0 +1,899 @@
+// Mesh utilities
+// Geometry processing helpers shared by the mesh classes.
+#include "meshutils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	// FNV-1a over the raw vertex bytes.
+	unsigned int hashBytes(const unsigned char* data, int size)
+	{
+		unsigned int hash = 2166136261u;
+		for (int i = 0; i < size; i++)
+		{
+			hash ^= data[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Vertex to triangle adjacency in compressed rows.
+	struct Adjacency
+	{
+		std::vector<int> offsets;		// first entry of every vertex, vertexCount + 1 entries
+		std::vector<int> triangles;
+
+		Adjacency(const unsigned long* indices, int indexCount, int vertexCount) : offsets(vertexCount + 1, 0), triangles(indexCount)
+		{
+			for (int i = 0; i < indexCount; i++)
+			{
+				offsets[indices[i] + 1]++;
+			}
+			for (int v = 0; v < vertexCount; v++)
+			{
+				offsets[v + 1] += offsets[v];
+			}
+
+			std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+			for (int i = 0; i < indexCount; i++)
+			{
+				triangles[fill[indices[i]]++] = i / 3;
+			}
+		}
+	};
+
+	// Position of a vertex, the first three floats of it.
+	const float* positionOf(const void* vertices, int stride, unsigned long index)
+	{
+		return reinterpret_cast<const float*>(static_cast<const char*>(vertices) + (size_t)index * stride);
+	}
+
+	// Reusable FIFO cache, entries are stamped with the time they entered so a lookup is a single comparison.
+	struct FifoCache
+	{
+		std::vector<int> entered;
+		int time;
+		int size;
+
+		FifoCache(int vertexCount, int cacheSize) : entered(vertexCount, -cacheSize - 1), time(0), size(cacheSize) {}
+
+		// Returns true on a miss, which also inserts the vertex.
+		bool access(unsigned long vertex)
+		{
+			if (time - entered[vertex] < size)
+			{
+				return false;
+			}
+			entered[vertex] = time++;
+			return true;
+		}
+
+		void flush()
+		{
+			time += size;
+		}
+	};
+
+	// Symmetric plane quadric, the area weighted sum of squared distances to a set of planes (Garland and Heckbert 1997).
+	struct Quadric
+	{
+		double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+		double b0 = 0, b1 = 0, b2 = 0, c = 0;
+		double weight = 0;
+
+		// Plane n.p + d = 0, n normalised.
+		void addPlane(double nx, double ny, double nz, double d, double w)
+		{
+			a00 += w * nx * nx; a11 += w * ny * ny; a22 += w * nz * nz;
+			a01 += w * nx * ny; a02 += w * nx * nz; a12 += w * ny * nz;
+			b0 += w * nx * d; b1 += w * ny * d; b2 += w * nz * d;
+			c += w * d * d;
+			weight += w;
+		}
+
+		void add(const Quadric& other)
+		{
+			a00 += other.a00; a11 += other.a11; a22 += other.a22;
+			a01 += other.a01; a02 += other.a02; a12 += other.a12;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		// Weighted mean squared distance of the point to the planes.
+		double evaluate(const float* p) const
+		{
+			double x = p[0], y = p[1], z = p[2];
+			double error = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2 * (b0 * x + b1 * y + b2 * z) + c;
+			return weight > 0 && error > 0 ? error / weight : 0;
+		}
+	};
+
+	// How a position may move during simplification.
+	enum VertexKind
+	{
+		Kind_Manifold,		// interior, one wedge, moves anywhere
+		Kind_Border,		// on a single open border, moves along it
+		Kind_Seam,			// two wedges meeting on an attribute seam, moves along it with both wedges
+		Kind_Locked			// anything more complex
+	};
+
+	unsigned long long edgeKey(unsigned long a, unsigned long b)
+	{
+		return ((unsigned long long)a << 32) | b;
+	}
+
+	// Records the single open edge partner of a vertex, -2 once there is more than one.
+	void setOpenPartner(std::vector<long>& partner, unsigned long vertex, unsigned long other)
+	{
+		partner[vertex] = partner[vertex] == -1 ? (long)other : -2;
+	}
+
+	void triangleNormal(const float* p0, const float* p1, const float* p2, float* normal)
+	{
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+}
+
+size_t MeshUtils::WeldStats::sourceBytes() const
+{
+	return (size_t)sourceVertexCount * vertexStride + (size_t)indexCount * sizeof(unsigned long);
+}
+
+size_t MeshUtils::WeldStats::weldedBytes() const
+{
+	size_t indexSize = shortIndices ? sizeof(unsigned short) : sizeof(unsigned long);
+	return (size_t)weldedVertexCount * vertexStride + (size_t)indexCount * indexSize;
+}
+
+// Open addressing hash table keyed on the vertex bytes. The table stores welded indices, so candidates are
+// compared against the output array, which only ever trails the input and allows welding in place.
+int MeshUtils::weldVertices(const void* vertices, int vertexCount, int stride, void* weldedVertices, unsigned long* remap)
+{
+	const unsigned char* source = static_cast<const unsigned char*>(vertices);
+	unsigned char* welded = static_cast<unsigned char*>(weldedVertices);
+
+	// Power of two table at most half full.
+	unsigned int tableSize = 16;
+	while (tableSize < (unsigned int)vertexCount * 2)
+	{
+		tableSize *= 2;
+	}
+	std::vector<int> table(tableSize, -1);
+
+	int weldedCount = 0;
+	for (int i = 0; i < vertexCount; i++)
+	{
+		const unsigned char* vertex = source + (size_t)i * stride;
+		unsigned int slot = hashBytes(vertex, stride) & (tableSize - 1);
+
+		// Probe until the vertex or an empty slot is found.
+		while (table[slot] >= 0 && memcmp(welded + (size_t)table[slot] * stride, vertex, stride) != 0)
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] < 0)
+		{
+			table[slot] = weldedCount;
+			if (welded + (size_t)weldedCount * stride != vertex)
+			{
+				memmove(welded + (size_t)weldedCount * stride, vertex, stride);
+			}
+			weldedCount++;
+		}
+
+		remap[i] = (unsigned long)table[slot];
+	}
+
+	return weldedCount;
+}
+
+bool MeshUtils::fitsShortIndices(int vertexCount)
+{
+	// 0xFFFF is left free as it doubles as the strip cut value.
+	return vertexCount < 0xFFFF;
+}
+
+// Band width w keeps the w + 1 vertices of the previous row and the w + 1 of the current one in the cache, every quad
+// then costs one new vertex: an ACMR of (w + 1) / 2w plus the first row of each band.
+int MeshUtils::buildGridIndices(unsigned long* indices, int columns, int rows, unsigned long baseVertex, bool mainDiagonal, int cacheSize, int pitch)
+{
+	int bandWidth = cacheSize > 0 ? cacheSize / 2 - 1 : columns;
+	bandWidth = bandWidth < 1 ? 1 : bandWidth;
+	pitch = pitch > 0 ? pitch : columns + 1;
+	int count = 0;
+
+	for (int bandStart = 0; bandStart < columns; bandStart += bandWidth)
+	{
+		int bandEnd = bandStart + bandWidth < columns ? bandStart + bandWidth : columns;
+		for (int y = 0; y < rows; y++)
+		{
+			for (int x = bandStart; x < bandEnd; x++)
+			{
+				// Corners in row major order, a b on the first row, c d on the next.
+				unsigned long a = baseVertex + (unsigned long)(y * pitch + x);
+				unsigned long b = a + 1;
+				unsigned long c = a + (unsigned long)pitch;
+				unsigned long d = c + 1;
+
+				if (mainDiagonal)
+				{
+					indices[count++] = a; indices[count++] = d; indices[count++] = c;
+					indices[count++] = a; indices[count++] = b; indices[count++] = d;
+				}
+				else
+				{
+					indices[count++] = c; indices[count++] = b; indices[count++] = a;
+					indices[count++] = c; indices[count++] = d; indices[count++] = b;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+int MeshUtils::packIndices(const unsigned long* indices, int count, int vertexCount, std::vector<unsigned char>& packed)
+{
+	if (!fitsShortIndices(vertexCount))
+	{
+		packed.resize((size_t)count * sizeof(unsigned long));
+		memcpy(packed.data(), indices, packed.size());
+		return sizeof(unsigned long);
+	}
+
+	packed.resize((size_t)count * sizeof(unsigned short));
+	unsigned short* shortIndices = reinterpret_cast<unsigned short*>(packed.data());
+	for (int i = 0; i < count; i++)
+	{
+		shortIndices[i] = (unsigned short)indices[i];
+	}
+	return sizeof(unsigned short);
+}
+
+MeshUtils::CacheStats MeshUtils::simulateVertexCache(const unsigned long* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	CacheStats stats;
+	if (indexCount < 3 || vertexCount <= 0)
+	{
+		return stats;
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	int misses = 0;
+	for (int i = 0; i < indexCount; i++)
+	{
+		misses += cache.access(indices[i]) ? 1 : 0;
+	}
+
+	stats.acmr = (float)misses / (indexCount / 3);
+	stats.atvr = (float)misses / vertexCount;
+	return stats;
+}
+
+// Tipsify: fans around the current vertex, then moves to the adjacent vertex that is still in the cache and has the fewest
+// triangles left, falling back to recently used vertices (dead end stack) and finally to the next vertex in input order.
+void MeshUtils::optimiseVertexCache(unsigned long* indices, int indexCount, int vertexCount, int cacheSize)
+{
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	Adjacency adjacency(indices, indexCount, vertexCount);
+	std::vector<int> liveTriangles(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	}
+
+	std::vector<int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<int> deadEnd;
+	std::vector<int> candidates;
+	std::vector<unsigned long> output;
+	output.reserve(indexCount);
+
+	int timeStamp = cacheSize + 1;
+	int cursor = 1;
+	int fanning = 0;
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+
+		// Emit every remaining triangle around the fanning vertex.
+		for (int a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++)
+		{
+			int triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned long vertex = indices[triangle * 3 + c];
+				output.push_back(vertex);
+				deadEnd.push_back((int)vertex);
+				candidates.push_back((int)vertex);
+				liveTriangles[vertex]--;
+
+				if (timeStamp - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = timeStamp++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// Pick the candidate that will still be in the cache after its remaining triangles, oldest first.
+		int best = -1;
+		int bestPriority = -1;
+		for (int vertex : candidates)
+		{
+			if (liveTriangles[vertex] <= 0)
+			{
+				continue;
+			}
+
+			int priority = 0;
+			if (timeStamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+			{
+				priority = timeStamp - cacheTime[vertex];
+			}
+
+			if (priority > bestPriority)
+			{
+				best = vertex;
+				bestPriority = priority;
+			}
+		}
+
+		// Dead end, try the recently used vertices, then scan forward through the input.
+		while (best < 0 && !deadEnd.empty())
+		{
+			int vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[vertex] > 0)
+			{
+				best = vertex;
+			}
+		}
+
+		while (best < 0 && cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+			{
+				best = cursor;
+			}
+			cursor++;
+		}
+
+		fanning = best;
+	}
+
+	memcpy(indices, output.data(), output.size() * sizeof(unsigned long));
+}
+
+// Tipsify's overdraw pass: cache optimised triangles are split into clusters at points where a cold cache costs little,
+// then clusters are sorted by how much they face away from the mesh centre, so likely occluders are drawn first.
+void MeshUtils::optimiseOverdraw(unsigned long* indices, int indexCount, const void* vertices, int vertexCount, int stride, float threshold, int cacheSize)
+{
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	float meshAcmr = simulateVertexCache(indices, indexCount, vertexCount, cacheSize).acmr;
+
+	// Split into clusters, the cache starts cold at every boundary as clusters are drawn in a different order.
+	std::vector<int> clusterStarts;
+	FifoCache cache(vertexCount, cacheSize);
+	int clusterStart = 0;
+	int misses = 0;
+	clusterStarts.push_back(0);
+	for (int t = 0; t < triangleCount; t++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			misses += cache.access(indices[t * 3 + c]) ? 1 : 0;
+		}
+
+		int clusterTriangles = t + 1 - clusterStart;
+		if (t + 1 < triangleCount && (float)misses / clusterTriangles <= meshAcmr * threshold && clusterTriangles >= cacheSize)
+		{
+			clusterStart = t + 1;
+			clusterStarts.push_back(clusterStart);
+			misses = 0;
+			cache.flush();
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+	int clusterCount = (int)clusterStarts.size() - 1;
+
+	// Mesh centroid.
+	float meshCentre[3] = { 0.f, 0.f, 0.f };
+	for (int v = 0; v < vertexCount; v++)
+	{
+		const float* position = positionOf(vertices, stride, v);
+		for (int a = 0; a < 3; a++)
+		{
+			meshCentre[a] += position[a] / vertexCount;
+		}
+	}
+
+	// Area weighted centroid and normal of every cluster, sorted by how far the cluster faces outwards.
+	std::vector<float> sortKey(clusterCount);
+	for (int cluster = 0; cluster < clusterCount; cluster++)
+	{
+		float centre[3] = { 0.f, 0.f, 0.f };
+		float normal[3] = { 0.f, 0.f, 0.f };
+		float area = 0.f;
+
+		for (int t = clusterStarts[cluster]; t < clusterStarts[cluster + 1]; t++)
+		{
+			const float* p0 = positionOf(vertices, stride, indices[t * 3 + 0]);
+			const float* p1 = positionOf(vertices, stride, indices[t * 3 + 1]);
+			const float* p2 = positionOf(vertices, stride, indices[t * 3 + 2]);
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float cross[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float triangleArea = sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+
+			for (int a = 0; a < 3; a++)
+			{
+				centre[a] += (p0[a] + p1[a] + p2[a]) / 3.f * triangleArea;
+				normal[a] += cross[a];
+			}
+			area += triangleArea;
+		}
+
+		float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float key = 0.f;
+		if (area > 0.f && normalLength > 0.f)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				key += (centre[a] / area - meshCentre[a]) * normal[a] / normalLength;
+			}
+		}
+		sortKey[cluster] = key;
+	}
+
+	std::vector<int> order(clusterCount);
+	for (int cluster = 0; cluster < clusterCount; cluster++)
+	{
+		order[cluster] = cluster;
+	}
+	std::stable_sort(order.begin(), order.end(), [&sortKey](int a, int b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<unsigned long> output;
+	output.reserve(indexCount);
+	for (int cluster : order)
+	{
+		output.insert(output.end(), indices + clusterStarts[cluster] * 3, indices + clusterStarts[cluster + 1] * 3);
+	}
+	memcpy(indices, output.data(), output.size() * sizeof(unsigned long));
+}
+
+int MeshUtils::optimiseVertexFetch(void* vertices, int vertexCount, int stride, unsigned long* indices, int indexCount)
+{
+	std::vector<int> remap(vertexCount, -1);
+	int used = 0;
+	for (int i = 0; i < indexCount; i++)
+	{
+		if (remap[indices[i]] < 0)
+		{
+			remap[indices[i]] = used++;
+		}
+		indices[i] = (unsigned long)remap[indices[i]];
+	}
+
+	std::vector<unsigned char> reordered((size_t)used * stride);
+	const unsigned char* source = static_cast<const unsigned char*>(vertices);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] >= 0)
+		{
+			memcpy(&reordered[(size_t)remap[v] * stride], source + (size_t)v * stride, stride);
+		}
+	}
+	memcpy(vertices, reordered.data(), reordered.size());
+	return used;
+}
+
+MeshUtils::OptimiseStats MeshUtils::optimiseMesh(void* vertices, int& vertexCount, int stride, unsigned long* indices, int indexCount)
+{
+	OptimiseStats stats;
+	stats.before = simulateVertexCache(indices, indexCount, vertexCount);
+
+	optimiseVertexCache(indices, indexCount, vertexCount);
+	optimiseOverdraw(indices, indexCount, vertices, vertexCount, stride);
+	vertexCount = optimiseVertexFetch(vertices, vertexCount, stride, indices, indexCount);
+
+	stats.after = simulateVertexCache(indices, indexCount, vertexCount);
+	return stats;
+}
+
+// Greedy passes of independent half edge collapses, cheapest first, until the target or the error limit is reached.
+// Positions shared by several vertices (attribute seams) are grouped, quadrics and topology live on the groups.
+float MeshUtils::simplifyMesh(const void* vertices, int vertexCount, int stride, const unsigned long* indices, int indexCount, std::vector<unsigned long>& result, int targetIndexCount, float targetError)
+{
+	result.assign(indices, indices + indexCount);
+	if (indexCount < 3 || vertexCount <= 0)
+	{
+		return 0.f;
+	}
+
+	// Group vertices with identical positions, every vertex points at the first one of its position.
+	std::vector<unsigned long> group(vertexCount);
+	std::vector<unsigned long> nextWedge(vertexCount);
+	{
+		std::vector<unsigned long> order(vertexCount);
+		for (int v = 0; v < vertexCount; v++)
+		{
+			order[v] = (unsigned long)v;
+		}
+		std::sort(order.begin(), order.end(), [&](unsigned long a, unsigned long b)
+		{
+			const float* pa = positionOf(vertices, stride, a);
+			const float* pb = positionOf(vertices, stride, b);
+			return std::lexicographical_compare(pa, pa + 3, pb, pb + 3) || (memcmp(pa, pb, 3 * sizeof(float)) == 0 && a < b);
+		});
+
+		for (int i = 0; i < vertexCount;)
+		{
+			int end = i + 1;
+			while (end < vertexCount && memcmp(positionOf(vertices, stride, order[i]), positionOf(vertices, stride, order[end]), 3 * sizeof(float)) == 0)
+			{
+				end++;
+			}
+			for (int j = i; j < end; j++)
+			{
+				group[order[j]] = order[i];
+				nextWedge[order[j]] = order[j + 1 < end ? j + 1 : i];
+			}
+			i = end;
+		}
+	}
+
+	// Triangle planes, plus planes through open edges perpendicular to their triangle so borders keep their shape.
+	std::vector<Quadric> quadrics(vertexCount);
+	{
+		std::unordered_map<unsigned long long, int> groupEdges;
+		for (int i = 0; i < indexCount; i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				groupEdges[edgeKey(group[indices[i + e]], group[indices[i + (e + 1) % 3]])]++;
+			}
+		}
+
+		for (int i = 0; i < indexCount; i += 3)
+		{
+			const float* p[3] = { positionOf(vertices, stride, indices[i]), positionOf(vertices, stride, indices[i + 1]), positionOf(vertices, stride, indices[i + 2]) };
+			float normal[3];
+			triangleNormal(p[0], p[1], p[2], normal);
+			double length = std::sqrt((double)normal[0] * normal[0] + (double)normal[1] * normal[1] + (double)normal[2] * normal[2]);
+			if (length <= 0)
+			{
+				continue;
+			}
+
+			double n[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+			double d = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+			for (int e = 0; e < 3; e++)
+			{
+				quadrics[group[indices[i + e]]].addPlane(n[0], n[1], n[2], d, length * 0.5);
+			}
+
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned long a = group[indices[i + e]], b = group[indices[i + (e + 1) % 3]];
+				if (groupEdges.count(edgeKey(b, a)))
+				{
+					continue;
+				}
+
+				const float* pa = p[e];
+				const float* pb = p[(e + 1) % 3];
+				double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+				double edgeLengthSq = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+				double side[3] = { edge[1] * n[2] - edge[2] * n[1], edge[2] * n[0] - edge[0] * n[2], edge[0] * n[1] - edge[1] * n[0] };
+				double sideLength = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+				if (sideLength <= 0)
+				{
+					continue;
+				}
+
+				side[0] /= sideLength; side[1] /= sideLength; side[2] /= sideLength;
+				double sideD = -(side[0] * pa[0] + side[1] * pa[1] + side[2] * pa[2]);
+				quadrics[a].addPlane(side[0], side[1], side[2], sideD, edgeLengthSq);
+				quadrics[b].addPlane(side[0], side[1], side[2], sideD, edgeLengthSq);
+			}
+		}
+	}
+
+	struct Collapse
+	{
+		unsigned long from;
+		unsigned long to;
+		float error;
+	};
+
+	float resultError = 0.f;
+	std::vector<unsigned long> remap(vertexCount);
+	std::vector<long> openOut(vertexCount), openIn(vertexCount), groupOpenOut(vertexCount), groupOpenIn(vertexCount);
+	std::vector<int> wedges(vertexCount);
+	std::vector<unsigned char> kind(vertexCount), locked(vertexCount);
+	std::vector<unsigned long> groupIndices;
+	std::vector<Collapse> collapses;
+
+	while ((int)result.size() > targetIndexCount)
+	{
+		int currentCount = (int)result.size();
+
+		// Classify the positions on the current topology.
+		std::unordered_map<unsigned long long, int> edges, groupEdges;
+		edges.reserve(currentCount * 2);
+		groupEdges.reserve(currentCount * 2);
+		for (int i = 0; i < currentCount; i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned long a = result[i + e], b = result[i + (e + 1) % 3];
+				edges[edgeKey(a, b)]++;
+				groupEdges[edgeKey(group[a], group[b])]++;
+			}
+		}
+
+		std::fill(openOut.begin(), openOut.end(), -1);
+		std::fill(openIn.begin(), openIn.end(), -1);
+		std::fill(groupOpenOut.begin(), groupOpenOut.end(), -1);
+		std::fill(groupOpenIn.begin(), groupOpenIn.end(), -1);
+		std::fill(wedges.begin(), wedges.end(), 0);
+		std::fill(locked.begin(), locked.end(), 0);
+		std::vector<unsigned char> used(vertexCount, 0);
+		for (int i = 0; i < currentCount; i++)
+		{
+			if (!used[result[i]])
+			{
+				used[result[i]] = 1;
+				wedges[group[result[i]]]++;
+			}
+		}
+
+		for (auto& it : edges)
+		{
+			unsigned long a = (unsigned long)(it.first >> 32), b = (unsigned long)(it.first & 0xFFFFFFFFull);
+			if (!edges.count(edgeKey(b, a)))
+			{
+				setOpenPartner(openOut, a, b);
+				setOpenPartner(openIn, b, a);
+			}
+		}
+		for (auto& it : groupEdges)
+		{
+			unsigned long a = (unsigned long)(it.first >> 32), b = (unsigned long)(it.first & 0xFFFFFFFFull);
+			if (it.second > 1)
+			{
+				// Non manifold edge.
+				locked[a] = locked[b] = 1;
+			}
+			else if (!groupEdges.count(edgeKey(b, a)))
+			{
+				setOpenPartner(groupOpenOut, a, b);
+				setOpenPartner(groupOpenIn, b, a);
+			}
+		}
+
+		for (int v = 0; v < vertexCount; v++)
+		{
+			if (group[v] != (unsigned long)v || !wedges[v])
+			{
+				continue;
+			}
+
+			bool groupClosed = groupOpenOut[v] == -1 && groupOpenIn[v] == -1;
+			bool groupBorder = groupOpenOut[v] >= 0 && groupOpenIn[v] >= 0;
+			if (locked[v])
+			{
+				kind[v] = Kind_Locked;
+			}
+			else if (wedges[v] == 1)
+			{
+				kind[v] = groupClosed ? Kind_Manifold : (groupBorder ? Kind_Border : Kind_Locked);
+			}
+			else if (wedges[v] == 2 && groupClosed)
+			{
+				// Both wedges must run along the seam as a single open edge loop each.
+				kind[v] = Kind_Seam;
+				unsigned long w = (unsigned long)v;
+				do
+				{
+					if (used[w] && (openOut[w] < 0 || openIn[w] < 0))
+					{
+						kind[v] = Kind_Locked;
+					}
+					w = nextWedge[w];
+				} while (w != (unsigned long)v);
+			}
+			else
+			{
+				kind[v] = Kind_Locked;
+			}
+		}
+		std::fill(locked.begin(), locked.end(), 0);
+
+		// Every edge gives two candidate collapses, one onto each end.
+		collapses.clear();
+		for (int i = 0; i < currentCount; i += 3)
+		{
+			for (int e = 0; e < 6; e++)
+			{
+				unsigned long from = result[i + e % 3];
+				unsigned long to = result[i + (e % 3 + (e < 3 ? 1 : 2)) % 3];
+				unsigned long fromGroup = group[from], toGroup = group[to];
+				if (fromGroup == toGroup)
+				{
+					continue;
+				}
+
+				bool allowed = false;
+				switch (kind[fromGroup])
+				{
+				case Kind_Manifold:
+					allowed = true;
+					break;
+				case Kind_Border:
+					allowed = kind[toGroup] == Kind_Border && (groupOpenOut[fromGroup] == (long)toGroup || groupOpenIn[fromGroup] == (long)toGroup);
+					break;
+				case Kind_Seam:
+					allowed = kind[toGroup] == Kind_Seam && (openOut[from] == (long)to || openIn[from] == (long)to);
+					break;
+				}
+
+				if (allowed)
+				{
+					Collapse collapse = { from, to, (float)std::sqrt(quadrics[fromGroup].evaluate(positionOf(vertices, stride, to))) };
+					collapses.push_back(collapse);
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+		{
+			return a.error < b.error || (a.error == b.error && (a.from < b.from || (a.from == b.from && a.to < b.to)));
+		});
+
+		// Collapses of one pass must not touch each other's triangles, the flip test assumes the neighbourhood is unchanged.
+		groupIndices.resize(currentCount);
+		for (int i = 0; i < currentCount; i++)
+		{
+			groupIndices[i] = group[result[i]];
+		}
+		Adjacency adjacency(groupIndices.data(), currentCount, vertexCount);
+
+		for (int v = 0; v < vertexCount; v++)
+		{
+			remap[v] = (unsigned long)v;
+		}
+
+		int trianglesToRemove = (currentCount - targetIndexCount) / 3;
+		int removed = 0;
+		int performed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > targetError || removed >= trianglesToRemove)
+			{
+				break;
+			}
+
+			unsigned long fromGroup = group[collapse.from], toGroup = group[collapse.to];
+			if (locked[fromGroup] || locked[toGroup])
+			{
+				continue;
+			}
+
+			// The other wedge of a seam follows the seam edge onto the matching wedge of the target.
+			unsigned long otherFrom = collapse.from, otherTo = collapse.to;
+			if (kind[fromGroup] == Kind_Seam)
+			{
+				otherFrom = nextWedge[collapse.from];
+				while (!used[otherFrom] || otherFrom == collapse.from)
+				{
+					otherFrom = nextWedge[otherFrom];
+				}
+				if (openOut[otherFrom] >= 0 && group[openOut[otherFrom]] == toGroup)
+				{
+					otherTo = (unsigned long)openOut[otherFrom];
+				}
+				else if (openIn[otherFrom] >= 0 && group[openIn[otherFrom]] == toGroup)
+				{
+					otherTo = (unsigned long)openIn[otherFrom];
+				}
+				else
+				{
+					continue;
+				}
+			}
+
+			// Reject collapses flipping a remaining triangle.
+			const float* target = positionOf(vertices, stride, collapse.to);
+			bool flips = false;
+			int collapsing = 0;
+			for (int t = adjacency.offsets[fromGroup]; t < adjacency.offsets[fromGroup + 1] && !flips; t++)
+			{
+				const unsigned long* triangle = &groupIndices[adjacency.triangles[t] * 3];
+				if (triangle[0] == toGroup || triangle[1] == toGroup || triangle[2] == toGroup)
+				{
+					collapsing++;
+					continue;
+				}
+
+				const float* before[3];
+				const float* after[3];
+				for (int k = 0; k < 3; k++)
+				{
+					before[k] = positionOf(vertices, stride, triangle[k]);
+					after[k] = triangle[k] == fromGroup ? target : before[k];
+				}
+				float normalBefore[3], normalAfter[3];
+				triangleNormal(before[0], before[1], before[2], normalBefore);
+				triangleNormal(after[0], after[1], after[2], normalAfter);
+				flips = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2] <= 0.f;
+			}
+			if (flips)
+			{
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			remap[otherFrom] = otherTo;
+			quadrics[toGroup].add(quadrics[fromGroup]);
+			resultError = collapse.error > resultError ? collapse.error : resultError;
+			removed += collapsing;
+			performed++;
+
+			// Lock the one ring of the collapsed position.
+			for (int t = adjacency.offsets[fromGroup]; t < adjacency.offsets[fromGroup + 1]; t++)
+			{
+				const unsigned long* triangle = &groupIndices[adjacency.triangles[t] * 3];
+				locked[triangle[0]] = locked[triangle[1]] = locked[triangle[2]] = 1;
+			}
+		}
+
+		if (performed == 0)
+		{
+			break;
+		}
+
+		// Apply the pass and drop the triangles that collapsed to a line.
+		int write = 0;
+		for (int i = 0; i < currentCount; i += 3)
+		{
+			unsigned long a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (group[a] != group[b] && group[b] != group[c] && group[a] != group[c])
+			{
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+		}
+		result.resize(write);
+	}
+
+	return resultError;
+}
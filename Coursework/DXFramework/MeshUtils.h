@@ -0,0 +1,127 @@
+/**
+* \class Mesh Utilities
+*
+* \brief CPU side geometry processing shared by the mesh classes
+*
+* Vertex welding: identical vertices (compared byte for byte) are merged into one, producing a compact vertex array and a remap table
+* that turns the old vertex indices into indices of the welded array. Works on any vertex layout, the stride is provided by the caller.
+*
+* Index optimisation: triangles are reordered for the post transform vertex cache (Tipsify), then clusters of them are reordered so
+* outward facing geometry is drawn first (less overdraw), and finally vertices are reordered into first use order for fetch locality.
+* A FIFO cache simulator measures ACMR (cache misses per triangle) and ATVR (cache misses per vertex) so the gain can be checked without a GPU.
+*
+* Grid generation: shared vertex triangle lists of regular grids in a cache friendly band order, for the procedural meshes.
+*
+* Simplification: quadric error metric edge collapses building coarser index lists over the same vertices, for level of detail chains.
+* Positions are expected to be the first member (three floats) of every vertex.
+*/
+
+
+#ifndef _MESHUTILS_H_
+#define _MESHUTILS_H_
+
+#include <cstddef>
+#include <vector>
+
+class MeshUtils
+{
+public:
+	/// Before and after numbers of a welded mesh, used for reporting.
+	struct WeldStats
+	{
+		int sourceVertexCount = 0;		///< vertices before welding, one per triangle corner for unrolled meshes
+		int weldedVertexCount = 0;		///< unique vertices left after welding
+		int indexCount = 0;
+		int vertexStride = 0;
+		bool shortIndices = false;		///< whether the welded mesh uses 16 bit indices
+
+		size_t sourceBytes() const;		///< vertex buffer plus 32 bit index buffer before welding
+		size_t weldedBytes() const;		///< vertex buffer plus index buffer after welding
+	};
+
+	/// Result of the vertex cache simulation.
+	struct CacheStats
+	{
+		float acmr = 0.f;		///< average cache miss ratio, transformed vertices per triangle (0.5 is ideal for large grids, 3 is the worst case)
+		float atvr = 0.f;		///< average transformed vertex ratio, transformed vertices per unique vertex (1 is ideal)
+	};
+
+	/// Cache numbers before and after optimiseMesh, used for reporting.
+	struct OptimiseStats
+	{
+		CacheStats before;
+		CacheStats after;
+	};
+
+	/** \brief Merges identical vertices
+	* @param vertices is the source array, vertexCount elements of stride bytes
+	* @param weldedVertices receives the unique vertices in first occurrence order, may be the same array as vertices
+	* @param remap receives the welded index of every source vertex (vertexCount elements)
+	* @return the number of unique vertices
+	*/
+	static int weldVertices(const void* vertices, int vertexCount, int stride, void* weldedVertices, unsigned long* remap);
+
+	/// Welds a vertex vector in place, remap is resized to the original vertex count.
+	template<class T>
+	static int weldVertices(std::vector<T>& vertices, std::vector<unsigned long>& remap)
+	{
+		remap.resize(vertices.size());
+		int count = weldVertices(vertices.data(), (int)vertices.size(), sizeof(T), vertices.data(), remap.data());
+		vertices.resize(count);
+		return count;
+	}
+
+	/// True when every vertex of the mesh can be addressed by a 16 bit index.
+	static bool fitsShortIndices(int vertexCount);
+
+	/// Simulates a FIFO post transform cache of cacheSize entries over a triangle list.
+	static CacheStats simulateVertexCache(const unsigned long* indices, int indexCount, int vertexCount, int cacheSize = 16);
+
+	/// Reorders triangles for the vertex cache with Tipsify (Sander et al. 2007), cacheSize is the targeted cache size.
+	static void optimiseVertexCache(unsigned long* indices, int indexCount, int vertexCount, int cacheSize = 16);
+
+	/** \brief Reorders clusters of cache optimised triangles to reduce overdraw
+	* Splits the list where the cluster ACMR is within threshold of the whole mesh, then sorts the clusters so the ones facing away from the centre come first.
+	* @param threshold is the allowed ACMR increase, 1.05 keeps the cache efficiency within 5%
+	*/
+	static void optimiseOverdraw(unsigned long* indices, int indexCount, const void* vertices, int vertexCount, int stride, float threshold = 1.05f, int cacheSize = 16);
+
+	/// Reorders vertices in order of first use and rewrites the indices. Unreferenced vertices are dropped, returns the new vertex count.
+	static int optimiseVertexFetch(void* vertices, int vertexCount, int stride, unsigned long* indices, int indexCount);
+
+	/// Runs the cache, overdraw and fetch passes in order. vertexCount is updated if unused vertices were dropped.
+	static OptimiseStats optimiseMesh(void* vertices, int& vertexCount, int stride, unsigned long* indices, int indexCount);
+
+	/// Optimises a vertex vector and its indices in place.
+	template<class T>
+	static OptimiseStats optimiseMesh(std::vector<T>& vertices, std::vector<unsigned long>& indices)
+	{
+		int count = (int)vertices.size();
+		OptimiseStats stats = optimiseMesh(vertices.data(), count, sizeof(T), indices.data(), (int)indices.size());
+		vertices.resize(count);
+		return stats;
+	}
+
+	/** \brief Simplifies a triangle list with quadric error metrics (Garland and Heckbert 1997)
+	* Edges collapse onto one of their vertices, so the result indexes the same vertex array and levels of detail can share one vertex buffer.
+	* Open borders only shrink along themselves, attribute seams move both of their sides together, anything more complex is kept.
+	* @param targetIndexCount stops the simplification once reached, 0 simplifies as far as targetError allows
+	* @param targetError is the largest allowed collapse error, an object space distance
+	* @return the error of the result, the largest collapse made
+	*/
+	static float simplifyMesh(const void* vertices, int vertexCount, int stride, const unsigned long* indices, int indexCount, std::vector<unsigned long>& result, int targetIndexCount, float targetError);
+
+	/** \brief Triangle list of a regular grid of columns x rows quads, over (columns + 1) x (rows + 1) row major vertices from baseVertex
+	* Quads are emitted in bands of columns narrow enough that two rows of band vertices stay in a cacheSize FIFO, near the 0.5 ACMR of
+	* an ideal grid order without running the optimiser. A cacheSize of 0 emits plain rows.
+	* @param mainDiagonal splits every quad from its first to its last corner, false splits it from the second to the third
+	* @param pitch is the vertex count of a grid row, 0 for columns + 1. Larger values index a block of a wider grid
+	* @return the number of indices written, columns * rows * 6
+	*/
+	static int buildGridIndices(unsigned long* indices, int columns, int rows, unsigned long baseVertex, bool mainDiagonal, int cacheSize = 16, int pitch = 0);
+
+	/// Packs indices as 16 bit values when vertexCount allows it, 32 bit otherwise. Returns the size of one packed index.
+	static int packIndices(const unsigned long* indices, int count, int vertexCount, std::vector<unsigned char>& packed);
+};
+
+#endif
@@ -0,0 +1,393 @@
+// Meshlets
+// Splits index buffers into clusters with bounds and normal cones, culls them on the CPU.
+#include "meshlets.h"
+#include "meshutils.h"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+namespace
+{
+	const float* positionOf(const void* vertices, int stride, unsigned long index)
+	{
+		return reinterpret_cast<const float*>(static_cast<const char*>(vertices) + (size_t)index * stride);
+	}
+
+	// Normals spread wider than this (about 84 degrees from the axis) make the cone useless.
+	const float k_MinConeDot = 0.1f;
+
+	// Bounds and cone of the triangles in [start, start + triangleCount * 3).
+	void computeBounds(const void* vertices, int stride, const unsigned long* indices, Meshlets::Meshlet& meshlet)
+	{
+		const unsigned long* triangles = indices + meshlet.indexStart;
+		int count = (int)meshlet.triangleCount * 3;
+
+		// Sphere around the box of the positions.
+		XMVECTOR boundsMin = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, triangles[0])));
+		XMVECTOR boundsMax = boundsMin;
+		for (int i = 1; i < count; i++)
+		{
+			XMVECTOR position = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, triangles[i])));
+			boundsMin = XMVectorMin(boundsMin, position);
+			boundsMax = XMVectorMax(boundsMax, position);
+		}
+		XMVECTOR centre = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+		XMVECTOR radiusSq = XMVectorZero();
+		for (int i = 0; i < count; i++)
+		{
+			XMVECTOR position = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, triangles[i])));
+			radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(XMVectorSubtract(position, centre)));
+		}
+		XMStoreFloat3(&meshlet.centre, centre);
+		meshlet.radius = std::sqrt(XMVectorGetX(radiusSq));
+
+		// Cone around the average normal, widened to every triangle normal.
+		std::vector<XMVECTOR> normals;
+		normals.reserve(meshlet.triangleCount);
+		XMVECTOR axis = XMVectorZero();
+		for (int i = 0; i < count; i += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, triangles[i])));
+			XMVECTOR p1 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, triangles[i + 1])));
+			XMVECTOR p2 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, triangles[i + 2])));
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.f)
+			{
+				normal = XMVector3Normalize(normal);
+				normals.push_back(normal);
+				axis = XMVectorAdd(axis, normal);
+			}
+		}
+
+		meshlet.coneCutoff = 2.f;
+		meshlet.coneAxis = XMFLOAT3(0.f, 0.f, 0.f);
+		meshlet.coneApex = meshlet.centre;
+		if (normals.empty() || XMVectorGetX(XMVector3LengthSq(axis)) <= 0.f)
+		{
+			return;
+		}
+
+		axis = XMVector3Normalize(axis);
+		float minDot = 1.f;
+		for (const XMVECTOR& normal : normals)
+		{
+			float dot = XMVectorGetX(XMVector3Dot(normal, axis));
+			minDot = dot < minDot ? dot : minDot;
+		}
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		if (minDot < k_MinConeDot)
+		{
+			return;
+		}
+
+		// Apex behind every triangle plane along the axis, so the test holds for the whole meshlet and not just its centre.
+		float maxT = 0.f;
+		int normal = 0;
+		for (int i = 0; i < count; i += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, triangles[i])));
+			XMVECTOR p1 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, triangles[i + 1])));
+			XMVECTOR p2 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, triangles[i + 2])));
+			if (XMVectorGetX(XMVector3LengthSq(XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0)))) <= 0.f)
+			{
+				continue;
+			}
+
+			const XMVECTOR& n = normals[normal++];
+			float t = XMVectorGetX(XMVector3Dot(XMVectorSubtract(centre, p0), n)) / XMVectorGetX(XMVector3Dot(axis, n));
+			maxT = t > maxT ? t : maxT;
+		}
+		XMStoreFloat3(&meshlet.coneApex, XMVectorSubtract(centre, XMVectorScale(axis, maxT)));
+		meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+	}
+}
+
+// Greedy growth over shared vertices (in the spirit of meshoptimizer): the next triangle adds the fewest vertices and
+// bends the normal cone the least. Triangles are then written back meshlet by meshlet.
+int Meshlets::buildMeshlets(const void* vertices, int vertexCount, int stride, unsigned long* indices, int indexStart, int indexCount,
+	std::vector<Meshlet>& meshlets, int maxVertices, int maxTriangles)
+{
+	size_t first = meshlets.size();
+	const unsigned long* source = indices + indexStart;
+	int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return 0;
+	}
+
+	// Vertices sharing a position are one corner for adjacency, so meshlets grow across normal and UV seams.
+	std::vector<int> sorted(vertexCount);
+	for (int i = 0; i < vertexCount; i++)
+	{
+		sorted[i] = i;
+	}
+	auto positionLess = [&](int a, int b)
+	{
+		const float* pa = positionOf(vertices, stride, a);
+		const float* pb = positionOf(vertices, stride, b);
+		return pa[0] != pb[0] ? pa[0] < pb[0] : pa[1] != pb[1] ? pa[1] < pb[1] : pa[2] < pb[2];
+	};
+	std::sort(sorted.begin(), sorted.end(), positionLess);
+	std::vector<int> corner(vertexCount);
+	int cornerCount = 0;
+	for (int i = 0; i < vertexCount; i++)
+	{
+		if (i > 0 && positionLess(sorted[i - 1], sorted[i]))
+		{
+			cornerCount++;
+		}
+		corner[sorted[i]] = cornerCount;
+	}
+	cornerCount++;
+
+	// Triangles around every corner.
+	std::vector<int> adjacencyStart(cornerCount + 1, 0);
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		adjacencyStart[corner[source[i]] + 1]++;
+	}
+	for (int i = 0; i < cornerCount; i++)
+	{
+		adjacencyStart[i + 1] += adjacencyStart[i];
+	}
+	std::vector<int> adjacency(triangleCount * 3);
+	std::vector<int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[corner[source[i]]]++] = i / 3;
+	}
+
+	// Unit normals, zero for degenerate triangles.
+	std::vector<XMFLOAT3> normals(triangleCount);
+	for (int t = 0; t < triangleCount; t++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, source[t * 3])));
+		XMVECTOR p1 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, source[t * 3 + 1])));
+		XMVECTOR p2 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(positionOf(vertices, stride, source[t * 3 + 2])));
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		XMStoreFloat3(&normals[t], XMVectorGetX(XMVector3LengthSq(normal)) > 0.f ? XMVector3Normalize(normal) : XMVectorZero());
+	}
+
+	std::vector<unsigned long> ordered;
+	ordered.reserve(triangleCount * 3);
+	std::vector<bool> used(triangleCount, false);
+	// Vertices are stamped with the meshlet that last used them.
+	std::vector<int> stamp(vertexCount, -1);
+	std::vector<unsigned long> meshletVertices;
+	std::vector<unsigned long> local(vertexCount);
+	meshletVertices.reserve(maxVertices);
+	int seed = 0;
+
+	for (int id = 0; ; id++)
+	{
+		// Next seed in index buffer order, which the cache optimisation already made spatially coherent.
+		while (seed < triangleCount && used[seed])
+		{
+			seed++;
+		}
+		if (seed == triangleCount)
+		{
+			break;
+		}
+
+		Meshlet meshlet = {};
+		meshlet.indexStart = (unsigned int)(indexStart + ordered.size());
+		meshletVertices.clear();
+		XMFLOAT3 normalSum(0.f, 0.f, 0.f);
+		int triangle = seed;
+
+		while (triangle >= 0)
+		{
+			used[triangle] = true;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned long vertex = source[triangle * 3 + k];
+				if (stamp[vertex] != id)
+				{
+					stamp[vertex] = id;
+					meshletVertices.push_back(vertex);
+				}
+				ordered.push_back(vertex);
+			}
+			normalSum.x += normals[triangle].x;
+			normalSum.y += normals[triangle].y;
+			normalSum.z += normals[triangle].z;
+			meshlet.triangleCount++;
+			if ((int)meshlet.triangleCount == maxTriangles)
+			{
+				break;
+			}
+
+			XMVECTOR axis = XMVector3Normalize(XMLoadFloat3(&normalSum));
+			float bestScore = FLT_MAX;
+			triangle = -1;
+			for (unsigned long vertex : meshletVertices)
+			{
+				for (int a = adjacencyStart[corner[vertex]]; a < adjacencyStart[corner[vertex] + 1]; a++)
+				{
+					int candidate = adjacency[a];
+					if (used[candidate])
+					{
+						continue;
+					}
+
+					const unsigned long* corners = source + candidate * 3;
+					int added = (stamp[corners[0]] != id ? 1 : 0) + (stamp[corners[1]] != id && corners[1] != corners[0] ? 1 : 0) +
+						(stamp[corners[2]] != id && corners[2] != corners[0] && corners[2] != corners[1] ? 1 : 0);
+					if ((int)meshletVertices.size() + added > maxVertices)
+					{
+						continue;
+					}
+
+					// Vertex reuse first, the cone spread decides between triangles adding as many vertices.
+					float spread = 1.f - XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[candidate]), axis));
+					float score = (float)added + spread;
+					if (score < bestScore)
+					{
+						bestScore = score;
+						triangle = candidate;
+					}
+				}
+			}
+		}
+
+		// Growth order suits the cone, not the vertex cache. Re-sort the meshlet on its local vertex numbering.
+		size_t start = meshlet.indexStart - indexStart;
+		for (size_t i = 0; i < meshletVertices.size(); i++)
+		{
+			local[meshletVertices[i]] = (unsigned long)i;
+		}
+		for (size_t i = start; i < ordered.size(); i++)
+		{
+			ordered[i] = local[ordered[i]];
+		}
+		MeshUtils::optimiseVertexCache(ordered.data() + start, (int)(ordered.size() - start), (int)meshletVertices.size());
+		for (size_t i = start; i < ordered.size(); i++)
+		{
+			ordered[i] = meshletVertices[ordered[i]];
+		}
+
+		meshlet.vertexCount = (unsigned int)meshletVertices.size();
+		meshlets.push_back(meshlet);
+	}
+
+	std::copy(ordered.begin(), ordered.end(), indices + indexStart);
+	for (size_t i = first; i < meshlets.size(); i++)
+	{
+		computeBounds(vertices, stride, indices, meshlets[i]);
+	}
+
+	return (int)(meshlets.size() - first);
+}
+
+// Planes from the combined matrix (Gribb and Hartmann), they come out in the space the matrix starts from.
+Meshlets::CullView Meshlets::makeCullView(const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection)
+{
+	CullView cullView;
+	cullView.margin = 0.f;
+	XMMATRIX worldView = XMMatrixMultiply(world, view);
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(worldView, projection));
+
+	XMVECTOR column0 = XMVectorSet(m._11, m._21, m._31, m._41);
+	XMVECTOR column1 = XMVectorSet(m._12, m._22, m._32, m._42);
+	XMVECTOR column2 = XMVectorSet(m._13, m._23, m._33, m._43);
+	XMVECTOR column3 = XMVectorSet(m._14, m._24, m._34, m._44);
+	XMVECTOR planes[6] = {
+		XMVectorAdd(column3, column0),			// left
+		XMVectorSubtract(column3, column0),		// right
+		XMVectorAdd(column3, column1),			// bottom
+		XMVectorSubtract(column3, column1),		// top
+		column2,								// near, depth starts at 0
+		XMVectorSubtract(column3, column2)		// far
+	};
+	for (int i = 0; i < 6; i++)
+	{
+		XMStoreFloat4(&cullView.planes[i], XMVectorDivide(planes[i], XMVector3Length(planes[i])));
+	}
+
+	// Eye, or view direction, taken back into object space.
+	XMVECTOR determinant;
+	XMFLOAT4X4 inverse;
+	XMStoreFloat4x4(&inverse, XMMatrixInverse(&determinant, worldView));
+	cullView.orthographic = m._34 == 0.f && m._24 == 0.f && m._14 == 0.f;
+	if (cullView.orthographic)
+	{
+		XMStoreFloat3(&cullView.eye, XMVector3Normalize(XMVectorSet(inverse._31, inverse._32, inverse._33, 0.f)));
+	}
+	else
+	{
+		cullView.eye = XMFLOAT3(inverse._41, inverse._42, inverse._43);
+	}
+	return cullView;
+}
+
+bool Meshlets::isSphereVisible(const CullView& view, const XMFLOAT3& centre, float radius)
+{
+	for (const XMFLOAT4& plane : view.planes)
+	{
+		if (plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Meshlets::isBackFacing(const CullView& view, const Meshlet& meshlet)
+{
+	if (meshlet.coneCutoff > 1.f)
+	{
+		return false;
+	}
+
+	XMVECTOR axis = XMLoadFloat3(&meshlet.coneAxis);
+	XMVECTOR direction = XMLoadFloat3(&view.eye);
+	if (!view.orthographic)
+	{
+		// From the eye to the apex, degenerate when the eye sits on the apex.
+		direction = XMVectorSubtract(XMLoadFloat3(&meshlet.coneApex), direction);
+		if (XMVectorGetX(XMVector3LengthSq(direction)) <= 0.f)
+		{
+			return false;
+		}
+		direction = XMVector3Normalize(direction);
+	}
+	return XMVectorGetX(XMVector3Dot(direction, axis)) >= meshlet.coneCutoff;
+}
+
+Meshlets::CullStats Meshlets::cullMeshlets(const Meshlet* meshlets, int count, const CullView& view, bool coneCulling, std::vector<IndexRange>& ranges)
+{
+	CullStats stats;
+	ranges.clear();
+
+	for (int i = 0; i < count; i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		if (!isSphereVisible(view, meshlet.centre, meshlet.radius + view.margin))
+		{
+			stats.frustumCulled++;
+			continue;
+		}
+		if (coneCulling && isBackFacing(view, meshlet))
+		{
+			stats.coneCulled++;
+			continue;
+		}
+
+		stats.visible++;
+		unsigned int indexCount = meshlet.triangleCount * 3;
+		if (!ranges.empty() && ranges.back().indexStart + ranges.back().indexCount == meshlet.indexStart)
+		{
+			ranges.back().indexCount += indexCount;
+		}
+		else
+		{
+			IndexRange range = { meshlet.indexStart, indexCount };
+			ranges.push_back(range);
+		}
+	}
+
+	stats.ranges = (int)ranges.size();
+	return stats;
+}
@@ -1,12 +1,26 @@
 // Model mesh and load
 // Loads a .obj and creates a mesh object from the data
 #include "model.h"
+#include "objloader.h"
+#include <cstring>
 
 // load model datat, initialise buffers (with model data) and load texture.
-Model::Model(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* filename)
+// A valid baked cache file skips the OBJ parsing and welding entirely.
+Model::Model(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* filename) : Model()
 {
-	loadModel(filename);
-	initBuffers(device);
+	load(filename);
+	finishLoad(device);
+}
+
+Model::Model()
+{
+	packedIndexSize = 0;
+	sourceHash = 0;
+	fromCache = false;
+	loaded = false;
+	boundsMin = XMFLOAT3(0.f, 0.f, 0.f);
+	boundsMax = XMFLOAT3(0.f, 0.f, 0.f);
+	lodErrors = { 0.005f, 0.02f, 0.05f };
 }
 
 // Release resources.
@@ -14,70 +28,218 @@ Model::~Model()
 {
 	// Run parent deconstructor
 	BaseMesh::~BaseMesh();
+}
+
+// CPU side of the load, touches nothing the draw calls read so the model can be rendered (as nothing) meanwhile.
+bool Model::load(const char* filename)
+{
+	// The level of detail targets are part of the bake.
+	unsigned int lodFlags = 2166136261u;
+	for (float error : lodErrors)
+	{
+		unsigned int bits;
+		memcpy(&bits, &error, sizeof(bits));
+		lodFlags = (lodFlags ^ bits) * 16777619u;
+	}
+
+	loaded = false;
+	cacheFile = MeshCache::getCachePath(filename, "model");
+	sourceHash = MeshCache::hashSource(filename, lodFlags);
+	fromCache = loadCache();
 
-	if (model)
+	if (!fromCache)
 	{
-		delete[] model;
-		model = 0;
+		if (!loadModel(filename))
+		{
+			return false;
+		}
+		processModel();
 	}
+	loaded = true;
+	return true;
 }
 
+// Device side of the load. A failed load has no bounds or buffers to set up, the model stays empty.
+void Model::finishLoad(ID3D11Device* device)
+{
+	if (!loaded)
+	{
+		return;
+	}
+	initBuffers(device);
+}
 
-// Initialise buffers with model data.
+// Initialise buffers with the prepared data, either straight from the mapped cache or from the processed OBJ.
 void Model::initBuffers(ID3D11Device* device)
 {
-	VertexType* vertices;
-	unsigned long* indices;
-	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData, indexData;
-		
-	vertices = new VertexType[vertexCount];
-	indices = new unsigned long[indexCount];
-	
-	// Load the vertex array and index array with data.
-	for (int i = 0; i<vertexCount; i++)
+	if (fromCache)
+	{
+		createVertexBuffer(device, cacheMesh.vertices, cacheMesh.vertexCount, cacheMesh.vertexStride);
+		createIndexBuffer(device, cacheMesh.indices, cacheMesh.indexCount, cacheMesh.indexSize == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT);
+		cache.close();
+	}
+	else if (!vertices.empty())
+	{
+		createVertexBuffer(device, vertices.data(), (int)vertices.size(), sizeof(VertexType));
+		createIndexBuffer(device, packedIndices.data(), (int)(packedIndices.size() / packedIndexSize), packedIndexSize == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT);
+	}
+
+	// The buffer holds every level of detail, the index count stays the full detail one.
+	// The chain only becomes visible to the draw calls here, load may run while the model is drawn.
+	setLods(lodChain.data(), (int)lodChain.size());
+	if (!lodChain.empty())
+	{
+		indexCount = lodChain[0].indexCount;
+	}
+	meshlets.swap(meshletBuild);
+
+	// Bounding sphere around the bounding box.
+	XMVECTOR low = XMLoadFloat3(&boundsMin);
+	XMVECTOR high = XMLoadFloat3(&boundsMax);
+	XMStoreFloat3(&boundingCentre, XMVectorScale(XMVectorAdd(low, high), 0.5f));
+	boundingRadius = XMVectorGetX(XMVector3Length(XMVectorSubtract(high, low))) * 0.5f;
+
+	// The buffers own the data now.
+	std::vector<VertexType>().swap(vertices);
+	std::vector<unsigned char>().swap(packedIndices);
+	std::vector<LevelOfDetail>().swap(lodChain);
+	std::vector<Meshlets::Meshlet>().swap(meshletBuild);
+}
+
+// Faces are loaded unrolled, so identical corners are welded into shared vertices referenced by a real index buffer.
+void Model::processModel()
+{
+	std::vector<unsigned long> indices;
+
+	// Merge identical corners, the remap table becomes the index buffer.
+	weldStats.sourceVertexCount = (int)vertices.size();
+	int weldedCount = MeshUtils::weldVertices(vertices, indices);
+
+	// Reorder for the vertex cache, overdraw and vertex fetch.
+	optimiseStats = MeshUtils::optimiseMesh(vertices, indices);
+	weldedCount = (int)vertices.size();
+
+	weldStats.weldedVertexCount = weldedCount;
+	weldStats.indexCount = (int)indices.size();
+	weldStats.vertexStride = sizeof(VertexType);
+
+	// Simplified levels are appended behind the full detail indices.
+	buildLods(indices);
+
+	// Clusters of the full detail level, its triangles are regrouped meshlet by meshlet.
+	meshletBuild.clear();
+	Meshlets::buildMeshlets(vertices.data(), weldedCount, sizeof(VertexType), indices.data(), 0, lodChain[0].indexCount, meshletBuild);
+
+	// Pack the indices to 16 bit when the welded vertex count allows it.
+	packedIndexSize = MeshUtils::packIndices(indices.data(), (int)indices.size(), weldedCount, packedIndices);
+	weldStats.shortIndices = packedIndexSize == sizeof(unsigned short);
+
+	// Bake the result for the next load.
+	std::vector<MeshCache::Lod> lodTable;
+	for (const LevelOfDetail& lod : lodChain)
+	{
+		MeshCache::Lod entry = { (unsigned int)lod.indexStart, (unsigned int)lod.indexCount, lod.error };
+		lodTable.push_back(entry);
+	}
+
+	MeshCache::Submesh submesh = { 0, (unsigned int)weldStats.indexCount, 0, boundsMin, boundsMax };
+	MeshCache::MeshData mesh;
+	mesh.vertices = vertices.data();
+	mesh.indices = packedIndices.data();
+	mesh.submeshes = &submesh;
+	mesh.lods = lodTable.data();
+	mesh.meshlets = meshletBuild.data();
+	mesh.vertexCount = weldedCount;
+	mesh.vertexStride = sizeof(VertexType);
+	mesh.indexCount = (int)indices.size();
+	mesh.indexSize = packedIndexSize;
+	mesh.submeshCount = 1;
+	mesh.lodCount = (int)lodTable.size();
+	mesh.meshletCount = (int)meshletBuild.size();
+	mesh.sourceVertexCount = weldStats.sourceVertexCount;
+	mesh.optimiseStats = optimiseStats;
+	MeshCache::save(cacheFile.c_str(), sourceHash, mesh);
+}
+
+// Simplifies the full detail mesh once per error target. Every level indexes the same optimised vertices.
+void Model::buildLods(std::vector<unsigned long>& indices)
+{
+	XMVECTOR low = XMLoadFloat3(&vertices[0].position);
+	XMVECTOR high = low;
+	for (const VertexType& vertex : vertices)
+	{
+		low = XMVectorMin(low, XMLoadFloat3(&vertex.position));
+		high = XMVectorMax(high, XMLoadFloat3(&vertex.position));
+	}
+	XMStoreFloat3(&boundsMin, low);
+	XMStoreFloat3(&boundsMax, high);
+	float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(high, low))) * 0.5f;
+
+	int fullCount = (int)indices.size();
+	LevelOfDetail full = { 0, fullCount, 0.f };
+	lodChain.assign(1, full);
+
+	for (float relativeError : lodErrors)
 	{
-		vertices[i].position = XMFLOAT3(model[i].x, model[i].y, -model[i].z);
-		vertices[i].texture = XMFLOAT2(model[i].tu, model[i].tv);
-		vertices[i].normal = XMFLOAT3(model[i].nx, model[i].ny, -model[i].nz);
+		std::vector<unsigned long> simplified;
+		float error = MeshUtils::simplifyMesh(vertices.data(), (int)vertices.size(), sizeof(VertexType), indices.data(), fullCount, simplified, 0, relativeError * radius);
+
+		// Not worth a switch.
+		if (simplified.empty() || simplified.size() * 10 > (size_t)lodChain.back().indexCount * 9)
+		{
+			continue;
+		}
 
-		indices[i] = i;
+		MeshUtils::optimiseVertexCache(simplified.data(), (int)simplified.size(), (int)vertices.size());
+		LevelOfDetail lod = { (int)indices.size(), (int)simplified.size(), error };
+		lodChain.push_back(lod);
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+	}
+}
+
+// Map the baked cache file, the streams go to the GPU straight from the mapped view in initBuffers.
+bool Model::loadCache()
+{
+	if (!MeshCache::load(cacheFile.c_str(), sourceHash, cache, cacheMesh) || cacheMesh.vertexStride != sizeof(VertexType))
+	{
+		cache.close();
+		return false;
 	}
 
-	// Set up the description of the static vertex buffer.
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexType)* vertexCount;
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-	// Now create the vertex buffer.
-	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
-
-	// Set up the description of the static index buffer.
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long)* indexCount;
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-	// Create the index buffer.
-	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
-	
-	// Release the arrays now that the vertex and index buffers have been created and loaded.
-	delete[] vertices;
-	vertices = 0;
-
-	delete[] indices;
-	indices = 0;
+	lodChain.clear();
+	for (int i = 0; i < cacheMesh.lodCount; i++)
+	{
+		const MeshCache::Lod& entry = cacheMesh.lods[i];
+		if ((size_t)entry.startIndex + entry.indexCount > (size_t)cacheMesh.indexCount)
+		{
+			cache.close();
+			return false;
+		}
+		LevelOfDetail lod = { (int)entry.startIndex, (int)entry.indexCount, entry.error };
+		lodChain.push_back(lod);
+	}
+	int fullCount = lodChain.empty() ? cacheMesh.indexCount : lodChain[0].indexCount;
+	meshletBuild.clear();
+	for (int i = 0; i < cacheMesh.meshletCount; i++)
+	{
+		const Meshlets::Meshlet& meshlet = cacheMesh.meshlets[i];
+		if ((size_t)meshlet.indexStart + (size_t)meshlet.triangleCount * 3 > (size_t)fullCount)
+		{
+			cache.close();
+			return false;
+		}
+		meshletBuild.push_back(meshlet);
+	}
+	boundsMin = cacheMesh.boundsMin;
+	boundsMax = cacheMesh.boundsMax;
+
+	weldStats.sourceVertexCount = cacheMesh.sourceVertexCount;
+	optimiseStats = cacheMesh.optimiseStats;
+	weldStats.weldedVertexCount = cacheMesh.vertexCount;
+	weldStats.indexCount = fullCount;
+	weldStats.vertexStride = sizeof(VertexType);
+	weldStats.shortIndices = cacheMesh.indexSize == sizeof(unsigned short);
+	return true;
 }
 
 //// Read model file and parse data.
@@ -221,104 +383,27 @@ void Model::initBuffers(ID3D11Device* device)
 //	faces.clear();
 //}
 
-// Modified from a mulit-threaded version by Mark Ropper (CGT).
-void Model::loadModel(const char* filename)
+// Parse the OBJ file with the multithreaded loader and unroll it into a triangle list.
+bool Model::loadModel(const char* filename)
 {
-	std::vector<XMFLOAT3> verts;
-	std::vector<XMFLOAT3> norms;
-	std::vector<XMFLOAT2> texCs;
-	std::vector<unsigned int> faces;
-
-	FILE* file;// = fopen(filename, "r");
-	errno_t err;
-	err = fopen_s(&file, filename, "r");
-	if(err != 0)
-	//if (file == NULL)
+	ObjLoader::ObjData obj;
+	if (!ObjLoader::loadFile(filename, obj))
 	{
-		return;
+		return false;
 	}
 
-	while (true)
+	// "Unroll" the loaded obj information into a list of triangles, flipping z for the left handed coordinate system.
+	vertices.resize(obj.corners.size());
+	for (size_t vIndex = 0; vIndex < obj.corners.size(); vIndex++)
 	{
-		char lineHeader[128];
+		const ObjLoader::Corner& corner = obj.corners[vIndex];
+		const XMFLOAT3& position = obj.positions[corner.position];
+		XMFLOAT2 texture = corner.texture >= 0 ? obj.texCoords[corner.texture] : XMFLOAT2(0.f, 0.f);
+		XMFLOAT3 normal = corner.normal >= 0 ? obj.normals[corner.normal] : XMFLOAT3(0.f, 0.f, 0.f);
 
-		// Read first word of the line
-		int res = fscanf_s(file, "%s", lineHeader, (int)sizeof(lineHeader));
-		if (res == EOF)
-		{
-			break; // exit loop
-		}
-		else // Parse
-		{
-			if (strcmp(lineHeader, "v") == 0) // Vertex
-			{
-				XMFLOAT3 vertex;
-				fscanf_s(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-				verts.push_back(vertex);
-			}
-			else if (strcmp(lineHeader, "vt") == 0) // Tex Coord
-			{
-				XMFLOAT2 uv;
-				fscanf_s(file, "%f %f\n", &uv.x, &uv.y);
-				texCs.push_back(uv);
-			}
-			else if (strcmp(lineHeader, "vn") == 0) // Normal
-			{
-				XMFLOAT3 normal;
-				fscanf_s(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-				norms.push_back(normal);
-			}
-			else if (strcmp(lineHeader, "f") == 0) // Face
-			{
-				unsigned int face[9];
-				int matches = fscanf_s(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &face[0], &face[1], &face[2],
-																			&face[3], &face[4], &face[5],
-																			&face[6], &face[7], &face[8]);
-				if (matches != 9)
-				{
-					// Parser error, or not triangle faces
-					return;
-				}
-
-				for (int i = 0; i < 9; i++)
-				{
-					faces.push_back(face[i]);
-				}
-
-
-			}
-		}
+		vertices[vIndex].position = XMFLOAT3(position.x, position.y, -position.z);
+		vertices[vIndex].texture = texture;
+		vertices[vIndex].normal = XMFLOAT3(normal.x, normal.y, -normal.z);
 	}
-
-	int vIndex = 0, nIndex = 0, tIndex = 0;
-	int numFaces = (int)faces.size() / 9;
-
-	//// Create the model using the vertex count that was read in.
-	vertexCount = numFaces * 3;
-	model = new ModelType[vertexCount];
-
-	// "Unroll" the loaded obj information into a list of triangles.
-	for (int f = 0; f < (int)faces.size(); f += 3)
-	{
-		model[vIndex].x = verts[(faces[f + 0] - 1)].x;
-		model[vIndex].y = verts[(faces[f + 0] - 1)].y;
-		model[vIndex].z = verts[(faces[f + 0] - 1)].z;
-		model[vIndex].tu = texCs[(faces[f + 1] - 1)].x;
-		model[vIndex].tv = texCs[(faces[f + 1] - 1)].y;
-		model[vIndex].nx = norms[(faces[f + 2] - 1)].x;
-		model[vIndex].ny = norms[(faces[f + 2] - 1)].y;
-		model[vIndex].nz = norms[(faces[f + 2] - 1)].z;
-
-		//increase index count
-		vIndex++;
-
-	}
-	indexCount = vIndex;
-
-
-	verts.clear();
-	norms.clear();
-	texCs.clear();
-	faces.clear();
-
+	return !vertices.empty();
 }
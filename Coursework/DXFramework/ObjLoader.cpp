@@ -0,0 +1,518 @@
+// OBJ loader
+// Parses Wavefront OBJ files in parallel, line aligned chunks are parsed on worker threads and merged afterwards.
+#include "objloader.h"
+#include "threadpool.h"
+#include "mappedfile.h"
+#include <thread>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	// Files smaller than this are parsed on the calling thread only.
+	const size_t k_MinChunkSize = 64 * 1024;
+
+	const double k_Pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	// Bits for corners which used negative (relative) indices.
+	const unsigned char k_RelativePosition = 1;
+	const unsigned char k_RelativeTexture = 2;
+	const unsigned char k_RelativeNormal = 4;
+
+	// Results of parsing one chunk of the file.
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT2> texCoords;
+		std::vector<XMFLOAT3> normals;
+		std::vector<ObjLoader::Corner> corners;
+		std::vector<unsigned char> relative;
+		bool hasRelative = false;
+	};
+
+	inline bool isDigit(char c)
+	{
+		return (unsigned char)(c - '0') < 10;
+	}
+
+	inline const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+		return p;
+	}
+
+	inline const char* findLineEnd(const char* p, const char* end)
+	{
+		const char* newLine = static_cast<const char*>(memchr(p, '\n', end - p));
+		return newLine ? newLine : end;
+	}
+
+	double scaleByPow10(double value, int exponent)
+	{
+		while (exponent > 22)
+		{
+			value *= k_Pow10[22];
+			exponent -= 22;
+		}
+		while (exponent < -22)
+		{
+			value /= k_Pow10[22];
+			exponent += 22;
+		}
+		return exponent >= 0 ? value * k_Pow10[exponent] : value / k_Pow10[-exponent];
+	}
+
+	// Locale independent float parser, returns nullptr if no number was found.
+	const char* parseFloat(const char* p, const char* end, float& out)
+	{
+		p = skipSpaces(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		unsigned long long mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		bool found = false;
+
+		// Integer part, only the first 19 significant digits fit the mantissa.
+		while (p < end && isDigit(*p))
+		{
+			found = true;
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa)
+					digits++;
+			}
+			else
+			{
+				exponent++;
+			}
+			p++;
+		}
+
+		// Fraction part.
+		if (p < end && *p == '.')
+		{
+			p++;
+			while (p < end && isDigit(*p))
+			{
+				found = true;
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+					if (mantissa)
+						digits++;
+				}
+				p++;
+			}
+		}
+
+		if (!found)
+			return nullptr;
+
+		// Exponent part.
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* e = p + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+'))
+			{
+				negativeExponent = *e == '-';
+				e++;
+			}
+
+			if (e < end && isDigit(*e))
+			{
+				int value = 0;
+				while (e < end && isDigit(*e))
+				{
+					if (value < 10000)
+						value = value * 10 + (*e - '0');
+					e++;
+				}
+				exponent += negativeExponent ? -value : value;
+				p = e;
+			}
+		}
+
+		double value = scaleByPow10((double)mantissa, exponent);
+		out = (float)(negative ? -value : value);
+		return p;
+	}
+
+	// Reads a signed integer, returns nullptr if there is none.
+	const char* parseInt(const char* p, const char* end, int& out)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		if (p >= end || !isDigit(*p))
+			return nullptr;
+
+		int value = 0;
+		while (p < end && isDigit(*p))
+		{
+			value = value * 10 + (*p - '0');
+			p++;
+		}
+
+		out = negative ? -value : value;
+		return p;
+	}
+
+	// Converts an OBJ index into a zero based one. Negative indices are stored relative to the chunk and flagged.
+	inline bool resolveIndex(int index, int chunkCount, int& out, bool& relative)
+	{
+		if (index > 0)
+		{
+			out = index - 1;
+			relative = false;
+			return true;
+		}
+		if (index < 0)
+		{
+			out = chunkCount + index;
+			relative = true;
+			return true;
+		}
+		return false;
+	}
+
+	// Parses a face line, corners are fanned into triangles.
+	void parseFace(const char* p, const char* end, Chunk& chunk, std::vector<ObjLoader::Corner>& face, std::vector<unsigned char>& faceRelative)
+	{
+		face.clear();
+		faceRelative.clear();
+
+		while (true)
+		{
+			p = skipSpaces(p, end);
+			if (p >= end || *p == '\r' || *p == '#')
+				break;
+
+			ObjLoader::Corner corner = { -1, -1, -1 };
+			unsigned char flags = 0;
+			bool relative;
+			int index;
+
+			// Position is required.
+			p = parseInt(p, end, index);
+			if (!p || !resolveIndex(index, (int)chunk.positions.size(), corner.position, relative))
+				return;
+			if (relative)
+				flags |= k_RelativePosition;
+
+			if (p < end && *p == '/')
+			{
+				p++;
+				// Texture coordinate is optional (v//vn).
+				if (p < end && *p != '/')
+				{
+					p = parseInt(p, end, index);
+					if (!p || !resolveIndex(index, (int)chunk.texCoords.size(), corner.texture, relative))
+						return;
+					if (relative)
+						flags |= k_RelativeTexture;
+				}
+
+				if (p < end && *p == '/')
+				{
+					p++;
+					p = parseInt(p, end, index);
+					if (!p || !resolveIndex(index, (int)chunk.normals.size(), corner.normal, relative))
+						return;
+					if (relative)
+						flags |= k_RelativeNormal;
+				}
+			}
+
+			face.push_back(corner);
+			faceRelative.push_back(flags);
+		}
+
+		// Triangulate as a fan around the first corner.
+		for (size_t i = 2; i < face.size(); i++)
+		{
+			chunk.corners.push_back(face[0]);
+			chunk.corners.push_back(face[i - 1]);
+			chunk.corners.push_back(face[i]);
+
+			unsigned char flags[3] = { faceRelative[0], faceRelative[i - 1], faceRelative[i] };
+			for (int c = 0; c < 3; c++)
+			{
+				chunk.relative.push_back(flags[c]);
+				chunk.hasRelative |= flags[c] != 0;
+			}
+		}
+	}
+
+	// Parses all lines of a chunk into its local arrays.
+	void parseChunk(Chunk& chunk)
+	{
+		std::vector<ObjLoader::Corner> face;
+		std::vector<unsigned char> faceRelative;
+
+		const char* p = chunk.begin;
+		const char* end = chunk.end;
+
+		while (p < end)
+		{
+			const char* lineEnd = findLineEnd(p, end);
+			const char* c = skipSpaces(p, lineEnd);
+
+			if (lineEnd - c >= 2)
+			{
+				if (c[0] == 'v' && (c[1] == ' ' || c[1] == '\t'))
+				{
+					XMFLOAT3 position(0.f, 0.f, 0.f);
+					const char* n = parseFloat(c + 2, lineEnd, position.x);
+					if (n)
+						n = parseFloat(n, lineEnd, position.y);
+					if (n)
+						n = parseFloat(n, lineEnd, position.z);
+					chunk.positions.push_back(position);
+				}
+				else if (c[0] == 'v' && c[1] == 't')
+				{
+					XMFLOAT2 uv(0.f, 0.f);
+					const char* n = parseFloat(c + 2, lineEnd, uv.x);
+					if (n)
+						parseFloat(n, lineEnd, uv.y);
+					chunk.texCoords.push_back(uv);
+				}
+				else if (c[0] == 'v' && c[1] == 'n')
+				{
+					XMFLOAT3 normal(0.f, 0.f, 0.f);
+					const char* n = parseFloat(c + 2, lineEnd, normal.x);
+					if (n)
+						n = parseFloat(n, lineEnd, normal.y);
+					if (n)
+						n = parseFloat(n, lineEnd, normal.z);
+					chunk.normals.push_back(normal);
+				}
+				else if (c[0] == 'f' && (c[1] == ' ' || c[1] == '\t'))
+				{
+					parseFace(c + 2, lineEnd, chunk, face, faceRelative);
+				}
+			}
+
+			p = lineEnd + 1;
+		}
+	}
+
+	// Adds the chunk offsets to the corner indices and checks them against the merged array sizes.
+	bool fixCorner(ObjLoader::Corner& corner, unsigned char relative, int positionBase, int textureBase, int normalBase, const ObjLoader::ObjData& data)
+	{
+		if (relative & k_RelativePosition)
+			corner.position += positionBase;
+		if (relative & k_RelativeTexture)
+			corner.texture += textureBase;
+		if (relative & k_RelativeNormal)
+			corner.normal += normalBase;
+
+		if (corner.position < 0 || corner.position >= (int)data.positions.size())
+			return false;
+
+		// Missing or broken optional attributes are dropped instead of failing the whole model.
+		if (corner.texture >= (int)data.texCoords.size())
+			corner.texture = -1;
+		if (corner.normal >= (int)data.normals.size())
+			corner.normal = -1;
+		return true;
+	}
+}
+
+void ObjLoader::ObjData::clear()
+{
+	positions.clear();
+	texCoords.clear();
+	normals.clear();
+	corners.clear();
+}
+
+bool ObjLoader::loadFile(const char* filename, ObjData& data, unsigned int maxThreads)
+{
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		data.clear();
+		return false;
+	}
+
+	return parse(file.getData(), file.getSize(), data, maxThreads);
+}
+
+bool ObjLoader::parse(const char* text, size_t size, ObjData& data, unsigned int maxThreads)
+{
+	data.clear();
+	if (!text || size == 0)
+		return false;
+
+	// Pick the number of chunks, small files are not worth the thread start up.
+	size_t threadCount = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+	size_t chunkCount = size / k_MinChunkSize;
+	if (chunkCount > threadCount)
+		chunkCount = threadCount;
+	if (chunkCount < 1)
+		chunkCount = 1;
+
+	// Split into line aligned chunks.
+	std::vector<Chunk> chunks(chunkCount);
+	const char* end = text + size;
+	const char* begin = text;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char* chunkEnd = (i + 1 == chunkCount) ? end : text + (size * (i + 1)) / chunkCount;
+		if (chunkEnd < begin)
+			chunkEnd = begin;
+		if (chunkEnd < end)
+			chunkEnd = findLineEnd(chunkEnd, end);
+		if (chunkEnd < end)
+			chunkEnd++;
+
+		chunks[i].begin = begin;
+		chunks[i].end = chunkEnd;
+		begin = chunkEnd;
+	}
+
+	ThreadPool::shared().runParallel(chunkCount, [&chunks](size_t i) { parseChunk(chunks[i]); });
+
+	// Offsets of each chunk in the merged arrays.
+	std::vector<size_t> positionBase(chunkCount), textureBase(chunkCount), normalBase(chunkCount), cornerBase(chunkCount);
+	size_t positionCount = 0, textureCount = 0, normalCount = 0, cornerCount = 0;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		positionBase[i] = positionCount;
+		textureBase[i] = textureCount;
+		normalBase[i] = normalCount;
+		cornerBase[i] = cornerCount;
+		positionCount += chunks[i].positions.size();
+		textureCount += chunks[i].texCoords.size();
+		normalCount += chunks[i].normals.size();
+		cornerCount += chunks[i].corners.size();
+	}
+
+	data.positions.resize(positionCount);
+	data.texCoords.resize(textureCount);
+	data.normals.resize(normalCount);
+	data.corners.resize(cornerCount);
+
+	// Merge, every chunk copies into its own range so this runs in parallel too.
+	std::vector<char> valid(chunkCount, 1);
+	ThreadPool::shared().runParallel(chunkCount, [&](size_t i)
+	{
+		Chunk& chunk = chunks[i];
+		if (!chunk.positions.empty())
+			memcpy(&data.positions[positionBase[i]], chunk.positions.data(), chunk.positions.size() * sizeof(XMFLOAT3));
+		if (!chunk.texCoords.empty())
+			memcpy(&data.texCoords[textureBase[i]], chunk.texCoords.data(), chunk.texCoords.size() * sizeof(XMFLOAT2));
+		if (!chunk.normals.empty())
+			memcpy(&data.normals[normalBase[i]], chunk.normals.data(), chunk.normals.size() * sizeof(XMFLOAT3));
+
+		Corner* corners = chunk.corners.empty() ? nullptr : &data.corners[cornerBase[i]];
+		for (size_t c = 0; c < chunk.corners.size(); c++)
+		{
+			corners[c] = chunk.corners[c];
+			if (!fixCorner(corners[c], chunk.hasRelative ? chunk.relative[c] : 0, (int)positionBase[i], (int)textureBase[i], (int)normalBase[i], data))
+				valid[i] = 0;
+		}
+	});
+
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		if (!valid[i])
+		{
+			// Face referenced a vertex that does not exist.
+			data.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Modified from a mulit-threaded version by Mark Ropper (CGT).
+bool ObjLoader::loadFileScanf(const char* filename, ObjData& data)
+{
+	data.clear();
+
+	FILE* file;
+	errno_t err;
+	err = fopen_s(&file, filename, "r");
+	if (err != 0)
+	{
+		return false;
+	}
+
+	while (true)
+	{
+		char lineHeader[128];
+
+		// Read first word of the line
+		int res = fscanf_s(file, "%s", lineHeader, (int)sizeof(lineHeader));
+		if (res == EOF)
+		{
+			break; // exit loop
+		}
+		else // Parse
+		{
+			if (strcmp(lineHeader, "v") == 0) // Vertex
+			{
+				XMFLOAT3 vertex;
+				fscanf_s(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
+				data.positions.push_back(vertex);
+			}
+			else if (strcmp(lineHeader, "vt") == 0) // Tex Coord
+			{
+				XMFLOAT2 uv;
+				fscanf_s(file, "%f %f\n", &uv.x, &uv.y);
+				data.texCoords.push_back(uv);
+			}
+			else if (strcmp(lineHeader, "vn") == 0) // Normal
+			{
+				XMFLOAT3 normal;
+				fscanf_s(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
+				data.normals.push_back(normal);
+			}
+			else if (strcmp(lineHeader, "f") == 0) // Face
+			{
+				int face[9];
+				int matches = fscanf_s(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &face[0], &face[1], &face[2],
+																			&face[3], &face[4], &face[5],
+																			&face[6], &face[7], &face[8]);
+				if (matches != 9)
+				{
+					// Parser error, or not triangle faces
+					fclose(file);
+					return false;
+				}
+
+				for (int i = 0; i < 9; i += 3)
+				{
+					Corner corner = { face[i] - 1, face[i + 1] - 1, face[i + 2] - 1 };
+					data.corners.push_back(corner);
+				}
+			}
+		}
+	}
+
+	fclose(file);
+	return true;
+}
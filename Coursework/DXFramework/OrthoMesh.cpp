@@ -86,6 +86,7 @@ void OrthoMesh::initBuffers(ID3D11Device* device)
 	vertexData.SysMemSlicePitch = 0;
 	// Now finally create the vertex buffer.
 	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
+	vertexStride = sizeof(VertexType);
 
 	// Set up the description of the index buffer.
 	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
@@ -3,9 +3,10 @@
 #include "planemesh.h"
 
 // Initialise buffer and load texture.
-PlaneMesh::PlaneMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int lresolution)
+PlaneMesh::PlaneMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int lresolution, bool lpacked)
 {
 	resolution = lresolution;
+	packed = lpacked;
 	initBuffers(device);
 }
 
@@ -17,137 +18,53 @@ PlaneMesh::~PlaneMesh()
 }
 
 // Generate plane (including texture coordinates and normals).
+// resolution x resolution shared vertices, indexed as (resolution - 1)^2 quads of two triangles.
 void PlaneMesh::initBuffers(ID3D11Device* device)
 {
 	VertexType* vertices;
 	unsigned long* indices;
 	int index, i, j;
-	float positionX, positionZ, u, v, increment;
-	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData, indexData;
-	
-	// Calculate the number of vertices in the terrain mesh.
-	vertexCount = (resolution - 1) * (resolution - 1) * 6;
+	float increment;
 
-
-	indexCount = vertexCount;
+	// Every grid point is stored once, quads share their corners with their neighbours.
+	vertexCount = resolution * resolution;
+	indexCount = (resolution - 1) * (resolution - 1) * 6;
 	vertices = new VertexType[vertexCount];
 	indices = new unsigned long[indexCount];
-	
 
-	index = 0;
-	// UV coords.
-	u = 0;
-	v = 0;
+	// UV coords step once per quad, as the unit quads did.
 	increment = 1.0f / resolution;
-	
-	for (j = 0; j<(resolution - 1); j++)
+
+	index = 0;
+	for (j = 0; j < resolution; j++)
 	{
-		for (i = 0; i<(resolution - 1); i++)
+		for (i = 0; i < resolution; i++)
 		{
-			// Upper left.
-			positionX = (float)i;
-			positionZ = (float)(j);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u, v);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-			// Upper right.
-			positionX = (float)(i + 1);
-			positionZ = (float)(j + 1);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u + increment, v + increment);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-
-			// lower left
-			positionX = (float)(i);
-			positionZ = (float)(j + 1);
-			
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u, v + increment);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-			// Upper left
-			positionX = (float)(i);
-			positionZ = (float)(j);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u, v);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-			// Bottom right
-			positionX = (float)(i + 1);
-			positionZ = (float)(j);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u + increment, v);
-			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
-			index++;
-
-			// Upper right.
-			positionX = (float)(i + 1);
-			positionZ = (float)(j + 1);
-
-			vertices[index].position = XMFLOAT3(positionX, 0.0f, positionZ);
-			vertices[index].texture = XMFLOAT2(u + increment, v + increment);
+			vertices[index].position = XMFLOAT3((float)i, 0.0f, (float)j);
+			vertices[index].texture = XMFLOAT2(i * increment, j * increment);
 			vertices[index].normal = XMFLOAT3(0.0, 1.0, 0.0);
-			indices[index] = index;
 			index++;
-
-			u += increment;
-	
 		}
+	}
 
-		u = 0;
-		v += increment;
+	// Same triangles as the unit quads, emitted in cache sized bands.
+	MeshUtils::buildGridIndices(indices, resolution - 1, resolution - 1, 0, true);
+	optimiseStats.before = optimiseStats.after = MeshUtils::simulateVertexCache(indices, indexCount, vertexCount);
+
+	// Packed planes are flat, the y axis of the positions decodes exactly.
+	if (packed)
+	{
+		createPackedVertexBuffer(device, vertices, vertexCount);
 	}
+	else
+	{
+		createVertexBuffer(device, vertices, vertexCount, sizeof(VertexType));
+	}
+	createIndexBuffer(device, indices, indexCount);
 
-	// Set up the description of the static vertex buffer.
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexType)* vertexCount;
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-	// Now create the vertex buffer.
-	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
-	
-	// Set up the description of the static index buffer.
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long)* indexCount;
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-	// Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-	// Create the index buffer.
-	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
-	
 	// Release the arrays now that the buffers have been created and loaded.
 	delete[] vertices;
 	vertices = 0;
 	delete[] indices;
 	indices = 0;
 }
-
-
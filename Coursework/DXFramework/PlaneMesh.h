@@ -5,7 +5,7 @@
 *
 * Inherits from Base Mesh, Builds a simple plane with texture coordinates and normals.
 * Provided resolution values deteremines the subdivisions of the plane.
-* Builds a plane from unit quads.
+* Builds a plane from unit quads sharing their corner vertices, indexed with 16 bit indices up to 255 x 255.
 *
 * \author Paul Robertson
 */
@@ -15,6 +15,7 @@
 #define _PLANEMESH_H_
 
 #include "BaseMesh.h"
+#include "MeshUtils.h"
 
 class PlaneMesh : public BaseMesh
 {
@@ -26,13 +27,19 @@ public:
 	* @param device is the renderer device
 	* @param device context is the renderer device context
 	* @param resolution is a int for subdivision of the plane. The number of unit quad on each axis. Default is 100.
+	* @param packed stores the vertices as VertexType_Packed, half the memory, needs shaders with a packed vertex shader.
 	*/
-	PlaneMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 100);
+	PlaneMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 100, bool packed = false);
 	~PlaneMesh();
 
+	/// Vertex cache numbers of the generated order, no optimiser runs on the grid.
+	const MeshUtils::OptimiseStats& getOptimiseStats() const { return optimiseStats; }
+
 protected:
 	void initBuffers(ID3D11Device* device);
 	int resolution;
+	bool packed;
+	MeshUtils::OptimiseStats optimiseStats;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,186 @@
+// Poisson scatter
+// Dart throwing on a grid of cells, tiles of cells in four phases on worker threads, candidates hashed from their cell and attempt.
+#include "poissonscatter.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	// Cells a point too close to a candidate can be away, the cell side is the minimum distance over root two.
+	const int k_Reach = 2;
+	// x of a cell without a point, points are never negative.
+	const float k_Empty = -1.f;
+	const float k_InverseRootTwo = 0.70710678f;
+
+	// 64 bit finaliser of splitmix64, every bit of the input flips half of the output.
+	inline unsigned long long mix(unsigned long long x)
+	{
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ull;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebull;
+		x ^= x >> 31;
+		return x;
+	}
+
+	// Low 21 bits as a fraction from 0 to 1, exclusive.
+	inline float toUnit(unsigned long long bits)
+	{
+		return (float)(bits & 0x1FFFFF) * (1.f / 2097152.f);
+	}
+
+	struct Grid
+	{
+		std::vector<XMFLOAT2> cells;	// point of each cell, row major
+		int count;						// cells per side
+		float cellSize;
+		float minDistanceSq;
+
+		// No point within the minimum distance of (x, z), which lies in cell (cellX, cellZ).
+		// The eight neighbours go first, a point too close is most likely in one of them.
+		bool isFree(float x, float z, int cellX, int cellZ) const
+		{
+			return isFree(x, z, cellX, cellZ, 1, false) && isFree(x, z, cellX, cellZ, k_Reach, true);
+		}
+
+		bool isFree(float x, float z, int cellX, int cellZ, int reach, bool ringOnly) const
+		{
+			int firstZ = std::max(cellZ - reach, 0), lastZ = std::min(cellZ + reach, count - 1);
+			int firstX = std::max(cellX - reach, 0), lastX = std::min(cellX + reach, count - 1);
+			for (int cz = firstZ; cz <= lastZ; cz++)
+			{
+				const XMFLOAT2* row = &cells[(size_t)cz * count];
+				bool innerRow = ringOnly && cz > cellZ - reach && cz < cellZ + reach;
+				for (int cx = firstX; cx <= lastX; cx += innerRow && cx == cellX - reach ? 2 * reach : 1)
+				{
+					if (row[cx].x == k_Empty)
+						continue;
+					float dx = row[cx].x - x, dz = row[cx].y - z;
+					if (dx * dx + dz * dz < minDistanceSq)
+						return false;
+				}
+			}
+			return true;
+		}
+	};
+}
+
+void PoissonScatter::scatter(const Settings& settings, const Heightfield& mask, const HeightfieldQuery* heights, std::vector<XMFLOAT3>& points, unsigned int maxThreads)
+{
+	points.clear();
+	if (mask.isEmpty() || settings.size <= 0.f || settings.minDistance <= 0.f)
+	{
+		return;
+	}
+
+	Grid grid;
+	grid.cellSize = settings.minDistance * k_InverseRootTwo;
+	grid.count = (int)std::ceil(settings.size / grid.cellSize);
+	grid.minDistanceSq = settings.minDistance * settings.minDistance;
+	grid.cells.assign((size_t)grid.count * grid.count, XMFLOAT2(k_Empty, k_Empty));
+
+	// Tiles of one phase are a tile apart, two cells at least, further than a candidate looks.
+	const int tileCells = std::max(settings.tileCells, k_Reach);
+	const int tileCount = (grid.count + tileCells - 1) / tileCells;
+	const int attempts = std::min(std::max(settings.attempts, 1), 256);
+	const unsigned long long seedKey = mix(settings.seed + 0x9e3779b97f4a7c15ull);
+	const float maskPerUnitX = mask.getWidth() / settings.size;
+	const float maskPerUnitZ = mask.getHeight() / settings.size;
+	std::vector<std::vector<XMFLOAT3>> tilePoints((size_t)tileCount * tileCount);
+
+	auto scatterTile = [&](int tileX, int tileZ, std::vector<int>& open)
+	{
+		std::vector<XMFLOAT3>& kept = tilePoints[(size_t)tileZ * tileCount + tileX];
+		int firstX = tileX * tileCells, lastX = std::min(firstX + tileCells, grid.count);
+		int firstZ = tileZ * tileCells, lastZ = std::min(firstZ + tileCells, grid.count);
+
+		// cells the mask leaves nothing in are never tried, nor are cells once they hold a point
+		open.clear();
+		for (int cz = firstZ; cz < lastZ; cz++)
+		{
+			int maskFirstZ = std::min((int)(cz * grid.cellSize * maskPerUnitZ), mask.getHeight() - 1);
+			int maskLastZ = std::min((int)((cz + 1) * grid.cellSize * maskPerUnitZ), mask.getHeight() - 1);
+			for (int cx = firstX; cx < lastX; cx++)
+			{
+				int maskFirstX = std::min((int)(cx * grid.cellSize * maskPerUnitX), mask.getWidth() - 1);
+				int maskLastX = std::min((int)((cx + 1) * grid.cellSize * maskPerUnitX), mask.getWidth() - 1);
+				bool covered = false;
+				for (int mz = maskFirstZ; mz <= maskLastZ && !covered; mz++)
+				{
+					const float* row = mask.getHeights() + (size_t)mz * mask.getWidth();
+					for (int mx = maskFirstX; mx <= maskLastX && !covered; mx++)
+						covered = row[mx] > 0.f;
+				}
+				if (covered)
+					open.push_back(cz * grid.count + cx);
+			}
+		}
+
+		for (int attempt = 0; attempt < attempts && !open.empty(); attempt++)
+		{
+			size_t stillOpen = 0;
+			for (size_t i = 0; i < open.size(); i++)
+			{
+				int cx = open[i] % grid.count, cz = open[i] / grid.count;
+
+				// x, z and the mask test from 21 bits each
+				unsigned long long bits = mix(seedKey ^ ((unsigned long long)open[i] << 8 | (unsigned long long)attempt));
+				float x = (cx + toUnit(bits)) * grid.cellSize;
+				float z = (cz + toUnit(bits >> 21)) * grid.cellSize;
+				int maskX = std::min((int)(x * maskPerUnitX), mask.getWidth() - 1);
+				int maskZ = std::min((int)(z * maskPerUnitZ), mask.getHeight() - 1);
+				if (x >= settings.size || z >= settings.size || toUnit(bits >> 42) >= mask.getHeights()[(size_t)maskZ * mask.getWidth() + maskX] ||
+					!grid.isFree(x, z, cx, cz))
+				{
+					open[stillOpen++] = open[i];
+					continue;
+				}
+
+				grid.cells[open[i]] = XMFLOAT2(x, z);
+				kept.push_back(XMFLOAT3(x, 0.f, z));
+			}
+			open.resize(stillOpen);
+		}
+
+		if (heights && !kept.empty())
+		{
+			std::vector<XMFLOAT2> ground(kept.size());
+			std::vector<float> y(kept.size());
+			for (size_t i = 0; i < kept.size(); i++)
+				ground[i] = XMFLOAT2(kept[i].x, kept[i].z);
+			heights->getHeights(ground.data(), (int)ground.size(), y.data());
+			for (size_t i = 0; i < kept.size(); i++)
+				kept[i].y = y[i];
+		}
+	};
+
+	size_t threadCount = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+	threadCount = threadCount < 1 ? 1 : threadCount;
+	std::vector<int> phaseTiles;
+	for (int phase = 0; phase < 4; phase++)
+	{
+		phaseTiles.clear();
+		for (int tileZ = phase >> 1; tileZ < tileCount; tileZ += 2)
+			for (int tileX = phase & 1; tileX < tileCount; tileX += 2)
+				phaseTiles.push_back(tileZ * tileCount + tileX);
+		if (phaseTiles.empty())
+			continue;
+
+		size_t jobCount = std::min(threadCount, phaseTiles.size());
+		ThreadPool::shared().runParallel(jobCount, [&](size_t job)
+		{
+			std::vector<int> open;
+			for (size_t i = job; i < phaseTiles.size(); i += jobCount)
+				scatterTile(phaseTiles[i] % tileCount, phaseTiles[i] / tileCount, open);
+		});
+	}
+
+	size_t total = 0;
+	for (const auto& tile : tilePoints)
+		total += tile.size();
+	points.reserve(total);
+	for (const auto& tile : tilePoints)
+		points.insert(points.end(), tile.begin(), tile.end());
+}
@@ -0,0 +1,46 @@
+/**
+* \class Poisson Scatter
+*
+* \brief Blue noise (Poisson disk) instance positions over a square, thinned by a mask image, on the CPU
+*
+* The square is covered by a grid of cells of the minimum distance over root two, so a cell holds at most one point and the points that can be
+* too close to a candidate lie within two cells of its own. Every empty cell is given a few candidates in turn, each one is kept when the mask
+* allows it and no kept point is closer than the minimum distance.
+* Candidates come from a counter based generator, a hash of the seed, the cell and the attempt, so none depends on the order the cells are visited in.
+* Cells are grouped into tiles run on worker threads in four phases, alternate tiles in each direction at once: tiles of a phase are at least
+* a tile apart and only see points of the phases before, so the scatter is the same whatever the thread count.
+*/
+
+
+#ifndef _POISSONSCATTER_H_
+#define _POISSONSCATTER_H_
+
+#include "Heightfield.h"
+#include "HeightfieldQuery.h"
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+class PoissonScatter
+{
+public:
+	/// Parameters of a scatter, the same parameters give the same points.
+	struct Settings
+	{
+		float size = 100.f;				///< side of the square, x and z from 0 to size, the mask covers it once
+		float minDistance = 2.f;		///< no two points are closer
+		int attempts = 8;				///< candidates per empty cell, more fill the gaps closer to a maximal set, at most 256
+		int tileCells = 32;				///< cells per side of a tile, the unit of work, at least 2
+		unsigned int seed = 1;
+	};
+
+	/** \brief Scatters the points, tile by tile with the tiles row by row
+	* @param mask is the density, a candidate over a texel of v is kept with probability v (nearest texel, row 0 at z = 0), e.g. a brush image loaded with Heightfield::load
+	* @param heights gives the y of every point, the points are left at 0 without it
+	* @param maxThreads limits the worker count, 0 uses all hardware threads
+	*/
+	static void scatter(const Settings& settings, const Heightfield& mask, const HeightfieldQuery* heights, std::vector<XMFLOAT3>& points, unsigned int maxThreads = 0);
+};
+
+#endif
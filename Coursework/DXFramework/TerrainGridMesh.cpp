@@ -0,0 +1,60 @@
+// Terrain grid mesh
+// Shared vertex grid in integer coordinates, indexed quadrant by quadrant.
+#include "terraingridmesh.h"
+
+TerrainGridMesh::TerrainGridMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int lresolution)
+{
+	resolution = lresolution + (lresolution & 1);
+	initBuffers(device);
+}
+
+// Release resources.
+TerrainGridMesh::~TerrainGridMesh()
+{
+	// Run parent deconstructor
+	BaseMesh::~BaseMesh();
+}
+
+void TerrainGridMesh::initBuffers(ID3D11Device* device)
+{
+	VertexType* vertices;
+	unsigned long* indices;
+	int side = resolution + 1;
+	int half = resolution / 2;
+
+	vertexCount = side * side;
+	indexCount = resolution * resolution * 6;
+	vertices = new VertexType[vertexCount];
+	indices = new unsigned long[indexCount];
+
+	int index = 0;
+	for (int z = 0; z < side; z++)
+	{
+		for (int x = 0; x < side; x++)
+		{
+			vertices[index].position = XMFLOAT3((float)x, 0.0f, (float)z);
+			vertices[index].texture = XMFLOAT2((float)x / resolution, (float)z / resolution);
+			vertices[index].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			index++;
+		}
+	}
+
+	// Each quarter is a block of the full grid, wound as PlaneMesh.
+	int count = 0;
+	for (int quadrant = 0; quadrant < 4; quadrant++)
+	{
+		unsigned long corner = (unsigned long)((quadrant >> 1) * half * side + (quadrant & 1) * half);
+		quadrants[quadrant].indexStart = (unsigned int)count;
+		quadrants[quadrant].indexCount = (unsigned int)MeshUtils::buildGridIndices(indices + count, half, half, corner, true, 16, side);
+		count += quadrants[quadrant].indexCount;
+	}
+
+	createVertexBuffer(device, vertices, vertexCount, sizeof(VertexType));
+	createIndexBuffer(device, indices, indexCount);
+
+	// Release the arrays now that the buffers have been created and loaded.
+	delete[] vertices;
+	vertices = 0;
+	delete[] indices;
+	indices = 0;
+}
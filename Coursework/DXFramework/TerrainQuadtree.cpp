@@ -0,0 +1,201 @@
+// Terrain quadtree
+// CDLOD node selection and culling over a heightmap min/max pyramid.
+#include "terrainquadtree.h"
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	// Texel index for the sampler, wrapped so edge nodes include the texels a wrapping sampler would blend in.
+	inline int wrapTexel(int texel, int count)
+	{
+		return ((texel % count) + count) % count;
+	}
+}
+
+TerrainQuadtree::TerrainQuadtree()
+{
+	for (int i = 0; i < k_MaxLods; i++)
+	{
+		ranges[i] = FLT_MAX;
+	}
+}
+
+// Leaves read their heightmap footprint, coarser levels merge their four children.
+void TerrainQuadtree::build(const Settings& lsettings, const float* heights, int width, int height, float texelScale, float uvOffset)
+{
+	settings = lsettings;
+	settings.lodCount = settings.lodCount < 1 ? 1 : settings.lodCount > k_MaxLods ? k_MaxLods : settings.lodCount;
+	settings.gridResolution += settings.gridResolution & 1;
+
+	// The root covers everything, whatever the distance.
+	for (int lod = 0; lod < settings.lodCount; lod++)
+	{
+		ranges[lod] = lod == settings.lodCount - 1 ? FLT_MAX : settings.leafRange * (float)(1 << lod);
+	}
+
+	int leaves = 1 << (settings.lodCount - 1);
+	bounds[0].assign((size_t)leaves * leaves, XMFLOAT2(0.f, settings.maxHeight));
+	if (heights && width > 0 && height > 0)
+	{
+		float texelsPerNode = texelScale / leaves;
+		for (int nodeZ = 0; nodeZ < leaves; nodeZ++)
+		{
+			// Bilinear taps around the footprint, texel centres sit at half texels.
+			int firstRow = (int)floorf((nodeZ * texelsPerNode + uvOffset) * height - 0.5f);
+			int lastRow = (int)floorf(((nodeZ + 1) * texelsPerNode + uvOffset) * height - 0.5f) + 1;
+			for (int nodeX = 0; nodeX < leaves; nodeX++)
+			{
+				int firstColumn = (int)floorf((nodeX * texelsPerNode + uvOffset) * width - 0.5f);
+				int lastColumn = (int)floorf(((nodeX + 1) * texelsPerNode + uvOffset) * width - 0.5f) + 1;
+
+				float low = FLT_MAX, high = -FLT_MAX;
+				for (int row = firstRow; row <= lastRow; row++)
+				{
+					const float* line = heights + (size_t)wrapTexel(row, height) * width;
+					for (int column = firstColumn; column <= lastColumn; column++)
+					{
+						float sample = line[wrapTexel(column, width)];
+						low = sample < low ? sample : low;
+						high = sample > high ? sample : high;
+					}
+				}
+				bounds[0][(size_t)nodeZ * leaves + nodeX] = XMFLOAT2(low * settings.maxHeight, high * settings.maxHeight);
+			}
+		}
+	}
+
+	for (int lod = 1; lod < settings.lodCount; lod++)
+	{
+		int count = leaves >> lod;
+		bounds[lod].resize((size_t)count * count);
+		for (int nodeZ = 0; nodeZ < count; nodeZ++)
+		{
+			for (int nodeX = 0; nodeX < count; nodeX++)
+			{
+				XMFLOAT2 merged(FLT_MAX, -FLT_MAX);
+				for (int child = 0; child < 4; child++)
+				{
+					const XMFLOAT2& childBounds = getBounds(lod - 1, nodeX * 2 + (child & 1), nodeZ * 2 + (child >> 1));
+					merged.x = childBounds.x < merged.x ? childBounds.x : merged.x;
+					merged.y = childBounds.y > merged.y ? childBounds.y : merged.y;
+				}
+				bounds[lod][(size_t)nodeZ * count + nodeX] = merged;
+			}
+		}
+	}
+}
+
+TerrainQuadtree::SelectionStats TerrainQuadtree::select(const Meshlets::CullView& view, const XMFLOAT3& eye, float lodBias, std::vector<Node>& nodes) const
+{
+	SelectionStats stats;
+	nodes.clear();
+
+	float lodRanges[k_MaxLods];
+	for (int lod = 0; lod < settings.lodCount; lod++)
+	{
+		lodRanges[lod] = ranges[lod] == FLT_MAX ? FLT_MAX : ranges[lod] / lodBias;
+	}
+
+	selectNode(settings.lodCount - 1, 0, 0, view, eye, lodRanges, nodes, stats);
+	return stats;
+}
+
+// Strugar's recursion: a node is drawn when in its own range, refined when in its children's, and children out of their
+// range are covered by the matching quarter of the parent.
+TerrainQuadtree::Result TerrainQuadtree::selectNode(int lod, int nodeX, int nodeZ, const Meshlets::CullView& view, const XMFLOAT3& eye, const float* lodRanges,
+	std::vector<Node>& nodes, SelectionStats& stats) const
+{
+	stats.visited++;
+
+	float size = getNodeSize(lod);
+	const XMFLOAT2& heights = getBounds(lod, nodeX, nodeZ);
+	XMFLOAT3 boxMin(nodeX * size, heights.x, nodeZ * size);
+	XMFLOAT3 boxMax(boxMin.x + size, heights.y, boxMin.z + size);
+
+	if (!isBoxVisible(view, boxMin, boxMax))
+	{
+		stats.culled++;
+		return Result::Culled;
+	}
+
+	if (!isBoxInRange(eye, lodRanges[lod], boxMin, boxMax))
+	{
+		return Result::OutOfRange;
+	}
+
+	if (lod == 0 || !isBoxInRange(eye, lodRanges[lod - 1], boxMin, boxMax))
+	{
+		addNode(lod, nodeX, nodeZ, -1, lodRanges, nodes, stats);
+		return Result::Selected;
+	}
+
+	for (int child = 0; child < 4; child++)
+	{
+		Result result = selectNode(lod - 1, nodeX * 2 + (child & 1), nodeZ * 2 + (child >> 1), view, eye, lodRanges, nodes, stats);
+		if (result == Result::OutOfRange)
+		{
+			addNode(lod, nodeX, nodeZ, child, lodRanges, nodes, stats);
+		}
+	}
+	return Result::Selected;
+}
+
+void TerrainQuadtree::addNode(int lod, int nodeX, int nodeZ, int quadrant, const float* lodRanges, std::vector<Node>& nodes, SelectionStats& stats) const
+{
+	float size = getNodeSize(lod);
+	const XMFLOAT2& heights = getBounds(lod, nodeX, nodeZ);
+
+	Node node;
+	node.x = nodeX * size;
+	node.z = nodeZ * size;
+	node.size = size;
+	node.lod = lod;
+	node.quadrant = quadrant;
+	node.minY = heights.x;
+	node.maxY = heights.y;
+
+	// The morph ends where the range ends, the root never morphs.
+	float previous = lod > 0 ? lodRanges[lod - 1] : 0.f;
+	node.morphEnd = lodRanges[lod];
+	node.morphStart = lodRanges[lod] == FLT_MAX ? FLT_MAX * 0.5f : previous + (lodRanges[lod] - previous) * settings.morphRatio;
+	nodes.push_back(node);
+
+	stats.selected++;
+	stats.triangles += quadrant < 0 ? getTrianglesPerNode() : getTrianglesPerNode() / 4;
+}
+
+const XMFLOAT2& TerrainQuadtree::getBounds(int lod, int nodeX, int nodeZ) const
+{
+	int count = 1 << (settings.lodCount - 1 - lod);
+	return bounds[lod][(size_t)nodeZ * count + nodeX];
+}
+
+// Positive vertex test, the box corner furthest along each plane normal.
+bool TerrainQuadtree::isBoxVisible(const Meshlets::CullView& view, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	for (const XMFLOAT4& plane : view.planes)
+	{
+		float x = plane.x >= 0.f ? boxMax.x : boxMin.x;
+		float y = plane.y >= 0.f ? boxMax.y : boxMin.y;
+		float z = plane.z >= 0.f ? boxMax.z : boxMin.z;
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < -view.margin)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool TerrainQuadtree::isBoxInRange(const XMFLOAT3& eye, float range, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	if (range == FLT_MAX)
+	{
+		return true;
+	}
+
+	float dx = eye.x < boxMin.x ? boxMin.x - eye.x : eye.x > boxMax.x ? eye.x - boxMax.x : 0.f;
+	float dy = eye.y < boxMin.y ? boxMin.y - eye.y : eye.y > boxMax.y ? eye.y - boxMax.y : 0.f;
+	float dz = eye.z < boxMin.z ? boxMin.z - eye.z : eye.z > boxMax.z ? eye.z - boxMax.z : 0.f;
+	return dx * dx + dy * dy + dz * dz <= range * range;
+}
@@ -0,0 +1,455 @@
+// Terrain streamer
+// Tiles generated on loader threads around the eye, cached within a memory budget and uploaded into a fixed pool of textures.
+#include "terrainstreamer.h"
+#include <directxpackedvector.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	float millisecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	ID3D11Texture2D* createSlotTexture(ID3D11Device* device, int side, DXGI_FORMAT format, ID3D11ShaderResourceView** view)
+	{
+		D3D11_TEXTURE2D_DESC desc = {};
+		desc.Width = (UINT)side;
+		desc.Height = (UINT)side;
+		desc.MipLevels = 1;
+		desc.ArraySize = 1;
+		desc.Format = format;
+		desc.SampleDesc.Count = 1;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		ID3D11Texture2D* texture = nullptr;
+		if (FAILED(device->CreateTexture2D(&desc, NULL, &texture)))
+		{
+			return nullptr;
+		}
+		device->CreateShaderResourceView(texture, NULL, view);
+		return texture;
+	}
+
+	// Layer weights by height as the landscape pixel shader blends its layers, the second layer also covering steep slopes.
+	unsigned int splatWeights(float height, float normalY, const XMFLOAT4& ranges, float steepSlope)
+	{
+		float weights[3] = { 0.f, 0.f, 0.f };
+		if (height < ranges.x)
+		{
+			weights[0] = 1.f;
+		}
+		else if (height < ranges.y)
+		{
+			float t = (height - ranges.x) / (ranges.y - ranges.x);
+			weights[0] = 1.f - t;
+			weights[1] = t;
+		}
+		else if (height < ranges.z)
+		{
+			weights[1] = 1.f;
+		}
+		else if (height < ranges.w)
+		{
+			float t = (height - ranges.z) / (ranges.w - ranges.z);
+			weights[1] = 1.f - t;
+			weights[2] = t;
+		}
+		else
+		{
+			weights[2] = 1.f;
+		}
+
+		// Fully the second layer a tenth below the steep slope.
+		float steep = (steepSlope - normalY) * 10.f;
+		steep = steep < 0.f ? 0.f : steep > 1.f ? 1.f : steep;
+		weights[0] *= 1.f - steep;
+		weights[2] *= 1.f - steep;
+		weights[1] = 1.f - weights[0] - weights[2];
+
+		unsigned int packed = 0xff000000u;
+		for (int i = 0; i < 3; i++)
+		{
+			packed |= (unsigned int)(weights[i] * 255.f + 0.5f) << (i * 8);
+		}
+		return packed;
+	}
+}
+
+TerrainStreamer::TerrainStreamer(ID3D11Device* device, const Settings& lsettings) :
+	settings(lsettings),
+	generator(lsettings.noise),
+	timeToResidentSum(0.0)
+{
+	unsigned int threads = settings.loaderThreads;
+	if (threads == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	loaders = new ThreadPool(threads);
+	settings.maxQueued = settings.maxQueued > 0 ? settings.maxQueued : (int)threads * 2;
+
+	// Every slot is made now, activating a tile only uploads into one.
+	const int samples = settings.tileQuads + 1;
+	for (int i = 0; device && i < settings.poolSlots; i++)
+	{
+		Slot slot;
+		slot.surface = createSlotTexture(device, samples, DXGI_FORMAT_R16G16B16A16_FLOAT, &slot.surfaceView);
+		slot.splat = createSlotTexture(device, samples, DXGI_FORMAT_R8G8B8A8_UNORM, &slot.splatView);
+		if (!slot.surface || !slot.splat)
+		{
+			break;
+		}
+		freeSlots.push_back((int)slots.size());
+		slots.push_back(slot);
+	}
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+	// Requests not started yet finish at once, the pool joins the rest.
+	for (auto& it : tiles)
+	{
+		if (it.second.data)
+		{
+			it.second.data->cancelled = true;
+		}
+	}
+	delete loaders;
+
+	for (auto& slot : slots)
+	{
+		slot.surfaceView->Release();
+		slot.splatView->Release();
+		slot.surface->Release();
+		slot.splat->Release();
+	}
+}
+
+float TerrainStreamer::getUvPerUnit() const
+{
+	return (float)settings.tileQuads / ((settings.tileQuads + 1) * settings.tileSize);
+}
+
+float TerrainStreamer::getUvOffset() const
+{
+	return 0.5f / (settings.tileQuads + 1);
+}
+
+void TerrainStreamer::update(ID3D11DeviceContext* deviceContext, const XMFLOAT3& eye)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	const float tileSize = settings.tileSize;
+
+	// Distance from the eye to the square of a tile, 0 over it.
+	auto tileDistance = [&](int x, int z)
+	{
+		float dx = std::max(std::max(x * tileSize - eye.x, eye.x - (x + 1) * tileSize), 0.f);
+		float dz = std::max(std::max(z * tileSize - eye.z, eye.z - (z + 1) * tileSize), 0.f);
+		return sqrtf(dx * dx + dz * dz);
+	};
+
+	for (auto& it : tiles)
+	{
+		it.second.wasWanted = it.second.wanted;
+		it.second.wanted = false;
+		it.second.distance = tileDistance(it.first.first, it.first.second);
+	}
+
+	// Tiles within the load radius, the ones not known yet become requests.
+	std::vector<std::pair<float, std::pair<int, int>>> requests;
+	int firstX = (int)floorf((eye.x - settings.loadRadius) / tileSize);
+	int lastX = (int)floorf((eye.x + settings.loadRadius) / tileSize);
+	int firstZ = (int)floorf((eye.z - settings.loadRadius) / tileSize);
+	int lastZ = (int)floorf((eye.z + settings.loadRadius) / tileSize);
+	for (int z = firstZ; z <= lastZ; z++)
+	{
+		for (int x = firstX; x <= lastX; x++)
+		{
+			float distance = tileDistance(x, z);
+			if (distance > settings.loadRadius)
+			{
+				continue;
+			}
+
+			auto found = tiles.find(std::make_pair(x, z));
+			if (found == tiles.end())
+			{
+				requests.push_back(std::make_pair(distance, std::make_pair(x, z)));
+				continue;
+			}
+
+			// Coming back into range counts from now.
+			Tile& tile = found->second;
+			if (tile.state != State::Resident && !tile.wasWanted)
+			{
+				tile.wantedSince = start;
+			}
+			tile.wanted = true;
+		}
+	}
+
+	// Finished jobs become cached tiles, requests that left the range are cancelled and dropped once their job is done.
+	int queued = 0;
+	for (auto it = tiles.begin(); it != tiles.end();)
+	{
+		Tile& tile = it->second;
+		if (tile.state == State::Queued)
+		{
+			tile.data->cancelled = !tile.wanted;
+			if (tile.job.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				queued++;
+				++it;
+				continue;
+			}
+
+			if (tile.data->surface.empty())
+			{
+				stats.cancelled++;
+				it = tiles.erase(it);
+				continue;
+			}
+			tile.state = State::Cached;
+			stats.generated++;
+			stats.generateMs = tile.data->generateMs;
+		}
+
+		// Out of range resident tiles free their slot and stay cached.
+		if (tile.state == State::Resident && tile.distance > settings.unloadRadius)
+		{
+			freeSlots.push_back(tile.slot);
+			tile.slot = -1;
+			tile.state = State::Cached;
+		}
+		++it;
+	}
+
+	// Nearest first, as many as the loaders may queue.
+	std::sort(requests.begin(), requests.end());
+	int submitted = 0;
+	for (auto& request : requests)
+	{
+		if (queued >= settings.maxQueued)
+		{
+			break;
+		}
+
+		Tile& tile = tiles[request.second];
+		tile.data = std::make_shared<TileData>();
+		tile.wanted = true;
+		tile.distance = request.first;
+		tile.wantedSince = start;
+		std::shared_ptr<TileData> data = tile.data;
+		int x = request.second.first;
+		int z = request.second.second;
+		tile.job = loaders->submit([this, data, x, z]()
+		{
+			if (!data->cancelled)
+			{
+				generate(x, z, *data);
+			}
+		});
+		queued++;
+		submitted++;
+	}
+
+	// A few uploads into free slots, nearest wanted tiles first.
+	std::vector<std::pair<float, Tile*>> uploads;
+	for (auto& it : tiles)
+	{
+		if (it.second.state == State::Cached && it.second.wanted)
+		{
+			uploads.push_back(std::make_pair(it.second.distance, &it.second));
+		}
+	}
+	std::sort(uploads.begin(), uploads.end(), [](const std::pair<float, Tile*>& a, const std::pair<float, Tile*>& b) { return a.first < b.first; });
+
+	// Tiles between the load and unload radius hold on to their slot until a wanted tile needs it, furthest first.
+	std::vector<std::pair<float, Tile*>> lingering;
+	for (auto& it : tiles)
+	{
+		if (it.second.state == State::Resident && !it.second.wanted)
+		{
+			lingering.push_back(std::make_pair(it.second.distance, &it.second));
+		}
+	}
+	std::sort(lingering.begin(), lingering.end(), [](const std::pair<float, Tile*>& a, const std::pair<float, Tile*>& b) { return a.first < b.first; });
+
+	const int samples = settings.tileQuads + 1;
+	int uploaded = 0;
+	for (auto& upload : uploads)
+	{
+		// Out of budget, a lingering tile keeps drawing rather than giving up its slot for an upload that will not happen.
+		if (!deviceContext || uploaded >= settings.uploadsPerUpdate)
+		{
+			break;
+		}
+
+		if (freeSlots.empty() && !lingering.empty())
+		{
+			Tile& released = *lingering.back().second;
+			freeSlots.push_back(released.slot);
+			released.slot = -1;
+			released.state = State::Cached;
+			lingering.pop_back();
+		}
+
+		if (freeSlots.empty())
+		{
+			break;
+		}
+
+		Tile& tile = *upload.second;
+		tile.slot = freeSlots.back();
+		freeSlots.pop_back();
+		const Slot& slot = slots[tile.slot];
+		deviceContext->UpdateSubresource(slot.surface, 0, NULL, tile.data->surface.data(), samples * sizeof(Heightfield::SurfaceTexel), 0);
+		deviceContext->UpdateSubresource(slot.splat, 0, NULL, tile.data->splat.data(), samples * sizeof(unsigned int), 0);
+		tile.state = State::Resident;
+		uploaded++;
+		stats.uploaded++;
+
+		float timeToResident = millisecondsSince(tile.wantedSince);
+		timeToResidentSum += timeToResident;
+		stats.timeToResidentMs = timeToResident;
+		stats.maxTimeToResidentMs = std::max(stats.maxTimeToResidentMs, timeToResident);
+		stats.averageTimeToResidentMs = (float)(timeToResidentSum / stats.uploaded);
+	}
+
+	evict();
+
+	stats.queued = queued;
+	stats.maxQueued = std::max(stats.maxQueued, queued);
+	stats.cached = 0;
+	stats.resident = 0;
+	stats.missing = 0;
+	residentTiles.clear();
+	for (auto& it : tiles)
+	{
+		const Tile& tile = it.second;
+		stats.cached += tile.state == State::Cached ? 1 : 0;
+		stats.missing += tile.wanted && tile.state != State::Resident ? 1 : 0;
+		if (tile.state == State::Resident)
+		{
+			stats.resident++;
+			const Slot& slot = slots[tile.slot];
+			ResidentTile resident = { it.first.first, it.first.second, XMFLOAT2(it.first.first * tileSize, it.first.second * tileSize),
+				slot.surfaceView, slot.splatView, &tile.data->quadtree };
+			residentTiles.push_back(resident);
+		}
+	}
+	stats.missing += (int)requests.size() - submitted;
+	stats.freeSlots = (int)freeSlots.size();
+	stats.cpuBytes = (size_t)(stats.cached + stats.resident) * getTileBytes();
+	stats.updateMs = millisecondsSince(start);
+	stats.maxUpdateMs = std::max(stats.maxUpdateMs, stats.updateMs);
+}
+
+void TerrainStreamer::finishLoading()
+{
+	for (auto& it : tiles)
+	{
+		if (it.second.state == State::Queued)
+		{
+			it.second.job.wait();
+		}
+	}
+}
+
+// Cached tiles out of range go, furthest first, until the tiles held fit the budget. Resident and wanted tiles are kept whatever the budget.
+void TerrainStreamer::evict()
+{
+	const size_t tileBytes = getTileBytes();
+	size_t held = 0;
+	std::vector<std::pair<float, std::pair<int, int>>> candidates;
+	for (auto& it : tiles)
+	{
+		if (it.second.state == State::Queued)
+		{
+			continue;
+		}
+
+		held += tileBytes;
+		if (it.second.state == State::Cached && !it.second.wanted)
+		{
+			candidates.push_back(std::make_pair(it.second.distance, it.first));
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+	while (held > settings.memoryBudget && !candidates.empty())
+	{
+		tiles.erase(candidates.back().second);
+		candidates.pop_back();
+		held -= tileBytes;
+		stats.evicted++;
+	}
+}
+
+size_t TerrainStreamer::getTileBytes() const
+{
+	size_t samples = (size_t)(settings.tileQuads + 1) * (settings.tileQuads + 1);
+	return samples * (sizeof(Heightfield::SurfaceTexel) + sizeof(unsigned int));
+}
+
+// Runs on a loader thread, reads only the settings and the generator.
+void TerrainStreamer::generate(int x, int z, TileData& data) const
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// The tile samples and a ring past them for the normals along the edges.
+	const int samples = settings.tileQuads + 1;
+	const int apron = samples + 2;
+	std::vector<float> heights((size_t)apron * apron);
+	for (int row = 0; row < apron; row++)
+	{
+		generator.sampleRow(x * settings.tileQuads - 1, z * settings.tileQuads - 1 + row, apron, &heights[(size_t)row * apron]);
+	}
+
+	std::vector<float> tileHeights((size_t)samples * samples);
+	for (int row = 0; row < samples; row++)
+	{
+		std::copy(&heights[(size_t)(row + 1) * apron + 1], &heights[(size_t)(row + 1) * apron + 1 + samples], &tileHeights[(size_t)row * samples]);
+	}
+
+	// The bake differences neighbours normalStep * width texels away against a run of 2 * normalStep in heights of 0 to 1.
+	// A step of one texel with the heights divided by the apron width in object space gives object space normals,
+	// and a bake height scale of that width puts the heights back in object space.
+	const float bakeScale = settings.tileSize / settings.tileQuads * apron;
+	for (auto& height : heights)
+	{
+		height *= settings.heightScale / bakeScale;
+	}
+
+	Heightfield field;
+	field.setHeights(heights.data(), apron, apron);
+	Heightfield::SurfaceSettings surface;
+	surface.heightScale = bakeScale;
+	surface.normalStep = 1.f / apron;
+	std::vector<Heightfield::SurfaceTexel> baked;
+	field.bakeSurface(surface, baked, 1);
+
+	data.surface.resize((size_t)samples * samples);
+	data.splat.resize(data.surface.size());
+	for (int row = 0; row < samples; row++)
+	{
+		for (int column = 0; column < samples; column++)
+		{
+			const Heightfield::SurfaceTexel& texel = baked[(size_t)(row + 1) * apron + column + 1];
+			size_t i = (size_t)row * samples + column;
+			data.surface[i] = texel;
+			data.splat[i] = splatWeights(tileHeights[i] * settings.heightScale, PackedVector::XMConvertHalfToFloat(texel.normal[1]),
+				settings.splatRanges, settings.steepSlope);
+		}
+	}
+
+	TerrainQuadtree::Settings lod = settings.lod;
+	lod.size = settings.tileSize;
+	lod.maxHeight = settings.heightScale;
+	data.quadtree.build(lod, tileHeights.data(), samples, samples, (float)settings.tileQuads / samples, getUvOffset());
+	data.generateMs = millisecondsSince(start);
+}
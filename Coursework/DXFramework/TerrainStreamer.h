@@ -0,0 +1,153 @@
+/**
+* \class Terrain Streamer
+*
+* \brief Procedural terrain tiles streamed in and out around the camera, generated on loader threads and drawn from a fixed pool of textures
+*
+* The world is a grid of square tiles. A tile holds its baked surface (normals and object space heights, as Heightfield bakes them),
+* splat weights of the three landscape layers and a CDLOD quadtree over its heights. Neighbouring tiles share their edge samples and
+* normals come from samples past the edge, so tiles meet without seams.
+* Every update requests the missing tiles within the load radius nearest first, collects the finished ones and uploads a few of them
+* into free texture slots. Nothing in update waits on a loader thread, a tile that is not ready is simply not drawn yet.
+* Generated tiles stay on the CPU once out of range, so turning back uploads them again without generating. The least needed ones
+* are dropped when the tiles held exceed the memory budget.
+*/
+
+
+#ifndef _TERRAINSTREAMER_H_
+#define _TERRAINSTREAMER_H_
+
+#include "HeightGenerator.h"
+#include "Heightfield.h"
+#include "TerrainQuadtree.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+
+class TerrainStreamer
+{
+public:
+	struct Settings
+	{
+		HeightGenerator::Settings noise;
+		TerrainQuadtree::Settings lod;		///< level of detail within a tile, size and maxHeight are taken from the tile
+		int tileQuads = 128;				///< grid quads along a tile, the tile textures are tileQuads + 1 samples a side
+		float tileSize = 64.f;				///< object space side of a tile
+		float heightScale = 50.f;			///< object space height of a generated height of 1
+		XMFLOAT4 splatRanges = XMFLOAT4(8.f, 14.f, 24.f, 32.f);	///< heights blending the layers, first to second over x to y, second to third over z to w
+		float steepSlope = 0.7f;			///< normal y below which the second layer takes over, rock on cliffs
+		float loadRadius = 192.f;			///< tiles coming this close to the eye are requested
+		float unloadRadius = 256.f;			///< resident tiles further than this give their slot back, above loadRadius so tiles on the edge do not thrash
+		int poolSlots = 64;					///< texture pairs created up front, tiles past them wait on the CPU for a slot
+		size_t memoryBudget = 64 << 20;		///< CPU bytes of the tiles held, resident ones included
+		int uploadsPerUpdate = 2;			///< texture uploads per update at most, spreads activation over frames
+		int maxQueued = 0;					///< tiles requested but not generated at most, 0 allows two per loader thread
+		unsigned int loaderThreads = 0;		///< 0 uses all hardware threads but one
+	};
+
+	/// Tile ready to draw, its quadtree is in tile space with the origin at (x * tileSize, z * tileSize).
+	struct ResidentTile
+	{
+		int x, z;
+		XMFLOAT2 origin;
+		ID3D11ShaderResourceView* surface;	///< baked normals and heights, DXGI_FORMAT_R16G16B16A16_FLOAT
+		ID3D11ShaderResourceView* splat;	///< layer weights in rgb, DXGI_FORMAT_R8G8B8A8_UNORM
+		const TerrainQuadtree* quadtree;
+	};
+
+	/// Loader and pool state, the counts are those after the last update.
+	struct Stats
+	{
+		int queued = 0;					///< requested and not generated yet, the loader queue depth
+		int maxQueued = 0;
+		int cached = 0;					///< generated and only on the CPU
+		int resident = 0;
+		int freeSlots = 0;
+		int missing = 0;				///< tiles within the load radius not resident yet
+		size_t cpuBytes = 0;
+		int generated = 0;				///< totals since the streamer was made
+		int uploaded = 0;
+		int evicted = 0;
+		int cancelled = 0;				///< requests that left the range before a loader thread got to them
+		float generateMs = 0.f;			///< loader thread time of the last tile generated
+		float timeToResidentMs = 0.f;	///< from entering the load radius to drawable, last tile
+		float averageTimeToResidentMs = 0.f;
+		float maxTimeToResidentMs = 0.f;
+		float updateMs = 0.f;			///< calling thread time of the last update, what the frame pays
+		float maxUpdateMs = 0.f;
+	};
+
+	/** \brief Makes the pool textures and starts the loader threads
+	* Without a device nothing is uploaded, tiles are generated and cached only.
+	*/
+	TerrainStreamer(ID3D11Device* device, const Settings& settings);
+	~TerrainStreamer();
+
+	/** \brief Requests, collects and uploads tiles around the eye, never waits on the loaders
+	* @param eye is in the object space of the terrain, only x and z are used
+	*/
+	void update(ID3D11DeviceContext* deviceContext, const XMFLOAT3& eye);
+
+	const std::vector<ResidentTile>& getResidentTiles() const { return residentTiles; }
+	const Stats& getStats() const { return stats; }
+	const Settings& getSettings() const { return settings; }
+	/// Uv per tile space unit and uv of the tile origin, texel centres land on the grid vertices.
+	float getUvPerUnit() const;
+	float getUvOffset() const;
+	/// Waits for the requested tiles, for measurements.
+	void finishLoading();
+
+private:
+	// Workers and tiles are owned.
+	TerrainStreamer(const TerrainStreamer&);
+	TerrainStreamer& operator=(const TerrainStreamer&);
+
+	/// Filled by a loader thread, read by the calling thread once its job is done.
+	struct TileData
+	{
+		std::vector<Heightfield::SurfaceTexel> surface;		///< empty when the request was cancelled before it ran
+		std::vector<unsigned int> splat;
+		TerrainQuadtree quadtree;
+		float generateMs = 0.f;
+		std::atomic<bool> cancelled;
+		TileData() : cancelled(false) {}
+	};
+
+	enum class State { Queued, Cached, Resident };
+
+	struct Tile
+	{
+		std::shared_ptr<TileData> data;
+		std::future<void> job;
+		State state = State::Queued;
+		int slot = -1;
+		bool wanted = false;			///< within the load radius at the last update
+		bool wasWanted = false;
+		float distance = 0.f;			///< from the eye to the tile square at the last update
+		std::chrono::high_resolution_clock::time_point wantedSince;
+	};
+
+	struct Slot
+	{
+		ID3D11Texture2D* surface = nullptr;
+		ID3D11Texture2D* splat = nullptr;
+		ID3D11ShaderResourceView* surfaceView = nullptr;
+		ID3D11ShaderResourceView* splatView = nullptr;
+	};
+
+	void generate(int x, int z, TileData& data) const;
+	size_t getTileBytes() const;
+	void evict();
+
+	Settings settings;
+	HeightGenerator generator;
+	ThreadPool* loaders;
+	std::map<std::pair<int, int>, Tile> tiles;
+	std::vector<Slot> slots;
+	std::vector<int> freeSlots;
+	std::vector<ResidentTile> residentTiles;
+	Stats stats;
+	double timeToResidentSum;
+};
+
+#endif
@@ -2,6 +2,33 @@
 // Loads and stores a single texture.
 // Handles .dds, .png and .jpg (probably).
 #include "TextureManager.h"
+#include <wincodec.h>
+#include <chrono>
+
+namespace
+{
+	// WIC needs COM on every thread using it, initialised for the lifetime of the object.
+	// A thread already initialised in another mode keeps it, WIC works in both.
+	class ComScope
+	{
+	public:
+		ComScope() { result = CoInitializeEx(NULL, COINIT_MULTITHREADED); }
+		~ComScope() { if (SUCCEEDED(result)) CoUninitialize(); }
+
+	private:
+		HRESULT result;
+	};
+
+	template<class T>
+	void releaseCom(T*& object)
+	{
+		if (object)
+		{
+			object->Release();
+			object = 0;
+		}
+	}
+}
 
 
  //Attempt to load texture. If load fails use default texture.
@@ -69,14 +96,235 @@ void TextureManager::loadTexture(const wchar_t* uid, const wchar_t* filename)
 	}
 }
 
-// Release resource.
+// Release resources. Images still decoding are dropped, their futures do not depend on the manager.
 TextureManager::~TextureManager()
 {
-	if (texture)
+	for (auto& it : pendingTextures)
+	{
+		releaseCom(it.texture);
+	}
+
+	// Every view was registered once, including the last one created which texture still points at.
+	for (auto& it : textureMap)
 	{
-		texture->Release();
-		texture = 0;
+		releaseCom(it.second);
 	}
+	texture = 0;
+}
+
+// Creates the texture at its final size straight away, so the view can be handed out before the image exists.
+ID3D11ShaderResourceView* TextureManager::loadTextureAsync(const wchar_t* uid, const wchar_t* filename, ThreadPool& pool, LoadedCallback onLoaded)
+{
+	if (!filename || !does_file_exist(filename))
+	{
+		MessageBox(NULL, L"Texture filename does not exist", L"ERROR", MB_OK);
+		return getTexture(uid);
+	}
+
+	// check file extension, DDS files are not decoded by WIC.
+	std::wstring fn(filename);
+	std::string::size_type idx = fn.rfind('.');
+	if (idx != std::string::npos && fn.substr(idx + 1) == L"dds")
+	{
+		loadTexture(uid, filename);
+		if (onLoaded)
+		{
+			onLoaded(uid, getTexture(uid));
+		}
+		return getTexture(uid);
+	}
+
+	// Only the header is read here, the pixels are decoded on the pool.
+	unsigned int width, height;
+	if (!readImageSize(filename, width, height))
+	{
+		MessageBox(NULL, L"Texture loading error", L"ERROR", MB_OK);
+		return getTexture(uid);
+	}
+
+	// Full mip chain, generated on the GPU once the image is uploaded.
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = 0;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	PendingTexture pending;
+	pending.texture = 0;
+	pending.view = 0;
+	if (FAILED(device->CreateTexture2D(&desc, NULL, &pending.texture)) || FAILED(device->CreateShaderResourceView(pending.texture, NULL, &pending.view)))
+	{
+		releaseCom(pending.texture);
+		MessageBox(NULL, L"Texture loading error", L"ERROR", MB_OK);
+		return getTexture(uid);
+	}
+
+	// Placeholder, white in every mip level like the default texture.
+	ID3D11RenderTargetView* target = 0;
+	if (SUCCEEDED(device->CreateRenderTargetView(pending.texture, NULL, &target)))
+	{
+		const float white[4] = { 1.f, 1.f, 1.f, 1.f };
+		deviceContext->ClearRenderTargetView(target, white);
+		deviceContext->GenerateMips(pending.view);
+		target->Release();
+	}
+
+	textureMap.insert(std::make_pair(const_cast<wchar_t*>(uid), pending.view));
+	texture = pending.view;
+
+	pending.uid = uid;
+	pending.filename = filename;
+	pending.onLoaded = onLoaded;
+	std::wstring file = pending.filename;
+	pending.image = pool.submit([file]() { return decodeImage(file); });
+	pendingTextures.push_back(std::move(pending));
+	return texture;
+}
+
+int TextureManager::update()
+{
+	for (size_t i = 0; i < pendingTextures.size();)
+	{
+		if (pendingTextures[i].image.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			i++;
+			continue;
+		}
+
+		// Taken out of the list first, callbacks may start new loads.
+		PendingTexture pending = std::move(pendingTextures[i]);
+		pendingTextures.erase(pendingTextures.begin() + i);
+		uploadTexture(pending);
+	}
+
+	return (int)pendingTextures.size();
+}
+
+bool TextureManager::isLoaded(const wchar_t* uid)
+{
+	for (auto& it : pendingTextures)
+	{
+		if (it.uid == uid)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void TextureManager::waitFor(const wchar_t* uid)
+{
+	for (auto& it : pendingTextures)
+	{
+		if (it.uid == uid)
+		{
+			it.image.wait();
+			break;
+		}
+	}
+	update();
+}
+
+// Copies the decoded image into the top level and rebuilds the mip chain. A failed decode keeps the placeholder.
+void TextureManager::uploadTexture(PendingTexture& pending)
+{
+	DecodedImage image = pending.image.get();
+
+	D3D11_TEXTURE2D_DESC desc;
+	pending.texture->GetDesc(&desc);
+
+	if (image.pixels.empty() || image.width != desc.Width || image.height != desc.Height)
+	{
+		MessageBox(NULL, pending.filename.c_str(), L"Texture loading error", MB_OK);
+	}
+	else
+	{
+		deviceContext->UpdateSubresource(pending.texture, 0, NULL, image.pixels.data(), image.width * 4, 0);
+		deviceContext->GenerateMips(pending.view);
+	}
+
+	// The view keeps the texture alive.
+	releaseCom(pending.texture);
+
+	if (pending.onLoaded)
+	{
+		pending.onLoaded(pending.uid.c_str(), pending.view);
+	}
+}
+
+// Reads the image dimensions without decoding the pixels.
+bool TextureManager::readImageSize(const wchar_t* filename, unsigned int& width, unsigned int& height)
+{
+	ComScope com;
+	IWICImagingFactory* factory = 0;
+	IWICBitmapDecoder* decoder = 0;
+	IWICBitmapFrameDecode* frame = 0;
+
+	HRESULT result = CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+	if (SUCCEEDED(result))
+		result = factory->CreateDecoderFromFilename(filename, NULL, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder);
+	if (SUCCEEDED(result))
+		result = decoder->GetFrame(0, &frame);
+	if (SUCCEEDED(result))
+		result = frame->GetSize(&width, &height);
+
+	releaseCom(frame);
+	releaseCom(decoder);
+	releaseCom(factory);
+	return SUCCEEDED(result) && width > 0 && height > 0;
+}
+
+// Decodes the first frame of the image to 32 bit RGBA, runs on the pool.
+TextureManager::DecodedImage TextureManager::decodeImage(const std::wstring& filename)
+{
+	ComScope com;
+	DecodedImage image;
+	IWICImagingFactory* factory = 0;
+	IWICBitmapDecoder* decoder = 0;
+	IWICBitmapFrameDecode* frame = 0;
+	IWICFormatConverter* converter = 0;
+
+	HRESULT result = CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+	if (SUCCEEDED(result))
+		result = factory->CreateDecoderFromFilename(filename.c_str(), NULL, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder);
+	if (SUCCEEDED(result))
+		result = decoder->GetFrame(0, &frame);
+	if (SUCCEEDED(result))
+		result = frame->GetSize(&image.width, &image.height);
+	if (SUCCEEDED(result))
+		result = factory->CreateFormatConverter(&converter);
+	if (SUCCEEDED(result))
+		result = converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom);
+	if (SUCCEEDED(result))
+	{
+		image.pixels.resize((size_t)image.width * image.height * 4);
+		result = converter->CopyPixels(NULL, image.width * 4, (UINT)image.pixels.size(), image.pixels.data());
+	}
+
+	if (FAILED(result))
+	{
+		image.pixels.clear();
+	}
+
+	releaseCom(converter);
+	releaseCom(frame);
+	releaseCom(decoder);
+	releaseCom(factory);
+	return image;
+}
+
+bool TextureManager::readImagePixels(const wchar_t* filename, std::vector<unsigned char>& pixels, unsigned int& width, unsigned int& height)
+{
+	DecodedImage image = decodeImage(filename);
+	pixels.swap(image.pixels);
+	width = image.width;
+	height = image.height;
+	return !pixels.empty();
 }
 
 // Return texture as a shader resource.
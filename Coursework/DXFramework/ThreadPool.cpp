@@ -0,0 +1,73 @@
+// Thread pool
+// Worker threads taking jobs from a shared queue.
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	stopping = false;
+
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+	if (threadCount == 0)
+	{
+		threadCount = 1;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool& ThreadPool::shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+// Let the workers empty the queue, then join them.
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+			{
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		// Exceptions end up in the future of the job, packaged_task catches them.
+		job();
+	}
+}
@@ -0,0 +1,193 @@
+// Token scanner
+// Splits a borrowed text buffer into tokens and lines without copying it.
+#include "tokenscanner.h"
+#include <emmintrin.h>
+#include <intrin.h>
+
+namespace
+{
+	// Index of the lowest set bit of a non zero mask.
+	inline int lowestBit(unsigned int mask)
+	{
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (int)index;
+	}
+}
+
+TokenScanner::TokenScanner()
+{
+	setBuffer(nullptr, 0);
+	setDelimiters(nullptr);
+}
+
+TokenScanner::TokenScanner(const char* data, size_t size, const char* delimiters)
+{
+	setBuffer(data, size);
+	setDelimiters(delimiters);
+}
+
+TokenScanner::TokenScanner(const View& text, const char* delimiters)
+{
+	setBuffer(text.data, text.size);
+	setDelimiters(delimiters);
+}
+
+void TokenScanner::setBuffer(const char* data, size_t size)
+{
+	begin = data;
+	end = data + size;
+	cursor = begin;
+}
+
+// The lookup table serves the skipping and short tokens, the vector compares only pay off on longer runs.
+void TokenScanner::setDelimiters(const char* delimiters)
+{
+	memset(isDelimiter, 0, sizeof(isDelimiter));
+	vectorDelimiterCount = 0;
+	controlDelimiters = !delimiters;
+
+	if (!delimiters)
+	{
+		// Control characters and the space, TokenStream's default.
+		for (int c = 0; c <= ' '; c++)
+		{
+			isDelimiter[c] = true;
+		}
+		isDelimiter[127] = true;
+		return;
+	}
+
+	int count = 0;
+	for (const char* d = delimiters; *d; d++, count++)
+	{
+		isDelimiter[(unsigned char)*d] = true;
+		if (count < k_MaxVectorDelimiters)
+		{
+			vectorDelimiters[count] = *d;
+		}
+	}
+	vectorDelimiterCount = count <= k_MaxVectorDelimiters ? count : 0;
+}
+
+void TokenScanner::reset()
+{
+	cursor = begin;
+}
+
+bool TokenScanner::nextToken(View& token)
+{
+	while (cursor < end && isDelimiter[(unsigned char)*cursor])
+	{
+		cursor++;
+	}
+	if (cursor >= end)
+	{
+		return false;
+	}
+
+	const char* start = cursor;
+	if (*start == '"')
+	{
+		const char* quote = findByte(start + 1, end, '"');
+		cursor = quote < end ? quote + 1 : end;
+	}
+	else
+	{
+		cursor = findDelimiter(start + 1);
+	}
+
+	token.data = start;
+	token.size = (size_t)(cursor - start);
+	return true;
+}
+
+bool TokenScanner::nextLine(View& line)
+{
+	if (cursor >= end)
+	{
+		return false;
+	}
+
+	const char* lineEnd = findByte(cursor, end, '\n');
+	line.data = cursor;
+	line.size = (size_t)(lineEnd - cursor);
+	if (line.size > 0 && line.data[line.size - 1] == '\r')
+	{
+		line.size--;
+	}
+
+	cursor = lineEnd < end ? lineEnd + 1 : end;
+	return true;
+}
+
+const char* TokenScanner::findByte(const char* p, const char* end, char value)
+{
+	const __m128i pattern = _mm_set1_epi8(value);
+	for (; p + 16 <= end; p += 16)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, pattern));
+		if (mask)
+		{
+			return p + lowestBit(mask);
+		}
+	}
+
+	while (p < end && *p != value)
+	{
+		p++;
+	}
+	return p;
+}
+
+// Loads stay inside the buffer, the last partial block is scanned with the table.
+const char* TokenScanner::findDelimiter(const char* p) const
+{
+	if (controlDelimiters)
+	{
+		// Unsigned byte <= space, when the minimum with the space is the byte itself.
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i del = _mm_set1_epi8(127);
+		for (; p + 16 <= end; p += 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			__m128i hits = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(bytes, space), bytes), _mm_cmpeq_epi8(bytes, del));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+			if (mask)
+			{
+				return p + lowestBit(mask);
+			}
+		}
+	}
+	else if (vectorDelimiterCount > 0)
+	{
+		__m128i patterns[k_MaxVectorDelimiters];
+		for (int i = 0; i < vectorDelimiterCount; i++)
+		{
+			patterns[i] = _mm_set1_epi8(vectorDelimiters[i]);
+		}
+
+		for (; p + 16 <= end; p += 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			__m128i hits = _mm_cmpeq_epi8(bytes, patterns[0]);
+			for (int i = 1; i < vectorDelimiterCount; i++)
+			{
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, patterns[i]));
+			}
+
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+			if (mask)
+			{
+				return p + lowestBit(mask);
+			}
+		}
+	}
+
+	while (p < end && !isDelimiter[(unsigned char)*p])
+	{
+		p++;
+	}
+	return p;
+}
@@ -0,0 +1,74 @@
+/**
+* \class Token Scanner
+*
+* \brief Non allocating tokenizer over a borrowed text buffer
+*
+* Replaces TokenStream for text asset parsing. The buffer is not copied, it has to outlive the scanner (a MappedFile view for example),
+* and tokens and lines are returned as views into it, so scanning never allocates.
+* Delimiters and newlines are found 16 bytes at a time with SSE2 compares.
+*/
+
+
+#ifndef _TOKENSCANNER_H_
+#define _TOKENSCANNER_H_
+
+#include <string>
+#include <cstring>
+
+class TokenScanner
+{
+public:
+	/// Borrowed piece of the buffer, a minimal string_view. Not null terminated.
+	struct View
+	{
+		const char* data = nullptr;
+		size_t size = 0;
+
+		bool empty() const { return size == 0; }
+		bool operator==(const char* text) const { return strlen(text) == size && memcmp(data, text, size) == 0; }
+		bool operator!=(const char* text) const { return !(*this == text); }
+		bool startsWith(const char* prefix) const { size_t length = strlen(prefix); return length <= size && memcmp(data, prefix, length) == 0; }
+		std::string str() const { return std::string(data, size); }		///< Copies the view, allocates
+	};
+
+	/// Empty scanner, whitespace delimited.
+	TokenScanner();
+	/** \brief Scans size bytes at data, nothing is copied
+	* @param delimiters is a null terminated set of single byte delimiters, null uses every byte up to and including the space
+	*/
+	TokenScanner(const char* data, size_t size, const char* delimiters = nullptr);
+	TokenScanner(const View& text, const char* delimiters = nullptr);
+
+	void setBuffer(const char* data, size_t size);
+	void setDelimiters(const char* delimiters);
+	void reset();			///< Back to the start of the buffer
+
+	/** \brief Skips delimiters and returns the run of bytes up to the next one
+	* A token starting with a double quote runs to the closing quote, delimiters included, as TokenStream did.
+	* @return false once only delimiters are left
+	*/
+	bool nextToken(View& token);
+	/// Returns the rest of the current line without its line break (LF or CRLF) and moves to the next one. Empty lines are returned too.
+	bool nextLine(View& line);
+
+	bool atEnd() const { return cursor >= end; }
+	size_t getPosition() const { return (size_t)(cursor - begin); }
+
+	/// First occurrence of value in [p, end), or end. SSE2, the same result as memchr.
+	static const char* findByte(const char* p, const char* end, char value);
+
+private:
+	static const int k_MaxVectorDelimiters = 4;
+
+	const char* findDelimiter(const char* p) const;
+
+	const char* begin;
+	const char* end;
+	const char* cursor;
+	bool isDelimiter[256];
+	char vectorDelimiters[k_MaxVectorDelimiters];	///< compared 16 bytes at a time when the set is small enough
+	int vectorDelimiterCount;						///< 0 falls back to the lookup table
+	bool controlDelimiters;							///< default set, compared as a range
+};
+
+#endif
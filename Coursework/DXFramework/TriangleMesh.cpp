@@ -69,6 +69,7 @@ void TriangleMesh::initBuffers(ID3D11Device* device)
 	//vertexData.SysMemSlicePitch = 0;
 	// Now create the vertex buffer.
 	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
+	vertexStride = sizeof(VertexType);
 	
 	indexBufferDesc = {sizeof(unsigned long) * indexCount, D3D11_USAGE_DEFAULT, D3D11_BIND_INDEX_BUFFER, 0, 0, 0};
 	indexData = {indices, 0, 0};
@@ -0,0 +1,240 @@
+// Vertex packing
+// Quantises full float vertices into the 16 byte packed layout and back.
+#include "vertexpacking.h"
+#include <directxpackedvector.h>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	// Worst case angle between a unit normal and its octahedral snorm16 encoding. Each component is off by at most half a step (1/65534),
+	// measured at 0.0037 degrees over millions of random normals once the octahedral stretch is included, rounded up.
+	const float k_OctahedralErrorDegrees = 0.0045f;
+
+	const float k_RadiansToDegrees = 57.2957795f;
+
+	float signNotZero(float value)
+	{
+		return value >= 0.f ? 1.f : -1.f;
+	}
+
+	float clampUnit(float value, float low)
+	{
+		return value < low ? low : (value > 1.f ? 1.f : value);
+	}
+}
+
+unsigned short VertexPacking::encodeUnorm16(float value)
+{
+	return (unsigned short)(clampUnit(value, 0.f) * 65535.f + 0.5f);
+}
+
+float VertexPacking::decodeUnorm16(unsigned short value)
+{
+	return value / 65535.f;
+}
+
+short VertexPacking::encodeSnorm16(float value)
+{
+	return (short)std::floor(clampUnit(value, -1.f) * 32767.f + 0.5f);
+}
+
+float VertexPacking::decodeSnorm16(short value)
+{
+	// -32768 and -32767 both map to -1
+	return value == -32768 ? -1.f : value / 32767.f;
+}
+
+unsigned short VertexPacking::encodeHalf(float value)
+{
+	return PackedVector::XMConvertFloatToHalf(value);
+}
+
+float VertexPacking::decodeHalf(unsigned short value)
+{
+	return PackedVector::XMConvertHalfToFloat(value);
+}
+
+// Projects the normal on the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper one (Cigolle et al. 2014).
+void VertexPacking::encodeOctahedral(const XMFLOAT3& normal, short encoded[2])
+{
+	float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if (length <= 0.f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float u = normal.x / length;
+	float v = normal.y / length;
+	if (normal.z < 0.f)
+	{
+		float foldedU = (1.f - std::fabs(v)) * signNotZero(u);
+		float foldedV = (1.f - std::fabs(u)) * signNotZero(v);
+		u = foldedU;
+		v = foldedV;
+	}
+
+	encoded[0] = encodeSnorm16(u);
+	encoded[1] = encodeSnorm16(v);
+}
+
+XMFLOAT3 VertexPacking::decodeOctahedral(const short encoded[2])
+{
+	float u = decodeSnorm16(encoded[0]);
+	float v = decodeSnorm16(encoded[1]);
+	float z = 1.f - std::fabs(u) - std::fabs(v);
+	if (z < 0.f)
+	{
+		float unfoldedU = (1.f - std::fabs(v)) * signNotZero(u);
+		float unfoldedV = (1.f - std::fabs(u)) * signNotZero(v);
+		u = unfoldedU;
+		v = unfoldedV;
+	}
+
+	XMFLOAT3 normal;
+	XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(u, v, z, 0.f)));
+	return normal;
+}
+
+VertexPacking::Quantisation VertexPacking::computeQuantisation(const Vertex* vertices, int count)
+{
+	Quantisation quantisation;
+	if (count <= 0)
+	{
+		return quantisation;
+	}
+
+	XMVECTOR boundsMin = XMLoadFloat3(&vertices[0].position);
+	XMVECTOR boundsMax = boundsMin;
+	for (int i = 1; i < count; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&vertices[i].position);
+		boundsMin = XMVectorMin(boundsMin, position);
+		boundsMax = XMVectorMax(boundsMax, position);
+	}
+
+	XMStoreFloat3(&quantisation.offset, boundsMin);
+	XMStoreFloat3(&quantisation.scale, XMVectorSubtract(boundsMax, boundsMin));
+	return quantisation;
+}
+
+VertexPacking::ErrorBounds VertexPacking::getErrorBounds(const Quantisation& quantisation, float maxTexture)
+{
+	ErrorBounds bounds;
+
+	// Half a unorm16 step of the widest axis, plus the float rounding of the offset + unorm * scale reconstruction.
+	float maxScale = 0.f;
+	float maxMagnitude = 0.f;
+	const float scale[3] = { quantisation.scale.x, quantisation.scale.y, quantisation.scale.z };
+	const float offset[3] = { quantisation.offset.x, quantisation.offset.y, quantisation.offset.z };
+	for (int i = 0; i < 3; i++)
+	{
+		float magnitude = std::fabs(offset[i]) + scale[i];
+		maxScale = scale[i] > maxScale ? scale[i] : maxScale;
+		maxMagnitude = magnitude > maxMagnitude ? magnitude : maxMagnitude;
+	}
+	bounds.position = maxScale / (2.f * 65535.f) + maxMagnitude * 2.f * FLT_EPSILON;
+
+	// Half a half float ulp at the largest magnitude, 10 mantissa bits. Values below 2^-14 are denormal with a fixed ulp of 2^-24.
+	int exponent = 0;
+	std::frexp(maxTexture, &exponent);
+	bounds.texture = std::ldexp(1.f, (exponent - 12) > -25 ? exponent - 12 : -25);
+
+	bounds.normalDegrees = k_OctahedralErrorDegrees;
+	return bounds;
+}
+
+float VertexPacking::getMaxTexture(const Vertex* vertices, int count)
+{
+	float maxTexture = 0.f;
+	for (int i = 0; i < count; i++)
+	{
+		float u = std::fabs(vertices[i].texture.x);
+		float v = std::fabs(vertices[i].texture.y);
+		maxTexture = u > maxTexture ? u : maxTexture;
+		maxTexture = v > maxTexture ? v : maxTexture;
+	}
+	return maxTexture;
+}
+
+void VertexPacking::packVertices(const Vertex* vertices, int count, const Quantisation& quantisation, PackedVertex* packed)
+{
+	// Flat axes decode to the offset whatever is stored, avoid the division.
+	float inverseScale[3] = {
+		quantisation.scale.x > 0.f ? 1.f / quantisation.scale.x : 0.f,
+		quantisation.scale.y > 0.f ? 1.f / quantisation.scale.y : 0.f,
+		quantisation.scale.z > 0.f ? 1.f / quantisation.scale.z : 0.f
+	};
+
+	for (int i = 0; i < count; i++)
+	{
+		const Vertex& vertex = vertices[i];
+		PackedVertex& out = packed[i];
+
+		out.position[0] = encodeUnorm16((vertex.position.x - quantisation.offset.x) * inverseScale[0]);
+		out.position[1] = encodeUnorm16((vertex.position.y - quantisation.offset.y) * inverseScale[1]);
+		out.position[2] = encodeUnorm16((vertex.position.z - quantisation.offset.z) * inverseScale[2]);
+		out.position[3] = 65535;
+
+		out.texture[0] = encodeHalf(vertex.texture.x);
+		out.texture[1] = encodeHalf(vertex.texture.y);
+
+		encodeOctahedral(vertex.normal, out.normal);
+	}
+}
+
+void VertexPacking::unpackVertices(const PackedVertex* packed, int count, const Quantisation& quantisation, Vertex* vertices)
+{
+	for (int i = 0; i < count; i++)
+	{
+		const PackedVertex& vertex = packed[i];
+		Vertex& out = vertices[i];
+
+		out.position.x = quantisation.offset.x + decodeUnorm16(vertex.position[0]) * quantisation.scale.x;
+		out.position.y = quantisation.offset.y + decodeUnorm16(vertex.position[1]) * quantisation.scale.y;
+		out.position.z = quantisation.offset.z + decodeUnorm16(vertex.position[2]) * quantisation.scale.z;
+		out.texture.x = decodeHalf(vertex.texture[0]);
+		out.texture.y = decodeHalf(vertex.texture[1]);
+		out.normal = decodeOctahedral(vertex.normal);
+	}
+}
+
+VertexPacking::ErrorBounds VertexPacking::measureError(const Vertex* vertices, const PackedVertex* packed, int count, const Quantisation& quantisation)
+{
+	ErrorBounds error;
+
+	for (int i = 0; i < count; i++)
+	{
+		Vertex decoded;
+		unpackVertices(&packed[i], 1, quantisation, &decoded);
+		const Vertex& source = vertices[i];
+
+		float position[3] = {
+			std::fabs(decoded.position.x - source.position.x),
+			std::fabs(decoded.position.y - source.position.y),
+			std::fabs(decoded.position.z - source.position.z)
+		};
+		for (float it : position)
+			error.position = it > error.position ? it : error.position;
+
+		float texture[2] = { std::fabs(decoded.texture.x - source.texture.x), std::fabs(decoded.texture.y - source.texture.y) };
+		for (float it : texture)
+			error.texture = it > error.texture ? it : error.texture;
+
+		// Zero length source normals have no direction to lose. atan2 keeps precision for tiny angles where acos of the dot does not.
+		XMVECTOR sourceNormal = XMLoadFloat3(&source.normal);
+		if (XMVectorGetX(XMVector3LengthSq(sourceNormal)) > 0.f)
+		{
+			sourceNormal = XMVector3Normalize(sourceNormal);
+			XMVECTOR decodedNormal = XMLoadFloat3(&decoded.normal);
+			float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(sourceNormal, decodedNormal)));
+			float cosine = XMVectorGetX(XMVector3Dot(sourceNormal, decodedNormal));
+			float degrees = std::atan2(sine, cosine) * k_RadiansToDegrees;
+			error.normalDegrees = degrees > error.normalDegrees ? degrees : error.normalDegrees;
+		}
+	}
+
+	return error;
+}
@@ -0,0 +1,170 @@
+// Water mesh
+// Grid of a PlaneMesh, trimmed to the quads where the water is above the terrain.
+#include "watermesh.h"
+#include "meshutils.h"
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	inline int wrap(int texel, int count)
+	{
+		return ((texel % count) + count) % count;
+	}
+}
+
+WaterMesh::WaterMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const Heightfield& heightfield, const Settings& lsettings, float llevel) :
+	settings(lsettings),
+	level(llevel)
+{
+	// Lowest texel of every quad, widened by a texel on each side as the bilinear filter reaches that far.
+	int quads = settings.resolution - 1;
+	quadFloors.assign((size_t)quads * quads, -FLT_MAX);
+	const float* heights = heightfield.getHeights();
+	int width = heightfield.getWidth();
+	int height = heightfield.getHeight();
+	if (heights)
+	{
+		for (int z = 0; z < quads; z++)
+		{
+			int firstRow = (int)floorf((settings.terrainOffset.y + z) * settings.uvPerUnit * height - 0.5f);
+			int lastRow = (int)ceilf((settings.terrainOffset.y + z + 1) * settings.uvPerUnit * height - 0.5f);
+			for (int x = 0; x < quads; x++)
+			{
+				int firstColumn = (int)floorf((settings.terrainOffset.x + x) * settings.uvPerUnit * width - 0.5f);
+				int lastColumn = (int)ceilf((settings.terrainOffset.x + x + 1) * settings.uvPerUnit * width - 0.5f);
+
+				float floor = FLT_MAX;
+				for (int row = firstRow; row <= lastRow; row++)
+				{
+					const float* texels = heights + (size_t)wrap(row, height) * width;
+					for (int column = firstColumn; column <= lastColumn; column++)
+					{
+						float sample = texels[wrap(column, width)];
+						floor = sample < floor ? sample : floor;
+					}
+				}
+				quadFloors[(size_t)z * quads + x] = floor * settings.heightScale;
+			}
+		}
+	}
+
+	initBuffers(device);
+}
+
+// Release resources.
+WaterMesh::~WaterMesh()
+{
+	// Run parent deconstructor
+	BaseMesh::~BaseMesh();
+}
+
+int WaterMesh::getQuadCount()
+{
+	return indexCount / 6;
+}
+
+void WaterMesh::setLevel(ID3D11Device* device, float llevel)
+{
+	if (llevel == level)
+	{
+		return;
+	}
+
+	level = llevel;
+	if (indexBuffer)
+	{
+		indexBuffer->Release();
+		indexBuffer = 0;
+	}
+	if (vertexBuffer)
+	{
+		vertexBuffer->Release();
+		vertexBuffer = 0;
+	}
+	initBuffers(device);
+}
+
+// Wet quads and their neighbours, with the vertices they use in row major order and the corners split as in PlaneMesh.
+void WaterMesh::initBuffers(ID3D11Device* device)
+{
+	int resolution = settings.resolution;
+	int quads = resolution - 1;
+
+	std::vector<unsigned char> wet((size_t)quads * quads, 0);
+	for (size_t i = 0; i < wet.size(); i++)
+	{
+		wet[i] = quadFloors[i] - settings.margin < level;
+	}
+
+	std::vector<unsigned char> kept((size_t)quads * quads, 0);
+	for (int z = 0; z < quads; z++)
+	{
+		for (int x = 0; x < quads; x++)
+		{
+			bool nearWater = false;
+			for (int dz = -1; dz <= 1 && !nearWater; dz++)
+			{
+				for (int dx = -1; dx <= 1 && !nearWater; dx++)
+				{
+					int nx = x + dx;
+					int nz = z + dz;
+					nearWater = nx >= 0 && nz >= 0 && nx < quads && nz < quads && wet[(size_t)nz * quads + nx];
+				}
+			}
+			kept[(size_t)z * quads + x] = nearWater;
+		}
+	}
+
+	// Grid vertices of the kept quads, numbered in first use order.
+	std::vector<unsigned long> remap((size_t)resolution * resolution, ~0ul);
+	std::vector<VertexType> vertices;
+	std::vector<unsigned long> indices;
+	float increment = 1.0f / resolution;
+	auto vertex = [&](int x, int z)
+	{
+		unsigned long& index = remap[(size_t)z * resolution + x];
+		if (index == ~0ul)
+		{
+			index = (unsigned long)vertices.size();
+			VertexType added;
+			added.position = XMFLOAT3((float)x, 0.0f, (float)z);
+			added.texture = XMFLOAT2(x * increment, z * increment);
+			added.normal = XMFLOAT3(0.0, 1.0, 0.0);
+			vertices.push_back(added);
+		}
+		return index;
+	};
+
+	for (int z = 0; z < quads; z++)
+	{
+		for (int x = 0; x < quads; x++)
+		{
+			if (!kept[(size_t)z * quads + x])
+			{
+				continue;
+			}
+
+			unsigned long a = vertex(x, z);
+			unsigned long b = vertex(x + 1, z);
+			unsigned long c = vertex(x, z + 1);
+			unsigned long d = vertex(x + 1, z + 1);
+			unsigned long quad[6] = { a, d, c, a, b, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	vertexCount = (int)vertices.size();
+	indexCount = (int)indices.size();
+	if (indices.empty())
+	{
+		// Nothing above the terrain, drawn as an empty range.
+		return;
+	}
+
+	MeshUtils::optimiseVertexCache(indices.data(), indexCount, vertexCount);
+
+	// Flat like the plane, the y axis of the positions decodes exactly.
+	createPackedVertexBuffer(device, vertices.data(), vertexCount);
+	createIndexBuffer(device, indices.data(), indexCount);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#ifndef _CHECK_H
+#define _CHECK_H
+#include <cstdio>
+
+//! checks of the console test target, a failed check prints where it is and the run carries on
+//! main returns the failures, so the target fails the build step or script running it
+namespace Check
+{
+	//! failed checks since the start of the run
+	int& failures();
+
+	inline bool report(bool passed, const char* condition, const char* file, int line)
+	{
+		if (!passed)
+		{
+			std::printf("%s(%d): failed %s\n", file, line, condition);
+			failures()++;
+		}
+		return passed;
+	}
+}
+
+//! evaluates to the condition, so loops can stop at the first failure instead of printing one line per element
+#define CHECK(condition) Check::report((condition) ? true : false, #condition, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,116 @@
+// Depth sort tests
+// The bitonic passes run on the CPU against std::sort, then the compute shaders on a WARP device against that reference.
+#include "Check.h"
+#include "TestDevice.h"
+#include "../Coursework/GPUDepthSort.h"
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	//! point counts around the group size and its powers of two, and the counts the benchmark sorts
+	const unsigned int k_Counts[] = { 1, 2, 3, 255, 511, 512, 513, 1000, 1024, 1025, 4096, 5000, 65537, 100000 };
+
+	//! random points, or points on a coarse grid so many of them are exactly as far as each other and the index decides
+	std::vector<XMFLOAT3> makePoints(unsigned int count, bool grid, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> coordinate(0.f, 100.f);
+		std::uniform_int_distribution<int> cell(0, 7);
+		std::vector<XMFLOAT3> positions(count);
+		for (auto& position : positions)
+		{
+			if (grid)
+				position = XMFLOAT3((float)cell(random), (float)cell(random), (float)cell(random));
+			else
+				position = XMFLOAT3(coordinate(random), coordinate(random) * 0.5f, coordinate(random));
+		}
+		return positions;
+	}
+
+	//! the passes sort the padded keys like std::sort, every point far to near then the padding
+	void checkReference()
+	{
+		std::printf("  CPU passes against std::sort\n");
+		std::mt19937 random(1);
+		const XMFLOAT3 camera(50.f, 20.f, 50.f);
+		for (unsigned int count : k_Counts)
+		{
+			unsigned int padded = DepthSort::paddedCount(count);
+			CHECK(padded >= count && padded >= DepthSort::k_GroupSize && (padded & (padded - 1)) == 0 && padded / 2 < (std::max)(count, DepthSort::k_GroupSize));
+
+			std::vector<DepthSort::Pass> passes;
+			DepthSort::buildPasses(padded, passes);
+			CHECK(!passes.empty() && passes.front().local && passes.back().local && passes.back().lastLevel == padded);
+
+			for (bool grid : { false, true })
+			{
+				std::vector<XMFLOAT3> positions = makePoints(count, grid, random);
+				std::vector<DepthSort::Key> reference, sorted;
+				DepthSort::makeKeys(positions.data(), sizeof(XMFLOAT3), count, camera, reference);
+				sorted = reference;
+				DepthSort::sortReference(reference, passes);
+				std::sort(sorted.begin(), sorted.end(), DepthSort::less);
+
+				if (!CHECK(std::memcmp(sorted.data(), reference.data(), reference.size() * sizeof(DepthSort::Key)) == 0))
+				{
+					std::printf("    %u %s points\n", count, grid ? "grid" : "random");
+					continue;
+				}
+				CHECK(reference[count - 1].index < count && (count == padded || reference[count].index == DepthSort::k_Padding.index));
+			}
+		}
+	}
+
+	//! the kernels of the scene sort the same keys, bit for bit
+	void checkGPU()
+	{
+		std::printf("  GPU kernels against the CPU passes\n");
+		ID3D11Device* device = NULL;
+		ID3D11DeviceContext* context = NULL;
+		if (!CHECK(createTestDevice(&device, &context)))
+			return;
+
+		GPUDepthSort::Kernels kernels = {
+			compileComputeShader(device, L"../Coursework/shaders/gpu_order_keys_cs.hlsl"),
+			compileComputeShader(device, L"../Coursework/shaders/gpu_order_local_cs.hlsl"),
+			compileComputeShader(device, L"../Coursework/shaders/gpu_order_global_cs.hlsl"),
+			compileComputeShader(device, L"../Coursework/shaders/gpu_order_indices_cs.hlsl")
+		};
+		if (CHECK(kernels.keys && kernels.local && kernels.global && kernels.indices))
+		{
+			GPUDepthSort sort(device, kernels);
+			std::mt19937 random(2);
+			const XMFLOAT3 camera(50.f, 20.f, 50.f);
+			std::vector<DepthSort::Key> gpuKeys, reference;
+			std::vector<DepthSort::Pass> passes;
+
+			// Counts up and down, so the buffers grow and are reused with fewer points than they hold.
+			for (unsigned int count : { 5000u, 1u, 513u, 100000u, 4096u })
+			{
+				for (bool grid : { false, true })
+				{
+					std::vector<XMFLOAT3> positions = makePoints(count, grid, random);
+					sort.sortKeys(device, context, positions.data(), sizeof(XMFLOAT3), count, camera, gpuKeys);
+
+					DepthSort::makeKeys(positions.data(), sizeof(XMFLOAT3), count, camera, reference);
+					DepthSort::buildPasses((unsigned int)reference.size(), passes);
+					DepthSort::sortReference(reference, passes);
+					if (!CHECK(gpuKeys.size() == count && std::memcmp(gpuKeys.data(), reference.data(), count * sizeof(DepthSort::Key)) == 0))
+						std::printf("    %u %s points\n", count, grid ? "grid" : "random");
+				}
+			}
+		}
+
+		for (ID3D11ComputeShader* shader : { kernels.keys, kernels.local, kernels.global, kernels.indices })
+			if (shader)
+				shader->Release();
+		context->Release();
+		device->Release();
+	}
+}
+
+void testDepthSort()
+{
+	checkReference();
+	checkGPU();
+}
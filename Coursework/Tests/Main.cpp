@@ -0,0 +1,29 @@
+// Main.cpp
+// Console test target, runs every check without a window and returns the failures.
+#include "Check.h"
+
+void testMeshlets();
+void testTerrain();
+void testDepthSort();
+void testSteadyState();
+
+int& Check::failures()
+{
+	static int count = 0;
+	return count;
+}
+
+int main()
+{
+	std::printf("meshlets\n");
+	testMeshlets();
+	std::printf("terrain quadtree\n");
+	testTerrain();
+	std::printf("depth sort\n");
+	testDepthSort();
+	std::printf("steady state frames\n");
+	testSteadyState();
+
+	std::printf(Check::failures() ? "%d checks failed\n" : "all checks passed\n", Check::failures());
+	return Check::failures();
+}
@@ -0,0 +1,189 @@
+// Meshlet tests
+// Meshlet ranges and limits, bounding spheres holding every vertex and normal cones never culling a triangle facing the eye.
+#include "Check.h"
+#include "Meshlets.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+
+namespace
+{
+	//! positions first, as buildMeshlets reads them, with something after them so the stride is not the position's
+	struct Vertex
+	{
+		XMFLOAT3 position;
+		XMFLOAT2 texture;
+	};
+
+	//! closed sphere with a bumpy radius, clockwise from outside like the framework's meshes
+	void makeBumpySphere(int rings, int segments, std::vector<Vertex>& vertices, std::vector<unsigned long>& indices)
+	{
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> bump(0.8f, 1.2f);
+		vertices.clear();
+		indices.clear();
+
+		// Poles once, rings of segments in between, the seam shares its vertices.
+		vertices.push_back({ XMFLOAT3(0.f, 1.f, 0.f), XMFLOAT2(0.f, 0.f) });
+		for (int ring = 1; ring < rings; ring++)
+		{
+			float theta = XM_PI * ring / rings;
+			for (int segment = 0; segment < segments; segment++)
+			{
+				float phi = XM_2PI * segment / segments;
+				float radius = bump(random);
+				XMFLOAT3 position(sinf(theta) * cosf(phi) * radius, cosf(theta) * radius, sinf(theta) * sinf(phi) * radius);
+				vertices.push_back({ position, XMFLOAT2((float)segment / segments, (float)ring / rings) });
+			}
+		}
+		vertices.push_back({ XMFLOAT3(0.f, -1.f, 0.f), XMFLOAT2(0.f, 1.f) });
+
+		unsigned long bottom = (unsigned long)vertices.size() - 1;
+		auto at = [segments](int ring, int segment) { return (unsigned long)(1 + (ring - 1) * segments + (segment % segments)); };
+		for (int segment = 0; segment < segments; segment++)
+		{
+			indices.insert(indices.end(), { 0ul, at(1, segment), at(1, segment + 1) });
+			for (int ring = 1; ring < rings - 1; ring++)
+			{
+				indices.insert(indices.end(), { at(ring, segment), at(ring + 1, segment), at(ring + 1, segment + 1) });
+				indices.insert(indices.end(), { at(ring, segment), at(ring + 1, segment + 1), at(ring, segment + 1) });
+			}
+			indices.insert(indices.end(), { at(rings - 1, segment), bottom, at(rings - 1, segment + 1) });
+		}
+	}
+
+	//! triangles between random vertices of a box, normals in every direction
+	void makeSoup(int vertexCount, int triangleCount, std::vector<Vertex>& vertices, std::vector<unsigned long>& indices)
+	{
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> coordinate(-2.f, 2.f);
+		std::uniform_int_distribution<unsigned long> vertex(0, vertexCount - 1);
+		vertices.resize(vertexCount);
+		for (auto& it : vertices)
+			it = { XMFLOAT3(coordinate(random), coordinate(random), coordinate(random)), XMFLOAT2(0.f, 0.f) };
+		indices.resize((size_t)triangleCount * 3);
+		for (auto& index : indices)
+			index = vertex(random);
+	}
+
+	XMVECTOR positionOf(const std::vector<Vertex>& vertices, unsigned long index)
+	{
+		return XMLoadFloat3(&vertices[index].position);
+	}
+
+	//! view that only carries an eye, isBackFacing ignores the planes
+	Meshlets::CullView eyeView(const XMFLOAT3& eye, bool orthographic)
+	{
+		Meshlets::CullView view;
+		for (auto& plane : view.planes)
+			plane = XMFLOAT4(0.f, 0.f, 0.f, 1.f);
+		view.eye = eye;
+		view.orthographic = orthographic;
+		view.margin = 0.f;
+		return view;
+	}
+
+	//! whether every triangle of the meshlet faces away from the eye, degenerate triangles face nowhere
+	//! the tolerance is relative, the cone is built in floats
+	bool isMeshletBackFacing(const Meshlets::Meshlet& meshlet, const std::vector<Vertex>& vertices, const std::vector<unsigned long>& indices, const Meshlets::CullView& view)
+	{
+		for (unsigned int i = meshlet.indexStart; i < meshlet.indexStart + meshlet.triangleCount * 3; i += 3)
+		{
+			XMVECTOR p0 = positionOf(vertices, indices[i]);
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(positionOf(vertices, indices[i + 1]), p0), XMVectorSubtract(positionOf(vertices, indices[i + 2]), p0));
+			if (XMVectorGetX(XMVector3LengthSq(normal)) <= 0.f)
+				continue;
+			normal = XMVector3Normalize(normal);
+
+			XMVECTOR direction = XMLoadFloat3(&view.eye);
+			if (!view.orthographic)
+				direction = XMVector3Normalize(XMVectorSubtract(p0, direction));
+			if (XMVectorGetX(XMVector3Dot(normal, direction)) < -1e-4f)
+				return false;
+		}
+		return true;
+	}
+
+	//! builds the meshlets of the two halves of the mesh, then checks them against the triangles they hold
+	void checkMeshlets(const char* name, const std::vector<Vertex>& vertices, std::vector<unsigned long> indices, bool closed)
+	{
+		std::printf("  %s, %d triangles\n", name, (int)indices.size() / 3);
+
+		std::multiset<unsigned long> before(indices.begin(), indices.end());
+		int half = (int)indices.size() / 6 * 3;
+		std::vector<Meshlets::Meshlet> meshlets;
+		int first = Meshlets::buildMeshlets(vertices.data(), (int)vertices.size(), sizeof(Vertex), indices.data(), 0, half, meshlets);
+		int second = Meshlets::buildMeshlets(vertices.data(), (int)vertices.size(), sizeof(Vertex), indices.data(), half, (int)indices.size() - half, meshlets);
+		CHECK(first > 0 && second > 0 && first + second == (int)meshlets.size());
+		CHECK(std::multiset<unsigned long>(indices.begin(), indices.end()) == before);
+
+		// Meshlets follow each other through the index buffer and stop at the end of their call's range.
+		unsigned int next = 0;
+		for (int i = 0; i < (int)meshlets.size(); i++)
+		{
+			const Meshlets::Meshlet& meshlet = meshlets[i];
+			if (!CHECK(meshlet.indexStart == next && meshlet.triangleCount > 0))
+				return;
+			next += meshlet.triangleCount * 3;
+			CHECK(i != first - 1 || next == (unsigned int)half);
+			CHECK(meshlet.triangleCount <= 124 && meshlet.vertexCount <= 64);
+		}
+		CHECK(next == indices.size());
+
+		// Every vertex of every triangle inside the sphere, as many vertices as the meshlet says.
+		for (const Meshlets::Meshlet& meshlet : meshlets)
+		{
+			std::set<unsigned long> unique(indices.begin() + meshlet.indexStart, indices.begin() + meshlet.indexStart + meshlet.triangleCount * 3);
+			CHECK(unique.size() == meshlet.vertexCount);
+
+			XMVECTOR centre = XMLoadFloat3(&meshlet.centre);
+			float reach = 0.f;
+			for (unsigned long index : unique)
+				reach = (std::max)(reach, XMVectorGetX(XMVector3Length(XMVectorSubtract(positionOf(vertices, index), centre))));
+			if (!CHECK(reach <= meshlet.radius * 1.0001f + 1e-6f))
+				break;
+		}
+
+		// Eyes around and close to the mesh, and view directions for orthographic views: a culled meshlet never holds a triangle facing the eye.
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> coordinate(-1.f, 1.f);
+		int cones = 0, culled = 0;
+		for (const Meshlets::Meshlet& meshlet : meshlets)
+		{
+			cones += meshlet.coneCutoff <= 1.f ? 1 : 0;
+			for (int sample = 0; sample < 64; sample++)
+			{
+				XMFLOAT3 offset(coordinate(random), coordinate(random), coordinate(random));
+				float scale = sample < 32 ? meshlet.radius * 4.f : meshlet.radius * 0.5f;
+				Meshlets::CullView views[2] = {
+					eyeView(XMFLOAT3(meshlet.centre.x + offset.x * scale, meshlet.centre.y + offset.y * scale, meshlet.centre.z + offset.z * scale), false),
+					eyeView(offset, true)
+				};
+				XMStoreFloat3(&views[1].eye, XMVector3Normalize(XMLoadFloat3(&offset)));
+				for (const Meshlets::CullView& view : views)
+				{
+					if (!Meshlets::isBackFacing(view, meshlet))
+						continue;
+					culled++;
+					if (!CHECK(isMeshletBackFacing(meshlet, vertices, indices, view)))
+						return;
+				}
+			}
+		}
+		// A closed mesh has cones to test, the soup may not.
+		CHECK(!closed || (cones > 0 && culled > 0));
+	}
+}
+
+void testMeshlets()
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned long> indices;
+
+	makeBumpySphere(48, 64, vertices, indices);
+	checkMeshlets("bumpy sphere", vertices, indices, true);
+
+	makeSoup(3000, 4000, vertices, indices);
+	checkMeshlets("triangle soup", vertices, indices, false);
+}
@@ -0,0 +1,252 @@
+#pragma once
+#ifndef _RECORDING_DEVICE_H
+#define _RECORDING_DEVICE_H
+#include <d3d11.h>
+
+//! calls made through a RecordingDevice and its RecordingDeviceContext, the ones that stall on the GPU or allocate
+struct RecordedCalls
+{
+	int maps[6] = {};		//! by D3D11_MAP, READ is 1 to WRITE_NO_OVERWRITE 5
+	int copies = 0;			//! CopyResource and CopySubresourceRegion
+	int creates = 0;		//! every Create* of the device, resources, views, shaders and states
+	int dispatches = 0;
+	int draws = 0;
+};
+
+class RecordingDevice;
+
+//! stand-in for an immediate context, forwards every call to the wrapped one and counts the calls of RecordedCalls
+//! both wrappers live as long as the check using them, reference counts are the wrapped objects'
+class RecordingDeviceContext : public ID3D11DeviceContext
+{
+public:
+	RecordingDeviceContext(ID3D11DeviceContext* context, RecordingDevice* device) : context_(context), device_(device) {}
+
+	RecordedCalls calls;
+
+	// IUnknown and ID3D11DeviceChild, asking for the context gives the stand-in back
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+	{
+		if (riid == __uuidof(ID3D11DeviceContext) || riid == __uuidof(ID3D11DeviceChild) || riid == __uuidof(IUnknown))
+		{
+			*object = this;
+			AddRef();
+			return S_OK;
+		}
+		return context_->QueryInterface(riid, object);
+	}
+	ULONG STDMETHODCALLTYPE AddRef() override { return context_->AddRef(); }
+	ULONG STDMETHODCALLTYPE Release() override { return context_->Release(); }
+	void STDMETHODCALLTYPE GetDevice(ID3D11Device** device) override;
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* size, void* data) override { return context_->GetPrivateData(guid, size, data); }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT size, const void* data) override { return context_->SetPrivateData(guid, size, data); }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* data) override { return context_->SetPrivateDataInterface(guid, data); }
+
+	// Counted calls.
+	HRESULT STDMETHODCALLTYPE Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP type, UINT flags, D3D11_MAPPED_SUBRESOURCE* mapped) override
+	{
+		calls.maps[type]++;
+		return context_->Map(resource, subresource, type, flags, mapped);
+	}
+	void STDMETHODCALLTYPE CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y, UINT z, ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* box) override
+	{
+		calls.copies++;
+		context_->CopySubresourceRegion(destination, destinationSubresource, x, y, z, source, sourceSubresource, box);
+	}
+	void STDMETHODCALLTYPE CopyResource(ID3D11Resource* destination, ID3D11Resource* source) override
+	{
+		calls.copies++;
+		context_->CopyResource(destination, source);
+	}
+	void STDMETHODCALLTYPE Dispatch(UINT x, UINT y, UINT z) override { calls.dispatches++; context_->Dispatch(x, y, z); }
+	void STDMETHODCALLTYPE DispatchIndirect(ID3D11Buffer* arguments, UINT offset) override { calls.dispatches++; context_->DispatchIndirect(arguments, offset); }
+	void STDMETHODCALLTYPE Draw(UINT vertexCount, UINT startVertex) override { calls.draws++; context_->Draw(vertexCount, startVertex); }
+	void STDMETHODCALLTYPE DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex) override { calls.draws++; context_->DrawIndexed(indexCount, startIndex, baseVertex); }
+	void STDMETHODCALLTYPE DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance) override { calls.draws++; context_->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance); }
+	void STDMETHODCALLTYPE DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override { calls.draws++; context_->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance); }
+	void STDMETHODCALLTYPE DrawAuto() override { calls.draws++; context_->DrawAuto(); }
+	void STDMETHODCALLTYPE DrawIndexedInstancedIndirect(ID3D11Buffer* arguments, UINT offset) override { calls.draws++; context_->DrawIndexedInstancedIndirect(arguments, offset); }
+	void STDMETHODCALLTYPE DrawInstancedIndirect(ID3D11Buffer* arguments, UINT offset) override { calls.draws++; context_->DrawInstancedIndirect(arguments, offset); }
+
+	// Every shader stage binds and reads back its shader, resources, samplers and constants the same way.
+#define RECORDING_STAGE(stage, Shader) \
+	void STDMETHODCALLTYPE stage##SetShader(ID3D11##Shader* shader, ID3D11ClassInstance* const* instances, UINT instanceCount) override { context_->stage##SetShader(shader, instances, instanceCount); } \
+	void STDMETHODCALLTYPE stage##GetShader(ID3D11##Shader** shader, ID3D11ClassInstance** instances, UINT* instanceCount) override { context_->stage##GetShader(shader, instances, instanceCount); } \
+	void STDMETHODCALLTYPE stage##SetShaderResources(UINT start, UINT count, ID3D11ShaderResourceView* const* views) override { context_->stage##SetShaderResources(start, count, views); } \
+	void STDMETHODCALLTYPE stage##GetShaderResources(UINT start, UINT count, ID3D11ShaderResourceView** views) override { context_->stage##GetShaderResources(start, count, views); } \
+	void STDMETHODCALLTYPE stage##SetSamplers(UINT start, UINT count, ID3D11SamplerState* const* samplers) override { context_->stage##SetSamplers(start, count, samplers); } \
+	void STDMETHODCALLTYPE stage##GetSamplers(UINT start, UINT count, ID3D11SamplerState** samplers) override { context_->stage##GetSamplers(start, count, samplers); } \
+	void STDMETHODCALLTYPE stage##SetConstantBuffers(UINT start, UINT count, ID3D11Buffer* const* buffers) override { context_->stage##SetConstantBuffers(start, count, buffers); } \
+	void STDMETHODCALLTYPE stage##GetConstantBuffers(UINT start, UINT count, ID3D11Buffer** buffers) override { context_->stage##GetConstantBuffers(start, count, buffers); }
+
+	RECORDING_STAGE(VS, VertexShader)
+	RECORDING_STAGE(HS, HullShader)
+	RECORDING_STAGE(DS, DomainShader)
+	RECORDING_STAGE(GS, GeometryShader)
+	RECORDING_STAGE(PS, PixelShader)
+	RECORDING_STAGE(CS, ComputeShader)
+#undef RECORDING_STAGE
+
+	void STDMETHODCALLTYPE CSSetUnorderedAccessViews(UINT start, UINT count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts) override { context_->CSSetUnorderedAccessViews(start, count, views, initialCounts); }
+	void STDMETHODCALLTYPE CSGetUnorderedAccessViews(UINT start, UINT count, ID3D11UnorderedAccessView** views) override { context_->CSGetUnorderedAccessViews(start, count, views); }
+
+	// Forwarded as they are.
+	void STDMETHODCALLTYPE Unmap(ID3D11Resource* resource, UINT subresource) override { context_->Unmap(resource, subresource); }
+	void STDMETHODCALLTYPE UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box, const void* data, UINT rowPitch, UINT depthPitch) override { context_->UpdateSubresource(resource, subresource, box, data, rowPitch, depthPitch); }
+	void STDMETHODCALLTYPE CopyStructureCount(ID3D11Buffer* destination, UINT offset, ID3D11UnorderedAccessView* source) override { context_->CopyStructureCount(destination, offset, source); }
+	void STDMETHODCALLTYPE ResolveSubresource(ID3D11Resource* destination, UINT destinationSubresource, ID3D11Resource* source, UINT sourceSubresource, DXGI_FORMAT format) override { context_->ResolveSubresource(destination, destinationSubresource, source, sourceSubresource, format); }
+	void STDMETHODCALLTYPE GenerateMips(ID3D11ShaderResourceView* view) override { context_->GenerateMips(view); }
+	void STDMETHODCALLTYPE SetResourceMinLOD(ID3D11Resource* resource, FLOAT minLod) override { context_->SetResourceMinLOD(resource, minLod); }
+	FLOAT STDMETHODCALLTYPE GetResourceMinLOD(ID3D11Resource* resource) override { return context_->GetResourceMinLOD(resource); }
+
+	void STDMETHODCALLTYPE IASetInputLayout(ID3D11InputLayout* layout) override { context_->IASetInputLayout(layout); }
+	void STDMETHODCALLTYPE IAGetInputLayout(ID3D11InputLayout** layout) override { context_->IAGetInputLayout(layout); }
+	void STDMETHODCALLTYPE IASetVertexBuffers(UINT start, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets) override { context_->IASetVertexBuffers(start, count, buffers, strides, offsets); }
+	void STDMETHODCALLTYPE IAGetVertexBuffers(UINT start, UINT count, ID3D11Buffer** buffers, UINT* strides, UINT* offsets) override { context_->IAGetVertexBuffers(start, count, buffers, strides, offsets); }
+	void STDMETHODCALLTYPE IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset) override { context_->IASetIndexBuffer(buffer, format, offset); }
+	void STDMETHODCALLTYPE IAGetIndexBuffer(ID3D11Buffer** buffer, DXGI_FORMAT* format, UINT* offset) override { context_->IAGetIndexBuffer(buffer, format, offset); }
+	void STDMETHODCALLTYPE IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override { context_->IASetPrimitiveTopology(topology); }
+	void STDMETHODCALLTYPE IAGetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY* topology) override { context_->IAGetPrimitiveTopology(topology); }
+
+	void STDMETHODCALLTYPE SOSetTargets(UINT count, ID3D11Buffer* const* buffers, const UINT* offsets) override { context_->SOSetTargets(count, buffers, offsets); }
+	void STDMETHODCALLTYPE SOGetTargets(UINT count, ID3D11Buffer** buffers) override { context_->SOGetTargets(count, buffers); }
+
+	void STDMETHODCALLTYPE RSSetState(ID3D11RasterizerState* state) override { context_->RSSetState(state); }
+	void STDMETHODCALLTYPE RSGetState(ID3D11RasterizerState** state) override { context_->RSGetState(state); }
+	void STDMETHODCALLTYPE RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports) override { context_->RSSetViewports(count, viewports); }
+	void STDMETHODCALLTYPE RSGetViewports(UINT* count, D3D11_VIEWPORT* viewports) override { context_->RSGetViewports(count, viewports); }
+	void STDMETHODCALLTYPE RSSetScissorRects(UINT count, const D3D11_RECT* rects) override { context_->RSSetScissorRects(count, rects); }
+	void STDMETHODCALLTYPE RSGetScissorRects(UINT* count, D3D11_RECT* rects) override { context_->RSGetScissorRects(count, rects); }
+
+	void STDMETHODCALLTYPE OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth) override { context_->OMSetRenderTargets(count, targets, depth); }
+	void STDMETHODCALLTYPE OMGetRenderTargets(UINT count, ID3D11RenderTargetView** targets, ID3D11DepthStencilView** depth) override { context_->OMGetRenderTargets(count, targets, depth); }
+	void STDMETHODCALLTYPE OMSetRenderTargetsAndUnorderedAccessViews(UINT targetCount, ID3D11RenderTargetView* const* targets, ID3D11DepthStencilView* depth, UINT viewStart, UINT viewCount, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts) override
+	{
+		context_->OMSetRenderTargetsAndUnorderedAccessViews(targetCount, targets, depth, viewStart, viewCount, views, initialCounts);
+	}
+	void STDMETHODCALLTYPE OMGetRenderTargetsAndUnorderedAccessViews(UINT targetCount, ID3D11RenderTargetView** targets, ID3D11DepthStencilView** depth, UINT viewStart, UINT viewCount, ID3D11UnorderedAccessView** views) override
+	{
+		context_->OMGetRenderTargetsAndUnorderedAccessViews(targetCount, targets, depth, viewStart, viewCount, views);
+	}
+	void STDMETHODCALLTYPE OMSetBlendState(ID3D11BlendState* state, const FLOAT blendFactor[4], UINT sampleMask) override { context_->OMSetBlendState(state, blendFactor, sampleMask); }
+	void STDMETHODCALLTYPE OMGetBlendState(ID3D11BlendState** state, FLOAT blendFactor[4], UINT* sampleMask) override { context_->OMGetBlendState(state, blendFactor, sampleMask); }
+	void STDMETHODCALLTYPE OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef) override { context_->OMSetDepthStencilState(state, stencilRef); }
+	void STDMETHODCALLTYPE OMGetDepthStencilState(ID3D11DepthStencilState** state, UINT* stencilRef) override { context_->OMGetDepthStencilState(state, stencilRef); }
+
+	void STDMETHODCALLTYPE ClearRenderTargetView(ID3D11RenderTargetView* view, const FLOAT colour[4]) override { context_->ClearRenderTargetView(view, colour); }
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewUint(ID3D11UnorderedAccessView* view, const UINT values[4]) override { context_->ClearUnorderedAccessViewUint(view, values); }
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewFloat(ID3D11UnorderedAccessView* view, const FLOAT values[4]) override { context_->ClearUnorderedAccessViewFloat(view, values); }
+	void STDMETHODCALLTYPE ClearDepthStencilView(ID3D11DepthStencilView* view, UINT flags, FLOAT depth, UINT8 stencil) override { context_->ClearDepthStencilView(view, flags, depth, stencil); }
+
+	void STDMETHODCALLTYPE Begin(ID3D11Asynchronous* query) override { context_->Begin(query); }
+	void STDMETHODCALLTYPE End(ID3D11Asynchronous* query) override { context_->End(query); }
+	HRESULT STDMETHODCALLTYPE GetData(ID3D11Asynchronous* query, void* data, UINT size, UINT flags) override { return context_->GetData(query, data, size, flags); }
+	void STDMETHODCALLTYPE SetPredication(ID3D11Predicate* predicate, BOOL value) override { context_->SetPredication(predicate, value); }
+	void STDMETHODCALLTYPE GetPredication(ID3D11Predicate** predicate, BOOL* value) override { context_->GetPredication(predicate, value); }
+
+	void STDMETHODCALLTYPE ExecuteCommandList(ID3D11CommandList* commands, BOOL restoreState) override { context_->ExecuteCommandList(commands, restoreState); }
+	HRESULT STDMETHODCALLTYPE FinishCommandList(BOOL restoreState, ID3D11CommandList** commands) override { return context_->FinishCommandList(restoreState, commands); }
+	void STDMETHODCALLTYPE ClearState() override { context_->ClearState(); }
+	void STDMETHODCALLTYPE Flush() override { context_->Flush(); }
+	D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE GetType() override { return context_->GetType(); }
+	UINT STDMETHODCALLTYPE GetContextFlags() override { return context_->GetContextFlags(); }
+
+private:
+	ID3D11DeviceContext* context_;
+	RecordingDevice* device_;
+};
+
+//! stand-in for a device, forwards every call to the wrapped one and counts the Create* calls
+//! its immediate context is the RecordingDeviceContext it was given, the calls of both go to the same RecordedCalls
+class RecordingDevice : public ID3D11Device
+{
+public:
+	explicit RecordingDevice(ID3D11Device* device) : device_(device) {}
+
+	void setImmediateContext(RecordingDeviceContext* context) { context_ = context; }
+	//! calls of the device and its context since the last reset
+	RecordedCalls& calls() { return context_->calls; }
+	void resetCalls() { context_->calls = RecordedCalls(); }
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+	{
+		if (riid == __uuidof(ID3D11Device) || riid == __uuidof(IUnknown))
+		{
+			*object = this;
+			AddRef();
+			return S_OK;
+		}
+		return device_->QueryInterface(riid, object);
+	}
+	ULONG STDMETHODCALLTYPE AddRef() override { return device_->AddRef(); }
+	ULONG STDMETHODCALLTYPE Release() override { return device_->Release(); }
+
+	// Counted calls, everything the device makes.
+	HRESULT STDMETHODCALLTYPE CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Buffer** buffer) override { created(); return device_->CreateBuffer(desc, data, buffer); }
+	HRESULT STDMETHODCALLTYPE CreateTexture1D(const D3D11_TEXTURE1D_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture1D** texture) override { created(); return device_->CreateTexture1D(desc, data, texture); }
+	HRESULT STDMETHODCALLTYPE CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture2D** texture) override { created(); return device_->CreateTexture2D(desc, data, texture); }
+	HRESULT STDMETHODCALLTYPE CreateTexture3D(const D3D11_TEXTURE3D_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture3D** texture) override { created(); return device_->CreateTexture3D(desc, data, texture); }
+	HRESULT STDMETHODCALLTYPE CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view) override { created(); return device_->CreateShaderResourceView(resource, desc, view); }
+	HRESULT STDMETHODCALLTYPE CreateUnorderedAccessView(ID3D11Resource* resource, const D3D11_UNORDERED_ACCESS_VIEW_DESC* desc, ID3D11UnorderedAccessView** view) override { created(); return device_->CreateUnorderedAccessView(resource, desc, view); }
+	HRESULT STDMETHODCALLTYPE CreateRenderTargetView(ID3D11Resource* resource, const D3D11_RENDER_TARGET_VIEW_DESC* desc, ID3D11RenderTargetView** view) override { created(); return device_->CreateRenderTargetView(resource, desc, view); }
+	HRESULT STDMETHODCALLTYPE CreateDepthStencilView(ID3D11Resource* resource, const D3D11_DEPTH_STENCIL_VIEW_DESC* desc, ID3D11DepthStencilView** view) override { created(); return device_->CreateDepthStencilView(resource, desc, view); }
+	HRESULT STDMETHODCALLTYPE CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT count, const void* code, SIZE_T length, ID3D11InputLayout** layout) override { created(); return device_->CreateInputLayout(elements, count, code, length, layout); }
+	HRESULT STDMETHODCALLTYPE CreateVertexShader(const void* code, SIZE_T length, ID3D11ClassLinkage* linkage, ID3D11VertexShader** shader) override { created(); return device_->CreateVertexShader(code, length, linkage, shader); }
+	HRESULT STDMETHODCALLTYPE CreateGeometryShader(const void* code, SIZE_T length, ID3D11ClassLinkage* linkage, ID3D11GeometryShader** shader) override { created(); return device_->CreateGeometryShader(code, length, linkage, shader); }
+	HRESULT STDMETHODCALLTYPE CreateGeometryShaderWithStreamOutput(const void* code, SIZE_T length, const D3D11_SO_DECLARATION_ENTRY* declaration, UINT entries, const UINT* strides, UINT strideCount, UINT rasterizedStream, ID3D11ClassLinkage* linkage, ID3D11GeometryShader** shader) override
+	{
+		created();
+		return device_->CreateGeometryShaderWithStreamOutput(code, length, declaration, entries, strides, strideCount, rasterizedStream, linkage, shader);
+	}
+	HRESULT STDMETHODCALLTYPE CreatePixelShader(const void* code, SIZE_T length, ID3D11ClassLinkage* linkage, ID3D11PixelShader** shader) override { created(); return device_->CreatePixelShader(code, length, linkage, shader); }
+	HRESULT STDMETHODCALLTYPE CreateHullShader(const void* code, SIZE_T length, ID3D11ClassLinkage* linkage, ID3D11HullShader** shader) override { created(); return device_->CreateHullShader(code, length, linkage, shader); }
+	HRESULT STDMETHODCALLTYPE CreateDomainShader(const void* code, SIZE_T length, ID3D11ClassLinkage* linkage, ID3D11DomainShader** shader) override { created(); return device_->CreateDomainShader(code, length, linkage, shader); }
+	HRESULT STDMETHODCALLTYPE CreateComputeShader(const void* code, SIZE_T length, ID3D11ClassLinkage* linkage, ID3D11ComputeShader** shader) override { created(); return device_->CreateComputeShader(code, length, linkage, shader); }
+	HRESULT STDMETHODCALLTYPE CreateClassLinkage(ID3D11ClassLinkage** linkage) override { created(); return device_->CreateClassLinkage(linkage); }
+	HRESULT STDMETHODCALLTYPE CreateBlendState(const D3D11_BLEND_DESC* desc, ID3D11BlendState** state) override { created(); return device_->CreateBlendState(desc, state); }
+	HRESULT STDMETHODCALLTYPE CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** state) override { created(); return device_->CreateDepthStencilState(desc, state); }
+	HRESULT STDMETHODCALLTYPE CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** state) override { created(); return device_->CreateRasterizerState(desc, state); }
+	HRESULT STDMETHODCALLTYPE CreateSamplerState(const D3D11_SAMPLER_DESC* desc, ID3D11SamplerState** state) override { created(); return device_->CreateSamplerState(desc, state); }
+	HRESULT STDMETHODCALLTYPE CreateQuery(const D3D11_QUERY_DESC* desc, ID3D11Query** query) override { created(); return device_->CreateQuery(desc, query); }
+	HRESULT STDMETHODCALLTYPE CreatePredicate(const D3D11_QUERY_DESC* desc, ID3D11Predicate** predicate) override { created(); return device_->CreatePredicate(desc, predicate); }
+	HRESULT STDMETHODCALLTYPE CreateCounter(const D3D11_COUNTER_DESC* desc, ID3D11Counter** counter) override { created(); return device_->CreateCounter(desc, counter); }
+	HRESULT STDMETHODCALLTYPE CreateDeferredContext(UINT flags, ID3D11DeviceContext** context) override { created(); return device_->CreateDeferredContext(flags, context); }
+
+	// Forwarded as they are, the immediate context is the stand-in.
+	HRESULT STDMETHODCALLTYPE OpenSharedResource(HANDLE resource, REFIID riid, void** object) override { return device_->OpenSharedResource(resource, riid, object); }
+	HRESULT STDMETHODCALLTYPE CheckFormatSupport(DXGI_FORMAT format, UINT* support) override { return device_->CheckFormatSupport(format, support); }
+	HRESULT STDMETHODCALLTYPE CheckMultisampleQualityLevels(DXGI_FORMAT format, UINT sampleCount, UINT* levels) override { return device_->CheckMultisampleQualityLevels(format, sampleCount, levels); }
+	void STDMETHODCALLTYPE CheckCounterInfo(D3D11_COUNTER_INFO* info) override { device_->CheckCounterInfo(info); }
+	HRESULT STDMETHODCALLTYPE CheckCounter(const D3D11_COUNTER_DESC* desc, D3D11_COUNTER_TYPE* type, UINT* activeCounters, LPSTR name, UINT* nameLength, LPSTR units, UINT* unitsLength, LPSTR description, UINT* descriptionLength) override
+	{
+		return device_->CheckCounter(desc, type, activeCounters, name, nameLength, units, unitsLength, description, descriptionLength);
+	}
+	HRESULT STDMETHODCALLTYPE CheckFeatureSupport(D3D11_FEATURE feature, void* data, UINT size) override { return device_->CheckFeatureSupport(feature, data, size); }
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* size, void* data) override { return device_->GetPrivateData(guid, size, data); }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT size, const void* data) override { return device_->SetPrivateData(guid, size, data); }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* data) override { return device_->SetPrivateDataInterface(guid, data); }
+	D3D_FEATURE_LEVEL STDMETHODCALLTYPE GetFeatureLevel() override { return device_->GetFeatureLevel(); }
+	UINT STDMETHODCALLTYPE GetCreationFlags() override { return device_->GetCreationFlags(); }
+	HRESULT STDMETHODCALLTYPE GetDeviceRemovedReason() override { return device_->GetDeviceRemovedReason(); }
+	void STDMETHODCALLTYPE GetImmediateContext(ID3D11DeviceContext** context) override
+	{
+		*context = context_;
+		context_->AddRef();
+	}
+	HRESULT STDMETHODCALLTYPE SetExceptionMode(UINT flags) override { return device_->SetExceptionMode(flags); }
+	UINT STDMETHODCALLTYPE GetExceptionMode() override { return device_->GetExceptionMode(); }
+
+private:
+	void created() { context_->calls.creates++; }
+
+	ID3D11Device* device_;
+	RecordingDeviceContext* context_ = nullptr;
+};
+
+inline void STDMETHODCALLTYPE RecordingDeviceContext::GetDevice(ID3D11Device** device)
+{
+	*device = device_;
+	device_->AddRef();
+}
+
+#endif
@@ -0,0 +1,163 @@
+// Steady state tests
+// Foliage frames through the recording device: once the buffers have grown, a frame neither waits on the GPU nor allocates.
+#include "Check.h"
+#include "RecordingDevice.h"
+#include "TestDevice.h"
+#include "../Coursework/GPUDepthSort.h"
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	//! nothing read back or copied, nothing created
+	bool isSteady(const RecordedCalls& calls)
+	{
+		return calls.maps[D3D11_MAP_READ] == 0 && calls.maps[D3D11_MAP_READ_WRITE] == 0 && calls.copies == 0 && calls.creates == 0;
+	}
+
+	void printCalls(const char* frame, const RecordedCalls& calls)
+	{
+		std::printf("    %s: %d read maps, %d copies, %d creates, %d discard and %d no overwrite maps, %d dispatches\n", frame, calls.maps[D3D11_MAP_READ] + calls.maps[D3D11_MAP_READ_WRITE],
+			calls.copies, calls.creates, calls.maps[D3D11_MAP_WRITE_DISCARD], calls.maps[D3D11_MAP_WRITE_NO_OVERWRITE], calls.dispatches);
+	}
+
+	void appendPoints(BetterPointMesh& mesh, int count, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> coordinate(0.f, 100.f);
+		std::vector<BaseMesh::VertexType> points(count);
+		for (auto& point : points)
+		{
+			point.position = XMFLOAT3(coordinate(random), coordinate(random) * 0.2f, coordinate(random));
+			point.texture = XMFLOAT2(0.f, 0.f);
+			point.normal = XMFLOAT3(0.f, 1.f, 0.f);
+		}
+		mesh.appendVertices(points.data(), count);
+	}
+
+	//! camera circling the points, a different view every frame
+	XMFLOAT3 cameraAt(int frame)
+	{
+		float angle = frame * 0.37f;
+		return XMFLOAT3(50.f + 60.f * cosf(angle), 10.f, 50.f + 60.f * sinf(angle));
+	}
+
+	//! the indices GPUDepthSort wrote, read back outside the counted frames, against std::sort of the mesh's points
+	bool isSortedFarToNear(ID3D11Device* device, ID3D11DeviceContext* context, GPUDepthSort& sort, BetterPointMesh& mesh, const XMFLOAT3& camera)
+	{
+		std::vector<BaseMesh::VertexType>& vertices = *mesh.getVerticesVector();
+		std::vector<DepthSort::Key> keys;
+		DepthSort::makeKeys(&vertices[0].position, sizeof(BaseMesh::VertexType), (unsigned int)vertices.size(), camera, keys);
+		std::sort(keys.begin(), keys.end(), DepthSort::less);
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_STAGING;
+		desc.ByteWidth = (UINT)(sizeof(unsigned int) * vertices.size());
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		ID3D11Buffer* readback = NULL;
+		if (FAILED(device->CreateBuffer(&desc, NULL, &readback)))
+			return false;
+
+		D3D11_BOX box = { 0, 0, 0, desc.ByteWidth, 1, 1 };
+		context->CopySubresourceRegion(readback, 0, 0, 0, 0, sort.getIndexBuffer(), 0, &box);
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		bool sorted = SUCCEEDED(context->Map(readback, 0, D3D11_MAP_READ, 0, &mapped));
+		if (sorted)
+		{
+			const unsigned int* indices = static_cast<const unsigned int*>(mapped.pData);
+			for (size_t i = 0; i < vertices.size() && sorted; i++)
+				sorted = indices[i] == keys[i].index;
+			context->Unmap(readback, 0);
+		}
+		readback->Release();
+		return sorted;
+	}
+
+	//! frames of the foliage as App1 draws them, the points appended since the last frame committed, then sorted on the GPU or given a CPU order, then bound
+	void checkFrames(ID3D11Device* realDevice, ID3D11DeviceContext* realContext, const GPUDepthSort::Kernels& kernels)
+	{
+		RecordingDevice device(realDevice);
+		RecordingDeviceContext context(realContext, &device);
+		device.setImmediateContext(&context);
+
+		std::mt19937 random(4);
+		BetterPointMesh mesh(&device, &context);
+		GPUDepthSort sort(&device, kernels);
+		int frame = 0;
+		auto runFrame = [&](bool cpuOrder)
+		{
+			device.resetCalls();
+			mesh.commit(&device);
+			XMFLOAT3 camera = cameraAt(frame++);
+			if (cpuOrder)
+			{
+				std::vector<DepthSort::Key> keys;
+				std::vector<unsigned int> order(mesh.getVertexCount());
+				DepthSort::makeKeys(&(*mesh.getVerticesVector())[0].position, sizeof(BaseMesh::VertexType), (unsigned int)order.size(), camera, keys);
+				std::sort(keys.begin(), keys.begin() + order.size(), DepthSort::less);
+				for (size_t i = 0; i < order.size(); i++)
+					order[i] = keys[i].index;
+				mesh.setDrawOrder(&device, order);
+			}
+			else
+			{
+				sort.sortMesh(&device, &context, &mesh, camera);
+			}
+			mesh.sendData(&context);
+			return device.calls();
+		};
+
+		// The first frame and a growth make the buffers, the frames after them have to be steady.
+		appendPoints(mesh, 5000, random);
+		printCalls("first", runFrame(false));
+		for (int i = 0; i < 4; i++)
+			CHECK(isSteady(runFrame(false)));
+
+		// Appending within the capacity maps the tail without overwrite.
+		int capacity = mesh.getCapacity();
+		appendPoints(mesh, 100, random);
+		CHECK(mesh.getVertexCount() <= capacity);
+		RecordedCalls append = runFrame(false);
+		printCalls("append", append);
+		CHECK(isSteady(append));
+		for (int i = 0; i < 4; i++)
+			CHECK(isSteady(runFrame(false)));
+
+		appendPoints(mesh, capacity, random);
+		printCalls("growth", runFrame(false));
+		CHECK(mesh.getCapacity() > capacity);
+		for (int i = 0; i < 4; i++)
+			CHECK(isSteady(runFrame(false)));
+		CHECK(isSortedFarToNear(realDevice, realContext, sort, mesh, cameraAt(frame - 1)));
+
+		// The CPU order grows its buffer once, then discards it every frame, also after an append.
+		printCalls("first CPU order", runFrame(true));
+		for (int i = 0; i < 4; i++)
+			CHECK(isSteady(runFrame(true)));
+		appendPoints(mesh, 10, random);
+		CHECK(isSteady(runFrame(true)));
+		CHECK(isSteady(runFrame(true)));
+	}
+}
+
+void testSteadyState()
+{
+	ID3D11Device* device = NULL;
+	ID3D11DeviceContext* context = NULL;
+	if (!CHECK(createTestDevice(&device, &context)))
+		return;
+
+	GPUDepthSort::Kernels kernels = {
+		compileComputeShader(device, L"../Coursework/shaders/gpu_order_keys_cs.hlsl"),
+		compileComputeShader(device, L"../Coursework/shaders/gpu_order_local_cs.hlsl"),
+		compileComputeShader(device, L"../Coursework/shaders/gpu_order_global_cs.hlsl"),
+		compileComputeShader(device, L"../Coursework/shaders/gpu_order_indices_cs.hlsl")
+	};
+	if (CHECK(kernels.keys && kernels.local && kernels.global && kernels.indices))
+		checkFrames(device, context, kernels);
+
+	for (ID3D11ComputeShader* shader : { kernels.keys, kernels.local, kernels.global, kernels.indices })
+		if (shader)
+			shader->Release();
+	context->Release();
+	device->Release();
+}
@@ -0,0 +1,131 @@
+// Terrain tests
+// Quadtree selections covering the terrain once, without holes or overlapping nodes.
+#include "Check.h"
+#include "TerrainQuadtree.h"
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	//! view keeping every node, so the selection has to cover the whole terrain
+	Meshlets::CullView allInside(const XMFLOAT3& eye)
+	{
+		Meshlets::CullView view;
+		for (auto& plane : view.planes)
+			plane = XMFLOAT4(0.f, 0.f, 0.f, 1.f);
+		view.eye = eye;
+		view.orthographic = false;
+		view.margin = 0.f;
+		return view;
+	}
+
+	//! times every leaf sized cell of the terrain is drawn by the nodes, quarters of a node count for their quarter only
+	std::vector<int> countCoverage(const TerrainQuadtree& quadtree, const std::vector<TerrainQuadtree::Node>& nodes)
+	{
+		const TerrainQuadtree::Settings& settings = quadtree.getSettings();
+		int leaves = 1 << (settings.lodCount - 1);
+		float leafSize = settings.size / leaves;
+		std::vector<int> coverage((size_t)leaves * leaves, 0);
+		for (const TerrainQuadtree::Node& node : nodes)
+		{
+			float size = node.quadrant < 0 ? node.size : node.size * 0.5f;
+			float x = node.x + (node.quadrant >= 0 && (node.quadrant & 1) ? size : 0.f);
+			float z = node.z + (node.quadrant >= 0 && (node.quadrant & 2) ? size : 0.f);
+			int firstX = (int)lroundf(x / leafSize), firstZ = (int)lroundf(z / leafSize), cells = (int)lroundf(size / leafSize);
+			for (int cellZ = firstZ; cellZ < firstZ + cells; cellZ++)
+				for (int cellX = firstX; cellX < firstX + cells; cellX++)
+					coverage[(size_t)cellZ * leaves + cellX]++;
+		}
+		return coverage;
+	}
+
+	//! whether the node lies within the range of its level, lodBias applied as select does
+	bool isInRange(const TerrainQuadtree& quadtree, const TerrainQuadtree::Node& node, const XMFLOAT3& eye, float lodBias)
+	{
+		XMFLOAT3 boxMin(node.x, node.minY, node.z), boxMax(node.x + node.size, node.maxY, node.z + node.size);
+		float range = quadtree.getRange(node.lod);
+		return TerrainQuadtree::isBoxInRange(eye, range == FLT_MAX ? range : range / lodBias, boxMin, boxMax);
+	}
+
+	void checkSelections(const char* name, const TerrainQuadtree& quadtree)
+	{
+		std::printf("  %s\n", name);
+		const TerrainQuadtree::Settings& settings = quadtree.getSettings();
+		std::vector<TerrainQuadtree::Node> nodes;
+
+		// Eyes on the terrain, at a corner, high above and away from it, so every level and the quarters of partly refined nodes show up.
+		const XMFLOAT3 eyes[] = {
+			XMFLOAT3(settings.size * 0.5f, 2.f, settings.size * 0.5f),
+			XMFLOAT3(settings.size * 0.1f, 10.f, settings.size * 0.8f),
+			XMFLOAT3(0.f, 1.f, 0.f),
+			XMFLOAT3(settings.size * 0.5f, settings.size * 2.f, settings.size * 0.5f),
+			XMFLOAT3(-settings.size, 5.f, settings.size * 3.f)
+		};
+		bool quarters = false;
+		for (const XMFLOAT3& eye : eyes)
+		{
+			for (float lodBias : { 0.5f, 1.f, 2.f })
+			{
+				TerrainQuadtree::SelectionStats stats = quadtree.select(allInside(eye), eye, lodBias, nodes);
+				CHECK(stats.culled == 0 && stats.selected == (int)nodes.size());
+
+				int triangles = 0;
+				for (const TerrainQuadtree::Node& node : nodes)
+				{
+					quarters |= node.quadrant >= 0;
+					triangles += node.quadrant < 0 ? quadtree.getTrianglesPerNode() : quadtree.getTrianglesPerNode() / 4;
+					if (!CHECK(isInRange(quadtree, node, eye, lodBias)))
+						break;
+				}
+				CHECK(triangles == stats.triangles);
+
+				std::vector<int> coverage = countCoverage(quadtree, nodes);
+				for (int count : coverage)
+				{
+					if (!CHECK(count == 1))
+						break;
+				}
+			}
+		}
+		CHECK(quarters);
+
+		// Frustum views flying over the terrain: culled nodes leave holes, but nothing is drawn twice.
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.f / 9.f, 0.1f, settings.size * 4.f);
+		for (int frame = 0; frame < 32; frame++)
+		{
+			float angle = XM_2PI * frame / 32;
+			XMVECTOR eye = XMVectorSet(settings.size * (0.5f + 0.4f * cosf(angle)), 8.f, settings.size * (0.5f + 0.4f * sinf(angle)), 1.f);
+			XMVECTOR target = XMVectorSet(settings.size * 0.5f, 0.f, settings.size * 0.5f, 1.f);
+			Meshlets::CullView view = Meshlets::makeCullView(XMMatrixIdentity(), XMMatrixLookAtLH(eye, target, XMVectorSet(0.f, 1.f, 0.f, 0.f)), projection);
+			TerrainQuadtree::SelectionStats stats = quadtree.select(view, view.eye, 1.f, nodes);
+			CHECK(stats.selected > 0);
+
+			std::vector<int> coverage = countCoverage(quadtree, nodes);
+			for (int count : coverage)
+			{
+				if (!CHECK(count <= 1))
+					break;
+			}
+		}
+	}
+}
+
+void testTerrain()
+{
+	TerrainQuadtree::Settings settings;
+	TerrainQuadtree flat;
+	flat.build(settings);
+	checkSelections("flat, default settings", flat);
+
+	// Deeper tree over a ridged heightmap, nodes get their own height bounds.
+	settings.size = 512.f;
+	settings.lodCount = 7;
+	settings.leafRange = 12.f;
+	std::vector<float> heights(256 * 256);
+	for (int z = 0; z < 256; z++)
+		for (int x = 0; x < 256; x++)
+			heights[(size_t)z * 256 + x] = 0.5f + 0.25f * sinf(x * 0.1f) * cosf(z * 0.07f);
+	TerrainQuadtree hills;
+	hills.build(settings, heights.data(), 256, 256);
+	checkSelections("heightmap, 7 levels", hills);
+}
@@ -0,0 +1,39 @@
+// Test device
+// WARP device and shader compilation for the checks that run on the GPU.
+#include "TestDevice.h"
+#include <d3dcompiler.h>
+#include <cstdio>
+
+bool createTestDevice(ID3D11Device** device, ID3D11DeviceContext** context)
+{
+	D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
+	HRESULT result = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_WARP, NULL, 0, &featureLevel, 1, D3D11_SDK_VERSION, device, NULL, context);
+	if (FAILED(result))
+	{
+		std::printf("  no WARP device (0x%08lx)\n", (unsigned long)result);
+		return false;
+	}
+	return true;
+}
+
+ID3D11ComputeShader* compileComputeShader(ID3D11Device* device, const wchar_t* filename)
+{
+	ID3DBlob* code = NULL;
+	ID3DBlob* errors = NULL;
+	HRESULT result = D3DCompileFromFile(filename, NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "cs_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &code, &errors);
+	if (errors)
+	{
+		std::printf("%s", (const char*)errors->GetBufferPointer());
+		errors->Release();
+	}
+	if (FAILED(result))
+	{
+		std::printf("  cannot compile %ls (0x%08lx)\n", filename, (unsigned long)result);
+		return NULL;
+	}
+
+	ID3D11ComputeShader* shader = NULL;
+	device->CreateComputeShader(code->GetBufferPointer(), code->GetBufferSize(), NULL, &shader);
+	code->Release();
+	return shader;
+}
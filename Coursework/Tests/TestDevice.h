@@ -0,0 +1,14 @@
+#pragma once
+#ifndef _TEST_DEVICE_H
+#define _TEST_DEVICE_H
+#include <d3d11.h>
+
+//! device of the checks that need one, WARP so they run the same on any machine, without a window or a GPU
+//! the caller releases both, returns false and prints why when no device could be made
+bool createTestDevice(ID3D11Device** device, ID3D11DeviceContext** context);
+
+//! compiles a compute shader of the scene from its source, main as the entry point, null and the errors printed when it fails
+//! shader paths are relative to the working directory, the project directory when Visual Studio starts the tests
+ID3D11ComputeShader* compileComputeShader(ID3D11Device* device, const wchar_t* filename);
+
+#endif
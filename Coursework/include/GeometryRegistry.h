@@ -0,0 +1,71 @@
+/**
+* \class Geometry Registry
+*
+* \brief Hands out shared, reference counted meshes so identical geometry is built and uploaded once
+*
+* Meshes are looked up by a key: the generator and its parameters for the procedural meshes, the hash of the file contents for meshes
+* loaded from a file, so copies of a file share too. The first acquire of a key builds the mesh, the following ones return it and count a hit.
+* Every acquire is matched by a release, the last one deletes the mesh and with it its buffers. Meshes still held are deleted with the registry.
+* Not thread safe, use it from the thread creating the buffers.
+*/
+
+
+#ifndef _GEOMETRYREGISTRY_H_
+#define _GEOMETRYREGISTRY_H_
+
+#include "PlaneMesh.h"
+#include "SphereMesh.h"
+#include "CubeMesh.h"
+#include <functional>
+#include <map>
+#include <string>
+
+class GeometryRegistry
+{
+public:
+	/// Counters since the registry was made.
+	struct Stats
+	{
+		int hits = 0;				///< acquires answered with a mesh already held
+		int misses = 0;				///< acquires that built their mesh
+		int liveMeshes = 0;			///< meshes currently held
+		size_t liveBytes = 0;		///< vertex and index buffers of the meshes currently held
+		size_t bytesSaved = 0;		///< buffers the hits would have created, measured once the meshes have them
+	};
+
+	GeometryRegistry();
+	~GeometryRegistry();
+
+	/** \brief Mesh of the key, built with create on a miss
+	* @param create returns a new mesh, it may create the buffers later (as models loading on another thread do)
+	*/
+	BaseMesh* acquire(const std::string& key, const std::function<BaseMesh*()>& create);
+	PlaneMesh* acquirePlane(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 100, bool packed = false);
+	SphereMesh* acquireSphere(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 20);
+	CubeMesh* acquireCube(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 20);
+
+	/// Drops one reference, the last one deletes the mesh. False for meshes the registry does not hold.
+	bool release(BaseMesh* mesh);
+	/// References to the mesh, 0 if the registry does not hold it.
+	int getReferenceCount(BaseMesh* mesh) const;
+	Stats getStats() const;
+
+	/// Key of a mesh loaded from a file by the importer type, the file name stands in for the contents if it can not be read.
+	static std::string getFileKey(const char* type, const char* filename);
+
+private:
+	struct Entry
+	{
+		BaseMesh* mesh;
+		int references;
+		int hits;
+	};
+
+	std::map<std::string, Entry> entries;
+	std::map<BaseMesh*, std::string> keys;
+	int hits;
+	int misses;
+	size_t releasedBytesSaved;		///< bytes saved by the hits of meshes already deleted
+};
+
+#endif
@@ -0,0 +1,48 @@
+/**
+* \class Horizon Occlusion
+*
+* \brief Ambient occlusion of a heightfield from the horizon angles around every texel, baked on the CPU into a single channel texture
+*
+* For each of a number of azimuths the map is swept along parallel lines a texel apart. Walking a line against the direction, the points
+* already passed are the ones that can rise above the horizon, and only the upper convex hull of them can be the highest, so a stack of it
+* gives every point its horizon in constant time on average, whatever the distance to the occluder.
+* A direction occludes a texel by the sine of its horizon above the sine of the surface slope the same way, as horizon based ambient occlusion does,
+* and the texture holds one minus the average over the directions. The map is not wrapped, nothing past its edges occludes.
+* Lines of a direction are split between threads, each texel is on one line per direction and the directions are summed in order,
+* so the bake is the same whatever the thread count and can be cached by its key.
+*/
+
+
+#ifndef _HORIZONOCCLUSION_H_
+#define _HORIZONOCCLUSION_H_
+
+#include "Heightfield.h"
+#include <vector>
+
+class HorizonOcclusion
+{
+public:
+	/// Parameters of a bake, part of its key.
+	struct Settings
+	{
+		int directions = 16;			///< azimuths swept, evenly spread
+		float heightScale = 50.f;		///< object space height of a sample of 1
+		float texelSize = 1.f;			///< object space distance between neighbouring texels
+	};
+
+	/** \brief Bakes the visibility of every texel, 255 where nothing rises above the surface
+	* @param maxThreads limits the worker count, 0 uses all hardware threads
+	*/
+	static void bake(const Heightfield& heightfield, const Settings& settings, std::vector<unsigned char>& visibility, unsigned int maxThreads = 0);
+	/// Hash of the heights, the settings and the bake version. A cached bake with another key is stale.
+	static unsigned long long getKey(const Heightfield& heightfield, const Settings& settings);
+
+	/// Reads a bake saved with save, false if missing, truncated, of another size or baked with another key.
+	static bool load(const char* cacheFile, unsigned long long key, int width, int height, std::vector<unsigned char>& visibility);
+	static bool save(const char* cacheFile, unsigned long long key, int width, int height, const std::vector<unsigned char>& visibility);
+
+	/// Immutable DXGI_FORMAT_R8_UNORM texture of the visibility, the returned view holds the only reference to it.
+	static ID3D11ShaderResourceView* createTexture(ID3D11Device* device, const unsigned char* visibility, int width, int height);
+};
+
+#endif
@@ -0,0 +1,42 @@
+/**
+* \class Mapped File
+*
+* \brief Read only memory mapped view of a file
+*
+* Maps a whole file into the address space of the process so loaders can parse it in place, without copying it into a string first.
+* The view stays valid until the object is closed or destroyed.
+*/
+
+
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include <windows.h>
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	/// Opens and maps the file, returns false if it does not exist or is empty.
+	bool open(const char* filename);
+	/// Unmaps the view and closes the file handles.
+	void close();
+
+	const char* getData() const { return data; }	///< Returns the start of the mapped file
+	size_t getSize() const { return size; }			///< Returns the file size in bytes
+	bool isOpen() const { return data != nullptr; }
+
+private:
+	// Mapping handles are owned, copying would release them twice.
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	HANDLE file;
+	HANDLE mapping;
+	const char* data;
+	size_t size;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/**
+* \class Mesh Cache
+*
+* \brief Binary baked mesh files, written after the first import and memory mapped afterwards
+*
+* A cache file holds a header, the submesh table, the level of detail table, the meshlet table, the vertex stream and the index stream (already in the GPU index format),
+* so the streams can be handed to D3D11_SUBRESOURCE_DATA straight from the mapped view without any copying.
+* The header stores a hash of the source file contents and the importer flags, a changed source or importer invalidates the file.
+*/
+
+
+#ifndef _MESHCACHE_H_
+#define _MESHCACHE_H_
+
+#include "MappedFile.h"
+#include "MeshUtils.h"
+#include "Meshlets.h"
+#include <directxmath.h>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+/// Range of the index stream drawn as one piece, MeshCache::Submesh. Outside the class so BaseMesh.h can declare it without this header.
+struct MeshSubmesh
+{
+	unsigned int startIndex;
+	unsigned int indexCount;
+	unsigned int materialSlot;		///< material index of the source scene
+	XMFLOAT3 boundsMin;				///< object space box of the range
+	XMFLOAT3 boundsMax;
+};
+
+class MeshCache
+{
+public:
+	typedef MeshSubmesh Submesh;
+
+	/// Range of the index stream holding one level of detail, all levels share the vertex stream.
+	struct Lod
+	{
+		unsigned int startIndex;
+		unsigned int indexCount;
+		float error;		///< simplification error, object space
+	};
+
+	/// Mesh read from or written to a cache file. When loaded, the pointers reference the mapped file.
+	struct MeshData
+	{
+		const void* vertices = nullptr;
+		const void* indices = nullptr;
+		const Submesh* submeshes = nullptr;
+		const Lod* lods = nullptr;
+		const Meshlets::Meshlet* meshlets = nullptr;	///< full detail clusters, ranges of the index stream
+		int vertexCount = 0;
+		int vertexStride = 0;
+		int indexCount = 0;
+		int indexSize = 0;				///< 2 or 4 bytes
+		int submeshCount = 0;
+		int lodCount = 0;
+		int meshletCount = 0;
+		int sourceVertexCount = 0;		///< vertex count before welding, kept for reporting
+		MeshUtils::OptimiseStats optimiseStats;	///< vertex cache numbers of the bake, kept for reporting
+		XMFLOAT3 boundsMin = XMFLOAT3(0.f, 0.f, 0.f);
+		XMFLOAT3 boundsMax = XMFLOAT3(0.f, 0.f, 0.f);
+	};
+
+	/// Cache file used for a source model, the tag tells apart importers sharing a source file.
+	static std::string getCachePath(const char* sourceFile, const char* tag);
+
+	/// 64 bit FNV-1a hash of a block of memory, pass a previous hash to chain blocks.
+	static unsigned long long hashData(const void* data, size_t size, unsigned long long hash = 14695981039346656037ull);
+
+	/// 64 bit FNV-1a hash of the source file contents, combined with the importer flags and the format version. Returns 0 if the file can not be read.
+	static unsigned long long hashSource(const char* sourceFile, unsigned int importerFlags);
+
+	/** \brief Maps a cache file and validates it against the source hash
+	* @param file keeps the mapping alive, the pointers in mesh are valid until it is closed
+	* @return false if the file is missing, truncated or was baked from a different source
+	*/
+	static bool load(const char* cacheFile, unsigned long long sourceHash, MappedFile& file, MeshData& mesh);
+
+	/// Writes the mesh, bounds are computed from the position stored at the start of every vertex.
+	static bool save(const char* cacheFile, unsigned long long sourceHash, MeshData& mesh);
+};
+
+#endif
@@ -0,0 +1,88 @@
+/**
+* \class Meshlets
+*
+* \brief Cluster decomposition of triangle lists and CPU cluster culling
+*
+* A mesh is split into meshlets, connected groups of at most maxTriangles triangles touching at most maxVertices vertices.
+* The triangles of each meshlet are stored next to each other, so every meshlet is a plain range of the index buffer.
+* Each meshlet stores a bounding sphere and a normal cone (Barczak 2016, as in meshoptimizer): when the eye lies inside the
+* cone of back facing directions, every triangle of the meshlet faces away and it can be skipped.
+* Culling runs in the object space of the mesh and emits the surviving meshlets as compacted index ranges for the draw calls.
+* Nothing here touches the device, both passes can be run and measured on the CPU alone.
+*/
+
+
+#ifndef _MESHLETS_H_
+#define _MESHLETS_H_
+
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+class Meshlets
+{
+public:
+	/// One cluster, 64 bytes. Stored as is in the mesh cache.
+	struct Meshlet
+	{
+		unsigned int indexStart;		///< first index of the meshlet in the index buffer
+		unsigned int triangleCount;
+		unsigned int vertexCount;		///< unique vertices referenced
+		float coneCutoff;				///< sine of the cone half angle, above 1 when the normals are too spread out for the cone test
+		XMFLOAT3 centre;				///< bounding sphere, object space
+		float radius;
+		XMFLOAT3 coneApex;
+		float padding0;
+		XMFLOAT3 coneAxis;				///< average triangle normal
+		float padding1;
+	};
+
+	/// Range of the index buffer to draw.
+	struct IndexRange
+	{
+		unsigned int indexStart;
+		unsigned int indexCount;
+	};
+
+	/// Frustum and eye in the object space of the mesh, see makeCullView.
+	struct CullView
+	{
+		XMFLOAT4 planes[6];		///< normalised, inside where dot(plane.xyz, p) + plane.w >= 0
+		XMFLOAT3 eye;			///< eye position, or the unit view direction for orthographic views
+		bool orthographic;
+		float margin;			///< added to every bounding radius, room for vertices the shaders displace
+	};
+
+	/// Meshlets removed by each test in a cull call.
+	struct CullStats
+	{
+		int visible = 0;
+		int frustumCulled = 0;
+		int coneCulled = 0;
+		int ranges = 0;			///< draw calls after merging neighbouring meshlets
+	};
+
+	/** \brief Splits a range of a triangle list into meshlets, appended to meshlets
+	* Triangles inside the range are reordered so every meshlet is a contiguous run of indices. Positions are the first three floats of every vertex.
+	* @param indexStart and indexCount select the range, meshlets never cross its ends (one call per submesh)
+	* @return the number of meshlets added
+	*/
+	static int buildMeshlets(const void* vertices, int vertexCount, int stride, unsigned long* indices, int indexStart, int indexCount,
+		std::vector<Meshlet>& meshlets, int maxVertices = 64, int maxTriangles = 124);
+
+	/// Object space frustum planes and eye of a draw, from the matrices the shaders get.
+	static CullView makeCullView(const XMMATRIX& world, const XMMATRIX& view, const XMMATRIX& projection);
+
+	/** \brief Tests every meshlet against the view and fills ranges with the survivors, neighbours merged into one range
+	* @param coneCulling enables the back face test, only valid for closed meshes while the rasteriser draws both faces
+	*/
+	static CullStats cullMeshlets(const Meshlet* meshlets, int count, const CullView& view, bool coneCulling, std::vector<IndexRange>& ranges);
+
+	/// Sphere against the frustum planes.
+	static bool isSphereVisible(const CullView& view, const XMFLOAT3& centre, float radius);
+	/// True when every triangle of the meshlet faces away from the eye.
+	static bool isBackFacing(const CullView& view, const Meshlet& meshlet);
+};
+
+#endif
@@ -5,6 +5,10 @@
 *
 * Is treated like a standard mesh object, but loads a basic OBJ file based on provided filename.
 * Future version will update/replace this model loader with something more complete.
+* The welded mesh is baked into a cache file next to the OBJ and memory mapped on later loads, until the OBJ changes.
+* Loading is split into a CPU part (load) and a device part (finishLoad), so the first can run on a worker thread.
+* A level of detail chain is simplified from the welded mesh and baked with it, every level is a range of the one index buffer.
+* The full detail level is also split into meshlets for CPU cluster culling, baked as well.
 *
 * \author Paul Robertson
 */
@@ -14,6 +18,8 @@
 #define _MODEL_H_
 
 #include "BaseMesh.h"
+#include "MeshUtils.h"
+#include "MeshCache.h"
 //#include "TokenStream.h"
 #include <vector>
 #include <fstream>
@@ -22,13 +28,6 @@ using namespace DirectX;
 
 class Model : public BaseMesh
 {
-	struct ModelType
-	{
-		float x, y, z;
-		float tu, tv;
-		float nx, ny, nz;
-	};
-
 public:
 	/** \brief Initialises the mesh and vertex list, but loading in from a file
 	* Provide filename to OBJ object, will be loaded and store like other mesh objects.
@@ -37,13 +36,57 @@ public:
 	* @param filename is a char* for filename.
 	*/
 	Model(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* filename);
+	/** \brief Empty model for asynchronous loading
+	* Draws nothing until load has run (on any thread) and finishLoad has created the buffers (on the device thread).
+	*/
+	Model();
 	~Model();
 
+	/// Maps the baked cache, or parses, welds, optimises and bakes the OBJ. CPU only, safe to run on a worker thread.
+	bool load(const char* filename);
+	/// Creates the buffers from the data prepared by load and releases that data. Call on the thread owning the device.
+	void finishLoad(ID3D11Device* device);
+
+	/// Vertex and memory numbers before and after welding, for reporting.
+	const MeshUtils::WeldStats& getWeldStats() const { return weldStats; }
+	/// Vertex cache numbers before and after optimisation, for reporting.
+	const MeshUtils::OptimiseStats& getOptimiseStats() const { return optimiseStats; }
+	bool isFromCache() const { return fromCache; }		///< True if the mesh was mapped from its baked cache file
+	bool isLoaded() const { return loaded; }			///< True once load succeeded, finishLoad does nothing otherwise
+
+	/** \brief Error targets of the generated levels of detail, one level per target
+	* Relative to the bounding radius, in increasing order. Set before load, a different set rebakes the cache.
+	* Levels removing less than a tenth of the triangles of the previous level are skipped.
+	*/
+	void setLodErrors(const std::vector<float>& errors) { lodErrors = errors; }
+	const std::vector<float>& getLodErrors() const { return lodErrors; }
+
+	int getMeshletCount() override { return (int)meshlets.size(); }
+	const Meshlets::Meshlet* getMeshlets() override { return meshlets.data(); }
+
 protected:
 	void initBuffers(ID3D11Device* device);
-	void loadModel(const char* filename);
+	bool loadModel(const char* filename);
+	void processModel();
+	void buildLods(std::vector<unsigned long>& indices);
+	bool loadCache();
 	
-	ModelType* model;
+	std::vector<VertexType> vertices;			///< welded vertices waiting for finishLoad
+	std::vector<unsigned char> packedIndices;	///< indices waiting for finishLoad, 16 or 32 bit
+	int packedIndexSize;
+	std::vector<LevelOfDetail> lodChain;		///< levels of detail waiting for finishLoad
+	std::vector<Meshlets::Meshlet> meshletBuild;	///< meshlets waiting for finishLoad
+	std::vector<Meshlets::Meshlet> meshlets;
+	XMFLOAT3 boundsMin, boundsMax;
+	std::vector<float> lodErrors;
+	MappedFile cache;							///< baked cache mapped between load and finishLoad
+	MeshCache::MeshData cacheMesh;
+	MeshUtils::WeldStats weldStats;
+	MeshUtils::OptimiseStats optimiseStats;
+	std::string cacheFile;
+	unsigned long long sourceHash;
+	bool fromCache;
+	bool loaded;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+/**
+* \class OBJ Loader
+*
+* \brief Multithreaded Wavefront OBJ parser
+*
+* Memory maps the file, splits it into line aligned chunks and parses each chunk on its own thread.
+* Numbers are read with a locale independent parser, the chunks are merged into a single triangle list afterwards.
+* Supports v, vt, vn and faces with any number of corners in the v, v/vt, v//vn and v/vt/vn forms (including negative indices).
+* Faces with more than three corners are triangulated as a fan.
+*/
+
+
+#ifndef _OBJLOADER_H_
+#define _OBJLOADER_H_
+
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+class ObjLoader
+{
+public:
+	/// Single face corner. Indices are zero based, -1 marks a missing attribute.
+	struct Corner
+	{
+		int position;
+		int texture;
+		int normal;
+	};
+
+	/// Parsed file contents, corners are stored as a triangle list (three per triangle).
+	struct ObjData
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT2> texCoords;
+		std::vector<XMFLOAT3> normals;
+		std::vector<Corner> corners;
+
+		void clear();
+	};
+
+	/** \brief Memory maps and parses an OBJ file
+	* @param filename is the path to the OBJ file
+	* @param data receives the parsed geometry
+	* @param maxThreads limits the worker count, 0 uses all hardware threads
+	*/
+	static bool loadFile(const char* filename, ObjData& data, unsigned int maxThreads = 0);
+
+	/// Parses OBJ text already in memory, the buffer does not need to be null terminated.
+	static bool parse(const char* text, size_t size, ObjData& data, unsigned int maxThreads = 0);
+
+	/// Previous fscanf_s based loader, triangles in v/vt/vn form only. Kept as a reference for benchmarking.
+	static bool loadFileScanf(const char* filename, ObjData& data);
+};
+
+#endif
@@ -8,6 +8,7 @@
 #define _SPHEREMESH_H_
 
 #include "BaseMesh.h"
+#include "MeshUtils.h"
 
 using namespace DirectX;
 
@@ -18,9 +19,13 @@ public:
 	SphereMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 20);
 	~SphereMesh();
 
+	/// Vertex cache numbers before and after optimisation, for reporting.
+	const MeshUtils::OptimiseStats& getOptimiseStats() const { return optimiseStats; }
+
 protected:
 	void initBuffers(ID3D11Device* device);
 	int resolution;
+	MeshUtils::OptimiseStats optimiseStats;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+/**
+* \class Terrain Grid Mesh
+*
+* \brief Grid drawn for every node of a TerrainQuadtree
+*
+* Inherits from Base Mesh, builds one square grid of resolution x resolution quads with shared vertices.
+* Positions are integer grid coordinates (x, 0, z) so the vertex shader can place and morph them per node, texture coordinates run from 0 to 1.
+* The indices are stored quadrant by quadrant, so a quarter of the grid is one range of the index buffer.
+*/
+
+
+#ifndef _TERRAINGRIDMESH_H_
+#define _TERRAINGRIDMESH_H_
+
+#include "BaseMesh.h"
+#include "MeshUtils.h"
+
+class TerrainGridMesh : public BaseMesh
+{
+
+public:
+	/** \brief Initialises and builds the grid
+	* @param device is the renderer device
+	* @param device context is the renderer device context
+	* @param resolution is the number of quads along each side, even
+	*/
+	TerrainGridMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int resolution = 16);
+	~TerrainGridMesh();
+
+	int getResolution() const { return resolution; }
+	/// Index range of one quarter, quadrants in x then z order as TerrainQuadtree::Node::quadrant.
+	const Meshlets::IndexRange& getQuadrant(int quadrant) const { return quadrants[quadrant]; }
+
+protected:
+	void initBuffers(ID3D11Device* device);
+	int resolution;
+	Meshlets::IndexRange quadrants[4];
+};
+
+#endif
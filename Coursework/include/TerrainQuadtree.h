@@ -0,0 +1,100 @@
+/**
+* \class Terrain Quadtree
+*
+* \brief Continuous distance dependent level of detail for heightmap terrain (CDLOD, Strugar 2010)
+*
+* The terrain square is split into a quadtree, every node drawn with the same grid of gridResolution quads, so a node covers
+* twice the area of its children at half their density. Nodes are selected by distance: each level has a range, twice the range
+* of the next finer level, and a node is refined while the eye lies within the range of its children. Where only some children are
+* in range, the others are drawn as quarters of the parent grid. Vertices morph onto the next coarser grid towards the end of the range
+* of their level, so neighbouring nodes of different levels meet without cracks.
+* Node bounds come from a min/max pyramid over the heightmap, nodes are frustum culled on the way down.
+* Nothing here touches the device, selection can be run and measured on the CPU alone.
+*/
+
+
+#ifndef _TERRAINQUADTREE_H_
+#define _TERRAINQUADTREE_H_
+
+#include "Meshlets.h"
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+class TerrainQuadtree
+{
+public:
+	static const int k_MaxLods = 12;
+
+	struct Settings
+	{
+		float size = 100.f;				///< side of the terrain square, object space x and z run from 0 to size
+		float maxHeight = 50.f;			///< object space height of a heightmap sample of 1
+		int gridResolution = 16;		///< quads along the side of every node, even
+		int lodCount = 5;				///< levels of the tree, level 0 is the finest and lodCount - 1 the root
+		float leafRange = 16.f;			///< distance up to which level 0 is drawn, every coarser level doubles it. Below about twice the size of a level 0 node, neighbours can be two levels apart and crack
+		float morphRatio = 0.7f;		///< share of a level's range after which its vertices morph to the coarser grid
+	};
+
+	/// Selected node, drawn with the grid scaled to size and placed at (x, z).
+	struct Node
+	{
+		float x, z;			///< corner of the node with the smallest coordinates
+		float size;
+		int lod;
+		int quadrant;		///< -1 draws the whole grid, 0 to 3 only that quarter (x then z order) as the rest is drawn finer
+		float morphStart;	///< eye distances over which the vertices move onto the coarser grid
+		float morphEnd;
+		float minY, maxY;	///< object space height bounds
+	};
+
+	/// Nodes and triangles of one selection.
+	struct SelectionStats
+	{
+		int visited = 0;
+		int selected = 0;
+		int culled = 0;			///< nodes outside the frustum, whole subtrees skipped
+		int triangles = 0;		///< submitted with the selected nodes
+	};
+
+	TerrainQuadtree();
+
+	/** \brief Sets up the levels and builds the node bounds
+	* @param heights is an optional row major width x height heightmap of normalised samples, row 0 at z = 0. Without it every node spans 0 to maxHeight
+	* @param texelScale is the part of the heightmap covering the terrain, 1 maps its whole width onto size
+	* @param uvOffset is the uv of the terrain origin, the shader samples at position / size * texelScale + uvOffset
+	*/
+	void build(const Settings& settings, const float* heights = nullptr, int width = 0, int height = 0, float texelScale = 1.f, float uvOffset = 0.f);
+
+	/** \brief Selects the nodes to draw for one view, replaces the contents of nodes
+	* @param view culls in object space, see Meshlets::makeCullView
+	* @param eye is the object space position ranges are measured from, the camera even for shadow views
+	* @param lodBias divides the ranges, above 1 selects coarser nodes
+	*/
+	SelectionStats select(const Meshlets::CullView& view, const XMFLOAT3& eye, float lodBias, std::vector<Node>& nodes) const;
+
+	const Settings& getSettings() const { return settings; }
+	float getRange(int lod) const { return ranges[lod]; }
+	int getTrianglesPerNode() const { return settings.gridResolution * settings.gridResolution * 2; }
+
+	/// Box against the frustum planes, conservative.
+	static bool isBoxVisible(const Meshlets::CullView& view, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax);
+	/// Whether a sphere around the eye reaches into the box.
+	static bool isBoxInRange(const XMFLOAT3& eye, float range, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax);
+
+private:
+	enum class Result { OutOfRange, Culled, Selected };
+
+	Result selectNode(int lod, int nodeX, int nodeZ, const Meshlets::CullView& view, const XMFLOAT3& eye, const float* lodRanges,
+		std::vector<Node>& nodes, SelectionStats& stats) const;
+	void addNode(int lod, int nodeX, int nodeZ, int quadrant, const float* lodRanges, std::vector<Node>& nodes, SelectionStats& stats) const;
+	float getNodeSize(int lod) const { return settings.size / (float)(1 << (settings.lodCount - 1 - lod)); }
+	const XMFLOAT2& getBounds(int lod, int nodeX, int nodeZ) const;
+
+	Settings settings;
+	float ranges[k_MaxLods];
+	std::vector<XMFLOAT2> bounds[k_MaxLods];	///< min and max height of every node, per level, row major
+};
+
+#endif
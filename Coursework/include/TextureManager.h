@@ -15,6 +15,9 @@
 #include <fstream>
 #include <vector>
 #include <map>
+#include <functional>
+#include <future>
+#include "ThreadPool.h"
 //#include "Texture.h"
 
 using namespace DirectX;
@@ -22,17 +25,57 @@ using namespace DirectX;
 class TextureManager
 {
 public:
+	// Called on the thread running update, once the texture shows its image.
+	typedef std::function<void(const wchar_t* uid, ID3D11ShaderResourceView* texture)> LoadedCallback;
+
 	TextureManager(ID3D11Device* device, ID3D11DeviceContext* deviceContext);
 	~TextureManager();
 
 	void loadTexture(const wchar_t* uid, const wchar_t* filename);
 	ID3D11ShaderResourceView* getTexture(const wchar_t* uid);
 
+	// Asynchronous loading. The view is created and registered right away, showing plain white until update uploads the image.
+	// It never changes afterwards, so it can be handed out immediately. The image is decoded with WIC on the pool.
+	// DDS files are loaded synchronously.
+	ID3D11ShaderResourceView* loadTextureAsync(const wchar_t* uid, const wchar_t* filename, ThreadPool& pool, LoadedCallback onLoaded = nullptr);
+	// Uploads the images decoded so far and generates their mipmaps. Call on the thread owning the device context, returns the number still loading.
+	int update();
+	bool isLoaded(const wchar_t* uid);
+	// Blocks until the texture is uploaded, uploading other finished images meanwhile.
+	void waitFor(const wchar_t* uid);
+
+	// Decodes an image to 32 bit RGBA on the calling thread, for CPU side use of image data such as heightmaps. False if it cannot be read.
+	static bool readImagePixels(const wchar_t* filename, std::vector<unsigned char>& pixels, unsigned int& width, unsigned int& height);
+
 private:
+	// Image decoded on a worker, 32 bit RGBA.
+	struct DecodedImage
+	{
+		std::vector<unsigned char> pixels;
+		unsigned int width = 0;
+		unsigned int height = 0;
+	};
+
+	struct PendingTexture
+	{
+		std::wstring uid;
+		std::wstring filename;
+		ID3D11Texture2D* texture;
+		ID3D11ShaderResourceView* view;
+		std::future<DecodedImage> image;
+		LoadedCallback onLoaded;
+	};
+
+	static bool readImageSize(const wchar_t* filename, unsigned int& width, unsigned int& height);
+	static DecodedImage decodeImage(const std::wstring& filename);
+	void uploadTexture(PendingTexture& pending);
+
 	bool does_file_exist(const wchar_t *fileName);
 	void generateTexture(ID3D11Device* device);
 	void addDefaultTexture();
 
+	std::vector<PendingTexture> pendingTextures;
+
 	ID3D11ShaderResourceView* texture;
 	ID3D11Device* device;
 	ID3D11DeviceContext* deviceContext;
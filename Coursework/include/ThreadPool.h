@@ -0,0 +1,103 @@
+/**
+* \class Thread Pool
+*
+* \brief Fixed set of worker threads running queued jobs
+*
+* Jobs run in submission order on whichever worker is free, each submit returns a future for the result of the job.
+* Used for loading work that must not block the thread owning the device context (file IO, image decoding, model processing).
+* shared() is the pool of the framework's parallel loops, see runParallel.
+* The destructor finishes the queued jobs before joining the workers.
+*/
+
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	/// Starts the workers, 0 uses one per hardware thread.
+	ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	/// Queues a job, the future receives its return value or the exception it threw.
+	template<class F>
+	std::future<typename std::result_of<F()>::type> submit(F job)
+	{
+		typedef typename std::result_of<F()>::type Result;
+		std::shared_ptr<std::packaged_task<Result()>> task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+		std::future<Result> result = task->get_future();
+		enqueue([task]() { (*task)(); });
+		return result;
+	}
+
+	/// Runs job(0..count-1) and returns once all of them are done, job(0) on the calling thread and the others on the workers.
+	/// A job must not call it on the pool running it, every worker could end up waiting on jobs queued behind it.
+	template<class Job>
+	void runParallel(size_t count, Job job)
+	{
+		std::vector<std::future<void>> results;
+		results.reserve(count);
+		for (size_t i = 1; i < count; i++)
+		{
+			results.push_back(submit([job, i]() { job(i); }));
+		}
+
+		// The other jobs may use the caller's locals, they have to end before an exception leaves.
+		try
+		{
+			if (count > 0)
+			{
+				job(0);
+			}
+		}
+		catch (...)
+		{
+			for (auto& result : results)
+			{
+				result.wait();
+			}
+			throw;
+		}
+
+		for (auto& result : results)
+		{
+			result.wait();
+		}
+		for (auto& result : results)
+		{
+			result.get();
+		}
+	}
+
+	/// Pool of the framework's parallel loops, one worker per hardware thread, started on first use.
+	static ThreadPool& shared();
+
+	unsigned int getThreadCount() const { return (unsigned int)workers.size(); }
+
+private:
+	// Workers and the queue are owned, a copy would join them twice.
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	void enqueue(std::function<void()> job);
+	void workerLoop();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping;
+};
+
+#endif
@@ -3,6 +3,7 @@
     By Allen Sherrod and Wendy Jones
 
     TokenStream - Used to return blocks of text in a file.
+    Superseded by TokenScanner, which scans the text in place without copying it.
 */
 
 
@@ -0,0 +1,84 @@
+/**
+* \class Vertex Packing
+*
+* \brief Quantised 16 byte vertex format and its CPU encoder/decoder
+*
+* Packs the 32 byte position, texture, normal vertex into half the size:
+* positions are stored as unorm16 relative to the mesh bounds (dequantised in the vertex shader with the mesh Quantisation),
+* texture coordinates as half floats and normals octahedral encoded in two snorm16 values.
+* The matching input layout is created by BaseShader::loadPackedVertexShader, the shaders decode with PACKED_VERTEX defined.
+*/
+
+
+#ifndef _VERTEXPACKING_H_
+#define _VERTEXPACKING_H_
+
+#include <directxmath.h>
+
+using namespace DirectX;
+
+class VertexPacking
+{
+public:
+	/// Full precision vertex, same layout as BaseMesh::VertexType.
+	struct Vertex
+	{
+		XMFLOAT3 position;
+		XMFLOAT2 texture;
+		XMFLOAT3 normal;
+	};
+
+	/// Packed vertex, 16 bytes. Matches R16G16B16A16_UNORM, R16G16_FLOAT and R16G16_SNORM in the input layout.
+	struct PackedVertex
+	{
+		unsigned short position[4];		///< unorm16 relative to the bounds, w is always 1
+		unsigned short texture[2];		///< half floats
+		short normal[2];				///< octahedral, snorm16
+	};
+
+	/// Maps unorm positions back to object space, position = offset + unorm * scale. Same layout as the shader constant buffer.
+	struct Quantisation
+	{
+		XMFLOAT3 offset = XMFLOAT3(0.f, 0.f, 0.f);
+		float padding0 = 0.f;
+		XMFLOAT3 scale = XMFLOAT3(0.f, 0.f, 0.f);
+		float padding1 = 0.f;
+	};
+
+	/// Largest difference between a vertex and its packed version.
+	struct ErrorBounds
+	{
+		float position = 0.f;		///< object space units, per axis
+		float texture = 0.f;		///< uv units
+		float normalDegrees = 0.f;	///< angle between the normals
+	};
+
+	/// Quantisation covering the bounds of the positions. Flat axes get a scale of 0 and decode exactly.
+	static Quantisation computeQuantisation(const Vertex* vertices, int count);
+
+	/** \brief Guaranteed worst case error of packing with the given quantisation
+	* @param maxTexture is the largest absolute texture coordinate of the mesh, half float precision depends on magnitude
+	*/
+	static ErrorBounds getErrorBounds(const Quantisation& quantisation, float maxTexture);
+
+	/// Largest absolute texture coordinate of the vertices, for getErrorBounds.
+	static float getMaxTexture(const Vertex* vertices, int count);
+
+	static void packVertices(const Vertex* vertices, int count, const Quantisation& quantisation, PackedVertex* packed);
+	static void unpackVertices(const PackedVertex* packed, int count, const Quantisation& quantisation, Vertex* vertices);
+
+	/// Error actually introduced by packing the vertices, should stay within getErrorBounds.
+	static ErrorBounds measureError(const Vertex* vertices, const PackedVertex* packed, int count, const Quantisation& quantisation);
+
+	// Component codecs, decoding follows the D3D format conversion rules so CPU and GPU agree.
+	static unsigned short encodeUnorm16(float value);
+	static float decodeUnorm16(unsigned short value);
+	static short encodeSnorm16(float value);
+	static float decodeSnorm16(short value);
+	static unsigned short encodeHalf(float value);
+	static float decodeHalf(unsigned short value);
+	static void encodeOctahedral(const XMFLOAT3& normal, short encoded[2]);
+	static XMFLOAT3 decodeOctahedral(const short encoded[2]);
+};
+
+#endif
@@ -0,0 +1,55 @@
+/**
+* \class Water Mesh
+*
+* \brief Water surface over a heightfield, with quads only where the water can be seen above the terrain
+*
+* Inherits from Base Mesh. The grid is the one of PlaneMesh, resolution x resolution vertices one unit apart with the same texture
+* coordinates, but a quad is only kept while the lowest terrain under it, plus a margin for the waves and the terrain level of detail,
+* is below the water. The ring of quads around the kept ones is kept as well, so the shore is never cut short.
+* The lowest terrain under every quad is found once, moving the water up or down rebuilds the buffers from it without the heightfield.
+* Only translations between the water and the terrain are supported, as the scene uses.
+*/
+
+
+#ifndef _WATERMESH_H_
+#define _WATERMESH_H_
+
+#include "BaseMesh.h"
+#include "Heightfield.h"
+#include <vector>
+
+class WaterMesh : public BaseMesh
+{
+
+public:
+	/// Placement of the water grid over the heightfield.
+	struct Settings
+	{
+		int resolution = 100;				///< vertices along each side, as PlaneMesh
+		XMFLOAT2 terrainOffset = XMFLOAT2(0.f, 0.f);	///< x and z of the water origin in terrain object space
+		float uvPerUnit = 0.01f;			///< heightmap uv per terrain object space unit
+		float heightScale = 50.f;			///< terrain height of a heightmap sample of 1
+		float margin = 0.5f;				///< quads are kept while the terrain is less than this above the water
+	};
+
+	/** \brief Finds the terrain under every quad and builds the mesh
+	* @param level is the height of the water in terrain object space
+	*/
+	WaterMesh(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const Heightfield& heightfield, const Settings& settings, float level);
+	~WaterMesh();
+
+	/// Rebuilds the buffers when the level differs from the current one.
+	void setLevel(ID3D11Device* device, float level);
+	float getLevel() const { return level; }
+	int getQuadCount();
+	/// Quads of the full plane, (resolution - 1)^2.
+	int getFullQuadCount() const { return (settings.resolution - 1) * (settings.resolution - 1); }
+
+protected:
+	void initBuffers(ID3D11Device* device);
+	Settings settings;
+	float level;
+	std::vector<float> quadFloors;		///< lowest terrain under every quad, row major
+};
+
+#endif